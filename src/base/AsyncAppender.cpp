@@ -0,0 +1,502 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+#include "AsyncAppender.ih"
+
+namespace controlbox {
+
+AsyncLogger * AsyncLogger::d_instance = 0;
+volatile int AsyncLogger::d_active = 0;
+volatile int AsyncLogger::d_forwarding = 0;
+pthread_t AsyncLogger::d_thread;
+
+/// Copy a string into a fixed size buffer, truncating it if required
+static void copyString(char * dst, std::string const & src, size_t size) {
+	size_t l_len = src.size();
+
+	if ( l_len >= size ) {
+		l_len = size-1;
+	}
+	memcpy(dst, src.data(), l_len);
+	dst[l_len] = 0;
+
+}
+
+AsyncAppender::AsyncAppender(std::string const & name, AsyncLogger * logger,
+				t_targets const & targets) :
+	log4cpp::AppenderSkeleton(name),
+	d_logger(logger),
+	d_targets(targets) {
+}
+
+AsyncAppender::~AsyncAppender() {
+}
+
+void AsyncAppender::_append(log4cpp::LoggingEvent const & event) {
+
+	d_logger->push(this, event);
+
+}
+
+void AsyncAppender::forward(log4cpp::LoggingEvent const & event) {
+	t_targets::iterator l_it;
+
+	for (l_it = d_targets.begin(); l_it != d_targets.end(); l_it++) {
+		(*l_it)->doAppend(event);
+	}
+
+}
+
+bool AsyncAppender::reopen() {
+	return true;
+}
+
+void AsyncAppender::close() {
+}
+
+bool AsyncAppender::requiresLayout() const {
+	return false;
+}
+
+void AsyncAppender::setLayout(log4cpp::Layout * layout) {
+}
+
+AsyncLogger::AsyncLogger(unsigned int ringSize, std::string const & logName) :
+	Object(logName),
+	d_ringSize(1),
+	d_wakeup(0),
+	d_idle(0),
+	d_written(0),
+	d_dropped(0),
+	d_spilled(0),
+	d_truncated(0),
+	d_lastReport(0),
+	d_doExit(false),
+	d_tid(0) {
+
+	LOG4CPP_DEBUG(log, "AsyncLogger::AsyncLogger(ringSize=%u)", ringSize);
+
+	// Rounding up to a power of two, thus rings are indexed by masking
+	while ( d_ringSize < ringSize ) {
+		d_ringSize <<= 1;
+	}
+
+	pthread_key_create(&d_key, AsyncLogger::closeRing);
+
+}
+
+AsyncLogger * AsyncLogger::getInstance(unsigned int ringSize) {
+
+	if ( !d_instance ) {
+		d_instance = new AsyncLogger(ringSize);
+		// Appenders are guarded once the thread is running
+		d_instance->start();
+		d_instance->install();
+	}
+
+	return d_instance;
+}
+
+AsyncLogger::~AsyncLogger() {
+
+	LOG4CPP_DEBUG(log, "AsyncLogger::~AsyncLogger()");
+
+	shutdown();
+
+}
+
+void AsyncLogger::install() {
+	std::vector<log4cpp::Category *> * l_categories;
+	std::vector<log4cpp::Category *>::iterator l_cat;
+	log4cpp::AppenderSet l_appenders;
+	log4cpp::AppenderSet l_guarded;
+	log4cpp::AppenderSet::iterator l_app;
+	log4cpp::Filter * l_filter;
+	unsigned int l_count = 0;
+
+	l_categories = log4cpp::Category::getCurrentCategories();
+
+	for (l_cat = l_categories->begin(); l_cat != l_categories->end(); l_cat++) {
+
+		l_appenders = (*l_cat)->getAllAppenders();
+		if ( l_appenders.empty() ) {
+			continue;
+		}
+
+		for (l_app = l_appenders.begin(); l_app != l_appenders.end(); l_app++) {
+			if ( !l_guarded.insert(*l_app).second ) {
+				// Appender shared with an already guarded Category
+				continue;
+			}
+			// Chaining at the end: setFilter releases configured filters
+			l_filter = (*l_app)->getFilter();
+			if ( l_filter ) {
+				l_filter->appendChainedFilter(new Guard());
+			} else {
+				(*l_app)->setFilter(new Guard());
+			}
+		}
+
+		// The AsyncAppender is owned by the Category
+		(*l_cat)->addAppender(new AsyncAppender((*l_cat)->getName() + "_async",
+					this, AsyncAppender::t_targets(l_appenders.begin(),
+						l_appenders.end())));
+		l_count++;
+
+	}
+
+	delete l_categories;
+
+	LOG4CPP_INFO(log, "Asynchronous logging on [%u] categories, [%u] appenders, rings of [%u] records",
+			l_count, l_guarded.size(), d_ringSize);
+
+	atomicSet(&d_active, 1);
+
+}
+
+void AsyncLogger::shutdown() {
+	t_rings::iterator l_it;
+	t_stats l_stats;
+
+	if ( !atomicRead(&d_active) ) {
+		return;
+	}
+
+	LOG4CPP_DEBUG(log, "AsyncLogger::shutdown()");
+
+	// Appenders are called synchronously from now on
+	atomicSet(&d_active, 0);
+
+	// Waiting for records being filled
+	d_ringsLock.enterMutex();
+	for (l_it = d_rings.begin(); l_it != d_rings.end(); l_it++) {
+		while ( atomicRead(&(*l_it)->busy) ) {
+			ost::Thread::yield();
+		}
+	}
+	d_ringsLock.leaveMutex();
+
+	// Terminating the thread, which writes all the buffered records
+	d_doExit = true;
+	d_wakeup.post();
+	join();
+
+	getStats(l_stats);
+	LOG4CPP_INFO(log, "AsyncLogger stats: written=%lu, dropped=%lu, spilled=%lu, truncated=%lu, rings=%u",
+			l_stats.written, l_stats.dropped, l_stats.spilled,
+			l_stats.truncated, l_stats.rings);
+
+}
+
+void AsyncLogger::getStats(t_stats & stats) {
+
+	stats.written = d_written;
+	stats.dropped = d_dropped;
+	stats.spilled = d_spilled;
+	stats.truncated = d_truncated;
+	stats.ringSize = d_ringSize;
+
+	d_ringsLock.enterMutex();
+	stats.rings = d_rings.size();
+	d_ringsLock.leaveMutex();
+
+}
+
+AsyncLogger::t_ring * AsyncLogger::ring() {
+	t_ring * l_ring;
+
+	l_ring = (t_ring *)pthread_getspecific(d_key);
+	if ( l_ring ) {
+		return l_ring;
+	}
+
+	if ( !atomicRead(&d_active) ) {
+		return 0;
+	}
+
+	l_ring = new t_ring;
+	l_ring->records = new t_record[d_ringSize];
+	l_ring->head = 0;
+	l_ring->tail = 0;
+	l_ring->drops = 0;
+	l_ring->reported = 0;
+	l_ring->busy = 0;
+	l_ring->closed = 0;
+	l_ring->tid = syscall(SYS_gettid);
+
+	d_ringsLock.enterMutex();
+	d_rings.push_back(l_ring);
+	d_ringsLock.leaveMutex();
+
+	pthread_setspecific(d_key, l_ring);
+
+	return l_ring;
+
+}
+
+void AsyncLogger::closeRing(void * ring) {
+
+	// Released by the AsyncLogger thread once written
+	atomicSet(&((t_ring *)ring)->closed, 1);
+
+}
+
+bool AsyncLogger::push(AsyncAppender * appender, log4cpp::LoggingEvent const & event) {
+	t_ring * l_ring;
+	t_record * l_record;
+	unsigned int l_head;
+
+	l_ring = ring();
+	if ( !l_ring ) {
+		return false;
+	}
+
+	// Flagging the record filling, thus shutdown could wait for it
+	atomicSet(&l_ring->busy, 1);
+	if ( !atomicRead(&d_active) ) {
+		atomicSet(&l_ring->busy, 0);
+		return false;
+	}
+
+	l_head = l_ring->head;
+	if ( l_head - atomicRead(&l_ring->tail) >= d_ringSize ) {
+		l_ring->drops++;
+		atomicSet(&l_ring->busy, 0);
+		return false;
+	}
+
+	l_record = &l_ring->records[l_head & (d_ringSize-1)];
+	l_record->appender = appender;
+	l_record->priority = event.priority;
+	l_record->sec = event.timeStamp.getSeconds();
+	l_record->usec = event.timeStamp.getMicroSeconds();
+	copyString(l_record->thread, event.threadName, ASYNCLOGGER_THREAD_SIZE);
+	if ( !store(l_record->category, ASYNCLOGGER_CATEGORY_SIZE,
+				l_record->longCategory, event.categoryName) ||
+			!store(l_record->message, ASYNCLOGGER_MESSAGE_SIZE,
+				l_record->longMessage, event.message) ) {
+		atomicInc(&d_truncated);
+	}
+	if ( l_record->longCategory || l_record->longMessage ) {
+		atomicInc(&d_spilled);
+	}
+
+	// Publishing the record
+	atomicSet(&l_ring->head, l_head+1);
+	atomicSet(&l_ring->busy, 0);
+
+	// Waking up the AsyncLogger thread only if it's idle
+	if ( atomicCAS(&d_idle, 1, 0) ) {
+		d_wakeup.post();
+	}
+
+	return true;
+
+}
+
+bool AsyncLogger::pending() {
+	t_rings::iterator l_it;
+	bool l_pending = false;
+
+	d_ringsLock.enterMutex();
+	for (l_it = d_rings.begin(); l_it != d_rings.end(); l_it++) {
+		if ( atomicRead(&(*l_it)->head) != (*l_it)->tail ) {
+			l_pending = true;
+			break;
+		}
+	}
+	d_ringsLock.leaveMutex();
+
+	return l_pending;
+
+}
+
+bool AsyncLogger::store(char * buffer, size_t size, char * & spill,
+				std::string const & str) {
+	size_t l_len = str.size();
+	size_t l_keep;
+
+	spill = 0;
+	if ( l_len < size ) {
+		memcpy(buffer, str.data(), l_len);
+		buffer[l_len] = 0;
+		return true;
+	}
+
+	spill = new (std::nothrow) char[l_len+1];
+	if ( spill ) {
+		memcpy(spill, str.data(), l_len);
+		spill[l_len] = 0;
+		return true;
+	}
+
+	// Out of memory: keeping what fits, marking the truncation
+	l_keep = size - sizeof(ASYNCLOGGER_TRUNCATED);
+	memcpy(buffer, str.data(), l_keep);
+	memcpy(buffer+l_keep, ASYNCLOGGER_TRUNCATED, sizeof(ASYNCLOGGER_TRUNCATED));
+	return false;
+
+}
+
+void AsyncLogger::write(t_record & record) {
+	log4cpp::LoggingEvent l_event(
+			record.longCategory ? record.longCategory : record.category,
+			record.longMessage ? record.longMessage : record.message,
+			"", record.priority);
+
+	l_event.threadName = record.thread;
+	l_event.timeStamp = log4cpp::TimeStamp(record.sec, record.usec);
+
+	// Only this thread reads the flag set
+	d_forwarding = 1;
+	record.appender->forward(l_event);
+	d_forwarding = 0;
+
+	delete [] record.longCategory;
+	delete [] record.longMessage;
+	record.longCategory = 0;
+	record.longMessage = 0;
+
+}
+
+unsigned int AsyncLogger::drain() {
+	std::vector<t_ring *>::iterator l_it;
+	t_ring * l_ring;
+	unsigned int l_head;
+	unsigned int l_tail;
+	unsigned long l_drops;
+	unsigned long long l_now;
+	bool l_report;
+	unsigned int l_count = 0;
+
+	// Rate limiting drops reports, which are buffered records too
+	l_now = Utils::monotonicUsec();
+	l_report = d_doExit ||
+		(l_now - d_lastReport) >= (ASYNCLOGGER_REPORT_PERIOD * 1000ULL);
+
+	// Scanning a copy, thus new threads don't wait for the writes
+	d_ringsLock.enterMutex();
+	d_scan.assign(d_rings.begin(), d_rings.end());
+	d_ringsLock.leaveMutex();
+
+	for (l_it = d_scan.begin(); l_it != d_scan.end(); l_it++) {
+		l_ring = (*l_it);
+
+		l_head = atomicRead(&l_ring->head);
+		for (l_tail = l_ring->tail; l_tail != l_head; l_tail++) {
+			write(l_ring->records[l_tail & (d_ringSize-1)]);
+			l_count++;
+		}
+
+		// Releasing the written records
+		atomicSet(&l_ring->tail, l_tail);
+
+		l_drops = l_ring->drops;
+		if ( l_drops != l_ring->reported &&
+				(l_report || atomicRead(&l_ring->closed)) ) {
+			LOG4CPP_WARN(log, "Thread [%d] logging too fast, [%lu] records dropped",
+					l_ring->tid, l_drops - l_ring->reported);
+			d_dropped += l_drops - l_ring->reported;
+			l_ring->reported = l_drops;
+			d_lastReport = l_now;
+		}
+
+		// Releasing the rings of terminated threads
+		if ( atomicRead(&l_ring->closed) &&
+				atomicRead(&l_ring->head) == l_tail ) {
+			d_ringsLock.enterMutex();
+			d_rings.remove(l_ring);
+			d_ringsLock.leaveMutex();
+			delete [] l_ring->records;
+			delete l_ring;
+		}
+
+	}
+
+	d_written += l_count;
+
+	return l_count;
+
+}
+
+void AsyncLogger::run(void) {
+	controlbox::ThreadDB *l_tdb = ThreadDB::getInstance();
+
+	d_tid = syscall(SYS_gettid);
+	d_thread = pthread_self();
+	LOG4CPP_INFO(log, "Thread [%s (%d)] started", "LOG", d_tid);
+
+	this->setName("LOG");
+	l_tdb->registerThread(this, d_tid);
+
+	while ( !d_doExit ) {
+
+		if ( drain() ) {
+			continue;
+		}
+
+		// Going idle: loggers will wake us up once new records are buffered
+		atomicSet(&d_idle, 1);
+
+		// Double checking for records buffered before the idle flag was set
+		if ( pending() ) {
+			if ( atomicCAS(&d_idle, 1, 0) ) {
+				continue;
+			}
+			// A logger has already posted a wakeup: consuming it
+		}
+
+		d_wakeup.wait();
+
+	}
+
+	// Writing any still buffered record
+	drain();
+
+	LOG4CPP_WARN(log, "Thread [%s (%d)] terminated", this->getName(), d_tid);
+	l_tdb->unregisterThread(this);
+
+}
+
+log4cpp::Filter::Decision AsyncLogger::Guard::_decide(log4cpp::LoggingEvent const & event) {
+
+	// Appenders are called synchronously once shut down
+	if ( !atomicRead(&AsyncLogger::d_active) ) {
+		return log4cpp::Filter::NEUTRAL;
+	}
+
+	if ( pthread_equal(pthread_self(), AsyncLogger::d_thread) &&
+			AsyncLogger::d_forwarding ) {
+		return log4cpp::Filter::NEUTRAL;
+	}
+
+	return log4cpp::Filter::DENY;
+
+}
+
+}// controlbox namespace
@@ -0,0 +1,321 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _ASYNCAPPENDER_H
+#define _ASYNCAPPENDER_H
+
+#include <controlbox/base/Object.h>
+#include <controlbox/base/Utility.h>
+#include <cc++/thread.h>
+#include <log4cpp/AppenderSkeleton.hh>
+#include <log4cpp/Filter.hh>
+#include <pthread.h>
+#include <list>
+#include <vector>
+
+/// The default number of log records buffered by each thread
+#define ASYNCLOGGER_RING_SIZE		128
+
+/// The message buffer size of a record, longer messages are spilled to the
+/// heap
+#define ASYNCLOGGER_MESSAGE_SIZE	256
+
+/// The category name buffer size of a record, longer names are spilled to
+/// the heap
+#define ASYNCLOGGER_CATEGORY_SIZE	48
+
+/// The mark ending a string truncated because it could not be spilled
+#define ASYNCLOGGER_TRUNCATED		"[...]"
+
+/// The maximum length of a buffered thread name
+#define ASYNCLOGGER_THREAD_SIZE		16
+
+/// The minimum time between two reports of dropped records [ms]
+#define ASYNCLOGGER_REPORT_PERIOD	1000
+
+namespace controlbox {
+
+class AsyncLogger;
+
+/// A log4cpp appender deferring the output to the AsyncLogger thread.
+/// An AsyncAppender is attached by the AsyncLogger to each configured
+/// Category, in front of the appenders defined by the logger configuration
+/// (the targets): logged events are just copied into the calling thread
+/// ring, the targets are called only by the AsyncLogger thread.
+class AsyncAppender : public log4cpp::AppenderSkeleton {
+
+public:
+
+    /// The appenders served by an AsyncAppender
+    typedef std::vector<log4cpp::Appender *> t_targets;
+
+protected:
+
+    /// The logger buffering the events
+    AsyncLogger * d_logger;
+
+    /// The appenders to forward events to
+    t_targets d_targets;
+
+public:
+
+    /// Build a new AsyncAppender
+    /// @param name the appender name
+    /// @param logger the logger buffering the events
+    /// @param targets the appenders to forward events to; they are still
+    ///		owned by their Category
+    AsyncAppender(std::string const & name, AsyncLogger * logger,
+    			t_targets const & targets);
+
+    ~AsyncAppender();
+
+    /// Forward an event to the targets.
+    /// This method is called by the AsyncLogger thread.
+    void forward(log4cpp::LoggingEvent const & event);
+
+    /// Targets are reopened by log4cpp itself
+    bool reopen();
+
+    /// Targets are closed by log4cpp itself
+    void close();
+
+    /// Events are formatted by the targets
+    bool requiresLayout() const;
+
+    /// Layouts are ignored
+    void setLayout(log4cpp::Layout * layout);
+
+protected:
+
+    /// Buffer an event into the calling thread ring
+    void _append(log4cpp::LoggingEvent const & event);
+
+};
+
+/// A background writer for log4cpp events.
+/// The AsyncLogger is a singleton thread running the logging I/O on behalf
+/// of all the other threads, thus a slow console, file or syslog never
+/// stalls a device thread.<br>
+/// Each thread logs into its own single-producer/single-consumer ring of
+/// preformatted records, allocated on its first log and released once the
+/// thread has terminated: buffering a record doesn't lock nor allocate,
+/// unless the message or the category name is too long for the record
+/// buffers and it's spilled to the heap.
+/// Still log4cpp formats the message, builds the event and locks the
+/// Category appenders before calling the AsyncAppender.
+/// When a ring is full new records are dropped and counted, drops are then
+/// reported by the AsyncLogger thread.<br>
+/// At installation an AsyncAppender is attached to each configured Category
+/// while a filter is added to the configured appenders to discard events
+/// not forwarded by the AsyncLogger thread: appenders are still owned and
+/// managed by log4cpp.
+/// @note an appender with its own filters accepting events is still called
+///		synchronously by the logging thread.
+/// @note events logged by Categories built after the installation are
+///		buffered only if the Category has no own appenders.
+class AsyncLogger : public Object, public ost::PosixThread {
+
+public:
+
+    /// Logging statistics
+    struct stats {
+        unsigned long written;		///< Records written
+        unsigned long dropped;		///< Records dropped on full rings
+        unsigned long spilled;		///< Records with strings spilled to the heap
+        unsigned long truncated;	///< Records truncated on spill failures
+        unsigned int rings;		///< Threads rings allocated
+        unsigned int ringSize;		///< Records buffered by each ring
+    };
+    typedef struct stats t_stats;
+
+protected:
+
+    /// A buffered log record
+    struct record {
+        AsyncAppender * appender;
+        log4cpp::Priority::Value priority;
+        int sec;
+        int usec;
+        char thread[ASYNCLOGGER_THREAD_SIZE];
+        char category[ASYNCLOGGER_CATEGORY_SIZE];
+        char message[ASYNCLOGGER_MESSAGE_SIZE];
+        /// The category name not fitting its buffer, 0 otherwise
+        char * longCategory;
+        /// The message not fitting its buffer, 0 otherwise
+        char * longMessage;
+    };
+    typedef struct record t_record;
+
+    /// A thread records ring.
+    /// head is updated only by the logging thread, tail only by the
+    /// AsyncLogger thread.
+    struct ring {
+        t_record * records;
+        volatile unsigned int head;
+        volatile unsigned int tail;
+        /// Records dropped on full ring
+        volatile unsigned long drops;
+        /// Drops already reported
+        unsigned long reported;
+        /// Set while the logging thread is filling a record
+        volatile int busy;
+        /// Set once the logging thread has terminated
+        volatile int closed;
+        /// The logging thread ID
+        int tid;
+    };
+    typedef struct ring t_ring;
+
+    typedef std::list<t_ring *> t_rings;
+
+    /// Discard the events not forwarded by the AsyncLogger thread
+    class Guard : public log4cpp::Filter {
+    protected:
+        log4cpp::Filter::Decision _decide(log4cpp::LoggingEvent const & event);
+    };
+    // Allowing inner class to access AsyncLogger members
+    friend class Guard;
+
+    static AsyncLogger * d_instance;
+
+    /// Set while records are buffered: appenders are guarded.
+    /// Guards could outlive the AsyncLogger, thus their state is static.
+    static volatile int d_active;
+
+    /// Set while the AsyncLogger thread is forwarding a record
+    static volatile int d_forwarding;
+
+    /// The AsyncLogger thread
+    static pthread_t d_thread;
+
+    /// Number of records of each ring, a power of two
+    unsigned int d_ringSize;
+
+    /// The key of the calling thread ring
+    pthread_key_t d_key;
+
+    /// The allocated rings
+    t_rings d_rings;
+
+    /// Protect the rings list
+    ost::Mutex d_ringsLock;
+
+    /// The rings scanned by a drain, used only by the AsyncLogger thread
+    std::vector<t_ring *> d_scan;
+
+    /// Used to wakeup the AsyncLogger thread
+    ost::Semaphore d_wakeup;
+
+    /// Set while the AsyncLogger thread is waiting for new records
+    volatile int d_idle;
+
+    /// Usage counters
+    volatile unsigned long d_written;
+    volatile unsigned long d_dropped;
+    volatile unsigned long d_spilled;
+    volatile unsigned long d_truncated;
+
+    /// The time of the last drops report [us]
+    unsigned long long d_lastReport;
+
+    /// Set true when the AsyncLogger thread should terminate
+    bool d_doExit;
+
+    /// The AsyncLogger thread ID
+    int d_tid;
+
+public:
+
+    /// Get an instance of the AsyncLogger.
+    /// AsyncLogger is a singleton class, this method provide a pointer to
+    /// the (eventually just created and started) only one instance.
+    /// The AsyncLogger should be built once log4cpp has been configured.
+    /// @param ringSize the number of records buffered by each thread;
+    ///		considered only by the call building the instance
+    static AsyncLogger * getInstance(unsigned int ringSize = ASYNCLOGGER_RING_SIZE);
+
+    /// Stop buffering records.
+    /// All the buffered records are written and the AsyncLogger thread is
+    /// terminated; thereafter appenders are called synchronously again.
+    /// This method should be called before log4cpp::Category::shutdown.
+    void shutdown();
+
+    /// Buffer an event into the calling thread ring.
+    /// @return true if the event has been buffered, false if it has been
+    ///		dropped
+    bool push(AsyncAppender * appender, log4cpp::LoggingEvent const & event);
+
+    /// Collect usage statistics.
+    void getStats(t_stats & stats);
+
+protected:
+
+    /// Build a new AsyncLogger
+    AsyncLogger(unsigned int ringSize, std::string const & logName = "AsyncLogger");
+
+    /// The AsyncLogger lives up to the process termination: AsyncAppenders,
+    /// owned by log4cpp, keep referencing it.
+    ~AsyncLogger();
+
+    /// Attach an AsyncAppender to each configured Category
+    void install();
+
+    /// Return the calling thread ring, building it on first use.
+    /// @return 0 if the AsyncLogger has been shut down
+    t_ring * ring();
+
+    /// Mark a ring closed on its thread termination
+    static void closeRing(void * ring);
+
+    /// Return true if some rings has records to write
+    bool pending();
+
+    /// Write all the buffered records, releasing the closed rings.
+    /// @return the number of records written
+    unsigned int drain();
+
+    /// Copy a string into a record buffer, spilling it to the heap if
+    /// longer than the buffer.
+    /// @param spill set to the spilled string, 0 if not spilled
+    /// @return false if the string has been truncated
+    static bool store(char * buffer, size_t size, char * & spill,
+    			std::string const & str);
+
+    /// Write a buffered record, releasing its spilled strings
+    void write(t_record & record);
+
+    /// The AsyncLogger thread body.
+    void run(void);
+
+};
+
+}// controlbox namespace
+
+#endif
@@ -0,0 +1,103 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _ATOMIC_H
+#define _ATOMIC_H
+
+/// @file Atomic.h
+/// Minimal atomic primitives used by lock-free data structures.
+/// These helpers are thin wrappers around the GCC __sync builtins (GCC >= 4.1),
+/// which on ARM EABI targets are implemented by the kernel user-helpers.
+/// All the operations imply a full memory barrier.
+
+namespace controlbox {
+
+/// Issue a full memory barrier.
+inline void atomicBarrier(void) {
+	__sync_synchronize();
+}
+
+/// Atomically read a value.
+template <typename T>
+inline T atomicRead(volatile T * p_ptr) {
+	T l_value = *p_ptr;
+	__sync_synchronize();
+	return l_value;
+}
+
+/// Atomically set a value.
+template <typename T>
+inline void atomicSet(volatile T * p_ptr, T p_value) {
+	__sync_synchronize();
+	*p_ptr = p_value;
+	__sync_synchronize();
+}
+
+/// Atomically add a value returning the new one.
+template <typename T>
+inline T atomicAdd(volatile T * p_ptr, T p_value) {
+	return __sync_add_and_fetch(p_ptr, p_value);
+}
+
+/// Atomically increment a counter returning the new value.
+template <typename T>
+inline T atomicInc(volatile T * p_ptr) {
+	return __sync_add_and_fetch(p_ptr, 1);
+}
+
+/// Atomically decrement a counter returning the new value.
+template <typename T>
+inline T atomicDec(volatile T * p_ptr) {
+	return __sync_sub_and_fetch(p_ptr, 1);
+}
+
+/// Compare-and-swap.
+/// @return true if *p_ptr was equal to p_old and has been set to p_new
+template <typename T>
+inline bool atomicCAS(volatile T * p_ptr, T p_old, T p_new) {
+	return __sync_bool_compare_and_swap(p_ptr, p_old, p_new);
+}
+
+/// Atomically update a maximum value.
+/// Update *p_ptr to p_value only if the latter is greater.
+template <typename T>
+inline void atomicMax(volatile T * p_ptr, T p_value) {
+	T l_cur = *p_ptr;
+	while ( p_value > l_cur ) {
+		if ( __sync_bool_compare_and_swap(p_ptr, l_cur, p_value) ) {
+			break;
+		}
+		l_cur = *p_ptr;
+	}
+}
+
+}// namespace controlbox
+
+#endif
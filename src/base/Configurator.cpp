@@ -34,14 +34,33 @@
 
 namespace controlbox {
 
+/// The compiled configuration signature
+#define CONFIGURATOR_BLOB_MAGIC	"CBOXCFG"
+
 Configurator * Configurator::d_instance = 0;
 
 Configurator::Configurator(std::string const & confFile):
         log(log4cpp::Category::getInstance(std::string("controlbox.Configurator"))),
-        d_confFile(confFile) {
+        d_confFile(confFile),
+        d_file(0),
+        d_view(0),
+        d_inotify(-1),
+        d_syncTimer(0),
+        d_syncPending(false),
+        d_lastSync(0) {
+    t_fileSnapshot * l_file;
 
     LOG4CPP_DEBUG(log,"Configurator::Configurator(), using config file: %s", d_confFile.c_str() );
 
+    // Failures are notified by param(), which retries loading the file
+    l_file = new t_fileSnapshot;
+    if ( loadBlob(*l_file) == OK || loadFile(*l_file) == OK ) {
+        d_file = l_file;
+    } else {
+        delete l_file;
+    }
+    publishView();
+
 }
 
 Configurator & Configurator::getInstance(std::string const & confFile) {
@@ -61,31 +80,475 @@ Configurator::~Configurator() {
 
     LOG4CPP_DEBUG(log, "Configurator::~Configurator()");
 
+    if ( d_inotify != -1 ) {
+        Reactor::getInstance()->unwatch(d_inotify);
+        ::close(d_inotify);
+    }
+
+    if ( d_syncTimer ) {
+        TimerWheel::getInstance()->cancel(d_syncTimer);
+        // NOTE the Executor could be already terminated
+        if ( Executor::peekInstance() ) {
+            Executor::peekInstance()->cancel(this);
+        }
+    }
+
     syncToFile();
 
     d_property.clear();
+    d_subscriptions.clear();
+
+    delete d_view;
+    if ( d_file ) {
+        delete d_file;
+    }
+
+}
+
+
+void Configurator::getStamp(struct stat const & st, t_fileStamp & stamp) {
+
+    stamp.inode = st.st_ino;
+    stamp.size = st.st_size;
+    stamp.mtime = st.st_mtim.tv_sec;
+    stamp.mtimeNsec = st.st_mtim.tv_nsec;
+
+}
+
+bool Configurator::sameStamp(t_fileStamp const & stamp, struct stat const & st) {
+    t_fileStamp l_stamp;
+
+    getStamp(st, l_stamp);
+
+    return ( stamp.inode == l_stamp.inode &&
+                stamp.size == l_stamp.size &&
+                stamp.mtime == l_stamp.mtime &&
+                stamp.mtimeNsec == l_stamp.mtimeNsec );
+}
+
+exitCode Configurator::loadFile(t_fileSnapshot & snapshot) {
+    unsigned int i;
+    struct stat l_stat;
+    ssize_t l_read = 0;
+    unsigned long long l_start;
+    int l_fd;
 
+    LOG4CPP_DEBUG(log, "Configurator::loadFile()");
+
+    l_start = Utils::monotonicUsec();
+
+    l_fd = ::open(d_confFile.c_str(), O_RDONLY);
+    if ( l_fd == -1 ) {
+        LOG4CPP_ERROR(log, "Unable to open configuration file [%s]: %s",
+                        d_confFile.c_str(), strerror(errno));
+        return CFG_OPEN_FAILED;
+    }
+
+    // Reading the whole file at once
+    snapshot.data.clear();
+    memset(&snapshot.stamp, 0, sizeof(t_fileStamp));
+    if ( fstat(l_fd, &l_stat) == 0 ) {
+        snapshot.data.resize(l_stat.st_size);
+        getStamp(l_stat, snapshot.stamp);
+    }
+    i = 0;
+    for (;;) {
+        if ( i == snapshot.data.size() ) {
+            // The file could be grown meanwhile
+            snapshot.data.resize(i+MAX_CONFFILE_LINE);
+        }
+        l_read = ::read(l_fd, &snapshot.data[i], snapshot.data.size()-i);
+        if ( l_read == -1 && errno == EINTR ) {
+            continue;
+        }
+        if ( l_read <= 0 ) {
+            break;
+        }
+        i += l_read;
+    }
+    ::close(l_fd);
+    if ( l_read == -1 ) {
+        LOG4CPP_ERROR(log, "Unable to read configuration file [%s]: %s",
+                        d_confFile.c_str(), strerror(errno));
+        snapshot.data.clear();
+        return CFG_OPEN_FAILED;
+    }
+    snapshot.data.resize(i);
+
+    parseFile(snapshot);
+
+    LOG4CPP_INFO(log, "Loaded [%u] params from configuration file [%s] in [%lluus]",
+                    snapshot.params.size(), d_confFile.c_str(),
+                    Utils::monotonicUsec()-l_start);
+
+    return OK;
+
+}
+
+uint64_t Configurator::blobAlign(uint64_t size) {
+    return (size + CONFIGURATOR_BLOB_ALIGN-1) & ~(uint64_t)(CONFIGURATOR_BLOB_ALIGN-1);
 }
 
+exitCode Configurator::loadBlob(t_fileSnapshot & snapshot) {
+    std::string l_blobFile = d_confFile + CONFIGURATOR_BLOB_SUFFIX;
+    t_blobHeader const * l_header;
+    char const * l_blob;
+    t_fileParam const * l_params;
+    int const * l_index;
+    struct stat l_src;
+    struct stat l_stat;
+    unsigned long long l_start;
+    uint64_t l_dataEnd;
+    uint64_t l_size;
+    exitCode result = CFG_BLOB_INVALID;
+    unsigned int l_empty;
+    unsigned int i;
+    int l_fd;
+
+    LOG4CPP_DEBUG(log, "Configurator::loadBlob()");
+
+    l_start = Utils::monotonicUsec();
+
+    l_fd = ::open(l_blobFile.c_str(), O_RDONLY);
+    if ( l_fd == -1 ) {
+        return CFG_BLOB_INVALID;
+    }
+    if ( fstat(l_fd, &l_stat) == -1 || l_stat.st_size < (off_t)sizeof(t_blobHeader) ||
+            stat(d_confFile.c_str(), &l_src) == -1 ) {
+        ::close(l_fd);
+        return CFG_BLOB_INVALID;
+    }
+
+    l_blob = (char const *)mmap(0, l_stat.st_size, PROT_READ, MAP_PRIVATE, l_fd, 0);
+    ::close(l_fd);
+    if ( l_blob == MAP_FAILED ) {
+        LOG4CPP_WARN(log, "Unable to map compiled configuration [%s]: %s",
+                        l_blobFile.c_str(), strerror(errno));
+        return CFG_BLOB_INVALID;
+    }
+
+    // Sections are mapped at aligned offsets of a page aligned mapping
+    (void)sizeof(StaticAssert<(sizeof(t_blobHeader) % CONFIGURATOR_BLOB_ALIGN == 0)>);
+    (void)sizeof(StaticAssert<(CONFIGURATOR_BLOB_ALIGN % __alignof__(t_fileParam) == 0)>);
+    (void)sizeof(StaticAssert<(sizeof(t_fileParam) % __alignof__(int) == 0)>);
+
+    l_header = (t_blobHeader const *)l_blob;
+    l_dataEnd = blobAlign(l_header->dataSize);
+    l_size = sizeof(t_blobHeader) + l_dataEnd +
+                (uint64_t)l_header->paramsCount * sizeof(t_fileParam) +
+                (uint64_t)l_header->indexSize * sizeof(int);
+
+    if ( memcmp(l_header->magic, CONFIGURATOR_BLOB_MAGIC, sizeof(l_header->magic)) ||
+            l_header->version != CONFIGURATOR_BLOB_VERSION ||
+            l_header->paramSize != sizeof(t_fileParam) ||
+            l_header->indexSize < 8 ||
+            (l_header->indexSize & (l_header->indexSize-1)) ||
+            l_size != (uint64_t)l_stat.st_size ) {
+        LOG4CPP_WARN(log, "Compiled configuration [%s] not valid",
+                        l_blobFile.c_str());
+        goto unmap;
+    }
+
+    // The configuration file must be the compiled one
+    if ( l_header->dataSize != (uint64_t)l_src.st_size ||
+            !sameStamp(l_header->src, l_src) ) {
+        LOG4CPP_WARN(log, "Compiled configuration [%s] is stale",
+                        l_blobFile.c_str());
+        result = CFG_BLOB_STALE;
+        goto unmap;
+    }
+
+    // Params must lay within the file content, and the index must refer
+    // to params and have at least an empty slot to end lookups
+    l_blob += sizeof(t_blobHeader);
+    l_params = (t_fileParam const *)(l_blob + l_dataEnd);
+    l_index = (int const *)(l_params + l_header->paramsCount);
+    for (i=0; i<l_header->paramsCount; i++) {
+        if ( l_params[i].lable > l_header->dataSize ||
+                l_params[i].lableLen > l_header->dataSize-l_params[i].lable ||
+                l_params[i].value > l_header->dataSize ||
+                l_params[i].valueLen > l_header->dataSize-l_params[i].value ) {
+            break;
+        }
+    }
+    l_empty = 0;
+    if ( i == l_header->paramsCount ) {
+        for (i=0; i<l_header->indexSize; i++) {
+            if ( l_index[i] == -1 ) {
+                l_empty++;
+            } else if ( l_index[i] < 0 ||
+                    (unsigned int)l_index[i] >= l_header->paramsCount ) {
+                break;
+            }
+        }
+    }
+    if ( i != l_header->indexSize || !l_empty ) {
+        LOG4CPP_WARN(log, "Compiled configuration [%s] corrupted",
+                        l_blobFile.c_str());
+        goto unmap;
+    }
+
+    // Sections are already parsed and indexed: just copying them
+    snapshot.data.assign(l_blob, l_blob+l_header->dataSize);
+    snapshot.params.assign(l_params, l_params + l_header->paramsCount);
+    snapshot.index.assign(l_index, l_header->indexSize);
+    getStamp(l_src, snapshot.stamp);
+    result = OK;
+
+    LOG4CPP_INFO(log, "Loaded [%u] params from compiled configuration [%s] in [%lluus]",
+                    snapshot.params.size(), l_blobFile.c_str(),
+                    Utils::monotonicUsec()-l_start);
+
+unmap:
+    munmap((void *)l_header, l_stat.st_size);
+    return result;
+
+}
+
+exitCode Configurator::compile() {
+    std::string l_blobFile = d_confFile + CONFIGURATOR_BLOB_SUFFIX;
+    t_fileSnapshot l_file;
+    t_blobHeader l_header;
+    std::vector<char> l_blob;
+    struct stat l_before;
+    struct stat l_after;
+    char const * l_section;
+    bool l_changed;
+
+    LOG4CPP_DEBUG(log, "Configurator::compile()");
+
+    if ( stat(d_confFile.c_str(), &l_before) == -1 ||
+            loadFile(l_file) != OK ||
+            stat(d_confFile.c_str(), &l_after) == -1 ) {
+        return CFG_OPEN_FAILED;
+    }
+
+    d_lock.enterMutex();
+    l_changed = ( d_file && !sameStamp(d_file->stamp, l_after) );
+    d_lock.leaveMutex();
+
+    // The configuration file must not be changed while compiling, nor
+    // since it has been loaded to check the devices sections
+    if ( !sameStamp(l_file.stamp, l_before) ||
+            !sameStamp(l_file.stamp, l_after) ||
+            l_file.data.size() != (unsigned long)l_after.st_size ||
+            l_changed ) {
+        LOG4CPP_ERROR(log, "Configuration file [%s] changed while compiling",
+                        d_confFile.c_str());
+        return CFG_OPEN_FAILED;
+    }
+
+    memset(&l_header, 0, sizeof(t_blobHeader));
+    strncpy(l_header.magic, CONFIGURATOR_BLOB_MAGIC, sizeof(l_header.magic));
+    l_header.version = CONFIGURATOR_BLOB_VERSION;
+    l_header.paramSize = sizeof(t_fileParam);
+    l_header.dataSize = l_file.data.size();
+    l_header.paramsCount = l_file.params.size();
+    l_header.indexSize = l_file.index.slots.size();
+    l_header.src = l_file.stamp;
+
+    l_section = (char const *)&l_header;
+    l_blob.insert(l_blob.end(), l_section, l_section+sizeof(t_blobHeader));
+    l_blob.insert(l_blob.end(), l_file.data.begin(), l_file.data.end());
+    l_blob.resize(sizeof(t_blobHeader)+blobAlign(l_file.data.size()), 0);
+    if ( l_file.params.size() ) {
+        l_section = (char const *)&l_file.params[0];
+        l_blob.insert(l_blob.end(), l_section,
+                        l_section+l_file.params.size()*sizeof(t_fileParam));
+    }
+    l_section = (char const *)&l_file.index.slots[0];
+    l_blob.insert(l_blob.end(), l_section,
+                    l_section+l_file.index.slots.size()*sizeof(int));
+
+    if ( writeFile(l_blobFile, l_blob) != OK ) {
+        return CFG_WRITE_FAILED;
+    }
+
+    LOG4CPP_INFO(log, "Compiled [%u] params into [%s]",
+                    l_file.params.size(), l_blobFile.c_str());
+
+    return OK;
+
+}
+
+void Configurator::parseFile(t_fileSnapshot & snapshot) {
+    t_fileParam l_param;
+    unsigned int l_end;
+    unsigned int i, j;
+    char * l_data;
+
+    l_data = snapshot.data.size() ? &snapshot.data[0] : 0;
+
+    // Parsing: a param for each line, the lable is followed by blanks and
+    // the value, up to the end of line
+    snapshot.params.clear();
+    for (i=0; i<snapshot.data.size(); i=l_end+1) {
+
+        for (l_end=i; l_end<snapshot.data.size() && l_data[l_end]!='\n'; l_end++);
+
+        // Jumping empty and comment lines
+        if ( l_end == i || l_data[i] == '#' ) {
+            continue;
+        }
+
+        for (j=i; j<l_end && !isblank(l_data[j]); j++);
+        l_param.lable = i;
+        l_param.lableLen = j-i;
+        for (; j<l_end && isblank(l_data[j]); j++);
+        l_param.value = j;
+        l_param.valueLen = l_end-j;
+        l_param.hash = hashFnv(l_data+i, l_param.lableLen);
+
+        // Params without a value are not defined
+        if ( !l_param.valueLen ) {
+            LOG4CPP_WARN(log, "Missing params on configuration string [%s]",
+                            std::string(l_data+i, l_end-i).c_str());
+            continue;
+        }
+
+        snapshot.params.push_back(l_param);
+    }
+
+    // Indexing params
+    snapshot.index.reset(snapshot.params.size());
+
+    for (i=0; i<snapshot.params.size(); i++) {
+        // The first definition of a param wins
+        if ( findFileParam(snapshot, l_data+snapshot.params[i].lable,
+                                snapshot.params[i].lableLen) != -1 ) {
+            LOG4CPP_WARN(log, "Duplicated param [%s], using its first definition",
+                            std::string(l_data+snapshot.params[i].lable,
+                                snapshot.params[i].lableLen).c_str());
+            continue;
+        }
+        snapshot.index.insert(snapshot.params[i].hash, i);
+    }
+
+}
+
+int Configurator::findFileParam(t_fileSnapshot const & snapshot, char const * p, unsigned int len) {
+    unsigned int l_hash;
+    unsigned int l_slot;
+    int l_idx;
+
+    l_hash = hashFnv(p, len);
+    for (l_slot = snapshot.index.first(l_hash); (l_idx = snapshot.index.probe(l_slot)) != -1; ) {
+        t_fileParam const & l_param = snapshot.params[l_idx];
+        if ( l_param.hash == l_hash && l_param.lableLen == len &&
+                !memcmp(&snapshot.data[l_param.lable], p, len) ) {
+            return l_idx;
+        }
+    }
+
+    return -1;
+}
+
+std::string Configurator::fileValue(t_fileSnapshot const & snapshot, int idx) {
+    t_fileParam const & l_param = snapshot.params[idx];
+
+    return std::string(&snapshot.data[l_param.value], l_param.valueLen);
+}
+
+void Configurator::diffFile(t_fileSnapshot const & from, t_fileSnapshot const & to,
+                            std::list<std::string> & changed) {
+    unsigned int i;
+    int l_idx;
+
+    // New and updated params
+    for (i=0; i<to.index.slots.size(); i++) {
+        if ( to.index.slots[i] == -1 ) {
+            continue;
+        }
+        t_fileParam const & l_param = to.params[to.index.slots[i]];
+        l_idx = findFileParam(from, &to.data[l_param.lable], l_param.lableLen);
+        if ( l_idx != -1 &&
+                from.params[l_idx].valueLen == l_param.valueLen &&
+                !memcmp(&from.data[from.params[l_idx].value],
+                        &to.data[l_param.value], l_param.valueLen) ) {
+            continue;
+        }
+        changed.push_back(std::string(&to.data[l_param.lable], l_param.lableLen));
+    }
+
+    // Removed params
+    for (i=0; i<from.index.slots.size(); i++) {
+        if ( from.index.slots[i] == -1 ) {
+            continue;
+        }
+        t_fileParam const & l_param = from.params[from.index.slots[i]];
+        if ( findFileParam(to, &from.data[l_param.lable], l_param.lableLen) == -1 ) {
+            changed.push_back(std::string(&from.data[l_param.lable], l_param.lableLen));
+        }
+    }
+
+}
+
+void Configurator::publishView(t_fileSnapshot * release) {
+    t_view * l_view = new t_view;
+    t_view * l_old = d_view;
+    t_mapProperty::iterator it;
+
+    l_view->file = d_file;
+    for (it=d_property.begin(); it!=d_property.end(); it++) {
+        l_view->values.insert(l_view->values.end(),
+                        t_values::value_type(it->first, (it->second).value));
+    }
+    l_view->typed = d_typed;
+    l_view->typedDefaults = d_typedDefaults;
+
+    atomicSet(&d_view, l_view);
+
+    // Waiting for readers which could still use the previous view
+    d_rcu.synchronize();
+
+    delete l_old;
+    if ( release ) {
+        delete release;
+    }
+
+}
 
 std::string Configurator::param(std::string const & p, std::string const & defaultValue, bool keep)
 throw (exceptions::IOException) {
     t_mapProperty::iterator it;
-    string		line;
-    char		c_line[MAX_CONFFILE_LINE];
-    unsigned short	c_lineLableLength;
-    char *		c_lineValue;
-    char *		c_param;
-    size_t		c_paramLen;
-//     int 		pos;
-    ifstream 		c_file;
-    short 		i;
-    short		lineLength;
+    t_values::const_iterator v;
+    t_view const * l_view;
     std::string		fileParam;
-    bool		found;
+    unsigned int	l_epoch;
+    int			l_idx;
 
     LOG4CPP_DEBUG(log, "Configurator::param(param = [%s], defaultValue = [%s])", p.c_str(), defaultValue.c_str());
 
+    // Lock-free lookup into the current view, the lock is required just
+    // to load the file and to keep params on memory
+    l_epoch = d_rcu.readLock();
+    l_view = atomicRead(&d_view);
+    if ( l_view && l_view->file ) {
+        v = l_view->values.find(p);
+        if ( v != l_view->values.end() ) {
+            fileParam = v->second;
+            d_rcu.readUnlock(l_epoch);
+            LOG4CPP_DEBUG(log, "Loading attribute [%s] from memory: [%s]", p.c_str(), fileParam.c_str());
+            return fileParam;
+        }
+        if ( !keep ) {
+            l_idx = findFileParam(*l_view->file, p.data(), p.size());
+            if ( l_idx != -1 ) {
+                fileParam = fileValue(*l_view->file, l_idx);
+            }
+            d_rcu.readUnlock(l_epoch);
+            if ( l_idx != -1 ) {
+                LOG4CPP_DEBUG(log, "Loading attribute [%s] from file: [%s]", p.c_str(), fileParam.c_str());
+                return fileParam;
+            }
+            LOG4CPP_DEBUG(log, "Loading attribute [%s] from default value: [%s]", p.c_str(), defaultValue.c_str());
+            return defaultValue;
+        }
+    }
+    d_rcu.readUnlock(l_epoch);
+
+    ost::MutexLock l_lock(d_lock);
+
     // FIRST: Looking for (modified/new) param on memory
     it = d_property.find(p);
     if ( it != d_property.end() ) {
@@ -94,76 +557,268 @@ throw (exceptions::IOException) {
     }
 
     // Otherwise we should look on configuration file
-    found = false;
-    c_file.open(d_confFile.c_str(), ios_base::in);
-    if ( ! c_file ) {
-        throw exceptions::IOException();
+    if ( !d_file ) {
+        d_file = new t_fileSnapshot;
+        if ( loadFile(*d_file) != OK ) {
+            delete d_file;
+            d_file = 0;
+            throw exceptions::IOException();
+        }
+        publishView();
+    }
+
+    l_idx = findFileParam(*d_file, p.data(), p.size());
+    if ( l_idx != -1 ) {
+        fileParam = fileValue(*d_file, l_idx);
+        LOG4CPP_DEBUG(log, "Loading attribute [%s] from file: [%s]", p.c_str(), fileParam.c_str());
+        if ( keep ) {
+            addParam(p, fileParam, false, true);
+            publishView();
+        }
+        return fileParam;
     }
 
-    c_param = (char *)p.c_str();
-    c_paramLen = strlen(c_param);
-    while ( ! c_file.eof() ) {
+    LOG4CPP_DEBUG(log, "Loading attribute [%s] from default value: [%s]", p.c_str(), defaultValue.c_str());
+    if ( keep ) {
+        addParam(p, defaultValue, false, true);
+        publishView();
+    }
+    return defaultValue;
+}
 
-        getline(c_file, line);
+bool Configurator::parseTyped(std::string const & value, t_typedParam & typed) {
+    std::string::size_type l_start;
+    std::string::size_type l_end;
+    std::string l_value;
+    char const * l_str = value.c_str();
+    char * l_tail;
+    unsigned int i;
+
+    switch ( typed.type ) {
+    case PARAM_INT:
+        // Decimal, unless explicitly hexadecimal: leading zeros are not octal
+        while ( isspace(*l_str) ) {
+            l_str++;
+        }
+        l_tail = (char *)l_str;
+        if ( *l_tail == '-' || *l_tail == '+' ) {
+            l_tail++;
+        }
+        errno = 0;
+        if ( l_tail[0] == '0' && (l_tail[1] == 'x' || l_tail[1] == 'X') ) {
+            typed.intValue = strtol(l_str, &l_tail, 16);
+        } else {
+            typed.intValue = strtol(l_str, &l_tail, 10);
+        }
+        break;
+    case PARAM_DOUBLE:
+        errno = 0;
+        typed.doubleValue = strtod(l_str, &l_tail);
+        break;
+    case PARAM_BOOL:
+        l_value = value;
+        for (i=0; i<l_value.size(); i++) {
+            l_value[i] = tolower(l_value[i]);
+        }
+        if ( l_value == "1" || l_value == "yes" ||
+                l_value == "true" || l_value == "on" ) {
+            typed.boolValue = true;
+            return true;
+        }
+        if ( l_value == "0" || l_value == "no" ||
+                l_value == "false" || l_value == "off" ) {
+            typed.boolValue = false;
+            return true;
+        }
+        return false;
+    case PARAM_LIST:
+        typed.listValue.clear();
+        l_start = value.find_first_not_of(CONFIGURATOR_LIST_SEPARATORS);
+        while ( l_start != std::string::npos ) {
+            l_end = value.find_first_of(CONFIGURATOR_LIST_SEPARATORS, l_start);
+            typed.listValue.push_back(value.substr(l_start, l_end-l_start));
+            l_start = value.find_first_not_of(CONFIGURATOR_LIST_SEPARATORS, l_end);
+        }
+        return true;
+    }
 
-        if ( ! line.size() || ! strncmp(line.c_str(), "#", 1) ) {
-            // Jumping comment lines
-            continue;
+    // Numbers must be fully consumed, up to trailing blanks
+    if ( l_tail == l_str || errno == ERANGE ) {
+        return false;
+    }
+    for ( ; *l_tail; l_tail++) {
+        if ( !isspace(*l_tail) ) {
+            return false;
         }
+    }
 
-        strncpy(c_line, line.c_str(), MAX_CONFFILE_LINE);
-        lineLength = strlen(c_line);
+    return true;
+}
 
-        // TODO: check if the first space is a TAB!!!
+bool Configurator::definedParam(std::string const & p, std::string & value)
+throw (exceptions::IOException) {
+    t_mapProperty::iterator it;
+    int l_idx;
 
-        // Find first "space" (either a space or a tab) after the lable
-        for (i=0; i<=lineLength && !isblank(c_line[i]); i++);
-        c_lineLableLength = i;
-        // Find the start of the value (jumping all "spaces" after lable)
-        for (; i<=lineLength && isblank(c_line[i]); i++);
+    it = d_property.find(p);
+    if ( it != d_property.end() ) {
+        value = (it->second).value;
+        return true;
+    }
 
-        if ( i==lineLength ) {
-            LOG4CPP_WARN(log, "Missing params on configuration string [%s]", c_line);
-            c_lineValue = c_line;
-        } else {
-            c_lineValue = c_line+i-1;
-            (*c_lineValue) = 0;
-            c_lineValue++;
+    if ( !d_file ) {
+        d_file = new t_fileSnapshot;
+        if ( loadFile(*d_file) != OK ) {
+            delete d_file;
+            d_file = 0;
+            throw exceptions::IOException();
         }
+        publishView();
+    }
 
-        // If the two lables have different length they are not equals
-        if ( c_lineLableLength != c_paramLen ) {
-            continue;
+    l_idx = findFileParam(*d_file, p.data(), p.size());
+    if ( l_idx == -1 ) {
+        return false;
+    }
+
+    value = fileValue(*d_file, l_idx);
+    return true;
+}
+
+void Configurator::parseParam(std::string const & p, t_typedParam & typed) {
+    std::string l_value;
+
+    typed.valid = false;
+    if ( !definedParam(p, l_value) ) {
+        return;
+    }
+
+    typed.valid = parseTyped(l_value, typed);
+    if ( !typed.valid ) {
+        // Reported just once, up to the next change of the param
+        LOG4CPP_WARN(log, "Invalid value [%s] for param [%s], using the default",
+                        l_value.c_str(), p.c_str());
+    }
+
+}
+
+void Configurator::refreshTyped(std::string const & p) {
+    t_typedParams::iterator it;
+
+    for (it = d_typed.lower_bound(t_typedKey(p, PARAM_INT));
+            it != d_typed.end() && (it->first).first == p; it++) {
+        parseParam(p, it->second);
+    }
+
+}
+
+Configurator::t_typedParam const & Configurator::typedParam(std::string const & p,
+                                    std::string const & defaultValue,
+                                    t_paramType type) {
+    t_typedParams::iterator it;
+    t_typedParam l_typed;
+
+    l_typed.type = type;
+    l_typed.valid = false;
+    l_typed.intValue = 0;
+    l_typed.doubleValue = 0;
+    l_typed.boolValue = false;
+
+    // The configured value does not depend on the default one
+    it = d_typed.find(t_typedKey(p, type));
+    if ( it == d_typed.end() ) {
+        parseParam(p, l_typed);
+        it = d_typed.insert(t_typedParams::value_type(t_typedKey(p, type), l_typed)).first;
+    }
+    if ( (it->second).valid ) {
+        return it->second;
+    }
+
+    // Defaults are shared among params, whatever value they have
+    it = d_typedDefaults.find(t_typedKey(defaultValue, type));
+    if ( it == d_typedDefaults.end() ) {
+        l_typed.valid = parseTyped(defaultValue, l_typed);
+        if ( !l_typed.valid ) {
+            LOG4CPP_ERROR(log, "Invalid default value [%s] for param [%s]",
+                            defaultValue.c_str(), p.c_str());
         }
+        it = d_typedDefaults.insert(t_typedParams::value_type(t_typedKey(defaultValue, type), l_typed)).first;
+    }
 
-        //LOG4CPP_DEBUG(log, "Line:  [%s](%d) [%s]", c_line, c_paramLen, c_lineValue);
-        //LOG4CPP_DEBUG(log, "Param: [%s](%d)", c_param, c_lineLableLength);
-        //LOG4CPP_DEBUG(log, "Compare: %d", strncmp(c_line, c_param, MAX_CONFFILE_LINE));
+    return it->second;
+}
 
-        if ( ! strncmp(c_line, c_param, c_lineLableLength) ) {
-            c_file.close();
-            LOG4CPP_DEBUG(log, "Loading attribute [%s] from file: [%s]", p.c_str(), c_lineValue);
-            fileParam = string(c_lineValue);
-            if ( keep ) {
-                addParam(p, fileParam);
+Configurator::t_typedParam Configurator::lookupTyped(std::string const & p,
+                                    std::string const & defaultValue,
+                                    t_paramType type) {
+    t_typedParams::const_iterator it;
+    t_view const * l_view;
+    t_typedParam l_typed;
+    unsigned int l_epoch;
+    unsigned int l_parsed;
+
+    // Lock-free lookup into the current view
+    l_epoch = d_rcu.readLock();
+    l_view = atomicRead(&d_view);
+    if ( l_view ) {
+        it = l_view->typed.find(t_typedKey(p, type));
+        if ( it != l_view->typed.end() && (it->second).valid ) {
+            l_typed = it->second;
+            d_rcu.readUnlock(l_epoch);
+            return l_typed;
+        }
+        if ( it != l_view->typed.end() ) {
+            it = l_view->typedDefaults.find(t_typedKey(defaultValue, type));
+            if ( it != l_view->typedDefaults.end() ) {
+                l_typed = it->second;
+                d_rcu.readUnlock(l_epoch);
+                return l_typed;
             }
-            return fileParam;
         }
     }
-
-    c_file.close();
-    LOG4CPP_DEBUG(log, "Loading attribute [%s] from default value: [%s]", p.c_str(), defaultValue.c_str());
-    if ( keep ) {
-        addParam(p, defaultValue);
+    d_rcu.readUnlock(l_epoch);
+
+    // Parsing the param, or its default, the first time it's looked up
+    ost::MutexLock l_lock(d_lock);
+    l_parsed = d_typed.size() + d_typedDefaults.size();
+    l_typed = typedParam(p, defaultValue, type);
+    if ( d_typed.size() + d_typedDefaults.size() != l_parsed ) {
+        publishView();
     }
-    return defaultValue;
+
+    return l_typed;
+}
+
+long Configurator::paramInt(std::string const & p, std::string const & defaultValue)
+throw (exceptions::IOException) {
+
+    return lookupTyped(p, defaultValue, PARAM_INT).intValue;
+}
+
+double Configurator::paramDouble(std::string const & p, std::string const & defaultValue)
+throw (exceptions::IOException) {
+
+    return lookupTyped(p, defaultValue, PARAM_DOUBLE).doubleValue;
+}
+
+bool Configurator::paramBool(std::string const & p, std::string const & defaultValue)
+throw (exceptions::IOException) {
+
+    return lookupTyped(p, defaultValue, PARAM_BOOL).boolValue;
+}
+
+Configurator::t_paramList Configurator::paramList(std::string const & p, std::string const & defaultValue)
+throw (exceptions::IOException) {
+
+    return lookupTyped(p, defaultValue, PARAM_LIST).listValue;
 }
 
 inline
-exitCode Configurator::addParam (std::string const & p, std::string const & value, bool sync) {
+exitCode Configurator::addParam (std::string const & p, std::string const & value, bool sync, bool cached) {
     t_param entry;
 
     entry.toSync = sync;
+    entry.cached = cached;
     entry.value = value;
 
     d_property.insert(pair<std::string, t_param>(p, entry));
@@ -178,6 +833,7 @@ exitCode Configurator::addParam (std::string const & p, std::string const & valu
 
 exitCode Configurator::setParam(std::string const & p, std::string const & value, bool sync)
 throw (exceptions::IOException) {
+    ost::MutexLock l_lock(d_lock);
     t_mapProperty::iterator it;
 
     LOG4CPP_DEBUG(log, "setParam(param=%s, value=%s, sync=%s)", p.c_str(), value.c_str(), sync ? "YES" : "NO" );
@@ -191,20 +847,499 @@ throw (exceptions::IOException) {
         // The param is already on memory: updating value
         LOG4CPP_DEBUG(log, "Updating param [%s] value on memory ([%s] => [%s])", p.c_str(), (it->second).value.c_str(), value.c_str());
         (it->second).toSync = sync;
+        (it->second).cached = false;
         (it->second).value = value;
     }
 
     LOG4CPP_DEBUG(log, "Updated param [%s] value on memory", p.c_str());
 
+    refreshTyped(p);
+    publishView();
+
+    if ( sync ) {
+        scheduleSync();
+    }
+
+    return OK;
+
+}
+
+exitCode Configurator::watch() {
+    std::string l_dir;
+    std::string::size_type l_pos;
+    int l_flags;
+
+    LOG4CPP_DEBUG(log, "Configurator::watch()");
+
+    if ( d_inotify != -1 ) {
+        return OK;
+    }
+
+    // Watching the directory, to catch files replaced by a rename too
+    l_pos = d_confFile.rfind('/');
+    if ( l_pos == std::string::npos ) {
+        l_dir = ".";
+    } else {
+        l_dir = d_confFile.substr(0, l_pos ? l_pos : 1);
+    }
+
+    d_inotify = inotify_init();
+    if ( d_inotify == -1 ) {
+        LOG4CPP_ERROR(log, "Unable to init inotify: %s", strerror(errno));
+        return CFG_WATCH_FAILED;
+    }
+    l_flags = fcntl(d_inotify, F_GETFL);
+    fcntl(d_inotify, F_SETFL, l_flags | O_NONBLOCK);
+
+    if ( inotify_add_watch(d_inotify, l_dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1 ) {
+        LOG4CPP_ERROR(log, "Unable to watch configuration directory [%s]: %s",
+                        l_dir.c_str(), strerror(errno));
+        ::close(d_inotify);
+        d_inotify = -1;
+        return CFG_WATCH_FAILED;
+    }
+
+    if ( Reactor::getInstance()->watch(d_inotify, this) != OK ) {
+        LOG4CPP_ERROR(log, "Unable to register the configuration watch");
+        ::close(d_inotify);
+        d_inotify = -1;
+        return CFG_WATCH_FAILED;
+    }
+
+    LOG4CPP_INFO(log, "Watching configuration file [%s] for changes", d_confFile.c_str());
+
     return OK;
 
 }
 
+void Configurator::fdReady(int fd, unsigned int events) {
+    char l_buff[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    struct inotify_event * l_event;
+    std::string::size_type l_pos;
+    std::string l_name;
+    bool l_changed = false;
+    ssize_t l_len;
+    ssize_t i;
+
+    l_pos = d_confFile.rfind('/');
+    l_name = (l_pos == std::string::npos) ? d_confFile : d_confFile.substr(l_pos+1);
+
+    // Consuming all the pending events, the file is reloaded just once
+    for (;;) {
+        l_len = ::read(fd, l_buff, sizeof(l_buff));
+        if ( l_len == -1 && errno == EINTR ) {
+            continue;
+        }
+        if ( l_len <= 0 ) {
+            break;
+        }
+        for (i=0; i<l_len; i+=sizeof(struct inotify_event)+l_event->len) {
+            l_event = (struct inotify_event *)(l_buff+i);
+            if ( l_event->len && l_name == l_event->name ) {
+                l_changed = true;
+            }
+        }
+    }
+
+    if ( l_changed ) {
+        LOG4CPP_INFO(log, "Configuration file [%s] changed", d_confFile.c_str());
+        reload();
+    }
+
+}
+
+exitCode Configurator::reload() {
+    t_fileSnapshot * l_file;
+    t_fileSnapshot * l_old;
+    std::list<std::string> l_changed;
+    std::list<std::string>::iterator it;
+    t_mapProperty::iterator p;
+    t_subscriptions::iterator s;
+    std::pair<t_subscriptions::iterator, t_subscriptions::iterator> l_range;
+
+    LOG4CPP_DEBUG(log, "Configurator::reload()");
+
+    // Parsing the new configuration aside
+    l_file = new t_fileSnapshot;
+    if ( loadFile(*l_file) != OK ) {
+        LOG4CPP_WARN(log, "Reload failed, keeping current configuration");
+        delete l_file;
+        return CFG_OPEN_FAILED;
+    }
+
+    // Applying the new configuration as a whole
+    d_lock.enterMutex();
+
+    l_old = d_file;
+    if ( l_old ) {
+        diffFile(*l_old, *l_file, l_changed);
+    }
+    d_file = l_file;
+
+    // Dropping stale params kept on memory, they will be reloaded on demand,
+    // while params set at run-time override the file ones
+    it = l_changed.begin();
+    while ( it != l_changed.end() ) {
+        p = d_property.find(*it);
+        if ( p != d_property.end() ) {
+            if ( !(p->second).cached ) {
+                it = l_changed.erase(it);
+                continue;
+            }
+            d_property.erase(p);
+        }
+        it++;
+    }
+
+    // Reporting invalid values of the typed params as soon as loaded
+    for (it=l_changed.begin(); it!=l_changed.end(); it++) {
+        refreshTyped(*it);
+    }
+
+    // The previous configuration is released once no more read
+    publishView(l_old);
+
+    d_lock.leaveMutex();
+
+    LOG4CPP_INFO(log, "Configuration reloaded, [%u] params changed", l_changed.size());
+
+    // Notifying subscribers
+    d_subLock.enterMutex();
+    for (it=l_changed.begin(); it!=l_changed.end(); it++) {
+        l_range = d_subscriptions.equal_range(*it);
+        for (s=l_range.first; s!=l_range.second; s++) {
+            LOG4CPP_DEBUG(log, "Notifying param [%s] change", (*it).c_str());
+            (s->second)->paramChanged(*it);
+        }
+    }
+    d_subLock.leaveMutex();
+
+    return OK;
+
+}
+
+void Configurator::subscribe(std::string const & p, ConfigurationHandler * handler) {
+    ost::MutexLock l_lock(d_subLock);
+
+    LOG4CPP_DEBUG(log, "Configurator::subscribe(param=%s)", p.c_str());
+
+    d_subscriptions.insert(std::pair<std::string, ConfigurationHandler *>(p, handler));
+
+}
+
+void Configurator::unsubscribe(ConfigurationHandler * handler) {
+    ost::MutexLock l_lock(d_subLock);
+    t_subscriptions::iterator it;
+
+    LOG4CPP_DEBUG(log, "Configurator::unsubscribe()");
+
+    it = d_subscriptions.begin();
+    while ( it != d_subscriptions.end() ) {
+        if ( it->second == handler ) {
+            d_subscriptions.erase(it++);
+            continue;
+        }
+        it++;
+    }
+
+}
+
+void Configurator::scheduleSync() {
+    unsigned long long l_now;
+    unsigned long long l_period;
+    timeout_t l_delay = CONFIGURATOR_SYNC_DELAY;
+    TimerWheel * l_tw = TimerWheel::getInstance();
+
+    // Coalescing with the already scheduled write
+    if ( d_syncPending ) {
+        return;
+    }
+
+    // Bounding the write rate to save the flash
+    l_period = 1000ULL * paramInt("Configurator_syncPeriod", DEFAULT_SYNC_PERIOD);
+    l_now = Utils::monotonicUsec()/1000;
+    if ( d_lastSync && (d_lastSync+l_period > l_now+l_delay) ) {
+        l_delay = d_lastSync+l_period-l_now;
+    }
+
+    if ( d_syncTimer ) {
+        if ( l_tw->reschedule(d_syncTimer, l_delay) != OK ) {
+            d_syncTimer = 0;
+        }
+    }
+    if ( !d_syncTimer ) {
+        d_syncTimer = l_tw->schedule(this, l_delay);
+    }
+    if ( !d_syncTimer ) {
+        LOG4CPP_ERROR(log, "Failed scheduling the configuration file sync");
+        return;
+    }
+
+    d_syncPending = true;
+    LOG4CPP_DEBUG(log, "Configuration file sync scheduled in [%lums]", l_delay);
+
+}
+
+void Configurator::timerExpired(unsigned int timer) {
+
+    // Writing on a worker, the timer thread must never block
+    Executor::getInstance()->submit(this);
+
+}
+
+void Configurator::execute() {
+
+    syncToFile();
+
+}
+
+void Configurator::mergeFile(t_fileSnapshot const & file,
+                            std::map<std::string, std::string> const & dirty,
+                            std::vector<char> & data) {
+    std::map<std::string, std::string>::const_iterator d;
+    std::set<std::string> l_updated;
+    unsigned int l_pos = 0;
+    unsigned int i;
+
+    data.clear();
+
+    // Updating params values in place, the first definition is the used one
+    for (i=0; i<file.params.size(); i++) {
+        t_fileParam const & l_param = file.params[i];
+        d = dirty.find(std::string(&file.data[l_param.lable], l_param.lableLen));
+        if ( d == dirty.end() ||
+                findFileParam(file, &file.data[l_param.lable], l_param.lableLen) != (int)i ) {
+            continue;
+        }
+        data.insert(data.end(), file.data.begin()+l_pos,
+                        file.data.begin()+l_param.value);
+        data.insert(data.end(), (d->second).begin(), (d->second).end());
+        l_pos = l_param.value+l_param.valueLen;
+        l_updated.insert(d->first);
+    }
+    data.insert(data.end(), file.data.begin()+l_pos, file.data.end());
+
+    // Appending params not yet defined
+    if ( !data.empty() && data.back() != '\n' && l_updated.size() < dirty.size() ) {
+        data.push_back('\n');
+    }
+    for (d=dirty.begin(); d!=dirty.end(); d++) {
+        if ( l_updated.count(d->first) ) {
+            continue;
+        }
+        data.insert(data.end(), (d->first).begin(), (d->first).end());
+        data.push_back('\t');
+        data.insert(data.end(), (d->second).begin(), (d->second).end());
+        data.push_back('\n');
+    }
+
+}
+
 exitCode Configurator::syncToFile() {
+    std::map<std::string, std::string> l_dirty;
+    std::map<std::string, std::string>::iterator d;
+    t_mapProperty::iterator it;
+    t_fileSnapshot const * l_base;
+    t_fileSnapshot * l_file;
+    t_fileSnapshot * l_old;
+    std::vector<char> l_data;
+    unsigned long long l_start;
+    struct stat l_stat;
+    unsigned int l_retry;
+    exitCode result;
+
+    LOG4CPP_DEBUG(log, "Configurator::syncToFile()");
+
+    l_start = Utils::monotonicUsec();
+
+    // Collecting the params to sync
+    d_lock.enterMutex();
+    d_syncPending = false;
+    if ( !d_file ) {
+        // Never replacing a file not yet read
+        LOG4CPP_ERROR(log, "Configuration file not loaded, sync skipped");
+        d_lock.leaveMutex();
+        return CFG_WRITE_FAILED;
+    }
+    for (it=d_property.begin(); it!=d_property.end(); it++) {
+        if ( (it->second).toSync ) {
+            l_dirty[it->first] = (it->second).value;
+            (it->second).toSync = false;
+        }
+    }
+    if ( l_dirty.empty() ) {
+        d_lock.leaveMutex();
+        return OK;
+    }
+
+    for (l_retry=0; ; l_retry++) {
+
+        // Merging on the current configuration, the write is done
+        // without holding the lock
+        l_base = d_file;
+        mergeFile(*l_base, l_dirty, l_data);
+        d_lock.leaveMutex();
+
+        result = writeTemp(d_confFile, l_data);
+
+        d_lock.enterMutex();
+        if ( result != OK ) {
+            break;
+        }
+
+        // The file could have been reloaded, or edited and not yet
+        // reloaded, meanwhile: the file is replaced only if it is still
+        // the one merged on
+        if ( d_file == l_base && stat(d_confFile.c_str(), &l_stat) == 0 &&
+                sameStamp(d_file->stamp, l_stat) ) {
+            result = commitTemp(d_confFile);
+            break;
+        }
 
-    LOG4CPP_WARN(log, "Configurator::syncToFile(): TO BE IMPLEMENTED");
+        ::unlink((d_confFile + ".tmp").c_str());
+        if ( l_retry == CONFIGURATOR_SYNC_RETRIES ) {
+            LOG4CPP_ERROR(log, "Configuration file [%s] keeps changing, sync postponed",
+                            d_confFile.c_str());
+            result = CFG_WRITE_FAILED;
+            break;
+        }
+
+        LOG4CPP_INFO(log, "Configuration file [%s] changed while syncing, merging again",
+                        d_confFile.c_str());
+        if ( d_file == l_base ) {
+            // Applying the external changes before merging on them
+            d_lock.leaveMutex();
+            reload();
+            d_lock.enterMutex();
+        }
+
+    }
+
+    d_lastSync = Utils::monotonicUsec()/1000;
+    if ( result != OK ) {
+        // Retrying later, with the current values of the params
+        for (d=l_dirty.begin(); d!=l_dirty.end(); d++) {
+            it = d_property.find(d->first);
+            if ( it != d_property.end() ) {
+                (it->second).toSync = true;
+            }
+        }
+        scheduleSync();
+        d_lock.leaveMutex();
+        return result;
+    }
+
+    // The written content is the new base for successive syncs
+    l_file = new t_fileSnapshot;
+    l_file->data.swap(l_data);
+    parseFile(*l_file);
+    if ( stat(d_confFile.c_str(), &l_stat) == 0 ) {
+        getStamp(l_stat, l_file->stamp);
+    }
+    l_old = d_file;
+    d_file = l_file;
+    publishView(l_old);
+    d_lock.leaveMutex();
+
+    LOG4CPP_INFO(log, "Synced [%u] params to [%s] in [%lluus]",
+                    l_dirty.size(), d_confFile.c_str(),
+                    Utils::monotonicUsec()-l_start);
 
+    return OK;
+
+}
+
+exitCode Configurator::writeTemp(std::string const & path, std::vector<char> const & data) {
+    std::string l_tmpFile = path + ".tmp";
+    struct stat l_stat;
+    mode_t l_mode = 0644;
+    unsigned int i = 0;
+    ssize_t l_written;
+    int l_fd;
+
+    if ( stat(path.c_str(), &l_stat) == 0 ) {
+        l_mode = l_stat.st_mode & 07777;
+    }
+
+    l_fd = ::open(l_tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, l_mode);
+    if ( l_fd == -1 ) {
+        LOG4CPP_ERROR(log, "Unable to open configuration file [%s]: %s",
+                        l_tmpFile.c_str(), strerror(errno));
+        return CFG_WRITE_FAILED;
+    }
+
+    while ( i < data.size() ) {
+        l_written = ::write(l_fd, &data[i], data.size()-i);
+        if ( l_written == -1 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            break;
+        }
+        i += l_written;
+    }
+
+    // The content must be on disk before replacing the file
+    if ( i < data.size() || fsync(l_fd) == -1 ) {
+        LOG4CPP_ERROR(log, "Unable to write configuration file [%s]: %s",
+                        l_tmpFile.c_str(), strerror(errno));
+        ::close(l_fd);
+        ::unlink(l_tmpFile.c_str());
+        return CFG_WRITE_FAILED;
+    }
+    ::close(l_fd);
+
+    return OK;
+
+}
+
+exitCode Configurator::commitTemp(std::string const & path) {
+    std::string l_tmpFile = path + ".tmp";
+    std::string l_dir;
+    std::string::size_type l_pos;
+    int l_fd;
+
+    if ( ::rename(l_tmpFile.c_str(), path.c_str()) == -1 ) {
+        LOG4CPP_ERROR(log, "Unable to replace configuration file [%s]: %s",
+                        path.c_str(), strerror(errno));
+        ::unlink(l_tmpFile.c_str());
+        return CFG_WRITE_FAILED;
+    }
+
+    // Syncing the directory entry too
+    l_pos = path.rfind('/');
+    if ( l_pos == std::string::npos ) {
+        l_dir = ".";
+    } else {
+        l_dir = path.substr(0, l_pos ? l_pos : 1);
+    }
+    l_fd = ::open(l_dir.c_str(), O_RDONLY);
+    if ( l_fd != -1 ) {
+        fsync(l_fd);
+        ::close(l_fd);
+    }
+
+    return OK;
+
+}
+
+exitCode Configurator::writeFile(std::string const & path, std::vector<char> const & data) {
+    unsigned long long l_start;
+    exitCode result;
+
+    l_start = Utils::monotonicUsec();
+
+    result = writeTemp(path, data);
+    if ( result == OK ) {
+        result = commitTemp(path);
+    }
+    if ( result != OK ) {
+        return result;
+    }
 
+    LOG4CPP_INFO(log, "Written [%u] bytes to [%s] in [%lluus]",
+                    data.size(), path.c_str(),
+                    Utils::monotonicUsec()-l_start);
 
     return OK;
 
@@ -32,12 +32,46 @@
 
 #include <string>
 #include <list>
+#include <vector>
+#include <map>
+#include <stdint.h>
+#include <sys/stat.h>
 #include <controlbox/base/Exception.h>
 #include <log4cpp/Category.hh>
 #include <controlbox/base/Utility.h>
+#include <controlbox/base/Reactor.h>
+#include <controlbox/base/TimerWheel.h>
+#include <controlbox/base/Executor.h>
+#include <controlbox/base/Rcu.h>
+#include <controlbox/base/HashIndex.h>
+#include <cc++/thread.h>
 
 #define DEFAULT_CONFFILE_PATH "/etc/cbox/cbox.conf"
 
+/// The minimum time between successive configuration file writes [s]
+#define DEFAULT_SYNC_PERIOD "60"
+
+/// The time params updates are coalesced before the first write [ms]
+#define CONFIGURATOR_SYNC_DELAY	1000
+
+/// The times a sync is merged again on a configuration file changed while
+/// writing, before being postponed
+#define CONFIGURATOR_SYNC_RETRIES	3
+
+/// The suffix of the compiled configuration file path
+#define CONFIGURATOR_BLOB_SUFFIX	".bin"
+
+/// The compiled configuration format version, to be increased on each
+/// change of the compiled configuration layout
+#define CONFIGURATOR_BLOB_VERSION	3
+
+/// The alignment of the compiled configuration sections: the file content
+/// is padded to keep the params, which are used in place, aligned
+#define CONFIGURATOR_BLOB_ALIGN		8
+
+/// The separators of the items of list params
+#define CONFIGURATOR_LIST_SEPARATORS	" \t,"
+
 #define MAX_CONFFILE_LINE	256
 
 // Define needed by the filter compiler
@@ -49,7 +83,43 @@
 namespace controlbox {
 
 
-class Configurator {
+/// An object that could be notified about configuration params changes.
+class ConfigurationHandler {
+
+public:
+
+    virtual ~ConfigurationHandler() {};
+
+    /// Notify the change of a subscribed param.
+    /// This method is called once the whole new configuration has been
+    /// applied: the new value should be read using Configurator::param,
+    /// which returns the default value if the param has been removed.
+    /// @param param the lable of the changed param
+    virtual void paramChanged(std::string const & param) = 0;
+
+};
+
+/// The configuration params provider.
+/// Params are read from a configuration file, a line for each param
+/// with its lable followed by blanks and the value, while lines starting
+/// with '#' are comments. The file is read and parsed just once: params
+/// are indexed by an hash of their lables, pointing to their values
+/// within the loaded file content.
+/// Once watched the configuration file is reloaded on changes: the new
+/// content is parsed aside and then swapped as a whole, thus readers never
+/// see an half applied configuration, and the subscribers of the changed
+/// params are notified.
+/// Params set to be synched are written back to the configuration file by
+/// an Executor task: writes are coalesced, at most one each
+/// Configurator_syncPeriod seconds, and atomic, using a synched temporary
+/// file renamed over the configuration file.
+/// A configuration file could be compiled into a binary snapshot of its
+/// parsed and indexed content: at startup the compiled configuration, if
+/// not older than the configuration file, is loaded without any parsing.
+/// Params are read without locks from an immutable view of the loaded
+/// file and of the memory params, which is rebuilt and swapped in, RCU
+/// style, by each update.
+class Configurator : public ReactorHandler, public TimerHandler, public Task {
 
 //-----[ Types ]----------------------------------------------------------------
 
@@ -66,16 +136,114 @@ public:
 
     typedef list<t_subStrFilter *> t_strFilter;
 
+    /// The items of a list param
+    typedef std::vector<std::string> t_paramList;
+
 protected:
 
     struct param {
         bool toSync;		///< Set if the param shuld be updated on disk
+        bool cached;		///< Set if the value has been read from the file
         std::string value;
     };
     typedef struct param t_param;
 
     typedef map<std::string, t_param> t_mapProperty;
 
+    /// A param defined by the configuration file.
+    /// Lable and value are offsets within the loaded file content.
+    struct fileParam {
+        unsigned int lable;
+        unsigned int lableLen;
+        unsigned int value;
+        unsigned int valueLen;
+        unsigned int hash;
+    };
+    typedef struct fileParam t_fileParam;
+
+    typedef std::vector<t_fileParam> t_fileParams;
+
+    /// The values of the memory params
+    typedef std::map<std::string, std::string> t_values;
+
+    /// The identity of a configuration file version
+    struct fileStamp {
+        uint64_t inode;
+        uint64_t size;
+        int64_t mtime;			///< Modification time [s]
+        uint32_t mtimeNsec;		///< Modification time nanoseconds
+    };
+    typedef struct fileStamp t_fileStamp;
+
+    /// A parsed configuration file content.
+    struct fileSnapshot {
+        /// The version of the configuration file loaded
+        t_fileStamp stamp;
+        /// The configuration file content
+        std::vector<char> data;
+        /// The params defined by the configuration file, in file order
+        t_fileParams params;
+        /// The hash index of params
+        HashIndex index;
+    };
+    typedef struct fileSnapshot t_fileSnapshot;
+
+    /// The types of typed params
+    enum paramType {
+        PARAM_INT = 0,
+        PARAM_DOUBLE,
+        PARAM_BOOL,
+        PARAM_LIST,
+    };
+    typedef enum paramType t_paramType;
+
+    /// A param value parsed to its type
+    struct typedParam {
+        t_paramType type;
+        bool valid;			///< False if undefined or invalid
+        long intValue;
+        double doubleValue;
+        bool boolValue;
+        t_paramList listValue;
+    };
+    typedef struct typedParam t_typedParam;
+
+    /// A typed value is looked up by its string and type
+    typedef std::pair<std::string, t_paramType> t_typedKey;
+
+    typedef std::map<t_typedKey, t_typedParam> t_typedParams;
+
+    /// An immutable view of the params, used by lock-free readers
+    struct view {
+        /// The loaded configuration file, 0 if not yet loaded
+        t_fileSnapshot const * file;
+        /// The memory params, which override the file ones
+        t_values values;
+        /// The typed params parsed so far
+        t_typedParams typed;
+        /// The typed default values parsed so far
+        t_typedParams typedDefaults;
+    };
+    typedef struct view t_view;
+
+    /// The handlers subscribed to each param
+    typedef std::multimap<std::string, ConfigurationHandler *> t_subscriptions;
+
+    /// The header of a compiled configuration.
+    /// It's followed by the file content, padded to CONFIGURATOR_BLOB_ALIGN,
+    /// the params and the index.
+    struct blobHeader {
+        char magic[8];			///< CONFIGURATOR_BLOB_MAGIC
+        uint32_t version;		///< CONFIGURATOR_BLOB_VERSION
+        uint32_t paramSize;		///< The size of a t_fileParam
+        uint32_t dataSize;		///< The configuration file size
+        uint32_t paramsCount;		///< The number of params
+        uint32_t indexSize;		///< The index size, a power of two
+        uint32_t reserved;
+        t_fileStamp src;		///< The compiled file version
+    };
+    typedef struct blobHeader t_blobHeader;
+
 
 
 //-----[ Members ]--------------------------------------------------------------
@@ -98,6 +266,44 @@ protected:
     /// memory
     t_mapProperty d_property;
 
+    /// The loaded configuration file, 0 if not yet loaded
+    t_fileSnapshot * d_file;
+
+    /// Protect the loaded configuration and the memory params
+    ost::Mutex d_lock;
+
+    /// The current params view, used by readers
+    t_view * volatile d_view;
+
+    /// Track the readers of the params views
+    RcuDomain d_rcu;
+
+    /// The configured values of the typed params parsed so far, by param.
+    /// Entries are parsed again as soon as their string value changes, and
+    /// published to lock-free readers by the params views.
+    t_typedParams d_typed;
+
+    /// The default values of the typed params parsed so far, by value
+    t_typedParams d_typedDefaults;
+
+    /// The subscribed handlers
+    t_subscriptions d_subscriptions;
+
+    /// Protect the subscriptions, held while notifying handlers
+    ost::Mutex d_subLock;
+
+    /// The inotify file descriptor, -1 if the file is not watched
+    int d_inotify;
+
+    /// The timer triggering configuration file writes, 0 if not yet defined
+    TimerWheel::t_timerId d_syncTimer;
+
+    /// Set while a configuration file write is scheduled
+    bool d_syncPending;
+
+    /// The monotonic time of the last configuration file write [ms]
+    unsigned long long d_lastSync;
+
 
 //-----[ Methods ]--------------------------------------------------------------
 
@@ -119,6 +325,37 @@ public:
     std::string param(std::string const & param, std::string const & defaultValue = "", bool keep = false)
     throw (exceptions::IOException);
 
+    /// Retrive an integer configuration param.
+    /// Values are parsed as decimal integers, or hexadecimal ones if
+    /// prefixed by 0x (e.g. 10, -10, 0x0A), just once: the parsed value is
+    /// cached up to the next change of the param, whatever the default.
+    /// Invalid values are reported once, when first parsed or as soon as
+    /// they are loaded or set, falling back to the default value.
+    /// @param param the param you are searching for
+    /// @param defaultValue the default value, as it could be defined on
+    ///		the configuration file
+    long paramInt(std::string const & param, std::string const & defaultValue = "0")
+    throw (exceptions::IOException);
+
+    /// Retrive a floating point configuration param.
+    /// @see paramInt
+    double paramDouble(std::string const & param, std::string const & defaultValue = "0")
+    throw (exceptions::IOException);
+
+    /// Retrive a boolean configuration param.
+    /// Values 1, yes, true and on are true while 0, no, false and off are
+    /// false, ignoring case.
+    /// @see paramInt
+    bool paramBool(std::string const & param, std::string const & defaultValue = "0")
+    throw (exceptions::IOException);
+
+    /// Retrive a list configuration param.
+    /// Items are separated by blanks and/or commas, empty items are
+    /// discarded.
+    /// @see paramInt
+    t_paramList paramList(std::string const & param, std::string const & defaultValue = "")
+    throw (exceptions::IOException);
+
     /// Test if a param has a specified value.
     /// @param keep set to true to optimize multiple value test for the same param.
     inline bool testParam(std::string const & p, std::string const & expectedValue, bool keep = false) {
@@ -138,10 +375,62 @@ public:
     /// its value on disk.
     /// @param param the param whose value you want to update
     /// @param value the value to set
-    /// @param synk set if the param should be synched on disk
+    /// @param synk set if the param should be synched on disk, the
+    ///		write is asynchronous and coalesced with other updates
     exitCode setParam(std::string const & param, std::string const & value = "", bool sync = false)
     throw (exceptions::IOException);
 
+    /// Watch the configuration file for changes.
+    /// The file is reloaded, by the Reactor thread, each time it is
+    /// written or replaced.
+    /// @return OK on success, CFG_WATCH_FAILED otherwise
+    exitCode watch();
+
+    /// Reload the configuration file.
+    /// The new configuration is applied as a whole and then the
+    /// subscribers of the changed params are notified.
+    /// Params set by setParam are kept, and not notified.
+    /// @return OK on success, CFG_OPEN_FAILED if the file could not be
+    ///		read, in which case the current configuration is kept
+    exitCode reload();
+
+    /// Subscribe for changes of a param.
+    /// @param param the lable of the param to watch
+    /// @param handler the handler to notify on changes
+    void subscribe(std::string const & param, ConfigurationHandler * handler);
+
+    /// Cancel all the subscriptions of an handler.
+    /// Once returned the handler will not be notified anymore and, if
+    /// it was running, its notification has been completed.
+    void unsubscribe(ConfigurationHandler * handler);
+
+    /// Notify the configuration file changes
+    void fdReady(int fd, unsigned int events);
+
+    /// Compile the configuration file.
+    /// The configuration file is parsed and its binary snapshot written
+    /// to the configuration file path with CONFIGURATOR_BLOB_SUFFIX.
+    /// @return OK on success, CFG_OPEN_FAILED if the configuration file
+    ///		could not be read or changed since it has been loaded,
+    ///		CFG_WRITE_FAILED if the compiled configuration could not
+    ///		be written
+    exitCode compile();
+
+    /// Sync params to the configuration file.
+    /// Params set to be synched are updated, or appended if not yet
+    /// defined, into a temporary copy of the configuration file which is
+    /// then synched and renamed over it. If the configuration file has
+    /// been changed meanwhile the params are merged again on the new one.
+    /// @return OK on success, CFG_WRITE_FAILED otherwise, in which case the
+    ///		params are synched again later
+    exitCode syncToFile();
+
+    /// Schedule the write of the configuration file
+    void timerExpired(unsigned int timer);
+
+    /// Write the configuration file
+    void execute();
+
 
     /*
     	/// Compile a string filter.
@@ -157,12 +446,107 @@ protected:
 
     Configurator(std::string const & confFile);
 
+    /// Load and parse the configuration file.
+    /// @param snapshot the parsed configuration file
+    /// @return OK on success, CFG_OPEN_FAILED if the file could not be read
+    exitCode loadFile(t_fileSnapshot & snapshot);
+
+    /// Parse and index the content of a configuration file
+    void parseFile(t_fileSnapshot & snapshot);
+
+    /// Round a compiled configuration section size to CONFIGURATOR_BLOB_ALIGN
+    static uint64_t blobAlign(uint64_t size);
+
+    /// Load the compiled configuration.
+    /// @param snapshot the compiled configuration file
+    /// @return OK on success, CFG_BLOB_STALE if the configuration file
+    ///		has been changed after its compilation, CFG_BLOB_INVALID if
+    ///		the compiled configuration is missing or not valid
+    exitCode loadBlob(t_fileSnapshot & snapshot);
+
+    /// Write a file content, atomically replacing the file
+    /// @return OK on success, CFG_WRITE_FAILED otherwise
+    exitCode writeFile(std::string const & path, std::vector<char> const & data);
+
+    /// Write and sync the temporary copy of a file
+    /// @return OK on success, CFG_WRITE_FAILED otherwise
+    exitCode writeTemp(std::string const & path, std::vector<char> const & data);
+
+    /// Replace a file with its temporary copy
+    /// @return OK on success, CFG_WRITE_FAILED otherwise
+    exitCode commitTemp(std::string const & path);
+
+    /// Merge the params to sync into a configuration file content.
+    /// @param file the configuration file to merge on
+    /// @param dirty the params to update, or append, with their values
+    /// @param data the merged content
+    static void mergeFile(t_fileSnapshot const & file,
+                            std::map<std::string, std::string> const & dirty,
+                            std::vector<char> & data);
+
+    /// Get the identity of a file version
+    static void getStamp(struct stat const & st, t_fileStamp & stamp);
+
+    /// Check if a file is still the specified version
+    static bool sameStamp(t_fileStamp const & stamp, struct stat const & st);
+
+    /// Schedule the sync of the params to the configuration file.
+    /// The configuration lock must be held.
+    void scheduleSync();
+
+    /// Look for a param defined by a configuration file.
+    /// @return the index of the file param, -1 if not defined
+    static int findFileParam(t_fileSnapshot const & snapshot, char const * param, unsigned int len);
+
+    /// Get the value of a param defined by a configuration file
+    static std::string fileValue(t_fileSnapshot const & snapshot, int idx);
+
+    /// Collect the lables of params which differ between two configurations
+    static void diffFile(t_fileSnapshot const & from, t_fileSnapshot const & to,
+                            std::list<std::string> & changed);
+
+    /// Get a param value, loading the configuration file if required.
+    /// The configuration lock must be held.
+    /// @return false if the param is not defined
+    bool definedParam(std::string const & param, std::string & value)
+    throw (exceptions::IOException);
+
+    /// Get a typed param from the current view, without locking.
+    /// Params and defaults not yet parsed are parsed under the
+    /// configuration lock, and published for the next lookups.
+    t_typedParam lookupTyped(std::string const & param,
+                                    std::string const & defaultValue,
+                                    t_paramType type);
+
+    /// Get a typed param, parsing it if not yet cached.
+    /// The configuration lock must be held.
+    t_typedParam const & typedParam(std::string const & param,
+                                    std::string const & defaultValue,
+                                    t_paramType type);
+
+    /// Parse the configured value of a param, reporting invalid values.
+    /// The configuration lock must be held.
+    void parseParam(std::string const & param, t_typedParam & typed);
+
+    /// Parse again the cached typed values of a changed param.
+    /// The configuration lock must be held.
+    void refreshTyped(std::string const & param);
+
+    /// Parse a value to a type.
+    /// @return true if the value is valid for the type
+    static bool parseTyped(std::string const & value, t_typedParam & typed);
+
+    /// Swap in a new view of the current params.
+    /// The configuration lock must be held.
+    /// @param release a replaced configuration file to delete, once no
+    ///		more used by readers
+    void publishView(t_fileSnapshot * release = 0);
+
     /// Add a param to the memory map.
     /// @param sync set if the param should be synched to disk
-    exitCode addParam(std::string const & param, std::string const & value, bool sync = false);
-
-    /// Sync map to file.
-    exitCode syncToFile();
+    /// @param cached set if the value has been read from the file
+    exitCode addParam(std::string const & param, std::string const & value,
+                        bool sync = false, bool cached = false);
 
 };
 
@@ -36,7 +36,12 @@ DeviceDB * DeviceDB::d_instance = 0;
 
 
 DeviceDB::DeviceDB(std::string const & logName) :
+        d_snapshot(0),
+        d_writeLock("dbWriteLock"),
         log(log4cpp::Category::getInstance("controlbox."+logName)) {
+
+    d_snapshot = buildSnapshot(t_deviceEntries());
+
 }
 
 DeviceDB * DeviceDB::getInstance() {
@@ -54,36 +59,202 @@ DeviceDB::~DeviceDB() {
 
     LOG4CPP_DEBUG(log, "DeviceDB::~DeviceDB()");
 
-    // flushing the db <map>
-    d_deviceDB.clear();
+    // flushing the db snapshot
+    delete d_snapshot;
+    d_snapshot = 0;
+
+}
+
+bool DeviceDB::parseId(Device::t_deviceId const & id, long & value) {
+    unsigned int l_len = id.size();
+    unsigned int i = 0;
+    bool l_neg = false;
+
+    if ( l_len && id[0] == '-' ) {
+        l_neg = true;
+        i++;
+    }
+
+    // Only canonical representations, thus each number has just one id,
+    // and at most 9 digits, thus it fits a long
+    if ( i == l_len || l_len-i > 9 ||
+            (id[i] == '0' && (l_neg || l_len-i > 1)) ) {
+        return false;
+    }
+
+    value = 0;
+    for ( ; i<l_len; i++) {
+        if ( id[i] < '0' || id[i] > '9' ) {
+            return false;
+        }
+        value = value*10 + (id[i]-'0');
+    }
+
+    if ( l_neg ) {
+        value = -value;
+    }
+
+    return true;
+}
+
+unsigned int DeviceDB::hash(Device::t_deviceType type, long id) {
+    unsigned int l_hash;
+
+    // Knuth multiplicative hashing, mixing in the type
+    l_hash = ((unsigned int)id) * 2654435761U;
+    l_hash ^= ((unsigned int)type) * 40503U;
+
+    return l_hash;
+}
+
+unsigned int DeviceDB::hash(Device::t_deviceType type, Device::t_deviceId const & id) {
+    long l_numId;
+
+    if ( parseId(id, l_numId) ) {
+        return hash(type, l_numId);
+    }
+
+    // FNV-1a, seeded by the type
+    return hashFnv(id, (HASH_FNV_BASIS ^ (unsigned int)type) * HASH_FNV_PRIME);
+}
+
+DeviceDB::t_snapshot * DeviceDB::buildSnapshot(t_deviceEntries const & entries) {
+    t_snapshot * l_snap = new t_snapshot();
+    unsigned int i;
+
+    l_snap->entries = entries;
+    l_snap->index.reset(entries.size());
+    for (i=0; i<entries.size(); i++) {
+        l_snap->index.insert(entries[i].hash, i);
+    }
+
+    return l_snap;
+}
+
+void DeviceDB::publish(t_snapshot * snapshot) {
+    t_snapshot * l_old = d_snapshot;
+
+    atomicSet(&d_snapshot, snapshot);
+
+    // Waiting for readers which could still use the previous snapshot
+    d_rcu.synchronize();
+
+    delete l_old;
+
+}
+
+int DeviceDB::find(t_snapshot const * snapshot, Device::t_deviceType type) {
+    t_deviceEntries const & l_entries = snapshot->entries;
+    unsigned int l_first = 0;
+    unsigned int l_last = l_entries.size();
+    unsigned int l_mid;
+
+    // Entries are sorted by type: looking for the first one of the type
+    while ( l_first < l_last ) {
+        l_mid = (l_first+l_last)/2;
+        if ( l_entries[l_mid].type < type ) {
+            l_first = l_mid+1;
+        } else {
+            l_last = l_mid;
+        }
+    }
+
+    if ( l_first == l_entries.size() ||
+            l_entries[l_first].type != type ) {
+        return -1;
+    }
+
+    return l_first;
+}
+
+DeviceDB::t_deviceEntry const * DeviceDB::find(t_snapshot const * snapshot,
+                                               Device::t_deviceType type, long id) {
+    unsigned int l_hash = hash(type, id);
+    unsigned int l_slot;
+    t_deviceEntry const * l_entry;
+    int l_idx;
+
+    for (l_slot = snapshot->index.first(l_hash); (l_idx = snapshot->index.probe(l_slot)) != -1; ) {
+        l_entry = &snapshot->entries[l_idx];
+        if ( l_entry->hash == l_hash && l_entry->type == type &&
+                l_entry->numeric && l_entry->numId == id ) {
+            return l_entry;
+        }
+    }
+
+    return 0;
+}
+
+DeviceDB::t_deviceEntry const * DeviceDB::find(t_snapshot const * snapshot,
+                                               Device::t_deviceType type,
+                                               Device::t_deviceId const & id) {
+    unsigned int l_hash;
+    unsigned int l_slot;
+    t_deviceEntry const * l_entry;
+    long l_numId;
+    int l_idx;
+
+    if ( parseId(id, l_numId) ) {
+        return find(snapshot, type, l_numId);
+    }
 
+    l_hash = hash(type, id);
+    for (l_slot = snapshot->index.first(l_hash); (l_idx = snapshot->index.probe(l_slot)) != -1; ) {
+        l_entry = &snapshot->entries[l_idx];
+        if ( l_entry->hash == l_hash && l_entry->type == type &&
+                l_entry->id == id ) {
+            return l_entry;
+        }
+    }
+
+    return 0;
 }
 
 exitCode DeviceDB::registerDevice(Device * device, Device::t_deviceType const & type, Device::t_deviceId const & id, bool override) {
     DeviceDB::t_deviceEntry entry;
-    t_dbEntry::iterator it;
+    t_deviceEntry const * l_old;
+    t_deviceEntries l_entries;
+    t_deviceEntries::iterator it;
 
     LOG4CPP_DEBUG(log, "DeviceDB::registerDevice(Device * device, type=%d, id='%s', override=%s)", type, id.c_str(), override ? "YES" : "NO" );
 
     entry.type = type;
     entry.id = id;
     entry.device = device;
+    entry.numeric = parseId(id, entry.numId);
+    if ( !entry.numeric ) {
+        entry.numId = 0;
+    }
+    entry.hash = hash(type, id);
+
+    d_writeLock.enterMutex();
 
-    it = find (entry.type, entry.id);
+    l_entries = d_snapshot->entries;
+    l_old = find(d_snapshot, type, id);
 
     // Eventually avoid device duplication (if overriding is not required)
-    if ( (it != d_deviceDB.end()) ) {
-        if ( override ) {
-            d_deviceDB.erase(it);
-        } else {
+    if ( l_old ) {
+        if ( !override ) {
+            d_writeLock.leaveMutex();
             LOG4CPP_WARN(log, "Trying to duplicate a device [%s]", id.c_str());
             return DB_DEVICE_DUPLICATE;
         }
+        l_entries.erase(l_entries.begin() + (l_old - &d_snapshot->entries[0]));
     }
 
-    d_deviceDB.insert( pair<Device::t_deviceType, t_deviceEntry>(type,entry) );
+    // Appending the device after the other ones of the same type
+    for (it=l_entries.begin(); it!=l_entries.end(); it++) {
+        if ( it->type > type ) {
+            break;
+        }
+    }
+    l_entries.insert(it, entry);
+
+    publish(buildSnapshot(l_entries));
 
-    if ( override && (it != d_deviceDB.end()) ) {
+    d_writeLock.leaveMutex();
+
+    if ( l_old ) {
         LOG4CPP_WARN(log, "Overriding device [%s] registration into class type [%d]", id.c_str(), type);
     } else {
         LOG4CPP_INFO(log, "Registered new device [%s (id: %s)] of class type [%d:%s]", device->name().c_str(), id.c_str(), type, Device::d_deviceTypeName[type]);
@@ -95,139 +266,126 @@ exitCode DeviceDB::registerDevice(Device * device, Device::t_deviceType const &
 
 
 exitCode DeviceDB::unregisterDevice(Device * device, Device::t_deviceType const & type, Device::t_deviceId const & id) {
-    t_dbEntry::iterator it;
+    t_deviceEntry const * l_entry;
+    t_deviceEntries l_entries;
 
     LOG4CPP_DEBUG(log, "DeviceDB::unregisterDevice(Device * device, type=%d, id='%s')", type, id.c_str());
 
-    it = find (type, id);
+    d_writeLock.enterMutex();
+
+    l_entry = find(d_snapshot, type, id);
 
     // If the device was NOT registered
-    if ( (it == d_deviceDB.end()) ||
-            (device != (it->second).device ) ) {
+    if ( !l_entry || device != l_entry->device ) {
+        d_writeLock.leaveMutex();
         LOG4CPP_WARN(log, "Trying to remove a device [%s] NOT registered", id.c_str());
         return DB_DEVICE_NOT_EXIST;
     }
 
-    d_deviceDB.erase(it);
-    LOG4CPP_INFO(log, "Unregistered device [%s] of class type [%d:%s]", id.c_str(), type, Device::d_deviceTypeName[type]);
-
-    return OK;
-
-}
-
+    l_entries = d_snapshot->entries;
+    l_entries.erase(l_entries.begin() + (l_entry - &d_snapshot->entries[0]));
+    publish(buildSnapshot(l_entries));
 
-inline
-DeviceDB::t_dbEntry::iterator DeviceDB::find(Device::t_deviceType const & type) {
-    t_dbEntry::iterator it;
-
-    LOG4CPP_DEBUG(log, "DeviceDB::find(type=%d)", type);
-
-    it = d_deviceDB.find(type);
-
-    // At this point: either it == d_deviceDB.end() or point
-    //  to a the first device within the specified class
-    return it;
-}
-
-inline
-DeviceDB::t_dbEntry::iterator DeviceDB::find(Device::t_deviceType const & type, Device::t_deviceId const & id) {
-    t_dbEntry::iterator first;
-    t_dbEntry::iterator it;
-    t_deviceEntry entry;
-
-    LOG4CPP_DEBUG(log, "DeviceDB::find(type=%d, id='%s')", type, id.c_str());
-
-    it = first = find(type);
-    // Checking among alle lables of required type
-    if ( it != d_deviceDB.end() ) {
-        LOG4CPP_DEBUG(log, "Checking devices in class type=%d", first->first);
-        do {
-            entry = it->second;
-            LOG4CPP_DEBUG(log, "Checking [%s]... ", entry.id.c_str());
-            if ( entry.id == id ) {
-                LOG4CPP_DEBUG(log, "Device [%s] FOUND!", id.c_str());
-                return it;
-            }
-            it++;
-        } while ( (it != d_deviceDB.end()) &&
-                  (it->first == first->first) );
-
-        LOG4CPP_DEBUG(log, "Search finished!");
+    d_writeLock.leaveMutex();
 
+    LOG4CPP_INFO(log, "Unregistered device [%s] of class type [%d:%s]", id.c_str(), type, Device::d_deviceTypeName[type]);
 
+    return OK;
 
-        if ( it == d_deviceDB.end() ||
-                (it->first != first->first) ) {
-            // No duplicated lables found!
-            LOG4CPP_DEBUG(log, "Device [%s] not present in DB", id.c_str());
-            it = d_deviceDB.end();
-            return it;
-        }
-    }
-    // At this point: either it == d_deviceDB.end() or point
-    //  to a device with the same lable (ready to ovverride it)
-    return it;
 }
 
 Device * DeviceDB::getDevice(Device::t_deviceType const & type, std::string const & id) {
-    t_dbEntry::iterator it;
+    t_deviceEntry const * l_entry;
+    Device * l_device = 0;
+    unsigned int l_epoch;
+
+    l_epoch = d_rcu.readLock();
+    l_entry = find(atomicRead(&d_snapshot), type, id);
+    if ( l_entry ) {
+        l_device = l_entry->device;
+    }
+    d_rcu.readUnlock(l_epoch);
 
-    it = find (type, id);
-    // Eventuallu avoid device duplication (if overriding is not required)
-    if ( it == d_deviceDB.end() ) {
+    if ( !l_device ) {
         LOG4CPP_DEBUG(log, "The required device [%s] is not registered", id.c_str());
-        return 0;
     }
 
-    return (it->second).device;
+    return l_device;
 
 }
 
 Device * DeviceDB::getDevice(Device::t_deviceType const & type, short int id) {
-    std::ostringstream strId("");
+    t_deviceEntry const * l_entry;
+    Device * l_device = 0;
+    unsigned int l_epoch;
+
+    l_epoch = d_rcu.readLock();
+    l_entry = find(atomicRead(&d_snapshot), type, (long)id);
+    if ( l_entry ) {
+        l_device = l_entry->device;
+    }
+    d_rcu.readUnlock(l_epoch);
+
+    if ( !l_device ) {
+        LOG4CPP_DEBUG(log, "The required device [%hd] is not registered", id);
+    }
 
-    strId << id;
-    return getDevice(type, strId.str());
+    return l_device;
 
 }
 
 
 Device * DeviceDB::getDevice(Device::t_deviceType const & type) {
-    t_dbEntry::iterator it;
+    t_snapshot const * l_snap;
+    Device * l_device = 0;
+    unsigned int l_epoch;
+    int l_idx;
+
+    l_epoch = d_rcu.readLock();
+    l_snap = atomicRead(&d_snapshot);
+    l_idx = find(l_snap, type);
+    if ( l_idx != -1 ) {
+        l_device = l_snap->entries[l_idx].device;
+    }
+    d_rcu.readUnlock(l_epoch);
 
-    it = find (type);
-    // Eventuallu avoid device duplication (if overriding is not required)
-    if ( it == d_deviceDB.end() ) {
+    if ( !l_device ) {
         LOG4CPP_INFO(log, "There is no one device of the required class [%d] registerd", type);
-        return 0;
     }
 
-    return (it->second).device;
+    return l_device;
 }
 
 
 std::string DeviceDB::printDB(Device::t_deviceType const & type) {
-    t_dbEntry::iterator it, first;
+    t_snapshot const * l_snap;
+    unsigned int l_epoch;
+    unsigned int i;
+    int l_idx;
     unsigned count = 0;
     std::ostringstream dump("");
 
+    l_epoch = d_rcu.readLock();
+    l_snap = atomicRead(&d_snapshot);
+
     if ( type != Device::UNDEF) {
-        it = first = find(type);
-        while ( (it != d_deviceDB.end()) &&
-                (it->first == first->first) ) {
-            count++;
-            dump << "\n" << type << " " << (it->second).id;
-            it++;
+        l_idx = find(l_snap, type);
+        if ( l_idx != -1 ) {
+            for (i=l_idx; i<l_snap->entries.size() &&
+                    l_snap->entries[i].type == type; i++) {
+                count++;
+                dump << "\n" << type << " " << l_snap->entries[i].id;
+            }
         }
     } else {
-        it = d_deviceDB.begin();
-        while ( it != d_deviceDB.end() ) {
+        for (i=0; i<l_snap->entries.size(); i++) {
             count++;
-            dump << "\n" << (it->second).type << " " << (it->second).id;
-            it++;
+            dump << "\n" << l_snap->entries[i].type << " " << l_snap->entries[i].id;
         }
     }
 
+    d_rcu.readUnlock(l_epoch);
+
     dump << "\n" << count << " registered device/s";
     if ( type ) {
         dump << " of class " << type;
@@ -32,13 +32,22 @@
 
 #include <controlbox/base/Utility.h>
 #include <controlbox/base/Device.h>
+#include <controlbox/base/Rcu.h>
+#include <controlbox/base/HashIndex.h>
+#include <cc++/thread.h>
+#include <vector>
 
 namespace controlbox {
 
 /// This interface define methods to save and retrive
 /// unique instances of system devices, either
 /// Generators, Dispatcher or Handlers, identified by their
-/// Device::t_deviceType.
+/// Device::t_deviceType.<br>
+/// Devices are indexed by an hash of their (type, id) key, numeric ids
+/// are hashed as integers thus lookups by a short int id never need to
+/// format it. Lookups never take locks: they are served by an immutable
+/// snapshot of the DB, (un)registrations build a new snapshot and swap
+/// it in, RCU style.
 class DeviceDB {
 
 private:
@@ -47,14 +56,36 @@ private:
         Device::t_deviceType type;
         Device::t_deviceId id;
         Device * device;
+        /// True if the id is the decimal representation of numId
+        bool numeric;
+        /// The numeric value of the id
+        long numId;
+        /// The hash of the (type, id) key
+        unsigned int hash;
     };
     typedef struct deviceEntry t_deviceEntry;
 
-    typedef multimap<Device::t_deviceType, t_deviceEntry> t_dbEntry;
+    /// Devices sorted by type, in registration order within each type
+    typedef std::vector<t_deviceEntry> t_deviceEntries;
+
+    /// An immutable view of the DB
+    struct snapshot {
+        t_deviceEntries entries;
+        /// The hash index of entries
+        HashIndex index;
+    };
+    typedef struct snapshot t_snapshot;
 
     static DeviceDB * d_instance;
 
-    t_dbEntry d_deviceDB;
+    /// The current DB snapshot, used by readers
+    t_snapshot * volatile d_snapshot;
+
+    /// Track the readers of the snapshots
+    RcuDomain d_rcu;
+
+    /// Serialize DB updates
+    ost::Mutex d_writeLock;
 
     log4cpp::Category & log;
 
@@ -88,6 +119,9 @@ public:
     /// device registerd into the class.
     Device * getDevice(Device::t_deviceType const & type);
 
+    /// Get a pointer to a Device from the DB by its numeric id.
+    /// This is the same of looking for the decimal representation
+    /// of the id, without formatting it.
     Device * getDevice(Device::t_deviceType const & type, short int id);
 
     Device * getDevice(Device::t_deviceType const & type, std::string const & id);
@@ -103,10 +137,40 @@ protected:
     /// Create a new DeviceDB
     DeviceDB(std::string const & logName = "DeviceDB");
 
-    inline DeviceDB::t_dbEntry::iterator find(Device::t_deviceType const & type);
+    /// Build a new snapshot indexing the specified entries.
+    static t_snapshot * buildSnapshot(t_deviceEntries const & entries);
+
+    /// Swap in a new snapshot.
+    /// The previous snapshot is deleted once all the readers which
+    /// could use it have completed.
+    /// @note must be called with the write lock held
+    void publish(t_snapshot * snapshot);
+
+    /// Look for the first device of the specified type.
+    /// @return the index of the entry, -1 if not found
+    static int find(t_snapshot const * snapshot, Device::t_deviceType type);
+
+    /// Look for a device by a numeric id.
+    /// @return the entry, 0 if not found
+    static t_deviceEntry const * find(t_snapshot const * snapshot,
+                                      Device::t_deviceType type, long id);
+
+    /// Look for a device.
+    /// @return the entry, 0 if not found
+    static t_deviceEntry const * find(t_snapshot const * snapshot,
+                                      Device::t_deviceType type,
+                                      Device::t_deviceId const & id);
+
+    /// Parse an id which is the canonical decimal representation of
+    /// a number, i.e. without leading zeros or a plus sign.
+    /// @return true if the id is numeric
+    static bool parseId(Device::t_deviceId const & id, long & value);
 
-    inline DeviceDB::t_dbEntry::iterator find(Device::t_deviceType const & type, Device::t_deviceId const & id);
+    /// Hash a (type, numeric id) key
+    static unsigned int hash(Device::t_deviceType type, long id);
 
+    /// Hash a (type, id) key
+    static unsigned int hash(Device::t_deviceType type, Device::t_deviceId const & id);
 
 };
 
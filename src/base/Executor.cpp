@@ -0,0 +1,362 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#include "Executor.ih"
+
+namespace controlbox {
+
+Executor * Executor::d_instance = 0;
+
+
+Executor::Executor(unsigned int workers, std::string const & logName) :
+	Object(logName),
+	d_pending(0),
+	d_idle(0),
+	d_cancelling(0),
+	d_next(0),
+	d_submitted(0),
+	d_executed(0),
+	d_stolen(0),
+	d_doExit(false) {
+	unsigned int l_id;
+
+	LOG4CPP_DEBUG(log, "Executor::Executor(workers=%u)", workers);
+
+	if ( !workers ) {
+		LOG4CPP_WARN(log, "At least one worker is required");
+		workers = 1;
+	}
+	if ( workers > EXECUTOR_MAX_WORKERS ) {
+		LOG4CPP_WARN(log, "Too many workers [%u], using [%u]",
+				workers, EXECUTOR_MAX_WORKERS);
+		workers = EXECUTOR_MAX_WORKERS;
+	}
+
+	for (l_id=0; l_id<workers; l_id++) {
+		d_workers.push_back(new Worker(this, l_id));
+	}
+
+	LOG4CPP_INFO(log, "Executing tasks with [%u] workers", workers);
+
+}
+
+Executor * Executor::getInstance(unsigned int workers) {
+	unsigned int l_id;
+
+	if ( !d_instance ) {
+		d_instance = new Executor(workers);
+		// Workers are started once the instance is defined
+		for (l_id=0; l_id<d_instance->d_workers.size(); l_id++) {
+			d_instance->d_workers[l_id]->start();
+		}
+	}
+
+	return d_instance;
+}
+
+Executor::~Executor() {
+	t_workers::iterator l_it;
+	t_stats l_stats;
+
+	LOG4CPP_DEBUG(log, "Executor::~Executor()");
+
+	getStats(l_stats);
+	LOG4CPP_INFO(log, "Executor stats: submitted=%lu, executed=%lu, stolen=%lu, dropped=%u",
+			l_stats.submitted, l_stats.executed, l_stats.stolen, l_stats.pending);
+
+	// Terminating the worker threads
+	d_cond.enterMutex();
+	d_doExit = true;
+	d_cond.signal(true);
+	d_cond.leaveMutex();
+
+	for (l_it = d_workers.begin(); l_it != d_workers.end(); l_it++) {
+		(*l_it)->join();
+		delete (*l_it);
+	}
+	d_workers.clear();
+
+	d_instance = 0;
+
+}
+
+Executor::Worker * Executor::self() {
+	int l_tid = syscall(SYS_gettid);
+	t_workers::iterator l_it;
+
+	for (l_it = d_workers.begin(); l_it != d_workers.end(); l_it++) {
+		if ( (*l_it)->d_tid == l_tid ) {
+			return (*l_it);
+		}
+	}
+
+	return 0;
+}
+
+exitCode Executor::submit(Task * task) {
+	Worker * l_worker;
+
+	if ( !task ) {
+		LOG4CPP_ERROR(log, "Trying to submit a null task");
+		return GENERIC_ERROR;
+	}
+
+	// Continuations are kept on the submitting worker, other submissions
+	// are spread round robin
+	l_worker = self();
+	if ( !l_worker ) {
+		l_worker = d_workers[(unsigned)atomicInc(&d_next) % d_workers.size()];
+	}
+
+	l_worker->push(task);
+	atomicInc(&d_pending);
+	atomicInc(&d_submitted);
+
+	// Waking up an idle worker, if any
+	d_cond.enterMutex();
+	if ( d_idle ) {
+		d_cond.signal(false);
+	}
+	d_cond.leaveMutex();
+
+	return OK;
+
+}
+
+unsigned int Executor::cancel(Task * task) {
+	t_workers::iterator l_it;
+	unsigned int l_removed = 0;
+	bool l_running;
+
+	LOG4CPP_DEBUG(log, "Executor::cancel()");
+
+	for (l_it = d_workers.begin(); l_it != d_workers.end(); l_it++) {
+		l_removed += (*l_it)->remove(task);
+	}
+	if ( l_removed ) {
+		atomicAdd(&d_pending, -(int)l_removed);
+	}
+
+	// Waiting for a running execution to complete, unless we are called
+	// by the task itself
+	d_cond.enterMutex();
+	atomicInc(&d_cancelling);
+	do {
+		l_running = false;
+		for (l_it = d_workers.begin(); l_it != d_workers.end(); l_it++) {
+			if ( (*l_it)->running(task) &&
+					(*l_it)->d_tid != syscall(SYS_gettid) ) {
+				l_running = true;
+				break;
+			}
+		}
+		if ( l_running ) {
+			d_cond.wait(0, true);
+		}
+	} while ( l_running );
+	atomicDec(&d_cancelling);
+	d_cond.leaveMutex();
+
+	return l_removed;
+
+}
+
+void Executor::getStats(t_stats & stats) {
+
+	stats.submitted = atomicRead(&d_submitted);
+	stats.executed = atomicRead(&d_executed);
+	stats.stolen = atomicRead(&d_stolen);
+	stats.workers = d_workers.size();
+	stats.pending = atomicRead(&d_pending);
+
+}
+
+Task * Executor::next(Worker * worker) {
+	Task * l_task;
+	unsigned int l_count;
+	unsigned int l_victim;
+
+	l_task = worker->pop();
+	if ( l_task ) {
+		return l_task;
+	}
+
+	// Stealing the oldest task of another worker
+	l_count = d_workers.size();
+	for (l_victim=1; l_victim<l_count; l_victim++) {
+		l_task = d_workers[(worker->d_id + l_victim) % l_count]->steal(worker);
+		if ( l_task ) {
+			atomicInc(&d_stolen);
+			return l_task;
+		}
+	}
+
+	return 0;
+
+}
+
+void Executor::execute(Worker * worker, Task * task) {
+
+	task->execute();
+	atomicInc(&d_executed);
+
+	// Releasing cancel requests waiting for this task
+	worker->done();
+	if ( atomicRead(&d_cancelling) ) {
+		d_cond.enterMutex();
+		d_cond.signal(true);
+		d_cond.leaveMutex();
+	}
+
+}
+
+void Executor::idle() {
+
+	d_cond.enterMutex();
+	d_idle++;
+	// Tasks submitted before we got the lock are already accounted
+	if ( !d_doExit && !atomicRead(&d_pending) ) {
+		d_cond.wait(0, true);
+	}
+	d_idle--;
+	d_cond.leaveMutex();
+
+}
+
+
+Executor::Worker::Worker(Executor * executor, unsigned int id) :
+	d_tid(0),
+	d_id(id),
+	d_executor(executor),
+	d_current(0) {
+}
+
+void Executor::Worker::push(Task * task) {
+	d_lock.enterMutex();
+	d_tasks.push_back(task);
+	d_lock.leaveMutex();
+}
+
+Task * Executor::Worker::pop() {
+	Task * l_task = 0;
+
+	d_lock.enterMutex();
+	if ( !d_tasks.empty() ) {
+		l_task = d_tasks.back();
+		d_tasks.pop_back();
+		atomicSet(&d_current, l_task);
+		atomicDec(&d_executor->d_pending);
+	}
+	d_lock.leaveMutex();
+
+	return l_task;
+}
+
+Task * Executor::Worker::steal(Worker * thief) {
+	Task * l_task = 0;
+
+	d_lock.enterMutex();
+	if ( !d_tasks.empty() ) {
+		l_task = d_tasks.front();
+		d_tasks.pop_front();
+		atomicSet(&thief->d_current, l_task);
+		atomicDec(&d_executor->d_pending);
+	}
+	d_lock.leaveMutex();
+
+	return l_task;
+}
+
+unsigned int Executor::Worker::remove(Task * task) {
+	std::deque<Task *>::iterator l_it;
+	unsigned int l_removed = 0;
+
+	d_lock.enterMutex();
+	l_it = d_tasks.begin();
+	while ( l_it != d_tasks.end() ) {
+		if ( (*l_it) == task ) {
+			l_it = d_tasks.erase(l_it);
+			l_removed++;
+			continue;
+		}
+		l_it++;
+	}
+	d_lock.leaveMutex();
+
+	return l_removed;
+}
+
+bool Executor::Worker::running(Task * task) {
+	return ( atomicRead(&d_current) == task );
+}
+
+void Executor::Worker::done() {
+	atomicSet(&d_current, (Task *)0);
+}
+
+void Executor::Worker::run (void) {
+	controlbox::ThreadDB *l_tdb = ThreadDB::getInstance();
+	Heartbeat * l_hb;
+	char l_name[8];
+	Task * l_task;
+
+	snprintf(l_name, 8, "EX%u", d_id);
+
+	d_tid = syscall(SYS_gettid);
+	LOG4CPP_INFO(d_executor->log, "Thread [%s (%d)] started", l_name, d_tid);
+
+	this->setName(l_name);
+	l_tdb->registerThread(this, d_tid);
+	l_hb = l_tdb->getHeartbeat(d_tid);
+
+	while ( !d_executor->d_doExit ) {
+
+		l_task = d_executor->next(this);
+		if ( l_task ) {
+			if ( l_hb ) {
+				l_hb->busy("task");
+			}
+			d_executor->execute(this, l_task);
+			if ( l_hb ) {
+				l_hb->idle();
+			}
+			continue;
+		}
+
+		d_executor->idle();
+
+	}
+
+	LOG4CPP_WARN(d_executor->log, "Thread [%s (%d)] terminated", this->getName(), d_tid);
+	l_tdb->unregisterThread(this);
+
+}
+
+}// controlbox namespace
@@ -0,0 +1,210 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _EXECUTOR_H
+#define _EXECUTOR_H
+
+#include <controlbox/base/Object.h>
+#include <controlbox/base/Utility.h>
+#include <cc++/thread.h>
+#include <deque>
+#include <vector>
+
+/// The default number of Executor worker threads
+#define EXECUTOR_DEFAULT_WORKERS	2
+/// The maximum number of Executor worker threads
+#define EXECUTOR_MAX_WORKERS	16
+
+namespace controlbox {
+
+/// A unit of work that could be run by the Executor.
+class Task {
+
+public:
+
+    virtual ~Task() {};
+
+    /// Run the task.
+    /// This method is called by an Executor worker thread: blocking here
+    /// stalls a worker, blocking I/O should be waited using the Reactor.
+    /// A task could submit itself again as its own continuation.
+    virtual void execute() = 0;
+
+};
+
+/// A work-stealing task executor.
+/// The Executor is a singleton running submitted Tasks on a (configurable)
+/// small set of worker threads, thus devices could run their logic as tasks
+/// instead of owning a dedicated thread.<br>
+/// Each worker has its own tasks deque: tasks submitted by a worker (e.g.
+/// continuations) are pushed on its own deque and run LIFO, to exploit
+/// caches, while tasks submitted by other threads are spread round robin.
+/// An idle worker steals the oldest tasks from the other workers.
+class Executor : public Object {
+
+public:
+
+    /// Executor usage statistics
+    struct stats {
+        unsigned long submitted;	///< Tasks submitted
+        unsigned long executed;		///< Tasks executed
+        unsigned long stolen;		///< Tasks executed by a worker other than the submission one
+        unsigned int workers;		///< Number of worker threads
+        unsigned int pending;		///< Tasks waiting to be executed
+    };
+    typedef struct stats t_stats;
+
+protected:
+
+    /// A worker thread
+    class Worker : public ost::PosixThread {
+    public:
+        Worker(Executor * executor, unsigned int id);
+        ~Worker() {};
+        void run (void);
+        /// Push a task on the back of the deque
+        void push(Task * task);
+        /// Pop a task from the back of the deque (local run)
+        Task * pop();
+        /// Pop a task from the front of the deque on behalf of another worker
+        Task * steal(Worker * thief);
+        /// Remove all the queued instances of a task
+        unsigned int remove(Task * task);
+        /// Return true if the worker is running the task
+        bool running(Task * task);
+        /// Mark the current task completed
+        void done();
+        /// The worker thread ID
+        int d_tid;
+        /// The worker index
+        unsigned int d_id;
+    protected:
+        Executor * d_executor;
+        /// The worker tasks
+        std::deque<Task *> d_tasks;
+        /// The task currently running, 0 if none.
+        /// It's set while the task is still owned by a deque lock: once
+        /// removed from the deques a task is always seen by cancel.
+        Task * volatile d_current;
+        /// Protect the deque
+        ost::Mutex d_lock;
+    };
+    // Allowing inner class to access Executor members
+    friend class Worker;
+
+    typedef std::vector<Worker *> t_workers;
+
+    static Executor * d_instance;
+
+    /// The worker threads
+    t_workers d_workers;
+
+    /// Used to wakeup idle workers and cancel requests
+    ost::Conditional d_cond;
+
+    /// The number of queued tasks
+    volatile int d_pending;
+
+    /// The number of workers waiting for new tasks
+    unsigned int d_idle;
+
+    /// The number of cancel requests waiting for a running task
+    volatile int d_cancelling;
+
+    /// The next worker receiving external submissions
+    volatile int d_next;
+
+    /// Usage counters
+    volatile unsigned long d_submitted;
+    volatile unsigned long d_executed;
+    volatile unsigned long d_stolen;
+
+    /// Set true when the worker threads should terminate
+    bool d_doExit;
+
+public:
+
+    /// Get an instance of Executor
+    /// Executor is a singleton class, this method provide a pointer to
+    /// the (eventually just created and started) only one instance.
+    /// @param workers the number of worker threads; considered only by
+    ///		the call building the instance
+    static Executor * getInstance(unsigned int workers = EXECUTOR_DEFAULT_WORKERS);
+
+    /// Get the instance of Executor, if any.
+    /// Unlike getInstance, the instance is never built: this could be
+    /// safely used on shutdown paths.
+    /// @return the Executor instance, 0 if not yet built or terminated
+    static inline Executor * peekInstance() {
+        return d_instance;
+    };
+
+    /// Terminate the worker threads.
+    /// Tasks still queued are dropped.
+    ~Executor();
+
+    /// Submit a task for execution.
+    /// @param task the task to run
+    /// @return OK on success
+    exitCode submit(Task * task);
+
+    /// Cancel a task.
+    /// All the queued instances of the task are removed and, if the task is
+    /// running, its execution is completed before returning: the task could
+    /// then be safely released. A task could cancel itself.
+    /// @return the number of queued instances removed
+    unsigned int cancel(Task * task);
+
+    /// Collect usage statistics.
+    void getStats(t_stats & stats);
+
+protected:
+
+    /// Build a new Executor
+    Executor(unsigned int workers, std::string const & logName = "Executor");
+
+    /// Return the worker running on the calling thread, 0 if the caller
+    /// is not a worker
+    Worker * self();
+
+    /// Get the next task for a worker, eventually stealing it
+    Task * next(Worker * worker);
+
+    /// Run a task accounting its execution
+    void execute(Worker * worker, Task * task);
+
+    /// Wait for new tasks to be submitted.
+    void idle();
+
+};
+
+}// controlbox namespace
+
+#endif
@@ -0,0 +1,140 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+#ifndef _HASHINDEX_H
+#define _HASHINDEX_H
+
+#include <string>
+#include <vector>
+
+/// The FNV-1a 32 bits offset basis
+#define HASH_FNV_BASIS	2166136261U
+/// The FNV-1a 32 bits prime
+#define HASH_FNV_PRIME	16777619U
+
+namespace controlbox {
+
+/// FNV-1a hash of a buffer.
+/// @param p_hash the hash to continue, by default a new one is started
+inline unsigned int hashFnv(char const * p_data, unsigned int p_len,
+				unsigned int p_hash = HASH_FNV_BASIS) {
+	unsigned int i;
+
+	for (i=0; i<p_len; i++) {
+		p_hash ^= (unsigned char)p_data[i];
+		p_hash *= HASH_FNV_PRIME;
+	}
+
+	return p_hash;
+}
+
+/// FNV-1a hash of a string.
+/// @see hashFnv
+inline unsigned int hashFnv(std::string const & p_str,
+				unsigned int p_hash = HASH_FNV_BASIS) {
+	return hashFnv(p_str.data(), p_str.size(), p_hash);
+}
+
+/// An open addressing hash index of the entries of a vector.
+/// Slots hold the entries indexes, -1 for empty ones, and collisions are
+/// resolved by linear probing. The index is sized to be at most half full,
+/// thus probing sequences are short and always end on an empty slot.<br>
+/// Entries are compared by their users: lookups just probe the candidates.
+/// @code
+///	for (l_slot = index.first(l_hash); (l_idx = index.probe(l_slot)) != -1; ) {
+///		if ( match(entries[l_idx]) ) {
+///			return l_idx;
+///		}
+///	}
+/// @endcode
+struct HashIndex {
+
+	/// The entries indexes, -1 for empty slots
+	std::vector<int> slots;
+
+	/// The number of slots minus one, the size is a power of two
+	unsigned int mask;
+
+	HashIndex() :
+		mask(0) {
+	};
+
+	/// Clear the index, sizing it for the specified number of entries
+	void reset(unsigned int p_count) {
+		unsigned int l_size = 8;
+
+		// Keeping the index at most half full
+		while ( l_size < 2*p_count ) {
+			l_size <<= 1;
+		}
+		slots.assign(l_size, -1);
+		mask = l_size-1;
+	};
+
+	/// Load the slots of an already built index.
+	/// @param p_size the number of slots, a power of two
+	void assign(int const * p_slots, unsigned int p_size) {
+		slots.assign(p_slots, p_slots+p_size);
+		mask = p_size-1;
+	};
+
+	/// Index an entry by its hash
+	void insert(unsigned int p_hash, int p_entry) {
+		unsigned int l_slot = p_hash & mask;
+
+		while ( slots[l_slot] != -1 ) {
+			l_slot = (l_slot+1) & mask;
+		}
+		slots[l_slot] = p_entry;
+	};
+
+	/// Get the first slot to probe for a hash
+	inline unsigned int first(unsigned int p_hash) const {
+		return p_hash & mask;
+	};
+
+	/// Probe a slot, moving to the next one.
+	/// @return the entry index of the probed slot, -1 once the probing
+	///		sequence is over
+	inline int probe(unsigned int & p_slot) const {
+		int l_idx;
+
+		if ( slots.empty() ) {
+			return -1;
+		}
+		l_idx = slots[p_slot];
+		p_slot = (p_slot+1) & mask;
+		return l_idx;
+	};
+
+};
+
+}// namespace controlbox
+
+#endif
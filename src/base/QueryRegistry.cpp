@@ -34,7 +34,12 @@ QueryRegistry * QueryRegistry::d_instance = 0;
 
 
 QueryRegistry::QueryRegistry(std::string const & logName) :
+        d_snapshot(0),
+        d_writeLock("qrWriteLock"),
         log(log4cpp::Category::getInstance("controlbox."+logName)) {
+
+    d_snapshot = buildSnapshot(t_queryEntries());
+
 }
 
 QueryRegistry * QueryRegistry::getInstance() {
@@ -52,14 +57,60 @@ QueryRegistry::~QueryRegistry() {
 
     LOG4CPP_DEBUG(log, "QueryRegistry::~QueryRegistry()");
 
-    // flushing the registry <map>
-    d_queryRegistry.clear();
+    // flushing the registry snapshot
+    delete d_snapshot;
+    d_snapshot = 0;
+
+}
+
+QueryRegistry::t_snapshot * QueryRegistry::buildSnapshot(t_queryEntries const & entries) {
+    t_snapshot * l_snap = new t_snapshot();
+    unsigned int i;
+
+    l_snap->entries = entries;
+    l_snap->index.reset(entries.size());
+    for (i=0; i<entries.size(); i++) {
+        l_snap->index.insert(entries[i].hash, i);
+    }
+
+    return l_snap;
+}
+
+int QueryRegistry::find(t_snapshot const * snapshot, t_queryName const & query) {
+    unsigned int l_hash = hashFnv(query);
+    unsigned int l_slot;
+    int l_idx;
+
+    for (l_slot = snapshot->index.first(l_hash); (l_idx = snapshot->index.probe(l_slot)) != -1; ) {
+        if ( snapshot->entries[l_idx].hash == l_hash &&
+                snapshot->entries[l_idx].name == query ) {
+            return l_idx;
+        }
+    }
+
+    return -1;
+}
+
+void QueryRegistry::publish(t_snapshot * snapshot, t_pQdesc release) {
+    t_snapshot * l_old = d_snapshot;
+
+    atomicSet(&d_snapshot, snapshot);
+
+    // Waiting for readers which could still use the previous snapshot,
+    // or the Querible and descriptor looked up from it
+    d_rcu.synchronize();
+
+    delete l_old;
+    if ( release ) {
+        delete release;
+    }
 
 }
 
 exitCode QueryRegistry::registerQuery(Querible * querible, t_pQdesc queryDescriptor) {
-    t_queryRegistry::iterator queryIt;
     std::string const & query = (queryDescriptor->name);
+    t_queryEntries l_entries;
+    t_queryEntry l_entry;
 
     LOG4CPP_DEBUG(log, "QueryRegistry::registerQuery(query=%s, querible=%p)", query.c_str(), querible);
 
@@ -68,15 +119,25 @@ exitCode QueryRegistry::registerQuery(Querible * querible, t_pQdesc queryDescrip
         return QR_MISSING_QUERIBLE;
     }
 
+    d_writeLock.enterMutex();
+
     // Avoid query name duplication
-    queryIt = d_queryRegistry.find(query);
-    if ( (queryIt != d_queryRegistry.end()) ) {
+    if ( find(d_snapshot, query) != -1 ) {
+        d_writeLock.leaveMutex();
         LOG4CPP_WARN(log, "Query already registered [%s]", query.c_str());
         return QR_QUERY_DUPLICATE;
     }
 
-    d_queryRegistry.insert(t_queryRegistryEntry(query, querible));
-    d_queribleRegistry.insert(t_queribleRegistryEntry(querible, queryDescriptor));
+    l_entry.name = query;
+    l_entry.hash = hashFnv(query);
+    l_entry.querible = querible;
+    l_entry.descr = queryDescriptor;
+
+    l_entries = d_snapshot->entries;
+    l_entries.push_back(l_entry);
+    publish(buildSnapshot(l_entries));
+
+    d_writeLock.leaveMutex();
 
     LOG4CPP_INFO(log, "Registered new query [%s] exported by Querible [%s]", query.c_str(), querible->name().c_str());
 
@@ -86,170 +147,177 @@ exitCode QueryRegistry::registerQuery(Querible * querible, t_pQdesc queryDescrip
 
 
 exitCode QueryRegistry::unregisterQuery(t_queryName const & query, bool release) {
-    t_queryRegistry::iterator queryIt;
-    t_queribleRegistry::iterator queribleIt;
-    t_queribleRegistry::iterator firstDescr;
-    t_pQdesc	pDesc;
+    t_queryEntries l_entries;
+    t_pQuerible l_querible;
+    t_pQdesc l_descr;
+    int l_idx;
 
     LOG4CPP_DEBUG(log, "QueryRegistry::unregisterQuery(query=%s, release=%s)", query.c_str(), release ? "YES" : "NO" );
 
-    queryIt = d_queryRegistry.find(query);
+    d_writeLock.enterMutex();
+
+    l_idx = find(d_snapshot, query);
 
     // If the query was NOT registered
-    if ( (queryIt == d_queryRegistry.end())) {
+    if ( l_idx == -1 ) {
+        d_writeLock.leaveMutex();
         LOG4CPP_WARN(log, "Trying to remove a query [%s] NOT registered", query.c_str());
         return QR_QUERY_NOT_EXIST;
     }
 
-    // looking for a query descriptor
-    queribleIt = firstDescr = d_queribleRegistry.find(queryIt->second);
-    while ( queribleIt != d_queribleRegistry.end() ) {
-        if ( queribleIt->first != firstDescr->first) {
-            queribleIt = d_queribleRegistry.end();
-            break;
-        }
-        pDesc = queribleIt->second;
-        if ( pDesc->name == query ) {
-            break;
-        }
-        queribleIt++;
-    }
-    // Eventually releasing the query desciption
-    if (queribleIt != d_queribleRegistry.end()) {
-        if (release) {
-            delete (queribleIt->second);
-        }
-        d_queribleRegistry.erase(queribleIt);
-    }
+    l_entries = d_snapshot->entries;
+    l_querible = l_entries[l_idx].querible;
+    l_descr = l_entries[l_idx].descr;
+    l_entries.erase(l_entries.begin()+l_idx);
 
-    d_queryRegistry.erase(queryIt);
-    LOG4CPP_INFO(log, "Unregistered query [%s] exported by Querible [%s]", query.c_str(), (queryIt->second)->name().c_str());
+    // Eventually releasing the query desciption, once no more used
+    publish(buildSnapshot(l_entries), release ? l_descr : 0);
+
+    d_writeLock.leaveMutex();
+
+    LOG4CPP_INFO(log, "Unregistered query [%s] exported by Querible [%s]", query.c_str(), l_querible->name().c_str());
 
     return OK;
 }
 
-Querible * QueryRegistry::getQuerible(t_queryName const & query) {
-    t_queryRegistry::iterator queryIt;
+QueryRegistry::Guard::Guard() :
+        d_registry(QueryRegistry::getInstance()) {
 
-    queryIt = d_queryRegistry.find(query);
-    if ( queryIt != d_queryRegistry.end() ) {
-        return queryIt->second;
-    }
+    d_epoch = d_registry->d_rcu.readLock();
+
+}
+
+QueryRegistry::Guard::~Guard() {
 
-    return 0;
+    d_registry->d_rcu.readUnlock(d_epoch);
 
 }
 
-Querible::t_queryDescription const * QueryRegistry::getQueryDescriptor(t_queryName const & query, Querible * querible) {
-    t_queribleRegistry::iterator firstDescr;
-    t_queribleRegistry::iterator queribleIt;
+Querible * QueryRegistry::lookup(t_queryName const & query, t_pQdesc & descr,
+                                Guard const & guard) {
+    t_snapshot const * l_snap;
+    Querible * l_querible = 0;
+    int l_idx;
 
-    // looking for a query descriptor
-    queribleIt = firstDescr = d_queribleRegistry.find(querible);
-    while ( queribleIt != d_queribleRegistry.end() ) {
-        if ( queribleIt->first != firstDescr->first) {
-            queribleIt = d_queribleRegistry.end();
-            break;
-        }
-        if ( queribleIt->second->name == query ) {
-            break;
-        }
-        queribleIt++;
-    }
+    descr = 0;
 
-    if (queribleIt != d_queribleRegistry.end()) {
-        return (queribleIt->second);
+    // NOTE the snapshot, and what it references, is kept alive by the guard
+    l_snap = atomicRead(&d_snapshot);
+    l_idx = find(l_snap, query);
+    if ( l_idx != -1 ) {
+        l_querible = l_snap->entries[l_idx].querible;
+        descr = l_snap->entries[l_idx].descr;
     }
 
-    return 0;
+    return l_querible;
 
 }
 
-Querible::t_queryDescription const * QueryRegistry::getQueryDescriptor(t_queryName const & query) {
-    Querible * querible;
+Querible * QueryRegistry::getQuerible(t_queryName const & query, Guard const & guard) {
+    t_pQdesc l_descr;
 
-    querible = getQuerible(query);
-    if ( !querible ) {
+    return lookup(query, l_descr, guard);
+
+}
+
+Querible::t_queryDescription const * QueryRegistry::getQueryDescriptor(t_queryName const & query,
+                                Querible * querible, Guard const & guard) {
+    t_pQdesc l_descr;
+
+    if ( lookup(query, l_descr, guard) != querible ) {
         return 0;
     }
 
-    return getQueryDescriptor(query, querible);
+    return l_descr;
+
+}
+
+Querible::t_queryDescription const * QueryRegistry::getQueryDescriptor(t_queryName const & query,
+                                Guard const & guard) {
+    t_pQdesc l_descr;
+
+    lookup(query, l_descr, guard);
+
+    return l_descr;
 
 }
 
+unsigned int QueryRegistry::printQuerible(std::ostringstream & dump, t_snapshot const * snapshot,
+                                        t_pQuerible querible, std::string const & radix,
+                                        std::vector<bool> & printed) {
+    t_pQdesc l_descr;
+    unsigned int count = 0;
+    unsigned int i;
 
+    dump << "\r\nQuery exported by [" << querible->name() << "]:";
+
+    for (i=0; i<snapshot->entries.size(); i++) {
+        if ( snapshot->entries[i].querible != querible ) {
+            continue;
+        }
+        printed[i] = true;
+        count++;
+
+        l_descr = snapshot->entries[i].descr;
+        dump << "\r\n  ";
+        dump << radix << setw(10) << left << l_descr->name << " ";
+        if (l_descr->flags & QST_RO) {
+            dump << "r";
+        } else {
+            dump << "-";
+        }
+        if (l_descr->flags & QST_WO) {
+            dump << "w";
+        } else {
+            dump << "-";
+        }
+        dump << " " << setw(40) << left << l_descr->description << " ";
+        if ( l_descr->flags & QST_WO ) {
+            dump << "\r\n" << setw(20) << " " << l_descr->supportedValues << " ";
+        }
+    }
+
+    return count;
+
+}
 
 std::string QueryRegistry::printRegistry(t_queryName const & query, std::string const & radix) {
-    t_queryRegistry::iterator queryIt;
-    t_queribleRegistry::iterator it, first;
+    t_snapshot const * l_snap;
+    std::vector<bool> l_printed;
+    unsigned int l_epoch;
+    unsigned int i;
+    int l_idx;
     unsigned count = 0;
     std::ostringstream dump("");
 
+    l_epoch = d_rcu.readLock();
+    l_snap = atomicRead(&d_snapshot);
+    l_printed.assign(l_snap->entries.size(), false);
+
     if ( query.size() ) {
-        queryIt = d_queryRegistry.find(query);
-        if ( queryIt == d_queryRegistry.end() ) {
+        l_idx = find(l_snap, query);
+        if ( l_idx == -1 ) {
+            d_rcu.readUnlock(l_epoch);
             LOG4CPP_WARN(log, "Required query is not registered");
             return "";
         }
-        it = first = d_queribleRegistry.find(queryIt->second);
-        if (it != d_queribleRegistry.end()) {
-            dump << "\r\nQuery exported by [" << (it->first)->name() << "]:";
-            while ( (it != d_queribleRegistry.end()) &&
-                    (it->first == first->first) ) {
-                count++;
-                dump << "\r\n  ";
-                dump << radix << setw(10) << left << it->second->name << " ";
-                if (it->second->flags & QST_RO) {
-                    dump << "r";
-                } else {
-                    dump << "-";
-                }
-                if (it->second->flags & QST_WO) {
-                    dump << "w";
-                } else {
-                    dump << "-";
-                }
-                dump << " " << setw(40) << left << it->second->description << " ";
-                if ( it->second->flags & QST_WO ) {
-                    dump << "\r\n" << setw(20) << " " << it->second->supportedValues << " ";
-                }
-                it++;
-            }
-        }
+        count = printQuerible(dump, l_snap, l_snap->entries[l_idx].querible,
+                              radix, l_printed);
     } else {
-        it = d_queribleRegistry.begin();
-        first = d_queribleRegistry.end();
-        while ( it != d_queribleRegistry.end() ) {
-            count++;
-            if (it->first != first->first) {
-                dump << "\r\nQuery exported by [" << (it->first)->name() << "]:";
-                first = it;
-            }
-            dump << "\r\n  ";
-            dump << radix << setw(10) << left << it->second->name << " ";
-            if (it->second->flags & QST_RO) {
-                dump << "r";
-            } else {
-                dump << "-";
-            }
-            if (it->second->flags & QST_WO) {
-                dump << "w";
-            } else {
-                dump << "-";
+        // Queries are grouped by Querible, in registration order
+        for (i=0; i<l_snap->entries.size(); i++) {
+            if ( !l_printed[i] ) {
+                count += printQuerible(dump, l_snap, l_snap->entries[i].querible,
+                                       radix, l_printed);
             }
-            dump << " " << setw(40) << left << it->second->description << " ";
-            if ( it->second->flags & QST_WO ) {
-                dump << "\r\n" << setw(20) << " " << it->second->supportedValues << " ";
-            }
-            it++;
         }
     }
 
+    d_rcu.readUnlock(l_epoch);
+
     dump << "\r\nTotal: " << count << " registered query\r\n";
 
     return dump.str();
 }
 
-
 }
-
@@ -33,13 +33,22 @@
 
 #include <controlbox/base/Utility.h>
 #include <controlbox/base/Querible.h>
-#include <map>
+#include <controlbox/base/Rcu.h>
+#include <controlbox/base/HashIndex.h>
+#include <cc++/thread.h>
+#include <vector>
 
 namespace controlbox {
 
 /// Class defining a QueryRegistry.
 /// A QueryRegistry allow to associate lable to reference to
 /// objects implementing Querible<br>
+/// Queries are indexed by an hash of their names, thus lookups cost O(1).
+/// Lookups never take locks: they are served by an immutable snapshot of
+/// the registry, (un)registrations build a new snapshot and swap it in,
+/// RCU style. The previous snapshot, and the descriptors unregistered
+/// with it, are released once all the readers which could be still using
+/// them have released their Guard.<br>
 /// @note This class is <i>abstract</i> and should be derived in order to
 ///	actually implement an EndPoint.
 /// <br>
@@ -58,6 +67,29 @@ class QueryRegistry  {
 //------------------------------------------------------------------------------
   public:
 
+	/// A registry read-side section.
+	/// Querible and descriptor pointers returned by the registry are
+	/// valid only while the Guard used for the lookup is alive: queries
+	/// unregistered meanwhile are released only once it is destroyed.
+	/// @note a Guard must not be held while (un)registering queries,
+	///	that would wait for the Guard itself.
+	class Guard {
+	  protected:
+		/// The guarded registry
+		QueryRegistry * d_registry;
+		/// The read-side section epoch
+		unsigned int d_epoch;
+	  public:
+		/// Enter a read-side section of the registry
+		Guard();
+		/// Leave the read-side section
+		~Guard();
+	  private:
+		Guard(Guard const &);
+		Guard & operator=(Guard const &);
+	};
+	friend class Guard;
+
 
 //------------------------------------------------------------------------------
 //				PRIVATE TYPES
@@ -68,13 +100,23 @@ class QueryRegistry  {
 	typedef Querible * t_pQuerible;
 	typedef Querible::t_queryDescription const * t_pQdesc;
 
-	/// Registered query
-	typedef map<t_queryName, t_pQuerible> t_queryRegistry;
-	typedef pair<t_queryName, t_pQuerible> t_queryRegistryEntry;
+	/// A registered query
+	struct queryEntry {
+		t_queryName name;	///< The query name
+		unsigned int hash;	///< The query name hash
+		t_pQuerible querible;	///< The Querible exporting the query
+		t_pQdesc descr;		///< The query descriptor
+	};
+	typedef struct queryEntry t_queryEntry;
+
+	typedef std::vector<t_queryEntry> t_queryEntries;
 
-	/// Query grouped by Querible.
-	typedef multimap<t_pQuerible, t_pQdesc> t_queribleRegistry;
-	typedef pair<t_pQuerible, t_pQdesc> t_queribleRegistryEntry;
+	/// An immutable snapshot of the registry
+	struct snapshot {
+		t_queryEntries entries;		///< Queries, in registration order
+		HashIndex index;		///< The hash index of entries
+	};
+	typedef struct snapshot t_snapshot;
 
 //------------------------------------------------------------------------------
 //				PRIVATE MEMBERS
@@ -83,9 +125,14 @@ class QueryRegistry  {
 
 	static QueryRegistry * d_instance;
 
-	t_queryRegistry d_queryRegistry;
+	/// The current registry snapshot, used by readers
+	t_snapshot * volatile d_snapshot;
+
+	/// Track the readers of the snapshots
+	RcuDomain d_rcu;
 
-	t_queribleRegistry d_queribleRegistry;
+	/// Serialize registry updates
+	ost::Mutex d_writeLock;
 
 	log4cpp::Category & log;
 
@@ -125,22 +172,38 @@ class QueryRegistry  {
 	/// Get a pointer to the Querible exporting the specified query.
 	/// Return a generic Querible pointer to
 	/// the device that has registered the specified query<br>
+	/// @param guard the read-side section the pointer is valid within
 	/// @return a Querible's pointer to the specified t_queryName if
 	/// present into the registry, a zero-pointer if ther's no such
 	/// a query registerd.
-	Querible * getQuerible(t_queryName const & query);
+	Querible * getQuerible(t_queryName const & query, Guard const & guard);
 
 	/// Get a pointer to the Query Descriptor for the specified query.
+	/// @param guard the read-side section the pointer is valid within
 	/// @return a t_queryDescription's pointer to the specified t_queryName if
 	/// present into the registry, a zero-pointer if ther's no such
 	/// a query registerd.
-	Querible::t_queryDescription const * getQueryDescriptor(t_queryName const & query);
+	Querible::t_queryDescription const * getQueryDescriptor(t_queryName const & query,
+				Guard const & guard);
 
 	/// Get a pointer to the QueribleDescriptor exporting the specified query.
+	/// @param guard the read-side section the pointer is valid within
 	/// @return a QueribleDescriptor's pointer to the specified t_queryName if
 	/// present into the registry, a zero-pointer if ther's no such
 	/// a query registerd.
-	Querible::t_queryDescription const * getQueryDescriptor(t_queryName const & query, Querible * querible);
+	Querible::t_queryDescription const * getQueryDescriptor(t_queryName const & query,
+				Querible * querible, Guard const & guard);
+
+	/// Get both the Querible and the descriptor of the specified query.
+	/// This requires a single lookup.
+	/// @param query the query name
+	/// @param descr the query descriptor, a zero-pointer if the query
+	///	is not registered
+	/// @param guard the read-side section the pointers are valid within
+	/// @return a Querible's pointer to the specified t_queryName if
+	/// present into the registry, a zero-pointer otherwise.
+	Querible * lookup(t_queryName const & query, t_pQdesc & descr,
+				Guard const & guard);
 
 	/// Print registered query.
 	/// This method return a string with a report of registerd query.
@@ -158,6 +221,27 @@ class QueryRegistry  {
 	/// Create a new QueryRegistry
 	QueryRegistry(std::string const & logName = "QueryRegistry");
 
+	/// Build a new snapshot indexing the specified queries.
+	static t_snapshot * buildSnapshot(t_queryEntries const & entries);
+
+	/// Swap in a new snapshot.
+	/// The previous snapshot, and the descriptors to release, are
+	/// deleted once all the readers which could use them have completed.
+	/// @note must be called with the write lock held
+	void publish(t_snapshot * snapshot, t_pQdesc release = 0);
+
+	/// Look for a query into a snapshot.
+	/// @return the index of the query entry, -1 if not found
+	static int find(t_snapshot const * snapshot, t_queryName const & query);
+
+
+	/// Dump the queries exported by a Querible.
+	/// @param printed set true for each dumped entry
+	/// @return the number of dumped queries
+	static unsigned int printQuerible(std::ostringstream & dump,
+				t_snapshot const * snapshot, t_pQuerible querible,
+				std::string const & radix, std::vector<bool> & printed);
+
 
 //------------------------------------------------------------------------------
 //				Command Parsers
@@ -0,0 +1,102 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _RCU_H
+#define _RCU_H
+
+#include <controlbox/base/Atomic.h>
+#include <sched.h>
+
+namespace controlbox {
+
+/// A minimal read-copy-update domain.
+/// Data structures mostly read and seldom updated could be shared as
+/// immutable snapshots: writers build a new snapshot, swap it in and then
+/// release the previous one once no reader could be using it anymore.<br>
+/// Readers never take locks: they just announce themselves, by readLock(),
+/// on the counter of the current epoch. Each synchronize() starts a new
+/// epoch and waits for the readers of the previous one.
+/// @note writers must be serialized by the caller.
+class RcuDomain {
+
+protected:
+
+    /// The current epoch
+    volatile unsigned int d_epoch;
+
+    /// Readers within a read-side section, for each epoch parity
+    volatile int d_readers[2];
+
+public:
+
+    RcuDomain() :
+        d_epoch(0) {
+        d_readers[0] = d_readers[1] = 0;
+    };
+
+    /// Enter a read-side section.
+    /// @return the epoch to pass to readUnlock()
+    inline unsigned int readLock() {
+        unsigned int l_epoch;
+
+        // A concurrent synchronize() could have started a new epoch
+        // meanwhile: in that case we retry, thus the writer never
+        // misses a reader it should wait for
+        for (;;) {
+            l_epoch = atomicRead(&d_epoch);
+            atomicInc(&d_readers[l_epoch & 1]);
+            if ( atomicRead(&d_epoch) == l_epoch ) {
+                return l_epoch;
+            }
+            atomicDec(&d_readers[l_epoch & 1]);
+        }
+    };
+
+    /// Leave a read-side section.
+    inline void readUnlock(unsigned int epoch) {
+        atomicDec(&d_readers[epoch & 1]);
+    };
+
+    /// Wait for all the readers which could still use a snapshot
+    /// swapped out before this call.
+    inline void synchronize() {
+        unsigned int l_epoch = d_epoch;
+
+        atomicSet(&d_epoch, l_epoch+1);
+        while ( atomicRead(&d_readers[l_epoch & 1]) ) {
+            sched_yield();
+        }
+    };
+
+};
+
+}// controlbox namespace
+
+#endif
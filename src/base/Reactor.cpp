@@ -0,0 +1,376 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#include "Reactor.ih"
+
+namespace controlbox {
+
+Reactor * Reactor::d_instance = 0;
+
+
+Reactor::Reactor(std::string const & logName) :
+	Object(logName),
+	d_epfd(-1),
+	d_firing(-1),
+	d_doExit(false),
+	d_tid(0) {
+	struct epoll_event l_event;
+
+	LOG4CPP_DEBUG(log, "Reactor::Reactor()");
+
+	d_wakeup[0] = d_wakeup[1] = -1;
+
+	d_epfd = epoll_create(REACTOR_MAX_EVENTS);
+	if ( d_epfd < 0 ) {
+		LOG4CPP_FATAL(log, "Failed creating the epoll descriptor: %s", strerror(errno));
+		return;
+	}
+
+	if ( pipe(d_wakeup) ) {
+		LOG4CPP_FATAL(log, "Failed creating the wakeup pipe: %s", strerror(errno));
+		return;
+	}
+	fcntl(d_wakeup[0], F_SETFL, O_NONBLOCK);
+
+	memset(&l_event, 0, sizeof(l_event));
+	l_event.events = EPOLLIN;
+	l_event.data.fd = d_wakeup[0];
+	if ( epoll_ctl(d_epfd, EPOLL_CTL_ADD, d_wakeup[0], &l_event) ) {
+		LOG4CPP_FATAL(log, "Failed watching the wakeup pipe: %s", strerror(errno));
+	}
+
+}
+
+Reactor * Reactor::getInstance() {
+
+	if ( !d_instance ) {
+		d_instance = new Reactor("Reactor");
+		d_instance->start();
+	}
+
+	LOG4CPP_DEBUG(d_instance->log, "Reactor::getInstance()");
+
+	return d_instance;
+}
+
+Reactor::~Reactor() {
+
+	LOG4CPP_DEBUG(log, "Reactor::~Reactor()");
+
+	// Terminating the reactor thread
+	d_doExit = true;
+	if ( d_wakeup[1] >= 0 ) {
+		::write(d_wakeup[1], "x", 1);
+	}
+	join();
+
+	if ( d_watches.size() ) {
+		LOG4CPP_WARN(log, "Dropping [%u] watches still defined", d_watches.size());
+	}
+	d_watches.clear();
+
+	if ( d_wakeup[0] >= 0 ) {
+		::close(d_wakeup[0]);
+		::close(d_wakeup[1]);
+	}
+	if ( d_epfd >= 0 ) {
+		::close(d_epfd);
+	}
+
+	d_instance = 0;
+
+}
+
+exitCode Reactor::watch(int fd, ReactorHandler * handler, unsigned int events) {
+	t_watch l_watch;
+
+	LOG4CPP_DEBUG(log, "Reactor::watch(fd=%d, events=0x%X)", fd, events);
+
+	if ( !handler ) {
+		LOG4CPP_ERROR(log, "Trying to watch [%d] without an handler", fd);
+		return GENERIC_ERROR;
+	}
+
+	l_watch.handler = handler;
+	l_watch.dispatcher = 0;
+	l_watch.events = events;
+
+	return addWatch(fd, l_watch);
+
+}
+
+exitCode Reactor::watch(int fd, comsys::Dispatcher * dispatcher, unsigned int events) {
+	t_watch l_watch;
+
+	LOG4CPP_DEBUG(log, "Reactor::watch(fd=%d, events=0x%X)", fd, events);
+
+	if ( !dispatcher ) {
+		LOG4CPP_ERROR(log, "Trying to watch [%d] without a dispatcher", fd);
+		return CS_DISPATCH_FAILURE;
+	}
+
+	l_watch.handler = 0;
+	l_watch.dispatcher = dispatcher;
+	l_watch.events = events;
+
+	return addWatch(fd, l_watch);
+
+}
+
+exitCode Reactor::addWatch(int fd, t_watch const & watch) {
+	struct epoll_event l_event;
+
+	memset(&l_event, 0, sizeof(l_event));
+	l_event.events = watch.events;
+	if ( watch.dispatcher ) {
+		l_event.events |= EPOLLONESHOT;
+	}
+	l_event.data.fd = fd;
+
+	d_cond.enterMutex();
+
+	if ( d_watches.find(fd) != d_watches.end() ) {
+		d_cond.leaveMutex();
+		LOG4CPP_WARN(log, "File descriptor [%d] already watched", fd);
+		return RCT_FD_ALREADY_WATCHED;
+	}
+
+	if ( epoll_ctl(d_epfd, EPOLL_CTL_ADD, fd, &l_event) ) {
+		d_cond.leaveMutex();
+		LOG4CPP_ERROR(log, "Failed watching [%d]: %s", fd, strerror(errno));
+		return RCT_EPOLL_FAILURE;
+	}
+
+	d_watches[fd] = watch;
+
+	d_cond.leaveMutex();
+
+	LOG4CPP_INFO(log, "Watching file descriptor [%d], events [0x%X]", fd, watch.events);
+
+	return OK;
+
+}
+
+exitCode Reactor::updateWatch(int fd, t_watch const & watch) {
+	struct epoll_event l_event;
+
+	memset(&l_event, 0, sizeof(l_event));
+	l_event.events = watch.events;
+	if ( watch.dispatcher ) {
+		l_event.events |= EPOLLONESHOT;
+	}
+	l_event.data.fd = fd;
+
+	if ( epoll_ctl(d_epfd, EPOLL_CTL_MOD, fd, &l_event) ) {
+		LOG4CPP_ERROR(log, "Failed updating watch [%d]: %s", fd, strerror(errno));
+		return RCT_EPOLL_FAILURE;
+	}
+
+	return OK;
+
+}
+
+exitCode Reactor::modify(int fd, unsigned int events) {
+	t_watches::iterator l_it;
+	exitCode result;
+
+	LOG4CPP_DEBUG(log, "Reactor::modify(fd=%d, events=0x%X)", fd, events);
+
+	d_cond.enterMutex();
+
+	l_it = d_watches.find(fd);
+	if ( l_it == d_watches.end() ) {
+		d_cond.leaveMutex();
+		LOG4CPP_WARN(log, "Trying to modify a not watched file descriptor [%d]", fd);
+		return RCT_FD_NOT_WATCHED;
+	}
+
+	l_it->second.events = events;
+	result = updateWatch(fd, l_it->second);
+
+	d_cond.leaveMutex();
+
+	return result;
+
+}
+
+exitCode Reactor::rearm(int fd) {
+	t_watches::iterator l_it;
+	exitCode result;
+
+	LOG4CPP_DEBUG(log, "Reactor::rearm(fd=%d)", fd);
+
+	d_cond.enterMutex();
+
+	l_it = d_watches.find(fd);
+	if ( l_it == d_watches.end() ) {
+		d_cond.leaveMutex();
+		LOG4CPP_WARN(log, "Trying to rearm a not watched file descriptor [%d]", fd);
+		return RCT_FD_NOT_WATCHED;
+	}
+
+	result = updateWatch(fd, l_it->second);
+
+	d_cond.leaveMutex();
+
+	return result;
+
+}
+
+exitCode Reactor::unwatch(int fd) {
+	t_watches::iterator l_it;
+	exitCode result = RCT_FD_NOT_WATCHED;
+
+	LOG4CPP_DEBUG(log, "Reactor::unwatch(fd=%d)", fd);
+
+	d_cond.enterMutex();
+
+	l_it = d_watches.find(fd);
+	if ( l_it != d_watches.end() ) {
+		// NOTE a struct is required by kernels older than 2.6.9
+		struct epoll_event l_event;
+		epoll_ctl(d_epfd, EPOLL_CTL_DEL, fd, &l_event);
+		d_watches.erase(l_it);
+		result = OK;
+	}
+
+	// Waiting for a running handler to complete, unless we are called
+	// by the handler itself
+	while ( d_firing == fd && syscall(SYS_gettid) != d_tid ) {
+		d_cond.wait(0, true);
+	}
+
+	d_cond.leaveMutex();
+
+	if ( result != OK ) {
+		LOG4CPP_WARN(log, "Trying to unwatch a not watched file descriptor [%d]", fd);
+	} else {
+		LOG4CPP_INFO(log, "Unwatched file descriptor [%d]", fd);
+	}
+
+	return result;
+
+}
+
+void Reactor::notify(int fd, unsigned int events) {
+	t_watches::iterator l_it;
+	t_watch l_watch;
+	bool l_dropped = false;
+
+	d_cond.enterMutex();
+
+	// Skipping file descriptors unwatched meanwhile
+	l_it = d_watches.find(fd);
+	if ( l_it == d_watches.end() ) {
+		d_cond.leaveMutex();
+		return;
+	}
+
+	l_watch = l_it->second;
+	d_firing = fd;
+
+	d_cond.leaveMutex();
+
+	if ( l_watch.handler ) {
+		l_watch.handler->fdReady(fd, events);
+	} else {
+		LOG4CPP_DEBUG(log, "Dispatching readiness of [%d]", fd);
+		l_watch.dispatcher->dispatch(false);
+	}
+
+	// Errors and hangups can't be masked: they would be reported again
+	// and again, up to the file descriptor closing. Dropping the watch,
+	// unless the handler has already replaced it.
+	d_cond.enterMutex();
+	if ( events & (FD_ERROR|FD_HANGUP) ) {
+		l_it = d_watches.find(fd);
+		if ( l_it != d_watches.end() &&
+				l_it->second.handler == l_watch.handler &&
+				l_it->second.dispatcher == l_watch.dispatcher ) {
+			// NOTE a struct is required by kernels older than 2.6.9
+			struct epoll_event l_event;
+			epoll_ctl(d_epfd, EPOLL_CTL_DEL, fd, &l_event);
+			d_watches.erase(l_it);
+			l_dropped = true;
+		}
+	}
+
+	// Releasing unwatch requests waiting for this handler
+	d_firing = -1;
+	d_cond.signal(true);
+	d_cond.leaveMutex();
+
+	if ( l_dropped ) {
+		LOG4CPP_WARN(log, "Dropped watch [%d] on %s", fd,
+				(events & FD_ERROR) ? "error" : "hangup");
+	}
+
+}
+
+void Reactor::run(void) {
+	controlbox::ThreadDB *l_tdb = ThreadDB::getInstance();
+	struct epoll_event l_events[REACTOR_MAX_EVENTS];
+	char l_drain[16];
+	int l_count;
+	int i;
+
+	d_tid = syscall(SYS_gettid);
+	LOG4CPP_INFO(log, "Thread [%s (%d)] started", "RCT", d_tid);
+
+	this->setName("RCT");
+	l_tdb->registerThread(this, d_tid);
+
+	while ( !d_doExit && d_epfd >= 0 ) {
+
+		l_count = epoll_wait(d_epfd, l_events, REACTOR_MAX_EVENTS, -1);
+		if ( l_count < 0 ) {
+			if ( errno == EINTR ) {
+				continue;
+			}
+			LOG4CPP_ERROR(log, "epoll_wait failed: %s", strerror(errno));
+			break;
+		}
+
+		for (i=0; i<l_count; i++) {
+			if ( l_events[i].data.fd == d_wakeup[0] ) {
+				while ( ::read(d_wakeup[0], l_drain, sizeof(l_drain)) > 0 );
+				continue;
+			}
+			notify(l_events[i].data.fd, l_events[i].events);
+		}
+
+	}
+
+	LOG4CPP_WARN(log, "Thread [%s (%d)] terminated", this->getName(), d_tid);
+	l_tdb->unregisterThread(this);
+
+}
+
+}// controlbox namespace
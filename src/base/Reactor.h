@@ -0,0 +1,205 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _REACTOR_H
+#define _REACTOR_H
+
+#include <controlbox/base/Object.h>
+#include <controlbox/base/Utility.h>
+#include <controlbox/base/comsys/Dispatcher.h>
+#include <cc++/thread.h>
+#include <sys/epoll.h>
+#include <map>
+
+/// The maximum number of readiness events collected by each epoll_wait
+#define REACTOR_MAX_EVENTS	16
+
+namespace controlbox {
+
+/// An object that could be notified by the Reactor about the readiness
+/// of a file descriptor.
+class ReactorHandler {
+
+public:
+
+    virtual ~ReactorHandler() {};
+
+    /// Notify the readiness of a watched file descriptor.
+    /// This method is called by the Reactor thread, shared by all the
+    /// watched file descriptors: its implementation should consume the
+    /// available data and return, it must never block.
+    /// @param fd the ready file descriptor
+    /// @param events the Reactor::fdEvent bitmask of ready events
+    virtual void fdReady(int fd, unsigned int events) = 0;
+
+};
+
+/// A shared file descriptors watcher.
+/// The Reactor is a singleton thread waiting, using epoll, for the readiness
+/// of all the file descriptors registered by event driven devices. Devices
+/// don't need anymore a dedicated thread blocking into its own select: once
+/// a file descriptor is ready the Reactor could either:
+/// <ul>
+///	<li>notify the associated ReactorHandler, or</li>
+///	<li>generate a Command by dispatching the default Command of the
+///		associated Dispatcher.</li>
+/// </ul>
+/// Watches are level triggered: handlers must consume the available data.
+/// Watches associated to a Dispatcher are one-shot instead, since the
+/// Command Handler could consume the data asynchronously: they must be
+/// rearmed once the data has been read.<br>
+/// Errors and hangups are always reported, whatever the watched events:
+/// once notified the watch is dropped, the owner should then close the
+/// file descriptor (its unwatch() is not required anymore).
+class Reactor : public Object, public ost::PosixThread {
+
+public:
+
+    /// The file descriptor events
+    enum fdEvent {
+        FD_READ   = EPOLLIN,
+        FD_WRITE  = EPOLLOUT,
+        FD_ERROR  = EPOLLERR,
+        FD_HANGUP = EPOLLHUP,
+    };
+    typedef enum fdEvent t_fdEvent;
+
+protected:
+
+    struct watch {
+        /// The handler to notify, 0 if a Dispatcher is used
+        ReactorHandler * handler;
+        /// The dispatcher to use, 0 if an handler is used
+        comsys::Dispatcher * dispatcher;
+        /// The events watched
+        unsigned int events;
+    };
+    typedef struct watch t_watch;
+
+    /// The watched file descriptors
+    typedef std::map<int, t_watch> t_watches;
+
+    static Reactor * d_instance;
+
+    /// The epoll file descriptor
+    int d_epfd;
+
+    /// A pipe used to wakeup the reactor thread
+    int d_wakeup[2];
+
+    /// Protect the watches
+    ost::Conditional d_cond;
+
+    /// The watched file descriptors
+    t_watches d_watches;
+
+    /// The file descriptor whose handler is currently running, -1 if none
+    int d_firing;
+
+    /// Set true when the reactor thread should terminate
+    bool d_doExit;
+
+    /// The reactor thread ID
+    int d_tid;
+
+public:
+
+    /// Get an instance of the Reactor.
+    /// Reactor is a singleton class, this method provide a pointer to
+    /// the (eventually just created and started) only one instance.
+    static Reactor * getInstance();
+
+    /// Terminate the reactor thread.
+    ~Reactor();
+
+    /// Watch a file descriptor notifying an handler.
+    /// @param fd the file descriptor to watch
+    /// @param handler the handler to notify on readiness
+    /// @param events the fdEvent bitmask of events to watch
+    /// @return OK on success, RCT_FD_ALREADY_WATCHED if the file descriptor
+    ///		is already watched, RCT_EPOLL_FAILURE on epoll errors
+    exitCode watch(int fd, ReactorHandler * handler, unsigned int events = FD_READ);
+
+    /// Watch a file descriptor generating Commands.
+    /// On readiness the dispatcher default Command is dispatched, the
+    /// watch is then disabled up to a rearm.
+    /// @param fd the file descriptor to watch
+    /// @param dispatcher the dispatcher to use on readiness
+    /// @param events the fdEvent bitmask of events to watch
+    /// @return OK on success, RCT_FD_ALREADY_WATCHED if the file descriptor
+    ///		is already watched, RCT_EPOLL_FAILURE on epoll errors
+    /// @see CommandDispatcher::setDefaultCommand
+    exitCode watch(int fd, comsys::Dispatcher * dispatcher, unsigned int events = FD_READ);
+
+    /// Change the events watched on a file descriptor.
+    /// This rearms one-shot watches too.
+    /// @param fd the watched file descriptor
+    /// @param events the fdEvent bitmask of events to watch
+    /// @return OK on success, RCT_FD_NOT_WATCHED if the file descriptor
+    ///		is not watched, RCT_EPOLL_FAILURE on epoll errors
+    exitCode modify(int fd, unsigned int events);
+
+    /// Rearm a one-shot watch with its current events.
+    /// @return OK on success, RCT_FD_NOT_WATCHED if the file descriptor
+    ///		is not watched, RCT_EPOLL_FAILURE on epoll errors
+    exitCode rearm(int fd);
+
+    /// Stop watching a file descriptor.
+    /// Once returned the handler will not be notified anymore and, if
+    /// it was running, its notification has been completed.
+    /// @note the file descriptor must be unwatched before being closed.
+    /// @return OK on success, RCT_FD_NOT_WATCHED if the file descriptor
+    ///		is not watched
+    exitCode unwatch(int fd);
+
+protected:
+
+    /// Build the Reactor
+    Reactor(std::string const & logName = "Reactor");
+
+    /// Add a watch.
+    exitCode addWatch(int fd, t_watch const & watch);
+
+    /// Update the epoll registration of a watched file descriptor.
+    /// The watches lock must be held.
+    exitCode updateWatch(int fd, t_watch const & watch);
+
+    /// Notify the readiness of a file descriptor.
+    /// The watch is dropped on errors and hangups.
+    void notify(int fd, unsigned int events);
+
+    /// The reactor thread body.
+    void run(void);
+
+};
+
+}// controlbox namespace
+
+#endif
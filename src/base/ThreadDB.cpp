@@ -34,10 +34,58 @@ namespace controlbox {
 
 ThreadDB * ThreadDB::d_instance = 0;
 
+/// The calling thread heartbeat, cached by ThreadDB::currentHeartbeat()
+static __thread Heartbeat * t_heartbeat = 0;
+
+/// The ThreadDB generation the cached heartbeat refers to, 0 if none
+static __thread unsigned int t_generation = 0;
+
+
+Heartbeat::Heartbeat() :
+	d_busy(0),
+	d_depth(0),
+	d_busySince(0),
+	d_operation(0),
+	d_command(0),
+	d_beats(0),
+	d_maxBusy(0) {
+	unsigned int i;
+
+	for (i=0; i<THREADDB_HISTOGRAM_BUCKETS; i++) {
+		d_histogram[i] = 0;
+	}
+
+}
+
+unsigned int Heartbeat::bucket(unsigned long duration) {
+	unsigned int l_bucket = 0;
+
+	while ( duration && l_bucket < THREADDB_HISTOGRAM_BUCKETS-1 ) {
+		duration >>= 1;
+		l_bucket++;
+	}
+
+	return l_bucket;
+}
+
 
 ThreadDB::ThreadDB(std::string const & logName) :
-	d_doExit(false),
+	d_lock("thrLock"),
+	d_timer(0),
+	d_stallTimer(0),
+	d_stallBudget(THREADDB_STALL_BUDGET),
+	d_msPerTick(10),
+	d_generation(1),
 	log(log4cpp::Category::getInstance("controlbox."+logName)) {
+	long l_hz;
+
+	l_hz = sysconf(_SC_CLK_TCK);
+	if ( l_hz > 0 ) {
+		d_msPerTick = 1000/l_hz;
+	}
+
+	exportQuery();
+
 }
 
 ThreadDB * ThreadDB::getInstance() {
@@ -52,14 +100,23 @@ ThreadDB * ThreadDB::getInstance() {
 }
 
 ThreadDB::~ThreadDB() {
+	t_threadDB::iterator l_it;
 
 	LOG4CPP_DEBUG(log, "ThreadDB::~ThreadDB()");
 
-	d_doExit = true;
-		if ( isRunning() ) {
-			this->resume();
-		}
+	if ( d_timer ) {
+		TimerWheel::getInstance()->cancel(d_timer);
+	}
+	if ( d_stallTimer ) {
+		TimerWheel::getInstance()->cancel(d_stallTimer);
+	}
+
+	QueryRegistry::getInstance()->unregisterQuery("THR");
+	QueryRegistry::getInstance()->unregisterQuery("THB");
 
+	for (l_it = d_threadDB.begin(); l_it != d_threadDB.end(); l_it++) {
+		delete l_it->heartbeat;
+	}
 	d_threadDB.clear();
 
 }
@@ -70,6 +127,8 @@ exitCode ThreadDB::registerThread(ost::PosixThread * p_thread, int p_tid) {
 
 	LOG4CPP_DEBUG(log, "ThreadDB::registerThread(ost::PosixThread * thread)");
 
+	d_lock.enterMutex();
+
 	l_it = d_threadDB.begin();
 	while ( l_it != d_threadDB.end() ) {
 		if ( l_it->thread == p_thread ) {
@@ -78,14 +137,29 @@ exitCode ThreadDB::registerThread(ost::PosixThread * p_thread, int p_tid) {
 		l_it++;
 	}
 	if ( l_it != d_threadDB.end() ) {
+		d_lock.leaveMutex();
 		LOG4CPP_WARN(log, "Thread [%d:%s] already registerd", l_it->tid, p_thread->getName());
 		return OK;
 	}
 
 	l_thread.thread = p_thread;
 	l_thread.tid = p_tid;
+	l_thread.stats.tid = p_tid;
+	l_thread.stats.name = p_thread->getName();
+	l_thread.stats.running = true;
+	l_thread.stats.utime = l_thread.stats.stime = 0;
+	l_thread.stats.vcsw = l_thread.stats.ivcsw = 0;
+	l_thread.stats.vmStk = l_thread.stats.vmRss = 0;
+	l_thread.stats.userLoad = l_thread.stats.sysLoad = 0;
+	l_thread.stats.vcswRate = l_thread.stats.ivcswRate = 0;
+	l_thread.sampled = 0;
+	l_thread.heartbeat = new Heartbeat();
+	l_thread.stalled = 0;
 
 	d_threadDB.push_back(l_thread);
+	atomicInc(&d_generation);
+	d_lock.leaveMutex();
+
 	LOG4CPP_INFO(log, "Registered new thread [%d:%s]", p_tid, p_thread->getName());
 
 	return OK;
@@ -99,6 +173,8 @@ exitCode ThreadDB::unregisterThread(ost::PosixThread * p_thread) {
 
 	LOG4CPP_DEBUG(log, "ThreadDB::unregisterThread(ost::PosixThread * p_thread)");
 
+	d_lock.enterMutex();
+
 	l_it = d_threadDB.begin();
 	while ( l_it != d_threadDB.end() ) {
 		if ( l_it->thread == p_thread ) {
@@ -107,25 +183,31 @@ exitCode ThreadDB::unregisterThread(ost::PosixThread * p_thread) {
 		l_it++;
 	}
 	if ( l_it == d_threadDB.end() ) {
+		d_lock.leaveMutex();
 		LOG4CPP_WARN(log, "Trying to unregister a thread [%s] not registerd", p_thread->getName());
 		return OK;
 	}
 
 	l_tid = l_it->tid;
 
+	atomicInc(&d_generation);
+	delete l_it->heartbeat;
 	d_threadDB.erase(l_it);
+	d_lock.leaveMutex();
 	LOG4CPP_WARN(log, "Unregistered thread [%d:%s]", l_tid, p_thread->getName());
 
 	return OK;
 
 }
 
-// Tot: N - Name1(pid1,S), Name2(pid2,S), Name3(pid3,S)...
+// Tot: N - Name1(pid1,S,cpu1%), Name2(pid2,S,cpu2%), Name3(pid3,S,cpu3%)...
 std::string ThreadDB::printDB() {
 	t_threadDB::iterator l_it;
 	std::ostringstream l_dump("");
 	bool l_isRunning;
 
+	d_lock.enterMutex();
+
 	l_dump << d_threadDB.size() << " threads; ";
 
 	l_it = d_threadDB.begin();
@@ -140,32 +222,358 @@ std::string ThreadDB::printDB() {
 			l_dump << ",T";
 		}
 
+		// CPU usage, if already sampled
+		if ( l_it->sampled ) {
+			l_dump << "," << std::fixed << std::setprecision(1)
+				<< (l_it->stats.userLoad+l_it->stats.sysLoad)/10.0 << "%";
+		}
+
 		l_dump << ") ";
 
 		l_it++;
 	}
 
+	d_lock.leaveMutex();
+
 	return l_dump.str();
 }
 
-void ThreadDB::run() {
-	int l_tid;
+exitCode ThreadDB::startMonitor(timeout_t period, unsigned long stallBudget) {
+
+	LOG4CPP_DEBUG(log, "ThreadDB::startMonitor(period=%lu, stallBudget=%lu)", period, stallBudget);
+
+	d_stallBudget = stallBudget;
+
+	if ( d_timer ) {
+		return TimerWheel::getInstance()->reschedule(d_timer, 0, period);
+	}
+
+	d_timer = TimerWheel::getInstance()->schedule(this, 0, period);
+	if ( !d_timer ) {
+		LOG4CPP_ERROR(log, "Failed scheduling the thread monitor");
+		return GENERIC_ERROR;
+	}
+
+	d_stallTimer = TimerWheel::getInstance()->schedule(this,
+			THREADDB_STALL_PERIOD, THREADDB_STALL_PERIOD);
+	if ( !d_stallTimer ) {
+		LOG4CPP_ERROR(log, "Failed scheduling the stalled threads check");
+		return GENERIC_ERROR;
+	}
+
+	LOG4CPP_DEBUG(log, "Thread monitor started, stall budget [%lums]", d_stallBudget);
+	return OK;
+
+}
+
+exitCode ThreadDB::readStats(t_threadData & thread, unsigned long long now) {
+	t_threadStats & l_stats = thread.stats;
+	unsigned long l_utime, l_stime;
+	unsigned long l_vcsw, l_ivcsw;
+	unsigned long l_elapsed;
+	char l_path[64];
+	char l_line[256];
+	char * l_fields;
+	FILE * l_file;
+
+	l_stats.running = (thread.thread)->isRunning();
+
+	// The stat line: pid (comm) state ppid ... utime stime ...
+	// the command name could contain spaces: fields are parsed after
+	// its closing bracket
+	snprintf(l_path, sizeof(l_path), "/proc/self/task/%d/stat", thread.tid);
+	l_file = fopen(l_path, "r");
+	if ( !l_file ) {
+		LOG4CPP_WARN(log, "Unable to sample thread [%d:%s]: %s",
+				thread.tid, l_stats.name.c_str(), strerror(errno));
+		return THR_STATS_FAILED;
+	}
+	l_fields = 0;
+	if ( fgets(l_line, sizeof(l_line), l_file) ) {
+		l_fields = strrchr(l_line, ')');
+	}
+	fclose(l_file);
+	if ( !l_fields || sscanf(l_fields+2,
+			"%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+			&l_utime, &l_stime) != 2 ) {
+		LOG4CPP_WARN(log, "Bad stat format for thread [%d:%s]",
+				thread.tid, l_stats.name.c_str());
+		return THR_STATS_FAILED;
+	}
+	l_utime *= d_msPerTick;
+	l_stime *= d_msPerTick;
+
+	snprintf(l_path, sizeof(l_path), "/proc/self/task/%d/status", thread.tid);
+	l_file = fopen(l_path, "r");
+	if ( !l_file ) {
+		LOG4CPP_WARN(log, "Unable to sample thread [%d:%s]: %s",
+				thread.tid, l_stats.name.c_str(), strerror(errno));
+		return THR_STATS_FAILED;
+	}
+	l_vcsw = l_ivcsw = 0;
+	while ( fgets(l_line, sizeof(l_line), l_file) ) {
+		if ( !strncmp(l_line, "VmStk:", 6) ) {
+			sscanf(l_line+6, "%lu", &l_stats.vmStk);
+		} else if ( !strncmp(l_line, "VmRSS:", 6) ) {
+			sscanf(l_line+6, "%lu", &l_stats.vmRss);
+		} else if ( !strncmp(l_line, "voluntary_ctxt_switches:", 24) ) {
+			sscanf(l_line+24, "%lu", &l_vcsw);
+		} else if ( !strncmp(l_line, "nonvoluntary_ctxt_switches:", 27) ) {
+			sscanf(l_line+27, "%lu", &l_ivcsw);
+		}
+	}
+	fclose(l_file);
+
+	// Rates are computed since the previous sample
+	if ( thread.sampled && now > thread.sampled ) {
+		l_elapsed = (now - thread.sampled) / 1000;
+		if ( l_elapsed ) {
+			l_stats.userLoad = ((l_utime - l_stats.utime) * 1000) / l_elapsed;
+			l_stats.sysLoad = ((l_stime - l_stats.stime) * 1000) / l_elapsed;
+			l_stats.vcswRate = ((l_vcsw - l_stats.vcsw) * 1000) / l_elapsed;
+			l_stats.ivcswRate = ((l_ivcsw - l_stats.ivcsw) * 1000) / l_elapsed;
+		}
+	}
+
+	l_stats.utime = l_utime;
+	l_stats.stime = l_stime;
+	l_stats.vcsw = l_vcsw;
+	l_stats.ivcsw = l_ivcsw;
+	thread.sampled = now;
+
+	return OK;
+
+}
+
+exitCode ThreadDB::sample(t_threadStatsList * stats) {
+	t_threadDB::iterator l_it;
+	unsigned long long l_now;
+	exitCode result = OK;
+
+	LOG4CPP_DEBUG(log, "ThreadDB::sample()");
+
+	d_lock.enterMutex();
+
+	if ( stats ) {
+		stats->clear();
+	}
+
+	l_now = Utils::monotonicUsec();
+	for (l_it = d_threadDB.begin(); l_it != d_threadDB.end(); l_it++) {
+		if ( readStats(*l_it, l_now) != OK ) {
+			result = THR_STATS_FAILED;
+		}
+		if ( stats ) {
+			stats->push_back(l_it->stats);
+		}
+	}
+
+	d_lock.leaveMutex();
+
+	return result;
+
+}
+
+std::string ThreadDB::formatStats() {
+	t_threadDB::iterator l_it;
+	std::ostringstream l_dump("");
+
+	for (l_it = d_threadDB.begin(); l_it != d_threadDB.end(); l_it++) {
+		t_threadStats const & l_stats = l_it->stats;
+		l_dump << l_stats.tid << "," << l_stats.name << ","
+			<< (l_stats.running ? "R" : "T") << ","
+			<< l_stats.utime << "," << l_stats.stime << ","
+			<< l_stats.userLoad << "," << l_stats.sysLoad << ","
+			<< l_stats.vcsw << "," << l_stats.ivcsw << ","
+			<< l_stats.vcswRate << "," << l_stats.ivcswRate << ","
+			<< l_stats.vmStk << "," << l_stats.vmRss << "\r\n";
+	}
+
+	return l_dump.str();
+
+}
+
+std::string ThreadDB::dumpStats() {
+	std::string l_dump;
+
+	d_lock.enterMutex();
+	l_dump = formatStats();
+	d_lock.leaveMutex();
+
+	return l_dump;
+
+}
+
+Heartbeat * ThreadDB::getHeartbeat(int p_tid) {
+	t_threadDB::iterator l_it;
+	Heartbeat * l_heartbeat = 0;
+
+	if ( !p_tid ) {
+		p_tid = syscall(SYS_gettid);
+	}
+
+	d_lock.enterMutex();
+	for (l_it = d_threadDB.begin(); l_it != d_threadDB.end(); l_it++) {
+		if ( l_it->tid == p_tid ) {
+			l_heartbeat = l_it->heartbeat;
+			break;
+		}
+	}
+	d_lock.leaveMutex();
+
+	return l_heartbeat;
+
+}
+
+Heartbeat * ThreadDB::currentHeartbeat() {
+	unsigned int l_generation = atomicRead(&d_generation);
+
+	if ( t_generation != l_generation ) {
+		t_heartbeat = getHeartbeat();
+		t_generation = l_generation;
+	}
+
+	return t_heartbeat;
+
+}
+
+std::string ThreadDB::dumpHeartbeats() {
+	t_threadDB::iterator l_it;
+	std::ostringstream l_dump("");
+	unsigned long l_now = Heartbeat::now();
+	Heartbeat * l_hb;
+	unsigned int i;
+	bool l_busy;
+
+	d_lock.enterMutex();
+
+	for (l_it = d_threadDB.begin(); l_it != d_threadDB.end(); l_it++) {
+		l_hb = l_it->heartbeat;
+		l_busy = atomicRead(&l_hb->d_busy);
+		l_dump << l_it->tid << "," << l_it->stats.name << ","
+			<< (l_busy ? "B" : "I") << ","
+			<< (l_busy ? l_now - l_hb->d_busySince : 0) << ","
+			<< (l_hb->d_operation ? l_hb->d_operation : "") << ","
+			<< l_hb->d_command << ","
+			<< l_hb->d_beats << "," << l_hb->d_maxBusy;
+		for (i=0; i<THREADDB_HISTOGRAM_BUCKETS; i++) {
+			l_dump << "," << l_hb->d_histogram[i];
+		}
+		l_dump << "\r\n";
+	}
+
+	d_lock.leaveMutex();
+
+	return l_dump.str();
 
-	l_tid = syscall(SYS_gettid);
-	LOG4CPP_INFO(log, "Thread [%s (%d)] started", "UQ", l_tid);
+}
+
+void ThreadDB::checkStalls() {
+	t_threadDB::iterator l_it;
+	unsigned long l_now = Heartbeat::now();
+	unsigned long l_since;
+	Heartbeat * l_hb;
+
+	d_lock.enterMutex();
+
+	for (l_it = d_threadDB.begin(); l_it != d_threadDB.end(); l_it++) {
+		l_hb = l_it->heartbeat;
+
+		if ( !atomicRead(&l_hb->d_busy) ) {
+			l_since = 0;
+		} else {
+			l_since = l_hb->d_busySince;
+		}
+
+		// A reported stall is over once the thread completes that
+		// busy section
+		if ( l_it->stalled && l_it->stalled != l_since ) {
+			LOG4CPP_INFO(log, "Thread [%d:%s] recovered after [%lums]",
+					l_it->tid, l_it->stats.name.c_str(),
+					l_now - l_it->stalled);
+			l_it->stalled = 0;
+		}
+
+		if ( !l_since || l_it->stalled ||
+				(l_now - l_since) <= d_stallBudget ) {
+			continue;
+		}
+
+		l_it->stalled = l_since;
+		LOG4CPP_WARN(log, "Thread [%d:%s] busy for [%lums] (budget %lums) handling [%s], command [%u]",
+				l_it->tid, l_it->stats.name.c_str(),
+				l_now - l_since, d_stallBudget,
+				l_hb->d_operation ? l_hb->d_operation : "undefined",
+				l_hb->d_command);
+	}
+
+	d_lock.leaveMutex();
+
+}
+
+std::string ThreadDB::name() const {
+	return "THR";
+}
+
+exitCode ThreadDB::exportQuery() {
+
+	registerQuery(QUERY_THREADS, "THR",
+			"Threads accounting: a line for each thread with tid,name,state,"
+			"utime[ms],stime[ms],user[per mille],sys[per mille],"
+			"vcsw,ivcsw,vcsw/s,ivcsw/s,VmStk[kB],VmRSS[kB]",
+			"Rates are computed between the last two monitor samples", QST_RO);
+
+	return registerQuery(QUERY_HEARTBEATS, "THB",
+			"Threads heartbeats: a line for each thread with tid,name,state,"
+			"busy[ms],operation,command,beats,maxBusy[ms],histogram",
+			"Histogram buckets: <1ms, [2^(i-1), 2^i)ms", QST_RO);
+
+}
+
+exitCode ThreadDB::query(Querible::t_query & p_query) {
+
+	LOG4CPP_DEBUG(log, "ThreadDB::query(type=%d)", p_query.type);
+
+	switch ( p_query.type ) {
+
+	case QM_QUERY:
+		if ( p_query.descr->id == QUERY_HEARTBEATS ) {
+			p_query.value = dumpHeartbeats();
+		} else {
+			// NOTE sampling here would reset the monitor rates
+			// window: queries are served by the last periodic
+			// sample, unless the monitor is not running
+			if ( !d_timer ) {
+				sample();
+			}
+			p_query.value = dumpStats();
+		}
+		p_query.responce = true;
+		break;
+	case QM_VALUES:
+		RETURN_VALUE(p_query, "%s of the registered threads\r\nFormat: AT+%s\n\r",
+				(p_query.descr->id == QUERY_HEARTBEATS) ? "Heartbeats" : "Accounting",
+				p_query.descr->name.c_str());
+		break;
+	case QM_SET:
+		RETURN_VALUE(p_query, "Read is the only mode supported by this query\n\r");
+		return HR_QUERYMODE_NOT_SUPPORTED;
+
+	}
+
+	return OK;
+
+}
 
-	this->setName("TM");
-	this->registerThread(this, l_tid);
+void ThreadDB::timerExpired(unsigned int timer) {
 
-	LOG4CPP_DEBUG(log, "Thread monitor started");
-	while ( !d_doExit ) {
-		LOG4CPP_INFO(log, "%s", printDB().c_str() );
-		::sleep(60);
+	if ( timer == d_stallTimer ) {
+		checkStalls();
+		return;
 	}
-	LOG4CPP_DEBUG(log, "Thread monitor terminated");
 
-	LOG4CPP_WARN(log, "Thread [%s (%d)] terminated", this->getName(), l_tid);
-	this->unregisterThread(this);
+	sample();
+	LOG4CPP_INFO(log, "%s", printDB().c_str() );
 
 }
 
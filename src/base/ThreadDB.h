@@ -32,33 +32,236 @@
 
 #include <controlbox/base/Object.h>
 #include <controlbox/base/Utility.h>
+#include <controlbox/base/TimerWheel.h>
+#include <controlbox/base/Querible.h>
+#include <controlbox/base/Atomic.h>
 #include <cc++/thread.h>
 #include <list>
+#include <vector>
+
+/// The default period of the registered threads log [ms]
+#define THREADDB_MONITOR_PERIOD	60000
+
+/// The default time a thread could be busy before being reported as stalled [ms]
+#define THREADDB_STALL_BUDGET	10000
+
+/// The period of the stalled threads check [ms]
+#define THREADDB_STALL_PERIOD	1000
+
+/// The number of buckets of the busy sections duration histogram.
+/// Bucket 0 counts sections shorter than 1ms, bucket i the ones lasting
+/// [2^(i-1), 2^i) ms, while the last bucket counts all the longer ones.
+#define THREADDB_HISTOGRAM_BUCKETS	16
 
 namespace controlbox {
 
+/// The liveness marker of a thread.
+/// A registered thread marks itself busy when it starts handling a job,
+/// e.g. a Command or an AT command, and idle once done: the ThreadDB
+/// monitor reports the threads busy for longer than a budget, and keeps
+/// an histogram of the busy sections duration.<br>
+/// Markers are updated only by their own thread, by plain stores and a
+/// memory barrier, thus they are cheap enough to mark each loop iteration.
+/// @note busy sections could be nested: just the outermost one is timed,
+///	while the innermost operation is reported
+class Heartbeat {
+
+public:
+
+	/// Set when the thread is busy
+	volatile int d_busy;
+
+	/// The nesting level of busy sections
+	unsigned int d_depth;
+
+	/// When the thread became busy [ms]
+	volatile unsigned long d_busySince;
+
+	/// The operation being handled
+	char const * volatile d_operation;
+
+	/// The type of the Command being handled, 0 if none
+	volatile unsigned int d_command;
+
+	/// The completed busy sections
+	volatile unsigned long d_beats;
+
+	/// The longest completed busy section [ms]
+	volatile unsigned long d_maxBusy;
+
+	/// The busy sections duration histogram
+	volatile unsigned long d_histogram[THREADDB_HISTOGRAM_BUCKETS];
+
+	Heartbeat();
+
+	/// Return the current time [ms]
+	static inline unsigned long now() {
+		return (unsigned long)(Utils::monotonicUsec()/1000);
+	};
+
+	/// Return the histogram bucket of a busy section duration.
+	static unsigned int bucket(unsigned long duration);
 
-/// This interface
-class ThreadDB : public ost::PosixThread {
+	/// Mark the thread busy.
+	/// @param operation a static string describing the job
+	/// @param command the type of the Command being handled, if any
+	inline void busy(char const * operation, unsigned int command = 0) {
+
+		d_operation = operation;
+		d_command = command;
+		if ( d_depth++ ) {
+			return;
+		}
+
+		d_busySince = now();
+		atomicSet(&d_busy, 1);
+
+	};
+
+	/// Mark the thread idle, i.e. the current busy section is completed.
+	inline void idle() {
+		unsigned long l_duration;
+
+		if ( !d_depth || --d_depth ) {
+			return;
+		}
+
+		atomicSet(&d_busy, 0);
+
+		l_duration = now() - d_busySince;
+		if ( l_duration > d_maxBusy ) {
+			d_maxBusy = l_duration;
+		}
+		d_histogram[bucket(l_duration)]++;
+		d_beats++;
+
+	};
+
+};
+
+/// Mark a thread busy within a scope.
+/// The thread is marked idle once the scope is left, whatever the exit
+/// path is.
+class HeartbeatScope {
+
+protected:
+
+	Heartbeat * d_heartbeat;
+
+public:
+
+	/// @param heartbeat the thread heartbeat, nothing is marked if null
+	HeartbeatScope(Heartbeat * heartbeat, char const * operation,
+			unsigned int command = 0) :
+		d_heartbeat(heartbeat) {
+		if ( d_heartbeat ) {
+			d_heartbeat->busy(operation, command);
+		}
+	};
+
+	~HeartbeatScope() {
+		if ( d_heartbeat ) {
+			d_heartbeat->idle();
+		}
+	};
+
+};
+
+
+/// A registry of the running threads.
+/// Each registered thread is identified by its kernel tid, which is used
+/// to sample its accounting from /proc/self/task/&lt;tid&gt;: user and
+/// system CPU time, voluntary and involuntary context switches, stack
+/// and resident memory. Rates (CPU usage and context switches per
+/// second) are computed over the time elapsed between two samples.<br>
+/// Samples are collected by the monitor, each time it logs the registered
+/// threads; the "THR" query returns a machine-readable dump of the last
+/// sample, thus it does not perturb the monitor rates.<br>
+/// Each registered thread has an Heartbeat, which it could use to mark
+/// the jobs it handles: the monitor reports any thread busy for longer
+/// than a budget, with the operation it is handling, while the "THB"
+/// query returns the busy sections duration histograms.
+/// @note VmStk and VmRSS are accounted by the kernel on the address
+///	space, which is shared among all the threads of the process
+class ThreadDB : public TimerHandler, public Querible {
+
+//-----[ Types ]----------------------------------------------------------------
+
+public:
+
+	/// The accounting of a thread
+	struct threadStats {
+		int tid;			///< The kernel thread id
+		std::string name;		///< The thread name
+		bool running;			///< True if the thread is running
+		unsigned long utime;		///< User time [ms]
+		unsigned long stime;		///< System time [ms]
+		unsigned long vcsw;		///< Voluntary context switches
+		unsigned long ivcsw;		///< Involuntary context switches
+		unsigned long vmStk;		///< Stack size [kB]
+		unsigned long vmRss;		///< Resident set size [kB]
+		unsigned int userLoad;		///< User CPU usage [per mille]
+		unsigned int sysLoad;		///< System CPU usage [per mille]
+		unsigned long vcswRate;		///< Voluntary context switches per second
+		unsigned long ivcswRate;	///< Involuntary context switches per second
+	};
+	typedef struct threadStats t_threadStats;
+
+	typedef std::vector<t_threadStats> t_threadStatsList;
 
 private:
 
 	struct threadData {
 		ost::PosixThread* thread;
 		int tid;
+		/// The last sample
+		t_threadStats stats;
+		/// When the last sample has been taken [us], 0 if never sampled
+		unsigned long long sampled;
+		/// The thread liveness marker
+		Heartbeat * heartbeat;
+		/// When the reported stall started [ms], 0 if not stalled
+		unsigned long stalled;
 	};
 	typedef struct threadData t_threadData;
 
 	typedef std::list<t_threadData> t_threadDB;
 
+	/// The exported queries
+	enum queries {
+		QUERY_THREADS = 0,
+		QUERY_HEARTBEATS
+	};
+
+//-----[ Members ]--------------------------------------------------------------
+
 	static ThreadDB * d_instance;
 
 	t_threadDB d_threadDB;
 
-	bool d_doExit;
+	/// Serialize the DB accesses
+	ost::Mutex d_lock;
+
+	/// The monitor timer, 0 if the monitor is not running
+	TimerWheel::t_timerId d_timer;
+
+	/// The stalled threads check timer, 0 if not running
+	TimerWheel::t_timerId d_stallTimer;
+
+	/// The time a thread could be busy before being reported as stalled [ms]
+	unsigned long d_stallBudget;
+
+	/// Milliseconds per clock tick
+	unsigned long d_msPerTick;
+
+	/// Bumped at each thread (un)registration, it invalidates the
+	/// heartbeats cached by currentHeartbeat()
+	volatile unsigned int d_generation;
 
 	log4cpp::Category & log;
 
+//-----[ Methods ]--------------------------------------------------------------
+
 public:
 
 	/// Get an instance of ThreadDB
@@ -82,13 +285,74 @@ public:
 	/// Print a log with current registerd thread and their status
 	std::string printDB();
 
+	/// Sample the accounting of all the registered threads.
+	/// @param stats if not null, filled with the new samples
+	/// @return OK on success, THR_STATS_FAILED if some thread could
+	///	not be sampled
+	exitCode sample(t_threadStatsList * stats = 0);
+
+	/// Dump the last samples in a machine-readable format.
+	/// A line for each thread, with comma separated fields:
+	/// tid,name,state,utime,stime,userLoad,sysLoad,vcsw,ivcsw,vcswRate,ivcswRate,vmStk,vmRss
+	/// @see t_threadStats
+	std::string dumpStats();
+
+	/// Get the heartbeat of a registered thread.
+	/// @param p_tid the thread id, 0 for the calling thread
+	/// @return the thread heartbeat, 0 if the thread is not registered
+	/// @note the heartbeat is released when the thread is unregistered
+	Heartbeat * getHeartbeat(int p_tid = 0);
+
+	/// Get the heartbeat of the calling thread.
+	/// The heartbeat is cached by each thread: this requires neither
+	/// locks nor system calls, unless some thread has been (un)registered
+	/// since the previous call.
+	/// @return the thread heartbeat, 0 if the thread is not registered
+	Heartbeat * currentHeartbeat();
+
+	/// Dump the heartbeats in a machine-readable format.
+	/// A line for each thread, with comma separated fields:
+	/// tid,name,state,busy,operation,command,beats,maxBusy,histogram...
+	/// where state is B (busy) or I (idle), busy is the time since the
+	/// thread is busy [ms] and the histogram is a field for each bucket
+	std::string dumpHeartbeats();
+
+	/// Start logging periodically the registered threads.
+	/// The monitor is run by the TimerWheel, which checks each
+	/// THREADDB_STALL_PERIOD milliseconds for stalled threads too.
+	/// @param period the milliseconds between two successive logs
+	/// @param stallBudget the milliseconds a thread could be busy
+	///	before being reported as stalled
+	exitCode startMonitor(timeout_t period = THREADDB_MONITOR_PERIOD,
+			unsigned long stallBudget = THREADDB_STALL_BUDGET);
+
+	/// Return the threads statistics or heartbeats.
+	exitCode query(Querible::t_query & query);
+
+	/// Return the Querible name.
+	std::string name() const;
+
 protected:
 
 	/// Create a new DeviceDB
 	ThreadDB(std::string const & logName = "ThreadDB");
 
-	/// The monitor thread
-	void run();
+	/// Export the "THR" and "THB" queries.
+	exitCode exportQuery();
+
+	/// Read the accounting of a thread from /proc.
+	/// @note must be called with the DB lock held
+	exitCode readStats(t_threadData & thread, unsigned long long now);
+
+	/// Format the last samples.
+	/// @note must be called with the DB lock held
+	std::string formatStats();
+
+	/// Report the threads busy for longer than the stall budget.
+	void checkStalls();
+
+	/// Log the registered threads on monitor timer expiration
+	void timerExpired(unsigned int timer);
 
 
 };
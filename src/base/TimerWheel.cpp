@@ -0,0 +1,544 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#include "TimerWheel.ih"
+
+namespace controlbox {
+
+TimerWheel * TimerWheel::d_instance = 0;
+
+
+TimerWheel::TimerWheel(std::string const & logName) :
+	Object(logName),
+	d_armed(0),
+	d_nextId(1),
+	d_ticks(now()),
+	d_wakeAt(0),
+	d_firing(0),
+	d_doExit(false),
+	d_tid(0) {
+
+	LOG4CPP_DEBUG(log, "TimerWheel::TimerWheel()");
+
+	memset(d_wheel, 0, sizeof(d_wheel));
+
+	LOG4CPP_INFO(log, "Timer wheel of [%dx%d] slots, [%dms] resolution",
+			TIMERWHEEL_LEVELS, TIMERWHEEL_LEVEL_SLOTS, TIMERWHEEL_TICK_MS);
+
+}
+
+TimerWheel * TimerWheel::getInstance() {
+
+	if ( !d_instance ) {
+		d_instance = new TimerWheel("TimerWheel");
+		d_instance->start();
+	}
+
+	LOG4CPP_DEBUG(d_instance->log, "TimerWheel::getInstance()");
+
+	return d_instance;
+}
+
+TimerWheel::~TimerWheel() {
+	t_timers::iterator l_it;
+
+	LOG4CPP_DEBUG(log, "TimerWheel::~TimerWheel()");
+
+	// Terminating the timer thread
+	d_cond.enterMutex();
+	d_doExit = true;
+	d_cond.signal(true);
+	d_cond.leaveMutex();
+	join();
+
+	if ( d_timers.size() ) {
+		LOG4CPP_WARN(log, "Dropping [%u] timers still defined", d_timers.size());
+	}
+
+	for (l_it = d_timers.begin(); l_it != d_timers.end(); l_it++) {
+		delete l_it->second;
+	}
+	d_timers.clear();
+
+	d_instance = 0;
+
+}
+
+unsigned long long TimerWheel::now() {
+	struct timespec l_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &l_ts);
+
+	return ((unsigned long long)l_ts.tv_sec*1000 + l_ts.tv_nsec/1000000) / TIMERWHEEL_TICK_MS;
+
+}
+
+unsigned long TimerWheel::toTicks(timeout_t msec) {
+	return (msec + TIMERWHEEL_TICK_MS - 1) / TIMERWHEEL_TICK_MS;
+}
+
+TimerWheel::t_timerId
+TimerWheel::schedule(TimerHandler * handler, timeout_t delay, timeout_t period) {
+	t_timer * l_timer;
+	t_timerId l_id;
+
+	LOG4CPP_DEBUG(log, "TimerWheel::schedule(delay=%lu, period=%lu)", delay, period);
+
+	if ( !handler ) {
+		LOG4CPP_ERROR(log, "Trying to schedule a timer without an handler");
+		return 0;
+	}
+
+	l_timer = new t_timer;
+	if ( !l_timer ) {
+		LOG4CPP_FATAL(log, "Unable to build a new timer");
+		return 0;
+	}
+
+	l_timer->handler = handler;
+	l_timer->period = period ? toTicks(period) : 0;
+	l_timer->gen = 0;
+	l_timer->next = 0;
+	l_timer->pprev = 0;
+
+	d_cond.enterMutex();
+
+	// Looking for an unused handle (0 is reserved)
+	do {
+		l_id = d_nextId++;
+	} while ( !l_id || d_timers.find(l_id) != d_timers.end() );
+
+	l_timer->id = l_id;
+	l_timer->expires = now() + toTicks(delay);
+	d_timers[l_id] = l_timer;
+	link(l_timer);
+
+	// Waking up the timer thread only if it's sleeping too much
+	if ( d_wakeAt && l_timer->expires < d_wakeAt ) {
+		d_cond.signal(true);
+	}
+
+	d_cond.leaveMutex();
+
+	LOG4CPP_DEBUG(log, "Scheduled timer [%u]", l_id);
+
+	return l_id;
+
+}
+
+exitCode TimerWheel::reschedule(t_timerId timer, timeout_t delay, timeout_t period) {
+	t_timers::iterator l_it;
+	t_timer * l_timer;
+
+	LOG4CPP_DEBUG(log, "TimerWheel::reschedule(timer=%u, delay=%lu, period=%lu)",
+			timer, delay, period);
+
+	d_cond.enterMutex();
+
+	l_it = d_timers.find(timer);
+	if ( l_it == d_timers.end() ) {
+		d_cond.leaveMutex();
+		LOG4CPP_WARN(log, "Trying to reschedule an undefined timer [%u]", timer);
+		return TW_TIMER_NOT_FOUND;
+	}
+
+	l_timer = l_it->second;
+	l_timer->period = period ? toTicks(period) : 0;
+	rearm(l_timer, toTicks(delay));
+
+	d_cond.leaveMutex();
+
+	return OK;
+
+}
+
+bool TimerWheel::rescheduleIfPending(t_timerId timer, timeout_t delay) {
+	t_timers::iterator l_it;
+	bool l_pending = false;
+
+	LOG4CPP_DEBUG(log, "TimerWheel::rescheduleIfPending(timer=%u, delay=%lu)",
+			timer, delay);
+
+	d_cond.enterMutex();
+
+	l_it = d_timers.find(timer);
+	if ( l_it != d_timers.end() && l_it->second->pprev ) {
+		rearm(l_it->second, toTicks(delay));
+		l_pending = true;
+	}
+
+	d_cond.leaveMutex();
+
+	return l_pending;
+
+}
+
+exitCode TimerWheel::setPeriod(t_timerId timer, timeout_t period) {
+	t_timers::iterator l_it;
+
+	LOG4CPP_DEBUG(log, "TimerWheel::setPeriod(timer=%u, period=%lu)", timer, period);
+
+	d_cond.enterMutex();
+
+	l_it = d_timers.find(timer);
+	if ( l_it == d_timers.end() ) {
+		d_cond.leaveMutex();
+		LOG4CPP_WARN(log, "Trying to update an undefined timer [%u]", timer);
+		return TW_TIMER_NOT_FOUND;
+	}
+
+	l_it->second->period = period ? toTicks(period) : 0;
+
+	d_cond.leaveMutex();
+
+	return OK;
+
+}
+
+exitCode TimerWheel::cancel(t_timerId timer) {
+	t_timers::iterator l_it;
+	exitCode result = TW_TIMER_NOT_FOUND;
+
+	LOG4CPP_DEBUG(log, "TimerWheel::cancel(timer=%u)", timer);
+
+	d_cond.enterMutex();
+
+	l_it = d_timers.find(timer);
+	if ( l_it != d_timers.end() ) {
+		unlink(l_it->second);
+		delete l_it->second;
+		d_timers.erase(l_it);
+		result = OK;
+	}
+
+	// Waiting for a running handler to complete, unless we are called
+	// by the handler itself
+	while ( d_firing == timer && syscall(SYS_gettid) != d_tid ) {
+		d_cond.wait(0, true);
+	}
+
+	d_cond.leaveMutex();
+
+	if ( result != OK ) {
+		LOG4CPP_WARN(log, "Trying to cancel an undefined timer [%u]", timer);
+	}
+
+	return result;
+
+}
+
+bool TimerWheel::pending(t_timerId timer) {
+	t_timers::iterator l_it;
+	bool l_pending = false;
+
+	d_cond.enterMutex();
+	l_it = d_timers.find(timer);
+	if ( l_it != d_timers.end() ) {
+		l_pending = (l_it->second->pprev != 0);
+	}
+	d_cond.leaveMutex();
+
+	return l_pending;
+
+}
+
+void TimerWheel::rearm(t_timer * p_timer, unsigned long p_ticks) {
+
+	unlink(p_timer);
+
+	// Expirations already collected are now stale
+	p_timer->gen++;
+	p_timer->expires = now() + p_ticks;
+	link(p_timer);
+
+	if ( d_wakeAt && p_timer->expires < d_wakeAt ) {
+		d_cond.signal(true);
+	}
+
+}
+
+void TimerWheel::link(t_timer * p_timer) {
+	unsigned long long l_when;
+	unsigned long long l_delta;
+	unsigned int l_level;
+	t_timer ** l_slot;
+
+	// Timers already expired are notified at the next tick
+	l_when = (p_timer->expires < d_ticks) ? d_ticks : p_timer->expires;
+	l_delta = l_when - d_ticks;
+
+	// Timers beyond the wheel range are parked into the last level:
+	// they will be linked again once their slot is cascaded
+	if ( l_delta >> (TIMERWHEEL_LEVEL_BITS*TIMERWHEEL_LEVELS) ) {
+		l_delta = (1ULL << (TIMERWHEEL_LEVEL_BITS*TIMERWHEEL_LEVELS)) - 1;
+		l_when = d_ticks + l_delta;
+	}
+
+	l_level = 0;
+	while ( l_delta >> (TIMERWHEEL_LEVEL_BITS*(l_level+1)) ) {
+		l_level++;
+	}
+
+	l_slot = &d_wheel[l_level][(l_when >> (TIMERWHEEL_LEVEL_BITS*l_level)) & (TIMERWHEEL_LEVEL_SLOTS-1)];
+
+	p_timer->next = *l_slot;
+	if ( p_timer->next ) {
+		p_timer->next->pprev = &p_timer->next;
+	}
+	p_timer->pprev = l_slot;
+	*l_slot = p_timer;
+
+	d_armed++;
+
+}
+
+void TimerWheel::unlink(t_timer * p_timer) {
+
+	if ( !p_timer->pprev ) {
+		return;
+	}
+
+	*(p_timer->pprev) = p_timer->next;
+	if ( p_timer->next ) {
+		p_timer->next->pprev = p_timer->pprev;
+	}
+	p_timer->next = 0;
+	p_timer->pprev = 0;
+
+	d_armed--;
+
+}
+
+unsigned int TimerWheel::cascade(unsigned int p_level) {
+	unsigned int l_index;
+	t_timer * l_timer;
+	t_timer * l_next;
+
+	l_index = (d_ticks >> (TIMERWHEEL_LEVEL_BITS*p_level)) & (TIMERWHEEL_LEVEL_SLOTS-1);
+
+	// Detaching the whole slot first: some timers could be linked back to it
+	l_timer = d_wheel[p_level][l_index];
+	d_wheel[p_level][l_index] = 0;
+
+	while ( l_timer ) {
+		l_next = l_timer->next;
+		l_timer->next = 0;
+		l_timer->pprev = 0;
+		d_armed--;
+		link(l_timer);
+		l_timer = l_next;
+	}
+
+	return l_index;
+
+}
+
+void TimerWheel::advance(unsigned long long upTo) {
+	unsigned int l_index;
+	unsigned int l_level;
+	t_timer * l_timer;
+	t_timer * l_next;
+	t_expired l_expired;
+
+	while ( d_ticks <= upTo ) {
+
+		// Nothing armed: just jumping forward
+		if ( !d_armed ) {
+			d_ticks = upTo + 1;
+			break;
+		}
+
+		// Cascading the upper levels each time a lower one wraps
+		l_index = d_ticks & (TIMERWHEEL_LEVEL_SLOTS-1);
+		if ( !l_index ) {
+			for (l_level=1; l_level<TIMERWHEEL_LEVELS; l_level++) {
+				if ( cascade(l_level) ) {
+					break;
+				}
+			}
+		}
+
+		l_timer = d_wheel[0][l_index];
+		d_wheel[0][l_index] = 0;
+
+		// Periodic timers are linked again starting from the next tick
+		d_ticks++;
+
+		while ( l_timer ) {
+			l_next = l_timer->next;
+			l_timer->next = 0;
+			l_timer->pprev = 0;
+			d_armed--;
+
+			l_expired.id = l_timer->id;
+			l_expired.gen = l_timer->gen;
+			d_expired.push_back(l_expired);
+
+			if ( l_timer->period ) {
+				l_timer->expires += l_timer->period;
+				// Skipping the expirations missed while late
+				if ( l_timer->expires < d_ticks ) {
+					l_timer->expires += l_timer->period *
+						((d_ticks - l_timer->expires + l_timer->period - 1) / l_timer->period);
+				}
+				link(l_timer);
+			}
+
+			l_timer = l_next;
+		}
+
+	}
+
+}
+
+void TimerWheel::fire() {
+	t_expiredList l_expired;
+	t_expiredList::iterator l_it;
+	t_timers::iterator l_timer;
+	TimerHandler * l_handler;
+
+	l_expired.swap(d_expired);
+
+	for (l_it = l_expired.begin(); l_it != l_expired.end(); l_it++) {
+
+		// Skipping timers cancelled, or rescheduled, meanwhile
+		l_timer = d_timers.find(l_it->id);
+		if ( l_timer == d_timers.end() ||
+				l_timer->second->gen != l_it->gen ) {
+			continue;
+		}
+
+		l_handler = l_timer->second->handler;
+		d_firing = l_it->id;
+
+		d_cond.leaveMutex();
+		l_handler->timerExpired(l_it->id);
+		d_cond.enterMutex();
+
+		// Releasing cancel requests waiting for this handler
+		d_firing = 0;
+		d_cond.signal(true);
+
+	}
+
+}
+
+unsigned long long TimerWheel::nextEvent() const {
+	unsigned long long l_next;
+	unsigned long long l_when;
+	unsigned long long l_base;
+	unsigned int l_shift;
+	unsigned int l_level;
+	unsigned int l_slot;
+
+	if ( !d_armed ) {
+		return 0;
+	}
+
+	l_next = ~0ULL;
+
+	// First level slots hold the exact expirations of the next ticks
+	for (l_slot=0; l_slot<TIMERWHEEL_LEVEL_SLOTS; l_slot++) {
+		if ( d_wheel[0][(d_ticks + l_slot) & (TIMERWHEEL_LEVEL_SLOTS-1)] ) {
+			l_next = d_ticks + l_slot;
+			break;
+		}
+	}
+
+	// Upper levels slots must be cascaded when the lower level wraps
+	for (l_level=1; l_level<TIMERWHEEL_LEVELS; l_level++) {
+		l_shift = TIMERWHEEL_LEVEL_BITS*l_level;
+		l_base = (d_ticks >> l_shift) & ~((unsigned long long)TIMERWHEEL_LEVEL_SLOTS-1);
+		for (l_slot=0; l_slot<TIMERWHEEL_LEVEL_SLOTS; l_slot++) {
+			if ( !d_wheel[l_level][l_slot] ) {
+				continue;
+			}
+			l_when = (l_base + l_slot) << l_shift;
+			if ( l_when < d_ticks ) {
+				l_when += (unsigned long long)TIMERWHEEL_LEVEL_SLOTS << l_shift;
+			}
+			if ( l_when < l_next ) {
+				l_next = l_when;
+			}
+		}
+	}
+
+	return l_next;
+
+}
+
+void TimerWheel::run(void) {
+	controlbox::ThreadDB *l_tdb = ThreadDB::getInstance();
+	unsigned long long l_now;
+	unsigned long long l_next;
+	timeout_t l_sleep;
+
+	d_tid = syscall(SYS_gettid);
+	LOG4CPP_INFO(log, "Thread [%s (%d)] started", "TW", d_tid);
+
+	this->setName("TW");
+	l_tdb->registerThread(this, d_tid);
+
+	d_cond.enterMutex();
+	while ( !d_doExit ) {
+
+		l_now = now();
+		advance(l_now);
+
+		if ( d_expired.size() ) {
+			// Handlers could take a while: checking again the wheel
+			fire();
+			continue;
+		}
+
+		l_next = nextEvent();
+		if ( !l_next ) {
+			LOG4CPP_DEBUG(log, "No timers armed, waiting...");
+			d_wakeAt = ~0ULL;
+			d_cond.wait(0, true);
+		} else if ( l_next > l_now ) {
+			l_sleep = (l_next - l_now) * TIMERWHEEL_TICK_MS;
+			if ( l_sleep > TIMERWHEEL_MAX_SLEEP_MS ) {
+				l_sleep = TIMERWHEEL_MAX_SLEEP_MS;
+			}
+			d_wakeAt = l_next;
+			d_cond.wait(l_sleep, true);
+		}
+		d_wakeAt = 0;
+
+	}
+	d_cond.leaveMutex();
+
+	LOG4CPP_WARN(log, "Thread [%s (%d)] terminated", this->getName(), d_tid);
+	l_tdb->unregisterThread(this);
+
+}
+
+}// controlbox namespace
@@ -0,0 +1,271 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _TIMERWHEEL_H
+#define _TIMERWHEEL_H
+
+#include <controlbox/base/Object.h>
+#include <controlbox/base/Utility.h>
+#include <cc++/thread.h>
+#include <map>
+#include <vector>
+
+/// The TimerWheel resolution [ms]
+#define TIMERWHEEL_TICK_MS	10
+/// The number of bits used to index the slots of each wheel level
+#define TIMERWHEEL_LEVEL_BITS	6
+/// The number of slots of each wheel level
+#define TIMERWHEEL_LEVEL_SLOTS	(1<<TIMERWHEEL_LEVEL_BITS)
+/// The number of wheel levels.
+/// With 10ms ticks four levels of 64 slots cover about 46 hours: longer
+/// timeouts are supported too, they are just cascaded more times.
+#define TIMERWHEEL_LEVELS	4
+/// The maximum time the timer thread sleeps before checking the wheel [ms].
+/// Timed waits are bound to the wall clock: this limits the effects of
+/// backward clock adjustments (e.g. GPS time synchronization)
+#define TIMERWHEEL_MAX_SLEEP_MS	60000
+
+namespace controlbox {
+
+/// An object that could be notified by the TimerWheel about expired timers.
+class TimerHandler {
+
+public:
+
+    virtual ~TimerHandler() {};
+
+    /// Notify the expiration of a timer.
+    /// This method is called by the TimerWheel thread, shared by all the
+    /// scheduled timers: its implementation should be short and must never
+    /// block, long running jobs should be handed over to another thread.
+    /// @param timer the expired timer
+    virtual void timerExpired(unsigned int timer) = 0;
+
+};
+
+/// A shared timer service.
+/// The TimerWheel is a singleton thread notifying TimerHandlers once their
+/// timers expire, both one-shot and periodic ones. Using this service,
+/// periodic jobs don't need a dedicated thread anymore just to sleep
+/// between two successive runs.<br>
+/// Timers are kept into a hierarchical timing wheel (TIMERWHEEL_LEVELS
+/// levels of TIMERWHEEL_LEVEL_SLOTS slots each) with a resolution of
+/// TIMERWHEEL_TICK_MS milliseconds: schedule, reschedule and cancel cost
+/// O(1) whatever is the number of active timers. The thread sleeps up to
+/// the next (possible) expiration, thus there are no wakeups while there
+/// are no timers expiring.
+/// @note periodic timers don't drift: the next expiration is computed
+///	from the previous one and not from the handler completion time.
+class TimerWheel : public Object, public ost::PosixThread {
+
+public:
+
+    /// A timer handle
+    typedef unsigned int t_timerId;
+
+protected:
+
+    struct timer {
+        /// The timer handle
+        t_timerId id;
+        /// The handler to notify
+        TimerHandler * handler;
+        /// The expiration tick
+        unsigned long long expires;
+        /// The period [ticks], 0 for one-shot timers
+        unsigned long period;
+        /// Incremented on each (re)scheduling, to spot stale expirations
+        unsigned int gen;
+        /// Next timer into the same slot
+        struct timer * next;
+        /// The link pointing to this timer, null if the timer is not armed
+        struct timer ** pprev;
+    };
+    typedef struct timer t_timer;
+
+    /// The timers defined, indexed by handle
+    typedef std::map<t_timerId, t_timer *> t_timers;
+
+    /// An expired timer waiting for its handler notification
+    struct expired {
+        t_timerId id;
+        unsigned int gen;
+    };
+    typedef struct expired t_expired;
+
+    typedef std::vector<t_expired> t_expiredList;
+
+    static TimerWheel * d_instance;
+
+    /// Protect the wheel and wakeup the timer thread
+    ost::Conditional d_cond;
+
+    /// The wheel levels
+    t_timer * d_wheel[TIMERWHEEL_LEVELS][TIMERWHEEL_LEVEL_SLOTS];
+
+    /// The defined timers
+    t_timers d_timers;
+
+    /// The number of armed timers
+    unsigned int d_armed;
+
+    /// The next timer handle
+    t_timerId d_nextId;
+
+    /// The next tick to process
+    unsigned long long d_ticks;
+
+    /// The tick the timer thread is sleeping up to, 0 if it is running
+    unsigned long long d_wakeAt;
+
+    /// The expired timers collected by the last wheel run
+    t_expiredList d_expired;
+
+    /// The timer whose handler is currently running, 0 if none
+    t_timerId d_firing;
+
+    /// Set true when the timer thread should terminate
+    bool d_doExit;
+
+    /// The timer thread ID
+    int d_tid;
+
+public:
+
+    /// Get an instance of the TimerWheel.
+    /// TimerWheel is a singleton class, this method provide a pointer to
+    /// the (eventually just created and started) only one instance.
+    static TimerWheel * getInstance();
+
+    /// Terminate the timer thread.
+    /// Timers still armed are dropped without notification.
+    ~TimerWheel();
+
+    /// Schedule a new timer.
+    /// @param handler the handler to notify on expiration
+    /// @param delay the milliseconds to the first expiration
+    /// @param period the milliseconds between successive expirations,
+    ///		0 (the default) for one-shot timers
+    /// @return the new timer handle, 0 on failures
+    /// @note the timer handle remain valid, even after the expiration of a
+    ///		one-shot timer, up to its cancellation: an expired timer
+    ///		could be armed again using reschedule.
+    t_timerId schedule(TimerHandler * handler, timeout_t delay, timeout_t period = 0);
+
+    /// Change the expiration of a timer.
+    /// The timer is (re)armed to expire after the specified delay,
+    /// whatever its current state is: an upcoming expiration is lost.
+    /// @param timer the timer handle
+    /// @param delay the milliseconds to the next expiration
+    /// @param period the milliseconds between successive expirations,
+    ///		0 for one-shot timers
+    /// @return OK on success, TW_TIMER_NOT_FOUND if the timer is not defined
+    exitCode reschedule(t_timerId timer, timeout_t delay, timeout_t period = 0);
+
+    /// Anticipate, or postpone, the expiration of an armed timer.
+    /// The check and the new arming are atomic: a timer which is expiring,
+    /// or already expired, is not armed again, thus its handler is not
+    /// notified twice. The timer period is not changed.
+    /// @param timer the timer handle
+    /// @param delay the milliseconds to the next expiration
+    /// @return true if the timer was armed and has been rescheduled
+    bool rescheduleIfPending(t_timerId timer, timeout_t delay);
+
+    /// Change the period of a timer.
+    /// The upcoming expiration is not affected: the new period is used to
+    /// compute the following ones.
+    /// @param timer the timer handle
+    /// @param period the milliseconds between successive expirations,
+    ///		0 to make the timer one-shot
+    /// @return OK on success, TW_TIMER_NOT_FOUND if the timer is not defined
+    exitCode setPeriod(t_timerId timer, timeout_t period);
+
+    /// Cancel a timer.
+    /// Once returned the timer handler will not be notified anymore and,
+    /// if it was running, its notification has been completed: the handler
+    /// could be safely released.
+    /// @param timer the timer handle
+    /// @return OK on success, TW_TIMER_NOT_FOUND if the timer is not defined
+    exitCode cancel(t_timerId timer);
+
+    /// Return true if the timer is armed
+    bool pending(t_timerId timer);
+
+protected:
+
+    /// Build the TimerWheel
+    TimerWheel(std::string const & logName = "TimerWheel");
+
+    /// Return the current monotonic time [ticks]
+    static unsigned long long now();
+
+    /// Convert a delay into a number of ticks, rounding up
+    static unsigned long toTicks(timeout_t msec);
+
+    /// Arm a timer into the slot corresponding to its expiration.
+    /// The wheel lock must be held.
+    void link(t_timer * timer);
+
+    /// Disarm a timer.
+    /// The wheel lock must be held.
+    void unlink(t_timer * timer);
+
+    /// Arm again a timer to expire after the specified number of ticks.
+    /// Expirations already collected become stale.
+    /// The wheel lock must be held.
+    void rearm(t_timer * timer, unsigned long ticks);
+
+    /// Move the timers of a slot back into the lower levels.
+    /// The wheel lock must be held.
+    /// @return the index of the cascaded slot
+    unsigned int cascade(unsigned int level);
+
+    /// Process all the ticks up to the specified one, collecting expired
+    /// timers into d_expired.
+    /// The wheel lock must be held.
+    void advance(unsigned long long upTo);
+
+    /// Notify the handlers of the collected expired timers.
+    /// The wheel lock must be held, it is released while handlers run.
+    void fire();
+
+    /// Return the next tick where some timers could expire, or cascade,
+    /// 0 if there are not armed timers.
+    /// The wheel lock must be held.
+    unsigned long long nextEvent() const;
+
+    /// The timer thread body.
+    void run(void);
+
+};
+
+}// controlbox namespace
+
+#endif
@@ -82,6 +82,44 @@ exitCode Utils::b64enc(const char *p_in, size_t p_inlen, char **p_out, size_t &p
 }
 
 
+unsigned long long Utils::timeUsec(void) {
+	struct timeval l_tv;
+
+	gettimeofday(&l_tv, 0);
+
+	return ((unsigned long long)l_tv.tv_sec*1000000)+l_tv.tv_usec;
+}
+
+unsigned long long Utils::monotonicUsec(void) {
+	struct timespec l_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &l_ts);
+
+	return ((unsigned long long)l_ts.tv_sec*1000000)+(l_ts.tv_nsec/1000);
+}
+
+std::string Utils::isoTime(void) {
+	char l_str[26];
+	time_t l_now;
+	struct tm l_tm;
+
+	l_now = time(0);
+	if ( !localtime_r(&l_now, &l_tm) ) {
+		return std::string();
+	}
+	if ( strftime(l_str, 25, "%FT%T%z", &l_tm) == 0 ) {
+		return std::string();
+	}
+
+	// The time zone designator is +hh:mm
+	l_str[24] = l_str[23];
+	l_str[23] = l_str[22];
+	l_str[22] = ':';
+	l_str[25] = 0;
+
+	return std::string(l_str);
+}
+
 exitCode Utils::b64dec(const char *p_in, char *p_out, size_t & p_outlen) {
 
 #warning Dummy b64dec implementation: Base64 decoding NOT yet supported
@@ -139,10 +139,36 @@ enum exitCode_ {
     ATCONTROL_REGISTRY_NOT_FOUND,
     GEN_NO_DISPATCHER,
     GEN_NOT_ENABLED,
+    GEN_RATE_LIMITED,
     DIS_SUSPENDED,
     DIS_COMMAND_NOT_SUPPORTED,
+    DIS_QUEUE_FULL,
+    DIS_DISPATCHER_ALREADY_DEFINED,
+    DIS_DISPATCHER_NOT_FOUND,
+    DIS_COALESCE_PARAM_INVALID,
+    TW_TIMER_NOT_FOUND,
+    RCT_FD_ALREADY_WATCHED,
+    RCT_FD_NOT_WATCHED,
+    RCT_EPOLL_FAILURE,
+    JRN_OPEN_FAILED,
+    JRN_WRITE_FAILED,
+    JRN_BAD_FORMAT,
+    JRN_END_OF_JOURNAL,
+    CMD_BUFFER_TOO_SMALL,
+    CMD_BAD_ENCODING,
+    SHM_OPEN_FAILED,
+    SHM_BAD_FORMAT,
+    SHM_FRAME_TOO_BIG,
+    SHM_NO_DATA,
+    THR_STATS_FAILED,
+    CFG_OPEN_FAILED,
+    CFG_WATCH_FAILED,
+    CFG_WRITE_FAILED,
+    CFG_BLOB_STALE,
+    CFG_BLOB_INVALID,
     GEN_THREAD_STARTED,
     WS_EP_NOT_SUPPORTED,
+    WS_EP_CFG_ERROR,
     WS_REGISTRY_NOT_FOUND,
     WS_MISSING_COMMAND_PARAM,
     WS_TRYING_UPLOAD,
@@ -215,6 +241,7 @@ enum exitCode_ {
     GPRS_RESET_REQUIRED,
     AS_I2C_OPEN_FAILED,
     AS_UNDEFINED_SENSOR,
+    AS_CFG_PARSE_ERROR,
     DS_PORT_READ_ERROR,
     DS_NO_NEW_EVENTS,
     DS_VALUE_CONVERSION_FAILED,
@@ -276,10 +303,19 @@ typedef enum deviceCode_ deviceCode;
 /// @see SERVICES_RANGE
 /// @see deviceCode
 enum commonService_ {
-    APPEND_DATA = 0	/// Require to append all meaningful data as param of the current command
+    APPEND_DATA = 0,	/// Require to append all meaningful data as param of the current command
+    RATE_LIMIT_SUMMARY	/// Report the number of events suppressed by a rate limited Generator
 };
 typedef enum commonService_ commonService;
 
+/// A compile time assertion.
+/// Only StaticAssert<true> is defined, thus sizeof(StaticAssert<cond>)
+/// fails the compilation whenever the constant cond is false.
+template <bool> struct StaticAssert;
+template <> struct StaticAssert<true> {
+    enum { value = 1 };
+};
+
 class Utils {
 
 public:
@@ -288,6 +324,21 @@ public:
 	static exitCode b64enc(const char *in, size_t inlen, char **out, size_t &outlen);
 	static exitCode b64dec(const char *inbuf, char *outbuf, size_t & out_len);
 
+	/// Return the current time in microseconds.
+	/// Meant to measure intervals, e.g. queueing latencies.
+	static unsigned long long timeUsec(void);
+
+	/// Return the current monotonic time in microseconds.
+	/// Unlike timeUsec() this time is never stepped by clock updates,
+	/// thus it is meant to timestamp events that should be replayed.
+	static unsigned long long monotonicUsec(void);
+
+	/// Return the current system time in ISO 8601 format.
+	/// The format is the one of DeviceTime::time(), e.g.
+	/// 2006-07-16T19:20:30+01:00, in the local time zone.
+	/// @return the formatted time, an empty string on failures
+	static std::string isoTime(void);
+
 };
 
 
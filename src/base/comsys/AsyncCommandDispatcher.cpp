@@ -0,0 +1,268 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#include "AsyncCommandDispatcher.ih"
+
+namespace controlbox {
+namespace comsys {
+
+
+AsyncCommandDispatcher::AsyncCommandDispatcher(Handler * handler, bool suspended,
+						unsigned int queueSize,
+						std::string const & logName) :
+	CommandDispatcher(handler, suspended, logName),
+	d_wakeup(0),
+	d_idle(0),
+	d_doExit(false),
+	d_tid(0),
+	d_heartbeat(0) {
+	unsigned short l_level;
+
+	LOG4CPP_DEBUG(log, "AsyncCommandDispatcher::AsyncCommandDispatcher(queueSize=%u)", queueSize);
+
+	for (l_level=0; l_level<COMMANDDISPATCHER_PRIO_LEVELS; l_level++) {
+		d_asyncQueues[l_level] = new CommandQueue(queueSize);
+	}
+
+	LOG4CPP_INFO(log, "Asynchronous dispatching using [%d] queues of [%u] commands",
+			COMMANDDISPATCHER_PRIO_LEVELS, d_asyncQueues[0]->capacity());
+
+	// Starting the dispatch thread
+	start();
+
+}
+
+AsyncCommandDispatcher::~AsyncCommandDispatcher() {
+	CommandQueue::t_stats l_stats;
+	t_prioStats l_prio;
+	unsigned short l_level;
+
+	LOG4CPP_DEBUG(log, "~AsyncCommandDispatcher()");
+
+	// Trailing Commands must not be delivered to a stopped thread
+	stopCoalescing();
+
+	// Terminating the dispatch thread
+	d_doExit = true;
+	d_wakeup.post();
+	join();
+
+	for (l_level=0; l_level<COMMANDDISPATCHER_PRIO_LEVELS; l_level++) {
+		d_asyncQueues[l_level]->getStats(l_stats);
+		getPrioStats(l_level, l_prio);
+		LOG4CPP_INFO(log, "P%u: dispatched [%lu] commands, overflows [%lu], high-water [%u/%u], max latency [%luus]",
+				l_level, l_stats.popped, l_stats.overflows,
+				l_stats.highWater, l_stats.capacity,
+				l_prio.maxLatency);
+		delete d_asyncQueues[l_level];
+	}
+
+}
+
+void AsyncCommandDispatcher::getStats(CommandQueue::t_stats & stats) const {
+	CommandQueue::t_stats l_stats;
+	unsigned short l_level;
+
+	memset(&stats, 0, sizeof(CommandQueue::t_stats));
+
+	for (l_level=0; l_level<COMMANDDISPATCHER_PRIO_LEVELS; l_level++) {
+		d_asyncQueues[l_level]->getStats(l_stats);
+		stats.pushed += l_stats.pushed;
+		stats.popped += l_stats.popped;
+		stats.overflows += l_stats.overflows;
+		stats.size += l_stats.size;
+		stats.capacity += l_stats.capacity;
+		if ( l_stats.highWater > stats.highWater ) {
+			stats.highWater = l_stats.highWater;
+		}
+	}
+
+}
+
+void AsyncCommandDispatcher::getStats(unsigned short level, CommandQueue::t_stats & stats) const {
+
+	if ( level >= COMMANDDISPATCHER_PRIO_LEVELS ) {
+		level = COMMANDDISPATCHER_PRIO_LEVELS-1;
+	}
+
+	d_asyncQueues[level]->getStats(stats);
+
+}
+
+bool AsyncCommandDispatcher::empty() const {
+	unsigned short l_level;
+
+	for (l_level=0; l_level<COMMANDDISPATCHER_PRIO_LEVELS; l_level++) {
+		if ( !d_asyncQueues[l_level]->empty() ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+exitCode AsyncCommandDispatcher::deliver(Command * command, bool clean, unsigned long long stamp) {
+	unsigned short l_level = prioLevel(command);
+
+	LOG4CPP_DEBUG(log, "AsyncCommandDispatcher::deliver(Command * command, bool clean)");
+
+	if ( !stamp ) {
+		stamp = Utils::monotonicUsec();
+	}
+
+	if ( !d_asyncQueues[l_level]->push(command, clean, stamp) ) {
+		LOG4CPP_WARN(log, "Dispatch queue P%u full, command [%u] dropped", l_level, command->type());
+		if ( clean ) {
+			command->release();
+		}
+		return DIS_QUEUE_FULL;
+	}
+
+	// Waking up the dispatch thread only if it's idle
+	if ( atomicCAS(&d_idle, 1, 0) ) {
+		d_wakeup.post();
+	}
+
+	return OK;
+
+}
+
+exitCode AsyncCommandDispatcher::deliverBatch(t_queuedCommand * batch, unsigned int count) {
+	exitCode result = OK;
+	exitCode l_result;
+	unsigned int i;
+
+	LOG4CPP_DEBUG(log, "AsyncCommandDispatcher::deliverBatch(count=%u)", count);
+
+	for (i=0; i<count; i++) {
+		l_result = deliver(batch[i].command, batch[i].clean, batch[i].stamp);
+		if ( result == OK ) {
+			result = l_result;
+		}
+	}
+
+	return result;
+
+}
+
+unsigned int AsyncCommandDispatcher::drain() {
+	t_queuedCommand l_batch[COMMANDDISPATCHER_BATCH_SIZE];
+	unsigned short l_level;
+	unsigned int l_size;
+	unsigned int l_count = 0;
+
+	for (;;) {
+
+		// Collecting a batch, higher priority first
+		l_size = 0;
+		l_level = 0;
+		while ( l_size < COMMANDDISPATCHER_BATCH_SIZE &&
+				l_level < COMMANDDISPATCHER_PRIO_LEVELS ) {
+			if ( !d_asyncQueues[l_level]->pop(l_batch[l_size].command,
+						l_batch[l_size].clean,
+						l_batch[l_size].stamp) ) {
+				// Moving to the next lower priority level
+				l_level++;
+				continue;
+			}
+			l_size++;
+		}
+
+		if ( !l_size ) {
+			break;
+		}
+
+		// Commands could be released by the Handler
+		if ( d_heartbeat ) {
+			d_heartbeat->busy("dispatch", l_batch[0].command->type());
+		}
+		try {
+			CommandDispatcher::deliverBatch(l_batch, l_size);
+		} catch (exceptions::IllegalCommandException & e) {
+			// The batch has been released: keeping on dispatching
+			LOG4CPP_ERROR(log, "Handler failed on a batch of [%u] commands", l_size);
+		}
+		if ( d_heartbeat ) {
+			d_heartbeat->idle();
+		}
+		l_count += l_size;
+
+	}
+
+	return l_count;
+
+}
+
+void AsyncCommandDispatcher::run(void) {
+	controlbox::ThreadDB *l_tdb = ThreadDB::getInstance();
+	unsigned int l_count;
+
+	d_tid = syscall(SYS_gettid);
+	LOG4CPP_INFO(log, "Thread [%s (%d)] started", "ACD", d_tid);
+
+	this->setName("ACD");
+	l_tdb->registerThread(this, d_tid);
+	d_heartbeat = l_tdb->getHeartbeat(d_tid);
+
+	while ( !d_doExit ) {
+
+		l_count = drain();
+		if ( l_count ) {
+			LOG4CPP_DEBUG(log, "Dispatched [%u] commands", l_count);
+			continue;
+		}
+
+		// Going idle: producers will wake us up once new commands are queued
+		atomicSet(&d_idle, 1);
+
+		// Double checking for commands queued before the idle flag was set
+		if ( !empty() ) {
+			if ( atomicCAS(&d_idle, 1, 0) ) {
+				continue;
+			}
+			// A producer has already posted a wakeup: consuming it
+		}
+
+		d_wakeup.wait();
+
+	}
+
+	// Notifying any still queued command
+	drain();
+
+	LOG4CPP_WARN(log, "Thread [%s (%d)] terminated", this->getName(), d_tid);
+	d_heartbeat = 0;
+	l_tdb->unregisterThread(this);
+
+}
+
+
+} //namespace comsys
+} //namespace controlbox
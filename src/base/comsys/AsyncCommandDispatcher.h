@@ -0,0 +1,132 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _ASYNCCOMMANDDISPATCHER_H
+#define _ASYNCCOMMANDDISPATCHER_H
+
+#include <controlbox/base/comsys/CommandDispatcher.h>
+#include <controlbox/base/comsys/CommandQueue.h>
+#include <controlbox/base/Utility.h>
+#include <controlbox/base/ThreadDB.h>
+#include <cc++/thread.h>
+
+
+namespace controlbox {
+namespace comsys {
+
+/// An asynchronous command dispatcher.
+/// An AsyncCommandDispatcher is a CommandDispatcher that decouple Generators
+/// from the associated Handler: dispatched Commands are pushed into a bounded
+/// lock-free CommandQueue and a dedicated dispatch thread is in charge to
+/// drain that queue notifying the Handler.<br>
+/// Generators never block on a slow Handler: once the queue is full new
+/// Commands are rejected, accounted as overflows and the dispatch returns
+/// DIS_QUEUE_FULL to notify the backpressure to the caller.<br>
+/// A queue is defined for each priority level, the dispatch thread always
+/// notify first the Commands with higher priority: under backlog an urgent
+/// Command never waits behind a burst of lower priority ones.
+/// @note the Handler is always notified by the same (dispatch) thread.
+class AsyncCommandDispatcher : public CommandDispatcher, public ost::PosixThread {
+
+protected:
+
+    /// The queues of commands waiting to be notified by the dispatch thread,
+    /// one for each priority level
+    CommandQueue * d_asyncQueues[COMMANDDISPATCHER_PRIO_LEVELS];
+
+    /// Used to wakeup the dispatch thread while idle
+    ost::Semaphore d_wakeup;
+
+    /// Set to 1 when the dispatch thread is (going to be) waiting for new commands
+    volatile int d_idle;
+
+    /// Set true when the dispatch thread should terminate
+    bool d_doExit;
+
+    /// The dispatch thread ID
+    int d_tid;
+
+    /// The dispatch thread liveness marker, 0 while not running
+    Heartbeat * d_heartbeat;
+
+public:
+
+    /// Build a new AsyncCommandDispatcher and start its dispatch thread.
+    /// @param handler the handler to notify
+    /// @param suspended set true to build a suspended dispatcher
+    /// @param queueSize the number of Commands, of each priority level,
+    ///		that could be queued waiting for the Handler notification
+    /// @param logName the log category, this name is prepended by the
+    ///		class namespace "controlbox.comlibs."
+    AsyncCommandDispatcher(Handler * handler = 0, bool suspended = true,
+                           unsigned int queueSize = COMMANDQUEUE_DEFAULT_SIZE,
+                           std::string const & logName = "acd");
+
+    /// Terminate the dispatch thread.
+    /// Commands still queued are notified before returning.
+    ~AsyncCommandDispatcher();
+
+    /// Collect dispatch queues statistics.
+    /// Counters are summed up over all the priority levels, while
+    /// the high-water mark is the maximum among them.
+    void getStats(CommandQueue::t_stats & stats) const;
+
+    /// Collect the dispatch queue statistics of a priority level.
+    void getStats(unsigned short level, CommandQueue::t_stats & stats) const;
+
+protected:
+
+    /// Queue a command for the dispatch thread.
+    /// @return OK on success, DIS_QUEUE_FULL if the command has been
+    ///		rejected (and eventually released) because of a full queue
+    exitCode deliver(Command * command, bool clean, unsigned long long stamp = 0);
+
+    /// Queue a batch of commands for the dispatch thread.
+    /// @return OK on success, DIS_QUEUE_FULL if some commands have been
+    ///		rejected (and eventually released) because of a full queue
+    exitCode deliverBatch(t_queuedCommand * batch, unsigned int count);
+
+    /// Notify the Handler about all queued Commands, higher priority first.
+    /// Commands are notified by (at most COMMANDDISPATCHER_BATCH_SIZE
+    /// commands long) batches.
+    /// @return the number of notified Commands
+    unsigned int drain();
+
+    /// Return true if there are not queued Commands.
+    bool empty() const;
+
+    /// The dispatch thread body.
+    void run(void);
+
+};
+
+} //namespace comsys
+} //namespace controlbox
+#endif
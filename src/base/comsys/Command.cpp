@@ -33,6 +33,85 @@
 namespace controlbox {
 namespace comsys {
 
+/// The interned param lables.
+/// Lables are never released, thus lookups don't need any lock: each lable
+/// is published into the open addressing index only once its name has been
+/// stored. The lock serializes only the registration of new lables.
+struct lableTable {
+	ost::Mutex lock;
+	/// The index slots: the lable id plus one, 0 for free slots
+	volatile unsigned short index[2*COMMAND_MAX_LABLES];
+	/// The lable names, by id
+	std::string * volatile names[COMMAND_MAX_LABLES];
+	/// The number of interned lables
+	volatile unsigned int count;
+	/// The lables registered once the table is full, looked up under lock
+	std::map<std::string, Command::t_lable> overflow;
+	std::vector<std::string> overflowNames;
+
+	lableTable() :
+		lock("cmdLablesMtx"),
+		count(0) {
+		static const char * wellKnown[Command::LBL_COUNT] = {
+			"timestamp",
+			"dist_evtType",
+			"dist_evtData",
+			"event",
+			"value",
+			"param",
+			"type",
+			"state",
+		};
+		unsigned short i;
+
+		memset((void *)index, 0, sizeof(index));
+		memset((void *)names, 0, sizeof(names));
+		for (i=0; i<Command::LBL_COUNT; i++) {
+			add(wellKnown[i]);
+		}
+	};
+
+	/// Lock-free lookup of an interned lable
+	bool find(std::string const & lable, Command::t_lable & id) {
+		unsigned int l_slot = hashFnv(lable) & (2*COMMAND_MAX_LABLES-1);
+		unsigned short l_entry;
+
+		for (;;) {
+			l_entry = atomicRead(&index[l_slot]);
+			if ( !l_entry ) {
+				return false;
+			}
+			if ( *names[l_entry-1] == lable ) {
+				id = l_entry-1;
+				return true;
+			}
+			l_slot = (l_slot+1) & (2*COMMAND_MAX_LABLES-1);
+		}
+	};
+
+	/// Intern a new lable, the lock must be held and the table not full
+	Command::t_lable add(std::string const & lable) {
+		unsigned int l_slot = hashFnv(lable) & (2*COMMAND_MAX_LABLES-1);
+		unsigned short l_id = count;
+
+		while ( index[l_slot] ) {
+			l_slot = (l_slot+1) & (2*COMMAND_MAX_LABLES-1);
+		}
+
+		// Publishing the name before the index slot referencing it
+		atomicSet(&names[l_id], new std::string(lable));
+		atomicSet(&index[l_slot], (unsigned short)(l_id+1));
+		atomicSet(&count, count+1);
+
+		return l_id;
+	};
+};
+
+static lableTable & lables() {
+	static lableTable l_lables;
+	return l_lables;
+}
+
 
 
 /*
@@ -42,7 +121,7 @@ Command::Command (t_cmdType const & cmdType, std::string const & logName) :
 	d_devType(Device::UNDEF),
 	d_devId(0) {
 
-	LOG4CPP_DEBUG(log, "Command::Command (d_cmdType=%u, logName=%s)", d_cmdType, logName.c_str());
+	LOG4CPP_DEBUG((*d_log), "Command::Command (d_cmdType=%u, logName=%s)", d_cmdType, logName.c_str());
 
 }
 */
@@ -53,39 +132,233 @@ Command::Command (t_cmdType const & cmdType, Device::t_deviceType devType,
         d_devType(devType),
         d_devId(devId),
         d_prio(10),
-        log(log4cpp::Category::getInstance(std::string("controlbox.comlibs.command."+logName))) {
+        d_coalesceKey(0),
+        d_refs(1),
+        d_payloadType(0),
+        d_payloadExporter(0),
+        d_exported(0),
+        d_logName(logName),
+        d_log(&log4cpp::Category::getInstance(std::string("controlbox.comlibs.command."+logName))) {
+
+	d_params.reserve(COMMAND_INLINE_PARAMS);
 
-	LOG4CPP_WARN(log, "NEW@%p (type=%u, device=%u, deviceId=%s, logName=%s)",
+	LOG4CPP_WARN((*d_log), "NEW@%p (type=%u, device=%u, deviceId=%s, logName=%s)",
 			this,
 			d_cmdType, d_devType, d_devId.c_str(), logName.c_str());
 
 }
 
 Command::~Command () {
-	t_mapValue::iterator it;
+	std::vector<std::string *>::iterator it;
 
-	LOG4CPP_WARN(log, "DEL@%p (type=%u, device=%u, deviceId=%s)",
+	LOG4CPP_WARN((*d_log), "DEL@%p (type=%u, device=%u, deviceId=%s)",
 			this,
 			d_cmdType, d_devType, d_devId.c_str());
 
-	// Walking the multimap to delete dynamic allocated params (string)
-	it = d_params.begin();
-	while ( it != d_params.end() ) {
-		if ( (it->second).type ==  PT_STRING) {
-			delete (it->second).value.s;
+	// Releasing dynamic allocated params (string)
+	clearParams();
+	for ( it = d_spareStrings.begin(); it != d_spareStrings.end(); it++ ) {
+		delete (*it);
+	}
+	d_spareStrings.clear();
+
+}
+
+void Command::reset(t_cmdType const & cmdType, Device::t_deviceType devType,
+                    Device::t_deviceId devId, std::string const & logName) {
+
+	clearParams();
+
+	d_cmdType = cmdType;
+	d_devType = devType;
+	d_devId = devId;
+	d_prio = 10;
+	d_coalesceKey = 0;
+	d_refs = 1;
+	d_payloadType = 0;
+	d_payloadExporter = 0;
+	d_exported = 0;
+
+	// Pooled Commands are usually recycled by the same Generator
+	if ( logName != d_logName ) {
+		d_log = &log4cpp::Category::getInstance(std::string("controlbox.comlibs.command."+logName));
+		d_logName = logName;
+	}
+
+	LOG4CPP_DEBUG((*d_log), "RECYCLED@%p (type=%u, device=%u, deviceId=%s, logName=%s)",
+			this,
+			d_cmdType, d_devType, d_devId.c_str(), logName.c_str());
+
+}
+
+void Command::clearParams() {
+	t_params::iterator it;
+
+	// Walking the params to save dynamic allocated params (string)
+	for ( it = d_params.begin(); it != d_params.end(); it++ ) {
+		if ( (it->param).type ==  PT_STRING) {
+			d_spareStrings.push_back((it->param).value.s);
 		}
-		it++;
 	}
+	// NOTE the params storage is kept for the next usages
 	d_params.clear();
 
 }
 
+void Command::setPayload(t_payloadType type, void const * payload, unsigned int size,
+                         t_payloadExporter exporter) {
+
+	if ( size > COMMAND_PAYLOAD_SIZE ) {
+		LOG4CPP_ERROR((*d_log), "Payload [%hu] too big (%u bytes), dropped", type, size);
+		return;
+	}
+
+	memcpy(d_payload.bytes, payload, size);
+	d_payloadType = type;
+	d_payloadExporter = exporter;
+	d_exported = 0;
+
+}
+
+void Command::doExportPayload() {
+	unsigned int l_spins;
+
+	if ( atomicCAS(&d_exported, 0, 1) ) {
+		LOG4CPP_DEBUG((*d_log), "Exporting payload [%hu] into params", d_payloadType);
+		d_payloadExporter(d_payload.bytes, *this);
+		if ( !atomicCAS(&d_exported, 1, 2) ) {
+			// Waking up the sleeping readers
+			atomicSet(&d_exported, 2);
+			syscall(SYS_futex, &d_exported, FUTEX_WAKE, INT_MAX, 0, 0, 0);
+		}
+		return;
+	}
+
+	// Another reader is exporting the payload: exports are short, thus
+	// yielding a while before sleeping up to the export completion
+	for (l_spins=0; l_spins<COMMAND_EXPORT_SPINS; l_spins++) {
+		if ( atomicRead(&d_exported) == 2 ) {
+			return;
+		}
+		sched_yield();
+	}
+
+	while ( atomicRead(&d_exported) != 2 ) {
+		atomicCAS(&d_exported, 1, 3);
+		syscall(SYS_futex, &d_exported, FUTEX_WAIT, 3, 0, 0, 0);
+	}
+
+}
+
+inline
+std::string * Command::newString(std::string const & value) {
+	std::string * l_str;
+
+	if ( d_spareStrings.empty() ) {
+		return new std::string(value);
+	}
+
+	l_str = d_spareStrings.back();
+	d_spareStrings.pop_back();
+	l_str->assign(value);
+
+	return l_str;
+}
+
 Command * Command::getCommand(t_cmdType const & cmdType, Device::t_deviceType devType,
                               Device::t_deviceId devId, std::string const & logName) {
 
     // TODO: return a Smart Pointer!!!
 
-    return new Command(cmdType, devType, devId, logName);
+    return CommandPool::getInstance()->get(cmdType, devType, devId, logName);
+
+}
+
+Command::t_lable Command::lableId(std::string const & lable) {
+    lableTable & l_lables = lables();
+    std::map<std::string, t_lable>::iterator it;
+    t_lable l_id;
+
+    if ( l_lables.find(lable, l_id) ) {
+        return l_id;
+    }
+
+    l_lables.lock.enterMutex();
+    if ( l_lables.find(lable, l_id) ) {
+        // Concurrently registered
+    } else if ( l_lables.count < COMMAND_MAX_LABLES ) {
+        l_id = l_lables.add(lable);
+    } else {
+        it = l_lables.overflow.find(lable);
+        if ( it != l_lables.overflow.end() ) {
+            l_id = it->second;
+        } else {
+            l_id = COMMAND_MAX_LABLES + l_lables.overflowNames.size();
+            l_lables.overflow[lable] = l_id;
+            l_lables.overflowNames.push_back(lable);
+        }
+    }
+    l_lables.lock.leaveMutex();
+
+    return l_id;
+}
+
+bool Command::findLable(std::string const & lable, t_lable & id) {
+    lableTable & l_lables = lables();
+    std::map<std::string, t_lable>::iterator it;
+    bool found = false;
+
+    if ( l_lables.find(lable, id) ) {
+        return true;
+    }
+
+    // Lables could have been registered elsewhere only once the table is full
+    if ( atomicRead(&l_lables.count) < COMMAND_MAX_LABLES ) {
+        return false;
+    }
+
+    l_lables.lock.enterMutex();
+    it = l_lables.overflow.find(lable);
+    if ( it != l_lables.overflow.end() ) {
+        id = it->second;
+        found = true;
+    }
+    l_lables.lock.leaveMutex();
+
+    return found;
+}
+
+std::string Command::lableName(t_lable lable) {
+    lableTable & l_lables = lables();
+    std::string l_name;
+
+    if ( lable < atomicRead(&l_lables.count) ) {
+        return *l_lables.names[lable];
+    }
+
+    l_lables.lock.enterMutex();
+    if ( lable >= COMMAND_MAX_LABLES &&
+            (unsigned int)(lable - COMMAND_MAX_LABLES) < l_lables.overflowNames.size() ) {
+        l_name = l_lables.overflowNames[lable - COMMAND_MAX_LABLES];
+    }
+    l_lables.lock.leaveMutex();
+
+    return l_name;
+}
+
+Command * Command::ref(unsigned int count) {
+
+    atomicAdd(&d_refs, count);
+
+    return this;
+
+}
+
+void Command::release() {
+
+    if ( atomicDec(&d_refs) == 0 ) {
+        CommandPool::getInstance()->put(this);
+    }
 
 }
 
@@ -104,27 +377,28 @@ exitCode Command::setDeviceId(Device::t_deviceId const & devId) {
 
 
 inline
-exitCode Command::eraseParam(std::string const & lable) {
-    t_mapValue::iterator first;
-    t_mapValue::iterator it;
-
-    // Walking the multimap to delete dynamic allocated params (string)
-    it = first = d_params.find(lable);
-    if ( it != d_params.end() ) {
-        do {
-            if ( (it->second).type ==  PT_STRING) {
-                delete (it->second).value.s;
-            }
-            it++;
-        } while ( it->first != first->first );
+exitCode Command::eraseParam(t_lable lable) {
+    t_params::iterator it;
+    t_params::iterator last;
+
+    // Compacting the params while saving dynamic allocated params (string)
+    last = d_params.begin();
+    for ( it = d_params.begin(); it != d_params.end(); it++ ) {
+        if ( it->lable != lable ) {
+            *(last++) = *it;
+            continue;
+        }
+        if ( (it->param).type ==  PT_STRING) {
+            d_spareStrings.push_back((it->param).value.s);
+        }
     }
-    d_params.erase(lable);
+    d_params.erase(last, d_params.end());
 
     return OK;
 }
 
 void Command::setPrio(unsigned short prio) {
-	LOG4CPP_DEBUG(log, "Setting command priority [%hu]", prio);
+	LOG4CPP_DEBUG((*d_log), "Setting command priority [%hu]", prio);
 	d_prio = prio;
 }
 
@@ -132,25 +406,39 @@ unsigned short Command::getPrio(void) const {
 	return d_prio;
 }
 
+void Command::setCoalesceKey(unsigned int key) {
+	d_coalesceKey = key;
+}
+
+unsigned int Command::getCoalesceKey(void) const {
+	return d_coalesceKey;
+}
+
 inline
-exitCode Command::setTheParam(std::string const & lable, t_cmdParam const & p, bool override) {
+exitCode Command::setTheParam(t_lable lable, t_cmdParam const & p, bool override) {
+    t_cmdEntry l_entry;
 
-    LOG4CPP_DEBUG(log, "Command::setTheParam(lable=%s, type=%d, override=%s)", lable.c_str(), p.type, override ? "YES" : "NO" );
+    LOG4CPP_DEBUG((*d_log), "Command::setTheParam(lable=%hu, type=%d, override=%s)", lable, p.type, override ? "YES" : "NO" );
 
-    // TODO: delete strings params!!!
     if ( override ) {
         eraseParam(lable);
     }
 
-    d_params.insert ( pair<std::string, t_cmdParam>(lable,p) );
+    l_entry.lable = lable;
+    l_entry.param = p;
+    d_params.push_back(l_entry);
 
     return OK;
 }
 
 exitCode Command::setParam(std::string const & lable, int value, bool override ) {
+    return setParam(lableId(lable), value, override);
+}
+
+exitCode Command::setParam(t_lable lable, int value, bool override ) {
     t_cmdParam p;
 
-    LOG4CPP_DEBUG(log, "Command::setParam(lable=%s, value=%d, override=%s)", lable.c_str(), value, override ? "YES" : "NO" );
+    LOG4CPP_DEBUG((*d_log), "Command::setParam(lable=%hu, value=%d, override=%s)", lable, value, override ? "YES" : "NO" );
 
     p.type = PT_INT;
     p.value.i = value;
@@ -160,9 +448,13 @@ exitCode Command::setParam(std::string const & lable, int value, bool override )
 
 
 exitCode Command::setParam(std::string const & lable, double value, bool override ) {
+    return setParam(lableId(lable), value, override);
+}
+
+exitCode Command::setParam(t_lable lable, double value, bool override ) {
     t_cmdParam p;
 
-    LOG4CPP_DEBUG(log, "Command::setParam(lable=%s, value=%f, override=%s)", lable.c_str(), value, override ? "YES" : "NO" );
+    LOG4CPP_DEBUG((*d_log), "Command::setParam(lable=%hu, value=%f, override=%s)", lable, value, override ? "YES" : "NO" );
 
     p.type = PT_FLOAT;
     p.value.d = value;
@@ -171,12 +463,16 @@ exitCode Command::setParam(std::string const & lable, double value, bool overrid
 }
 
 exitCode Command::setParam(std::string const & lable, std::string const & value, bool override) {
+    return setParam(lableId(lable), value, override);
+}
+
+exitCode Command::setParam(t_lable lable, std::string const & value, bool override) {
     t_cmdParam p;
 
-    LOG4CPP_DEBUG(log, "Command::setParam(lable=%s, value=%s, override=%s)", lable.c_str(), value.c_str(), override ? "YES" : "NO" );
+    LOG4CPP_DEBUG((*d_log), "Command::setParam(lable=%hu, value=%s, override=%s)", lable, value.c_str(), override ? "YES" : "NO" );
 
     p.type = PT_STRING;
-    p.value.s = new std::string(value);
+    p.value.s = newString(value);
 
     return setTheParam(lable, p, override);
 }
@@ -196,79 +492,81 @@ Device::t_deviceId Command::deviceId() const {
 }
 
 unsigned int Command::paramCount() const {
+    exportPayload();
     return d_params.size();
 }
 
 unsigned int Command::paramCount(std::string const & lable) const {
-    return d_params.count(lable);
+    t_lable l_id;
+
+    if ( !findLable(lable, l_id) ) {
+        return 0;
+    }
+
+    return paramCount(l_id);
+}
+
+unsigned int Command::paramCount(t_lable lable) const {
+    t_params::const_iterator it;
+    unsigned int l_count = 0;
+
+    exportPayload();
+
+    for ( it = d_params.begin(); it != d_params.end(); it++ ) {
+        if ( it->lable == lable ) {
+            l_count++;
+        }
+    }
+
+    return l_count;
 }
 
 inline
-Command::t_cmdParam Command::find(std::string const & lable, unsigned int pos)
+Command::t_cmdParam Command::find(t_lable lable, unsigned int pos)
 throw (exceptions::UnknowedParamException) {
+    t_params::const_iterator it;
+    unsigned int l_found = 0;
+
+    LOG4CPP_DEBUG((*d_log), "Command::find(lable=%hu, pos=%u)", lable, pos);
 
-    // Trying to optimize a bit multiple access for multi-value params retrivial
-
-    static std::string lastSearchLable;	// the last searched pos used to optimize multi-value param retrivial
-    static unsigned int lastPos = 0;		// the last searched pos used to optimeze forward search
-    static unsigned int lableCount = 0;		// the elements count for lastSearchLable
-    unsigned int delta = 0;			// used to optimize forward search
-    static t_mapValue::iterator it;		// the iterator used to optimize forward search of multi-value params
-
-    LOG4CPP_DEBUG(log, "Command::param(lable=%s, pos=%u)", lable.c_str(), pos);
-
-    /*
-    	LOG4CPP_DEBUG(log, "\tlastSearchLable: %s", lastSearchLable.c_str());
-    	LOG4CPP_DEBUG(log, "\tlastPos:         %u", lastPos);
-    	LOG4CPP_DEBUG(log, "\tlableCount:  %u", lableCount);
-    	LOG4CPP_DEBUG(log, "delta:             %u", delta);
-    */
-
-    // Optimizing multi-value param forward search
-    if ( (lable != lastSearchLable) || (pos < lastPos) ) {
-        lastSearchLable = lable;
-        it = d_params.find(lable);
-        lableCount = d_params.count(lable);
-        if ( ! lableCount ) {
-            throw exceptions::UnknowedParamException("The required param doesn't exist!");
+    exportPayload();
+
+    // NOTE the lookup must be reentrant: the same Command could be
+    // concurrently accessed by multiple Handlers
+    if ( !pos ) {
+        pos = 1;
+    }
+    for ( it = d_params.begin(); it != d_params.end(); it++ ) {
+        if ( it->lable == lable && ++l_found == pos ) {
+            return it->param;
         }
-        lastPos = pos;
-        delta = pos-1;
     }
 
-    // Check if the required pos is valid
-    if ( pos > lableCount ) {
-        LOG4CPP_WARN(log, "The required param '%s' has not as much elements! Looking for pos=%u, but size(%s)=%u",
-                     lable.c_str(), pos, lable.c_str(), lableCount);
-        throw exceptions::UnknowedParamException("The required param has not as much elements!");
+    if ( !l_found ) {
+        throw exceptions::UnknowedParamException("The required param doesn't exist!");
     }
 
-    // Optimizing forward search
-    if ( pos > lastPos ) {
-        delta = pos - lastPos;
-        lastPos = pos;
-    }
+    LOG4CPP_WARN((*d_log), "The required param '%hu' has not as much elements! Looking for pos=%u, but size(%hu)=%u",
+                 lable, pos, lable, l_found);
+    throw exceptions::UnknowedParamException("The required param has not as much elements!");
+
+}
+
 
-    /*
-    	LOG4CPP_DEBUG(log, "");
-    	LOG4CPP_DEBUG(log, "\tlastSearchLable: %s", lastSearchLable.c_str());
-    	LOG4CPP_DEBUG(log, "\tlastPos:         %u", lastPos);
-    	LOG4CPP_DEBUG(log, "\tlableCount:  %u", lableCount);
-    	LOG4CPP_DEBUG(log, "delta:             %u", delta);
-    */
-    // Moving the iterator to the required param:
-    // now we are quite sure we get the pos without going
-    // out of range
-    while ( delta-- ) {
-        it++;
+long Command::getIParam(std::string const & lable, unsigned int pos)
+throw (exceptions::UnknowedParamException) {
+    t_lable l_id;
+
+    if ( !findLable(lable, l_id) ) {
+        throw exceptions::UnknowedParamException("The required param doesn't exist!");
     }
 
-    return it->second;
+    return getIParam(l_id, pos);
 
 }
 
 
-long Command::getIParam(std::string const & lable, unsigned int pos)
+long Command::getIParam(t_lable lable, unsigned int pos)
 throw (exceptions::UnknowedParamException) {
     t_cmdParam p;
 
@@ -280,6 +578,19 @@ throw (exceptions::UnknowedParamException) {
 
 
 double Command::getFParam(std::string const & lable, unsigned int pos)
+throw (exceptions::UnknowedParamException) {
+    t_lable l_id;
+
+    if ( !findLable(lable, l_id) ) {
+        throw exceptions::UnknowedParamException("The required param doesn't exist!");
+    }
+
+    return getFParam(l_id, pos);
+
+}
+
+
+double Command::getFParam(t_lable lable, unsigned int pos)
 throw (exceptions::UnknowedParamException) {
     t_cmdParam p;
 
@@ -290,15 +601,27 @@ throw (exceptions::UnknowedParamException) {
 }
 
 std::string Command::param(std::string const & lable, unsigned int pos)
+throw (exceptions::UnknowedParamException) {
+    t_lable l_id;
+
+    if ( !findLable(lable, l_id) ) {
+        throw exceptions::UnknowedParamException("The required param doesn't exist!");
+    }
+
+    return param(l_id, pos);
+
+}
+
+std::string Command::param(t_lable lable, unsigned int pos)
 throw (exceptions::UnknowedParamException) {
     t_cmdParam p;
     std::ostringstream s_param("");
 
-    LOG4CPP_DEBUG(log, "Command::param(std::string const & lable, unsigned int pos)");
+    LOG4CPP_DEBUG((*d_log), "Command::param(t_lable lable, unsigned int pos)");
 
     p = find(lable, pos);
 
-    LOG4CPP_DEBUG(log, "Type: %d", p.type);
+    LOG4CPP_DEBUG((*d_log), "Type: %d", p.type);
 
     // Halding string conversion for non string params
     switch (p.type) {
@@ -318,72 +641,97 @@ throw (exceptions::UnknowedParamException) {
 }
 
 bool Command::hasParam(std::string const & lable) {
-    return d_params.find(lable) != d_params.end();
+    t_lable l_id;
+
+    if ( !findLable(lable, l_id) ) {
+        return false;
+    }
+
+    return hasParam(l_id);
+}
+
+bool Command::hasParam(t_lable lable) const {
+    t_params::const_iterator it;
+
+    exportPayload();
+
+    for ( it = d_params.begin(); it != d_params.end(); it++ ) {
+        if ( it->lable == lable ) {
+            return true;
+        }
+    }
+
+    return false;
 }
 
 
 exitCode Command::xmlDump(std::string & xmlCommand) {
-    t_mapValue::iterator it;		// = (command->paramList())->begin();
-    unsigned int countMultiparam = 0;	// if >0 means also we are in MULTIPARAM MODE
-    std::string lastLable;
+    t_params::iterator it;
+    t_params::iterator prev;
+    t_params::iterator next;
+    unsigned int countMultiparam;	// if >0 means also we are in MULTIPARAM MODE
+    std::string lable;
     std::ostringstream xml("");
 
-    LOG4CPP_DEBUG(log, "Command::xmlDump()");
+    LOG4CPP_DEBUG((*d_log), "Command::xmlDump()");
+
+    exportPayload();
 
 
-    //d_fwcategory->info("\n");
     xml << "\n<Command type='" << d_cmdType << "'>\n";
     xml << "\t<Device id='" << d_devId << "'>" << d_devType << "</Device>\n";
     xml << "\t<Params>\n";
 
+    for ( it = d_params.begin(); it != d_params.end(); it++ ) {
 
-    //d_fwcategory.info("");
-
-    it = d_params.begin();
-    while ( it != d_params.end() ) {
-
-        // Checking for multiparam values
-        if ( !countMultiparam && (d_params.count(it->first) > 1) ) {
-            xml << "\t\t<MultiValueParam Name='" << it->first << "'>\n";
-            countMultiparam = 1;
-            lastLable = it->first;
-        }
-
-        if ( countMultiparam ) {
-            xml << "\t\t\t<Value id='" << countMultiparam++ << "'>";
-        } else {
-            xml << "\t\t<Param Name='" << it->first << "'>";
-        }
-        switch ((it->second).type) {
-        case PT_INT:
-            xml << (it->second).value.i;
-            break;
-        case PT_FLOAT:
-            xml << (it->second).value.d;
-            break;
-        case PT_STRING:
-            xml << *((it->second).value.s);
-            break;
+        // Multiparam values are dumped all together at their first occurrence
+        for ( prev = d_params.begin(); prev != it; prev++ ) {
+            if ( prev->lable == it->lable ) {
+                break;
+            }
         }
-        if ( countMultiparam ) {
-            xml <<  "</Value>\n";
-        } else {
-            xml << "</Param>\n";
+        if ( prev != it ) {
+            continue;
         }
-        it++;
 
-        // Cheching if the current multiparam is finisched
-        if ( countMultiparam ) {
+        lable = lableName(it->lable);
+        countMultiparam = 0;
+        if ( paramCount(it->lable) > 1 ) {
+            xml << "\t\t<MultiValueParam Name='" << lable << "'>\n";
+            countMultiparam = 1;
+        }
 
-            if (it == d_params.end()) {
-                xml << "\t\t</MultiValueParam>\n";
+        for ( next = it; next != d_params.end(); next++ ) {
+            if ( next->lable != it->lable ) {
                 continue;
             }
 
-            if (lastLable != it->first) {
-                countMultiparam = 0; // Exiting multiparam mode
+            if ( countMultiparam ) {
+                xml << "\t\t\t<Value id='" << countMultiparam++ << "'>";
+            } else {
+                xml << "\t\t<Param Name='" << lable << "'>";
+            }
+            switch ((next->param).type) {
+            case PT_INT:
+                xml << (next->param).value.i;
+                break;
+            case PT_FLOAT:
+                xml << (next->param).value.d;
+                break;
+            case PT_STRING:
+                xml << *((next->param).value.s);
+                break;
             }
+            if ( countMultiparam ) {
+                xml <<  "</Value>\n";
+            } else {
+                xml << "</Param>\n";
+                break;
+            }
+        }
 
+        if ( countMultiparam ) {
+            xml << "\t\t</MultiValueParam>\n";
         }
 
     }
@@ -395,6 +743,22 @@ exitCode Command::xmlDump(std::string & xmlCommand) {
 
     return OK;
 
+}
+
+unsigned int Command::encodedSize() const {
+    unsigned int l_len;
+
+    CommandView::encode(*this, 0, 0, l_len);
+
+    return l_len;
+}
+
+exitCode Command::encode(char * buf, unsigned int size, unsigned int & len) const {
+
+    LOG4CPP_DEBUG((*d_log), "Command::encode(size=%u)", size);
+
+    return CommandView::encode(*this, buf, size, len);
+
 } //namespace comsys
 } //namespace controlbox
 
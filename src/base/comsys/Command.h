@@ -35,13 +35,22 @@
 #include <controlbox/base/Exception.h>
 #include <controlbox/base/Device.h>
 #include <map>
+#include <vector>
 
 #include <sstream>
 
-#define INSERT_PARAM(_labe_, _value_)							\
-	do {										\
-		d_params.insert (pair<std::string, t_cmdParam>(_lable_,_value_));	\
-	} while (0);
+/// The number of params a Command could hold without further allocations
+#define COMMAND_INLINE_PARAMS	8
+
+/// The number of param lables interned into the lock-free lookup table
+#define COMMAND_MAX_LABLES	512
+
+/// The maximum size of the typed payload a Command could carry
+#define COMMAND_PAYLOAD_SIZE	64
+
+/// The number of times a reader yields, waiting for a payload exported by
+/// another reader, before sleeping up to the export completion
+#define COMMAND_EXPORT_SPINS	16
 
 namespace controlbox {
 namespace comsys {
@@ -53,12 +62,42 @@ namespace comsys {
 /// defined as enum values by CommandHandlers.
 class Command {
 
+    friend class CommandPool;
+    friend class CommandJournal;
+    friend class CommandView;
+
 public:
 
     /// The Command Type.
     /// Meaningful values for that type are related to each device.
     typedef unsigned int t_cmdType;
 
+    /// An interned param lable.
+    /// Param lables are interned into small integer keys, once, by lableId().
+    typedef unsigned short t_lable;
+
+    /// Well known param lables.
+    /// These lables are interned at startup and could be used by Generators
+    /// and Handlers without any lookup.
+    enum wellKnownLable {
+        LBL_TIMESTAMP = 0,	///< "timestamp"
+        LBL_DIST_EVTTYPE,	///< "dist_evtType"
+        LBL_DIST_EVTDATA,	///< "dist_evtData"
+        LBL_EVENT,		///< "event"
+        LBL_VALUE,		///< "value"
+        LBL_PARAM,		///< "param"
+        LBL_TYPE,		///< "type"
+        LBL_STATE,		///< "state"
+        LBL_COUNT		///< The number of well known lables
+    };
+
+    /// A typed payload identifier, 0 for Commands without a payload.
+    /// @see TypedCommand
+    typedef unsigned short t_payloadType;
+
+    /// Export a typed payload as plain params of the Command carrying it.
+    typedef void (*t_payloadExporter)(void const * payload, Command & command);
+
 
 protected:
 
@@ -82,8 +121,17 @@ protected:
     };
     typedef struct cmdParam t_cmdParam;
 
-    /// Map param lables to value.
-    typedef multimap<std::string, t_cmdParam> t_mapValue;
+    /// A command param entry
+    struct cmdEntry {
+        unsigned short lable;	///< The interned param lable
+        t_cmdParam param;	///< The param value
+    };
+    typedef struct cmdEntry t_cmdEntry;
+
+    /// The flat list of params, in insertion order.
+    /// Commands have usually just a few params, thus a linear scan over
+    /// interned lables is faster than any string keyed lookup.
+    typedef std::vector<t_cmdEntry> t_params;
 
 
     /// The command type
@@ -96,7 +144,7 @@ protected:
     Device::t_deviceId d_devId;
 
     /// Other (optional) command params.
-    t_mapValue d_params;
+    t_params d_params;
 
     /// The command priority
     /// This priority could be used define the upload queue where the command
@@ -104,9 +152,51 @@ protected:
     /// @see WSProxyCommandHandler
     unsigned short d_prio;
 
+    /// The coalescing key, 0 if the command must never be coalesced.
+    /// Commands reporting successive states of the same source (e.g. a
+    /// sensor line) share the same key, so that a dispatcher could merge
+    /// them when they come in bursts.
+    /// @see EventDispatcher::setCoalescing
+    unsigned int d_coalesceKey;
+
+    /// The number of references to this command.
+    /// A Command could be shared among multiple Handlers (e.g. by a
+    /// MultipleDispatcher), in that case the Command is released only once
+    /// the last reference has been dropped.
+    volatile unsigned int d_refs;
+
+    /// String params storage released by previous users of this Command.
+    /// Pooled Commands keep the storage of their string params to avoid
+    /// allocating new ones each time the Command is recycled.
+    std::vector<std::string *> d_spareStrings;
+
+    /// The typed payload storage
+    union payload {
+        char bytes[COMMAND_PAYLOAD_SIZE];
+        long long alignLong;
+        double alignDouble;
+        void * alignPtr;
+    } d_payload;
+
+    /// The type of the carried payload, 0 if none
+    t_payloadType d_payloadType;
+
+    /// The exporter of the payload into plain params
+    t_payloadExporter d_payloadExporter;
+
+    /// The payload export state: 0 not exported, 1 exporting, 2 exported,
+    /// 3 exporting with sleeping readers
+    volatile int d_exported;
+
+    /// The name of the current log category.
+    /// A recycled Command looks up its category only if this name changes.
+    std::string d_logName;
+
     /// Logger
-    /// Use this logger reference, related to the 'log' category, to log your messages
-    log4cpp::Category & log;
+    /// Use this logger, related to the 'log' category, to log your messages.
+    /// @note this is a pointer, not a reference, since the category of
+    ///		a pooled Command is updated each time the Command is recycled.
+    log4cpp::Category * d_log;
 
 
 public:
@@ -125,7 +215,28 @@ public:
     /// @see Handler
     static Command * getCommand(t_cmdType const & cmdType, Device::t_deviceType devType, Device::t_deviceId devId, std::string const & logName = "Generic");
 
-    ~Command();
+    /// Intern a param lable.
+    /// The lable is registered, if not already known, and its key returned.
+    /// Hot paths should intern their lables once and then use the
+    /// t_lable version of the params accessors.
+    /// @param lable the param lable
+    /// @return the interned key for the lable
+    static t_lable lableId(std::string const & lable);
+
+    /// Return the name of an interned lable.
+    static std::string lableName(t_lable lable);
+
+    /// Get new references to this Command.
+    /// Each reference must be dropped by a call to release().
+    /// @param count the number of references to get (default 1)
+    /// @return this Command
+    Command * ref(unsigned int count = 1);
+
+    /// Drop a reference to this Command.
+    /// The Command is given back to the CommandPool once the last reference
+    /// has been dropped.
+    /// @note a newly created Command has a single reference.
+    void release();
 
     /// Set the device type identifier.
     /// @param devType the device type identifier
@@ -139,6 +250,14 @@ public:
 
     unsigned short getPrio(void) const;
 
+    /// Set the coalescing key.
+    /// @param key the key shared by the commands reporting the states of
+    ///		the same source, 0 (the default) to never coalesce this command
+    void setCoalesceKey(unsigned int key);
+
+    /// Get the coalescing key, 0 if the command must never be coalesced.
+    unsigned int getCoalesceKey(void) const;
+
     /// Set a string command parameter.
     /// Use this to associate a string parameter to the command
     /// @param lable the param name
@@ -146,6 +265,7 @@ public:
     /// @param override whatever override the current definition of this param if
     ///			already present (default true)
     exitCode setParam(std::string const & lable, std::string const & value, bool override = true);
+    exitCode setParam(t_lable lable, std::string const & value, bool override = true);
 
     /// Set an int command parameter.
     /// Use this to associate a string parameter to the command
@@ -154,6 +274,7 @@ public:
     /// @param override whatever override the current definition of this param if
     ///			already present (default true)
     exitCode setParam(std::string const & lable, int value, bool override = true);
+    exitCode setParam(t_lable lable, int value, bool override = true);
 
     /// Set a float command parameter.
     /// Use this to associate a float parameter to the command
@@ -162,6 +283,7 @@ public:
     /// @param override whatever override the current definition of this param if
     ///			already present (default true)
     exitCode setParam(std::string const & lable, double value, bool override = true);
+    exitCode setParam(t_lable lable, double value, bool override = true);
 
     /// Return the command type.
     /// @return the command type
@@ -185,6 +307,7 @@ public:
     /// @param lable the lable's param to count
     /// @return the number of params with lable specified
     unsigned int paramCount(std::string const & lable) const;
+    unsigned int paramCount(t_lable lable) const;
 
     /// Return the required command parameter.
     /// The param whose lable is specified is returned. If the param is a
@@ -197,6 +320,8 @@ public:
     /// @throw exceptions::UnknowedParamException if the required parameter is not present.
     long getIParam(std::string const & lable, unsigned int pos = 1)
     throw (exceptions::UnknowedParamException);
+    long getIParam(t_lable lable, unsigned int pos = 1)
+    throw (exceptions::UnknowedParamException);
 
     /// Return the required command parameter.
     /// The param whose lable is specified is returned. If the param is a
@@ -209,6 +334,8 @@ public:
     /// @throw exceptions::UnknowedParamException if the required parameter is not present.
     double getFParam(std::string const & lable, unsigned int pos = 1)
     throw (exceptions::UnknowedParamException);
+    double getFParam(t_lable lable, unsigned int pos = 1)
+    throw (exceptions::UnknowedParamException);
 
     /// Return the required command parameter.
     /// The param whose lable is specified is returned. If the param is a
@@ -223,13 +350,54 @@ public:
     /// @throw exceptions::UnknowedParamException if the required parameter is not present.
     std::string param(std::string const & lable, unsigned int pos = 1)
     throw (exceptions::UnknowedParamException);
+    std::string param(t_lable lable, unsigned int pos = 1)
+    throw (exceptions::UnknowedParamException);
 
     /// Verify if the specified param is defined.
     bool hasParam(std::string const & lable);
+    bool hasParam(t_lable lable) const;
 
 
     exitCode xmlDump(std::string & xmlCommand);
 
+    /// Return the length of the binary encoding of this Command.
+    /// @see CommandView
+    unsigned int encodedSize() const;
+
+    /// Encode this Command into a compact binary frame.
+    /// The frame is written into a caller provided buffer, thus no
+    /// allocations are required; use a CommandView to decode it.
+    /// @param buf the buffer where the frame is written
+    /// @param size the buffer size
+    /// @param len the frame length, set also when the buffer is too small
+    /// @return OK on success, CMD_BUFFER_TOO_SMALL if the frame doesn't fit
+    ///		into the buffer
+    /// @see CommandView
+    exitCode encode(char * buf, unsigned int size, unsigned int & len) const;
+
+    /// Return the type of the carried payload, 0 if none.
+    inline t_payloadType payloadType() const {
+        return d_payloadType;
+    };
+
+    /// Return the carried payload storage.
+    /// Use TypedCommand::payload() for a type checked access.
+    inline void * payload() {
+        return d_payload.bytes;
+    };
+
+    /// Set the typed payload.
+    /// Hot paths could carry a plain struct instead of params: the
+    /// payload is exported into params only the first time any params
+    /// accessor (or xmlDump) is used, thus legacy Handlers still work.
+    /// Use TypedCommand::getCommand() for a type checked initialization.
+    /// @param type the payload type
+    /// @param payload the payload to copy into the Command
+    /// @param size the payload size, at most COMMAND_PAYLOAD_SIZE
+    /// @param exporter the routine exporting the payload into params
+    void setPayload(t_payloadType type, void const * payload, unsigned int size,
+                    t_payloadExporter exporter);
+
 
 protected:
 
@@ -247,11 +415,43 @@ protected:
     /// @see Handler
     Command (t_cmdType const & cmdType, Device::t_deviceType devType, Device::t_deviceId devId, std::string const & logName);
 
-    inline exitCode eraseParam(std::string const & lable);
+    /// Destroy a Command.
+    /// Only the CommandPool deletes Commands: clients must drop their
+    /// references with release(), to keep the pool accounting right.
+    /// @see release
+    ~Command();
+
+    /// Reinitialize a recycled Command.
+    /// All params are dropped, keeping their storage for future usages,
+    /// and the Command is initialized as a newly created one.
+    void reset(t_cmdType const & cmdType, Device::t_deviceType devType, Device::t_deviceId devId, std::string const & logName);
+
+    /// Drop all the params, keeping their storage for future usages.
+    void clearParams();
+
+    /// Export the typed payload into params, if not already done.
+    /// Concurrent readers wait for the export to complete.
+    inline void exportPayload() const {
+        if ( d_payloadExporter && d_exported != 2 ) {
+            const_cast<Command *>(this)->doExportPayload();
+        }
+    };
+
+    /// Export the typed payload into params.
+    void doExportPayload();
+
+    /// Get a string storage initialized with the specified value.
+    inline std::string * newString(std::string const & value);
+
+    /// Look for an already interned lable.
+    /// @return true if the lable has been interned, false otherwise
+    static bool findLable(std::string const & lable, t_lable & id);
+
+    inline exitCode eraseParam(t_lable lable);
 
-    inline exitCode setTheParam(std::string const & lable, t_cmdParam const & param, bool override);
+    inline exitCode setTheParam(t_lable lable, t_cmdParam const & param, bool override);
 
-    inline t_cmdParam find(std::string const & lable, unsigned int pos)
+    inline t_cmdParam find(t_lable lable, unsigned int pos)
     throw (exceptions::UnknowedParamException);
 
     /// Convert from string to native T type.
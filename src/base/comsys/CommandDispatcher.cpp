@@ -33,24 +33,39 @@ namespace controlbox {
 namespace comsys {
 
 
-CommandDispatcher::CommandDispatcher(Handler * handler, bool suspended):
-        EventDispatcher(handler, suspended, "cd"),
-        d_command(0) {
+CommandDispatcher::CommandDispatcher(Handler * handler, bool suspended, std::string const & logName):
+        EventDispatcher(handler, suspended, logName),
+        d_command(0),
+        d_queueLock("cdQueueMtx"),
+        d_journal(0),
+        d_bus(0) {
 
-    LOG4CPP_DEBUG(log, "CommandDispatcher::CommandDispatcher(Handler * handler, bool suspended)");
+    LOG4CPP_DEBUG(log, "CommandDispatcher::CommandDispatcher(Handler * handler, bool suspended, std::string const & logName)");
+
+    memset(d_prioCounters, 0, sizeof(d_prioCounters));
 
 }
 
 
 CommandDispatcher::~CommandDispatcher() {
 
+	t_coalescedMap::iterator it;
+
 	LOG4CPP_DEBUG(log, "~CommandDispatcher()");
 
+	// Commands held back by debouncing are dropped
+	stopCoalescing();
+	for ( it = d_coalesced.begin(); it != d_coalesced.end(); it++ ) {
+		if ( it->second.held.command && it->second.held.clean ) {
+			it->second.held.command->release();
+		}
+	}
+
 	// ATTENZIONE: impedire l'accodamento durante lo shutdown...
 	d_suspended = true;
 	flushQueue(true);
 	if (d_command) {
-		delete d_command;
+		d_command->release();
 	}
 
 }
@@ -115,18 +130,46 @@ throw (exceptions::OutOfMemoryException) {
 
     LOG4CPP_DEBUG(log, "CommandDispatcher::dispatch(Command * command)");
 
+    if ( d_journal ) {
+        d_journal->record(command);
+    }
+
+    if ( d_bus ) {
+        d_bus->publish(command);
+    }
+
     // If disabled...
     if ( d_suspended ) {
         // Queuing command for handler notify
         LOG4CPP_INFO(log, "Disaptcher suspended; queuing new Command for delayed dispatching");
-        queueCommand(command);
+        queueCommand(command, clean);
         return DIS_SUSPENDED;
     }
 
+    if ( d_coalesce == COALESCE_DEBOUNCE && command->getCoalesceKey() ) {
+        return debounce(command, clean);
+    }
+
     // Dispatching command immediatly
-    d_handler->notify(command);
+    return deliver(command, clean);
+
+}
+
+exitCode CommandDispatcher::deliver(Command * command, bool clean, unsigned long long stamp) {
+
+    LOG4CPP_DEBUG(log, "CommandDispatcher::deliver(Command * command, bool clean)");
+
+    accountDelivery(prioLevel(command), stamp);
+    try {
+        d_handler->notify(command);
+    } catch (exceptions::IllegalCommandException & e) {
+        if ( clean ) {
+            command->release();
+        }
+        throw;
+    }
     if ( clean ) {
-    	delete command;
+    	command->release();
     }
 
     return OK;
@@ -134,13 +177,229 @@ throw (exceptions::OutOfMemoryException) {
 }
 
 
-exitCode CommandDispatcher::queueCommand(Command * command)
+exitCode CommandDispatcher::debounce(Command * command, bool clean) {
+    unsigned long long l_now = Utils::monotonicUsec();
+    unsigned long long l_window = (unsigned long long)d_coalesceParam*1000;
+    t_queuedCommand l_superseded;
+
+    d_coalesceLock.enterMutex();
+    t_coalesced & l_source = d_coalesced[sourceKey(command)];
+    l_superseded = l_source.held;
+
+    if ( l_source.lastNotify && (l_now - l_source.lastNotify) < l_window ) {
+        // Holding back the Command up to the window expiration
+        l_source.held.command = command;
+        l_source.held.clean = clean;
+        l_source.held.stamp = l_now;
+        armCoalescing(l_source.lastNotify + l_window);
+        d_coalesceLock.leaveMutex();
+        LOG4CPP_DEBUG(log, "Command held back within the debounce window");
+    } else {
+        l_source.held.command = 0;
+        l_source.lastNotify = l_now;
+        d_coalesceLock.leaveMutex();
+        deliver(command, clean);
+    }
+
+    if ( l_superseded.command ) {
+        atomicInc(&d_merged);
+        if ( l_superseded.clean ) {
+            l_superseded.command->release();
+        }
+    }
+
+    return OK;
+
+}
+
+void CommandDispatcher::timerExpired(unsigned int timer) {
+    std::vector<t_queuedCommand> l_due;
+    std::vector<t_queuedCommand>::iterator due;
+    t_coalescedMap::iterator it;
+    unsigned long long l_now;
+    unsigned long long l_window;
+
+    LOG4CPP_DEBUG(log, "CommandDispatcher::timerExpired(timer=%u)", timer);
+
+    // Held back events first, this also disarm the timer
+    EventDispatcher::timerExpired(timer);
+
+    d_coalesceLock.enterMutex();
+    l_now = Utils::monotonicUsec();
+    l_window = (unsigned long long)d_coalesceParam*1000;
+    for ( it = d_coalesced.begin(); it != d_coalesced.end(); it++ ) {
+        t_coalesced & l_source = it->second;
+        if ( !l_source.held.command ) {
+            continue;
+        }
+        if ( (l_now - l_source.lastNotify) < l_window ) {
+            armCoalescing(l_source.lastNotify + l_window);
+            continue;
+        }
+        l_due.push_back(l_source.held);
+        l_source.held.command = 0;
+        l_source.lastNotify = l_now;
+    }
+    d_coalesceLock.leaveMutex();
+
+    for ( due = l_due.begin(); due != l_due.end(); due++ ) {
+        if ( d_suspended ) {
+            queueCommand(due->command, due->clean);
+            continue;
+        }
+        LOG4CPP_DEBUG(log, "Delivering trailing Command");
+        deliver(due->command, due->clean, due->stamp);
+    }
+
+}
+
+void CommandDispatcher::coalesceQueued() {
+    std::map<unsigned long long, unsigned int> l_seen;
+    std::vector<t_queuedCommand> l_queued;
+    unsigned int l_keep;
+    unsigned short l_level;
+    unsigned int i;
+
+    if ( d_coalesce == COALESCE_NONE ) {
+        return;
+    }
+    l_keep = (d_coalesce == COALESCE_KEEP_LAST) ? d_coalesceParam : 1;
+
+    for (l_level=0; l_level<COMMANDDISPATCHER_PRIO_LEVELS; l_level++) {
+        queue<t_queuedCommand> & l_queue = d_queuedCommands[l_level];
+        if ( l_queue.size() < 2 ) {
+            continue;
+        }
+
+        l_queued.clear();
+        while ( !l_queue.empty() ) {
+            l_queued.push_back(l_queue.front());
+            l_queue.pop();
+        }
+
+        // Newest Commands first, keeping the last ones of each source
+        l_seen.clear();
+        for (i=l_queued.size(); i--; ) {
+            Command * l_cmd = l_queued[i].command;
+            if ( !l_cmd->getCoalesceKey() ||
+                    ++l_seen[sourceKey(l_cmd)] <= l_keep ) {
+                continue;
+            }
+            if ( l_queued[i].clean ) {
+                l_cmd->release();
+            }
+            l_queued[i].command = 0;
+            atomicInc(&d_merged);
+        }
+
+        for (i=0; i<l_queued.size(); i++) {
+            if ( l_queued[i].command ) {
+                l_queue.push(l_queued[i]);
+            }
+        }
+    }
+
+}
+
+exitCode CommandDispatcher::dispatchBatch(Command * const * commands, unsigned int count, bool clean) {
+    t_queuedCommand l_batch[COMMANDDISPATCHER_BATCH_SIZE];
+    unsigned int l_count;
+    exitCode result = OK;
+    exitCode l_result;
+
+    LOG4CPP_DEBUG(log, "CommandDispatcher::dispatchBatch(count=%u, clean=%d)", count, clean);
+
+    if ( d_journal ) {
+        d_journal->recordBatch(commands, count);
+    }
+
+    if ( d_bus ) {
+        d_bus->publishBatch(commands, count);
+    }
+
+    if ( d_suspended ) {
+        LOG4CPP_INFO(log, "Disaptcher suspended; queuing [%u] new Commands for delayed dispatching", count);
+        while ( count-- ) {
+            queueCommand(*(commands++), clean);
+        }
+        return DIS_SUSPENDED;
+    }
+
+    while ( count ) {
+        for (l_count=0; count && l_count<COMMANDDISPATCHER_BATCH_SIZE; count--) {
+            if ( d_coalesce == COALESCE_DEBOUNCE && (*commands)->getCoalesceKey() ) {
+                debounce(*(commands++), clean);
+                continue;
+            }
+            l_batch[l_count].command = *(commands++);
+            l_batch[l_count].clean = clean;
+            l_batch[l_count].stamp = 0;
+            l_count++;
+        }
+        if ( !l_count ) {
+            continue;
+        }
+        l_result = deliverBatch(l_batch, l_count);
+        if ( result == OK ) {
+            result = l_result;
+        }
+    }
+
+    return result;
+
+}
+
+exitCode CommandDispatcher::deliverBatch(t_queuedCommand * batch, unsigned int count) {
+    Command * l_commands[COMMANDDISPATCHER_BATCH_SIZE];
+    exitCode result;
+    unsigned int i;
+
+    LOG4CPP_DEBUG(log, "CommandDispatcher::deliverBatch(count=%u)", count);
+
+    for (i=0; i<count; i++) {
+        accountDelivery(prioLevel(batch[i].command), batch[i].stamp);
+        l_commands[i] = batch[i].command;
+    }
+
+    // Commands are released even if the Handler throws
+    try {
+        result = d_handler->notifyBatch(l_commands, count);
+    } catch (exceptions::IllegalCommandException & e) {
+        releaseBatch(batch, count);
+        throw;
+    }
+    releaseBatch(batch, count);
+
+    return result;
+
+}
+
+void CommandDispatcher::releaseBatch(t_queuedCommand * batch, unsigned int count) {
+    unsigned int i;
+
+    for (i=0; i<count; i++) {
+        if ( batch[i].clean ) {
+            batch[i].command->release();
+        }
+    }
+
+}
+
+
+exitCode CommandDispatcher::queueCommand(Command * command, bool clean)
 throw (exceptions::OutOfMemoryException) {
+    t_queuedCommand l_queued;
+
+    LOG4CPP_DEBUG(log, "CommandDispatcher::queueCommand(Command * command, bool clean)");
 
-    LOG4CPP_DEBUG(log, "CommandDispatcher::queueCommand(Command * command)");
+    l_queued.command = command;
+    l_queued.clean = clean;
+    l_queued.stamp = Utils::monotonicUsec();
 
     // Queuing command for handler notify
-    d_queuedCommands.push(command);
+    d_queueLock.enterMutex();
+    d_queuedCommands[prioLevel(command)].push(l_queued);
+    d_queueLock.leaveMutex();
 
     // ATTENZIONE: come ci si accorge di problemi di
     // allocazione, tipo memoria esaurita?!?
@@ -150,7 +409,65 @@ throw (exceptions::OutOfMemoryException) {
     return OK;
 }
 
+void CommandDispatcher::accountDelivery(unsigned short level, unsigned long long stamp) {
+	t_prioCounters & l_counters = d_prioCounters[level];
+	unsigned long l_latency;
+
+	atomicInc(&l_counters.delivered);
+	if ( !stamp ) {
+		return;
+	}
+
+	l_latency = (unsigned long)(Utils::monotonicUsec() - stamp);
+	atomicAdd(&l_counters.latency, l_latency);
+	atomicMax(&l_counters.maxLatency, l_latency);
+
+}
+
+void CommandDispatcher::setJournal(CommandJournal * journal) {
+
+	LOG4CPP_INFO(log, "Commands journaling %s", journal ? "enabled" : "disabled");
+	d_journal = journal;
+
+}
+
+void CommandDispatcher::setBus(ShmBus * bus) {
+
+	LOG4CPP_INFO(log, "Commands bus publishing %s", bus ? "enabled" : "disabled");
+	d_bus = bus;
+
+}
+
+void CommandDispatcher::getPrioStats(unsigned short level, t_prioStats & stats) const {
+
+	if ( level >= COMMANDDISPATCHER_PRIO_LEVELS ) {
+		level = COMMANDDISPATCHER_PRIO_LEVELS-1;
+	}
+
+	stats.delivered = d_prioCounters[level].delivered;
+	stats.latency = d_prioCounters[level].latency;
+	stats.maxLatency = d_prioCounters[level].maxLatency;
+
+}
+
+bool CommandDispatcher::popQueued(t_queuedCommand & queued) {
+	unsigned short l_level;
+
+	for (l_level=0; l_level<COMMANDDISPATCHER_PRIO_LEVELS; l_level++) {
+		if ( !d_queuedCommands[l_level].empty() ) {
+			queued = d_queuedCommands[l_level].front();
+			d_queuedCommands[l_level].pop();
+			return true;
+		}
+	}
+
+	return false;
+}
+
 exitCode CommandDispatcher::flushQueue(bool discard) {
+	t_queuedCommand l_queued;
+	t_queuedCommand l_batch[COMMANDDISPATCHER_BATCH_SIZE];
+	unsigned int l_count;
 
 	LOG4CPP_DEBUG(log, "CommandDispatcher::flushQueue(bool discard=%d)", discard);
 
@@ -159,18 +476,40 @@ exitCode CommandDispatcher::flushQueue(bool discard) {
 
 		LOG4CPP_WARN(log, "Flushing Command Queue: Discarding all commands");
 
-		while ( !d_queuedCommands.empty() && !d_suspended ) {
-			d_queuedCommands.pop();
-
+		d_queueLock.enterMutex();
+		while ( !d_suspended && popQueued(l_queued) ) {
+			if ( l_queued.clean ) {
+				l_queued.command->release();
+			}
 		}
+		d_queueLock.leaveMutex();
 
 	} else {
 
 		LOG4CPP_INFO(log, "Flushing Command Queue: Notifying all commands");
 
-		while ( !d_queuedCommands.empty() && !d_suspended ) {
-			d_handler->notify( d_queuedCommands.front() );
-			d_queuedCommands.pop();
+		d_queueLock.enterMutex();
+		coalesceQueued();
+		d_queueLock.leaveMutex();
+
+		// NOTE the lock is released while notifying the Handler to
+		// avoid blocking Generators on slow Handlers. Since new Commands
+		// could be queued meanwhile, the higher priority level is looked
+		// up again before each batch.
+		d_queueLock.enterMutex();
+		for (;;) {
+			for (l_count=0; l_count<COMMANDDISPATCHER_BATCH_SIZE &&
+					!d_suspended && popQueued(l_batch[l_count]); l_count++)
+				;
+			d_queueLock.leaveMutex();
+
+			if ( !l_count ) {
+				break;
+			}
+			LOG4CPP_DEBUG(log, "Flushing a batch of [%u] commands", l_count);
+			deliverBatch(l_batch, l_count);
+
+			d_queueLock.enterMutex();
 		}
 	}
 
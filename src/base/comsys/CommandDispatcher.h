@@ -32,8 +32,21 @@
 
 #include <controlbox/base/comsys/EventDispatcher.h>
 #include <controlbox/base/comsys/Command.h>
+#include <controlbox/base/comsys/CommandJournal.h>
+#include <controlbox/base/comsys/ShmBus.h>
 #include <controlbox/base/Utility.h>
+#include <cc++/thread.h>
 #include <queue>
+#include <map>
+
+/// The number of priority levels honored by CommandDispatchers.
+/// Commands are mapped to levels by their priority (Command::getPrio()),
+/// lower values being more urgent; priorities beyond the last level are
+/// mapped to the last one. This matches the WSProxy upload queues.
+#define COMMANDDISPATCHER_PRIO_LEVELS	5
+
+/// The maximum number of Commands notified to an Handler with a single call
+#define COMMANDDISPATCHER_BATCH_SIZE	32
 
 
 namespace controlbox {
@@ -42,23 +55,84 @@ namespace comsys {
 /// A command dispatcher.
 /// A CommandDispatcher is a Dispatcher that could Dispatch Command to a CommandHandler.
 /// Each CommandDispatcher could have a default Command to dispatch or otherwiese could dispatch
-/// Command provided by a Generator.
+/// Command provided by a Generator.<br>
+/// The coalescing policy (see EventDispatcher::setCoalescing()) applies
+/// also to the Commands defining a coalescing key (see
+/// Command::setCoalesceKey()): Commands are coalesced only with the ones
+/// of the same source, identified by the Command type and key.
 class CommandDispatcher : public EventDispatcher {
 
+public:
+
+    /// Delivery statistics of a priority level
+    struct prioStats {
+        unsigned long delivered;	///< Commands notified to the Handler
+        unsigned long latency;		///< Overall queueing latency [us] (wraps around)
+        unsigned long maxLatency;	///< Maximum queueing latency [us]
+    };
+    typedef struct prioStats t_prioStats;
+
 protected:
 
+    /// Delivery counters of a priority level
+    struct prioCounters {
+        volatile unsigned long delivered;
+        volatile unsigned long latency;
+        volatile unsigned long maxLatency;
+    };
+    typedef struct prioCounters t_prioCounters;
+
     /// The default command to send
     Command * d_command;
 
-    /// The queue of commands waiting to be dispatched while in suspended state
-    queue<Command *> d_queuedCommands;
+    /// A command waiting to be dispatched
+    struct queuedCommand {
+        Command * command;
+        bool clean;	///< Whatever the command should be released once notified
+        unsigned long long stamp;	///< The queuing time [us]
+    };
+    typedef struct queuedCommand t_queuedCommand;
+
+    /// The queues of commands waiting to be dispatched while in suspended state,
+    /// one for each priority level
+    queue<t_queuedCommand> d_queuedCommands[COMMANDDISPATCHER_PRIO_LEVELS];
+
+    /// The delivery counters of each priority level
+    t_prioCounters d_prioCounters[COMMANDDISPATCHER_PRIO_LEVELS];
+
+    /// The debouncing state of a Commands source
+    struct coalesced {
+        unsigned long long lastNotify;	///< The monotonic time [us] of the last notified Command
+        t_queuedCommand held;		///< The Command held back, if command is not null
+    };
+    typedef struct coalesced t_coalesced;
+
+    /// The debouncing state of each Commands source, indexed by sourceKey()
+    typedef std::map<unsigned long long, t_coalesced> t_coalescedMap;
+
+    /// The debouncing state of the Commands sources.
+    /// Access is protected by the coalescing lock.
+    t_coalescedMap d_coalesced;
+
+    /// Mutex access to the queue of suspended commands.
+    /// Many Generators, each one running its own thread, could dispatch
+    /// concurrently on the same CommandDispatcher.
+    ost::Mutex d_queueLock;
+
+    /// The journal recording dispatched Commands, if any
+    CommandJournal * d_journal;
+
+    /// The shared memory bus exporting dispatched Commands, if any
+    ShmBus * d_bus;
 
 public:
 
     /// Build a new suspended CommandDispatcher.
     /// The newly created CommandDispatcher is set in suspended state till it is
     /// attacched to an handler.
-    CommandDispatcher(Handler * handler = 0, bool suspended = true);
+    /// @param logName the log category, this name is prepended by the
+    ///		class namespace "controlbox.comlibs."
+    CommandDispatcher(Handler * handler = 0, bool suspended = true, std::string const & logName = "cd");
 
     ///
     ~CommandDispatcher();
@@ -71,6 +145,8 @@ public:
     ///		overwritten by that one, but the previous instance will NOT
     ///		be cleaned by that class: the client must provide to release
     ///		the memory associated with the previous command.
+    /// @note the reference to the current default command is taken over:
+    ///		it is released when this CommandDispatcher is destroyed.
     exitCode setDefaultCommand(Command * command);
 
     /// Enable commands dispatching
@@ -111,19 +187,116 @@ public:
     exitCode dispatch(Command * command, bool clean = true)
     throw (exceptions::OutOfMemoryException);
 
+    /// Dispatch a batch of commands to Handler.
+    /// If not suspended, the commands are notified to the Handler with
+    /// (at most COMMANDDISPATCHER_BATCH_SIZE commands long) batches.
+    /// Otherwise the commands are queued for future dispatching.
+    /// @param commands the Commands to dispatch
+    /// @param count the number of Commands
+    /// @param clean when true the commands are released once notified
+    /// @return OK on success, DIS_SUSPENDED if the Commands have been queued.
+    exitCode dispatchBatch(Command * const * commands, unsigned int count, bool clean = true);
+
+    /// Record dispatched Commands into a journal.
+    /// Each Command dispatched after this call is recorded, before
+    /// being notified or queued, into the specified journal.
+    /// @param journal the journal to use, 0 to stop recording. The journal
+    ///		is not owned and must be released by the caller once
+    ///		recording has been stopped.
+    void setJournal(CommandJournal * journal);
+
+    /// Export dispatched Commands on a shared memory bus.
+    /// Each Command dispatched after this call is published, before
+    /// being notified or queued, on the specified bus.
+    /// @param bus the bus to use, 0 to stop publishing. The bus is not
+    ///		owned and must be released by the caller once publishing
+    ///		has been stopped.
+    void setBus(ShmBus * bus);
+
+    /// Collect the delivery statistics of a priority level.
+    /// @param level the priority level, in [0..COMMANDDISPATCHER_PRIO_LEVELS)
+    /// @param stats the collected statistics
+    void getPrioStats(unsigned short level, t_prioStats & stats) const;
+
 protected:
 
+    /// Return the priority level of a Command.
+    static inline unsigned short prioLevel(Command * command) {
+        unsigned short l_prio = command->getPrio();
+        return (l_prio < COMMANDDISPATCHER_PRIO_LEVELS) ?
+                l_prio : COMMANDDISPATCHER_PRIO_LEVELS-1;
+    };
+
+    /// Return the key of the source of a coalescible Command.
+    static inline unsigned long long sourceKey(Command * command) {
+        return ((unsigned long long)command->type() << 32) |
+                command->getCoalesceKey();
+    };
+
+    /// Debounce a coalescible Command.
+    /// The Command is delivered if the debouncing window of its source
+    /// is expired, otherwise it is held back, superseding a previously held
+    /// one, up to the window expiration.
+    /// @return OK on success
+    exitCode debounce(Command * command, bool clean);
+
+    /// Coalesce the Commands queued while suspended.
+    /// Only the last Command of each source (the last N ones for
+    /// COALESCE_KEEP_LAST) is kept, the other ones are released.
+    /// @note must be called with the queue lock held
+    void coalesceQueued();
+
+    /// Deliver the Commands held back by COALESCE_DEBOUNCE whose window
+    /// is expired, and the held back events.
+    void timerExpired(unsigned int timer);
+
+    /// Account a Command notified to the Handler.
+    /// @param level the Command priority level
+    /// @param stamp the Command queuing time [us], 0 if never queued
+    void accountDelivery(unsigned short level, unsigned long long stamp);
+
+    /// Extract the next suspended Command, higher priority levels first.
+    /// @note must be called with the queue lock held
+    /// @return false if there are not queued Commands
+    bool popQueued(t_queuedCommand & queued);
+
     /// Queue new commands.
     /// Queue the defined command for delayed dispatching
     /// @param command the command to queue
+    /// @param clean when true the command is released once notified
     /// @return OK on success
     /// @throw exceptions::OutOfMemoryException if ther's not enought memory to queue the command
-    exitCode queueCommand(Command * command)
+    exitCode queueCommand(Command * command, bool clean = true)
     throw (exceptions::OutOfMemoryException);
 
+    /// Deliver a command to the associated Handler.
+    /// This is the point where a Command leave the dispatcher: this
+    /// implementation synchronously notify the Handler, within the caller
+    /// thread, and eventually release the Command.
+    /// Subclasses could override this method to customize the delivery policy.
+    /// @param command the Command to deliver
+    /// @param clean when true the command is released once notified
+    /// @param stamp the Command queuing time [us], 0 if never queued
+    /// @return OK on success
+    virtual exitCode deliver(Command * command, bool clean, unsigned long long stamp = 0);
+
+    /// Deliver a batch of commands to the associated Handler.
+    /// This implementation synchronously notify the whole batch to the
+    /// Handler, with a single Handler::notifyBatch() call, and eventually
+    /// release the Commands.
+    /// Subclasses could override this method to customize the delivery policy.
+    /// @param batch the Commands to deliver
+    /// @param count the number of Commands, at most COMMANDDISPATCHER_BATCH_SIZE
+    /// @return OK on success
+    virtual exitCode deliverBatch(t_queuedCommand * batch, unsigned int count);
+
+    /// Release the Commands of a delivered batch which have to be cleaned.
+    void releaseBatch(t_queuedCommand * batch, unsigned int count);
+
 
     /// Flush queude commands.
-    /// Disaptch all Commands queued while in suspended state.
+    /// Disaptch all Commands queued while in suspended state, higher
+    /// priority levels first, by batches.
     /// @param discard set TRUE when queued messages shuld be discarded instead than notified
     /// @return OK on success
     exitCode flushQueue(bool discard = false);
@@ -54,6 +54,9 @@ exitCode CommandGenerator::notify(Command * command, bool clean) {
 	LOG4CPP_DEBUG(log, "CommandGenerator::notify()");
 
 	if (d_enabled) {
+		if ( d_limiter && !admit(command, clean) ) {
+			return GEN_RATE_LIMITED;
+		}
 		LOG4CPP_INFO(log, "Command dispatching");
 		d_dispatcher->dispatch(command, clean);
 		return OK;
@@ -64,6 +67,68 @@ exitCode CommandGenerator::notify(Command * command, bool clean) {
 
 }
 
+exitCode CommandGenerator::notifyBatch(Command * const * commands, unsigned int count, bool clean) {
+
+	LOG4CPP_DEBUG(log, "CommandGenerator::notifyBatch(count=%u)", count);
+
+	if (!count) {
+		return OK;
+	}
+
+	if (d_enabled) {
+		if ( d_limiter ) {
+			return notifyLimited(commands, count, clean);
+		}
+		LOG4CPP_INFO(log, "Commands batch dispatching [%u]", count);
+		d_dispatcher->dispatchBatch(commands, count, clean);
+		return OK;
+	}
+
+	LOG4CPP_WARN(log, "Commands batch not dispatched because the Generator is disabled");
+	return GEN_NOT_ENABLED;
+
+}
+
+
+bool CommandGenerator::admit(Command * command, bool clean) {
+	Command * l_summary;
+
+	if ( !d_limiter->admit(command, d_dispatcher) ) {
+		if ( clean ) {
+			command->release();
+		}
+		return false;
+	}
+
+	// Notifying the over-limit Commands summary before the admitted one
+	l_summary = d_limiter->summary(command);
+	if ( l_summary ) {
+		d_dispatcher->dispatch(l_summary, true);
+	}
+
+	return true;
+}
+
+exitCode CommandGenerator::notifyLimited(Command * const * commands, unsigned int count, bool clean) {
+	std::vector<Command *> l_batch;
+	unsigned int i;
+
+	l_batch.reserve(count);
+	for (i=0; i<count; i++) {
+		if ( admit(commands[i], clean) ) {
+			l_batch.push_back(commands[i]);
+		}
+	}
+
+	if ( l_batch.empty() ) {
+		return GEN_RATE_LIMITED;
+	}
+
+	LOG4CPP_INFO(log, "Commands batch dispatching [%u/%u]", l_batch.size(), count);
+	d_dispatcher->dispatchBatch(&l_batch[0], l_batch.size(), clean);
+
+	return (l_batch.size() == count) ? OK : GEN_RATE_LIMITED;
+}
 
 } //namespace comsys
 } //namespace controlbox
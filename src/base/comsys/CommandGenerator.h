@@ -70,6 +70,25 @@ public:
 
     exitCode notify(Command * command, bool clean = true);
 
+    /// Notify a batch of Commands with a single dispatch call.
+    /// The associated Dispatcher could use this to deliver the whole
+    /// batch to its Handler taking its locks only once.
+    /// @param commands the Commands to notify
+    /// @param count the number of Commands into the batch
+    /// @param clean set true if the Commands should be released once notified
+    exitCode notifyBatch(Command * const * commands, unsigned int count, bool clean = true);
+
+protected:
+
+    /// Check a Command against the rate limiter.
+    /// A rejected Command is eventually released, while an admitted one
+    /// is preceded by the summary of the previously rejected ones, if any.
+    /// @return true if the Command should be notified
+    bool admit(Command * command, bool clean);
+
+    /// Notify the Commands of a batch admitted by the rate limiter.
+    exitCode notifyLimited(Command * const * commands, unsigned int count, bool clean);
+
 };
 
 
@@ -0,0 +1,437 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+
+#include "CommandJournal.ih"
+
+/// The journal file magic header
+#define COMMANDJOURNAL_MAGIC	"CBJ1"
+
+namespace controlbox {
+namespace comsys {
+
+/// Append the raw bytes of a value to a record buffer
+template <typename T>
+static inline void put(std::string & buf, T value) {
+	buf.append((char const *)&value, sizeof(T));
+}
+
+/// Read the raw bytes of a value from the journal file
+template <typename T>
+static inline bool get(FILE * file, T & value) {
+	return (fread(&value, sizeof(T), 1, file) == 1);
+}
+
+
+CommandJournal::CommandJournal(std::string const & path, t_journalMode mode,
+				std::string const & logName) :
+	Object("comlibs."+logName),
+	d_path(path),
+	d_mode(mode),
+	d_file(0),
+	d_buffer(0),
+	d_lock("cjLock") {
+	char l_magic[sizeof(COMMANDJOURNAL_MAGIC)-1];
+
+	LOG4CPP_DEBUG(log, "CommandJournal::CommandJournal(path=%s, mode=%d)", path.c_str(), mode);
+
+	memset(&d_stats, 0, sizeof(t_stats));
+
+	d_file = fopen(d_path.c_str(), (d_mode == JOURNAL_WRITE) ? "w" : "r");
+	if ( !d_file ) {
+		LOG4CPP_ERROR(log, "Unable to open journal [%s]: %s", d_path.c_str(), strerror(errno));
+		return;
+	}
+
+	d_buffer = new char[COMMANDJOURNAL_BUFFER_SIZE];
+	setvbuf(d_file, d_buffer, _IOFBF, COMMANDJOURNAL_BUFFER_SIZE);
+
+	if ( d_mode == JOURNAL_WRITE ) {
+		fwrite(COMMANDJOURNAL_MAGIC, sizeof(l_magic), 1, d_file);
+		d_stats.bytes += sizeof(l_magic);
+		LOG4CPP_INFO(log, "Recording commands into [%s]", d_path.c_str());
+		return;
+	}
+
+	if ( fread(l_magic, sizeof(l_magic), 1, d_file) != 1 ||
+			memcmp(l_magic, COMMANDJOURNAL_MAGIC, sizeof(l_magic)) ) {
+		LOG4CPP_ERROR(log, "[%s] is not a commands journal", d_path.c_str());
+		fclose(d_file);
+		d_file = 0;
+		return;
+	}
+	d_stats.bytes += sizeof(l_magic);
+
+	LOG4CPP_INFO(log, "Reading commands from [%s]", d_path.c_str());
+
+}
+
+CommandJournal::~CommandJournal() {
+
+	LOG4CPP_DEBUG(log, "~CommandJournal()");
+
+	if ( d_file ) {
+		fclose(d_file);
+		LOG4CPP_INFO(log, "Journal [%s] closed: %lu commands, %lu lables, %llu bytes, %lu errors",
+				d_path.c_str(), d_stats.commands, d_stats.lables,
+				d_stats.bytes, d_stats.errors);
+	}
+
+	if ( d_buffer ) {
+		delete [] d_buffer;
+	}
+
+}
+
+void CommandJournal::encode(Command * command, unsigned long long stamp, std::string & buf) {
+	Command::t_params::const_iterator it;
+	Command::t_cmdParam const * l_param;
+
+	// Typed payloads are journaled as plain params
+	command->exportPayload();
+
+	put(buf, (unsigned char)REC_COMMAND);
+	put(buf, stamp);
+	put(buf, (unsigned int)command->d_cmdType);
+	put(buf, (unsigned int)command->d_devType);
+	put(buf, command->d_prio);
+	put(buf, (unsigned short)command->d_devId.size());
+	buf.append(command->d_devId);
+	put(buf, (unsigned short)command->d_params.size());
+
+	for ( it = command->d_params.begin(); it != command->d_params.end(); it++ ) {
+		l_param = &(it->param);
+		put(buf, it->lable);
+		put(buf, (unsigned char)l_param->type);
+		switch ( l_param->type ) {
+		case Command::PT_INT:
+			put(buf, (long long)l_param->value.i);
+			break;
+		case Command::PT_FLOAT:
+			put(buf, l_param->value.d);
+			break;
+		case Command::PT_STRING:
+			put(buf, (unsigned int)l_param->value.s->size());
+			buf.append(*(l_param->value.s));
+			break;
+		}
+	}
+
+}
+
+void CommandJournal::encodeLables(Command * command, std::string & buf) {
+	Command::t_params::const_iterator it;
+	std::string l_name;
+
+	for ( it = command->d_params.begin(); it != command->d_params.end(); it++ ) {
+		if ( it->lable < d_known.size() && d_known[it->lable] ) {
+			continue;
+		}
+		if ( it->lable >= d_known.size() ) {
+			d_known.resize(it->lable+1, false);
+		}
+		d_known[it->lable] = true;
+
+		l_name = Command::lableName(it->lable);
+		put(buf, (unsigned char)REC_LABLE);
+		put(buf, it->lable);
+		put(buf, (unsigned short)l_name.size());
+		buf.append(l_name);
+		d_stats.lables++;
+	}
+
+}
+
+exitCode CommandJournal::write(std::string const & buf) {
+
+	if ( fwrite(buf.data(), buf.size(), 1, d_file) != 1 ) {
+		d_stats.errors++;
+		return JRN_WRITE_FAILED;
+	}
+	d_stats.bytes += buf.size();
+
+	return OK;
+}
+
+exitCode CommandJournal::record(Command * command, unsigned long long stamp) {
+	std::string l_lables;
+	std::string l_record;
+	exitCode result;
+
+	if ( !d_file || d_mode != JOURNAL_WRITE ) {
+		return JRN_WRITE_FAILED;
+	}
+
+	if ( !stamp ) {
+		stamp = Utils::monotonicUsec();
+	}
+
+	l_record.reserve(128);
+	encode(command, stamp, l_record);
+
+	d_lock.enterMutex();
+	encodeLables(command, l_lables);
+	if ( !l_lables.empty() ) {
+		write(l_lables);
+	}
+	result = write(l_record);
+	if ( result == OK ) {
+		d_stats.commands++;
+	}
+	d_lock.leaveMutex();
+
+	if ( result != OK ) {
+		LOG4CPP_WARN(log, "Recording command [%u] FAILED", command->type());
+	}
+
+	return result;
+}
+
+exitCode CommandJournal::recordBatch(Command * const * commands, unsigned int count) {
+	unsigned long long l_stamp = Utils::monotonicUsec();
+	std::string l_buf;
+	unsigned int i;
+	exitCode result;
+
+	if ( !d_file || d_mode != JOURNAL_WRITE ) {
+		return JRN_WRITE_FAILED;
+	}
+
+	l_buf.reserve(128*count);
+
+	d_lock.enterMutex();
+	for (i=0; i<count; i++) {
+		encodeLables(commands[i], l_buf);
+		encode(commands[i], l_stamp, l_buf);
+	}
+	result = write(l_buf);
+	if ( result == OK ) {
+		d_stats.commands += count;
+	}
+	d_lock.leaveMutex();
+
+	if ( result != OK ) {
+		LOG4CPP_WARN(log, "Recording a batch of [%u] commands FAILED", count);
+	}
+
+	return result;
+}
+
+exitCode CommandJournal::flush() {
+	exitCode result = OK;
+
+	if ( !d_file ) {
+		return JRN_WRITE_FAILED;
+	}
+
+	d_lock.enterMutex();
+	if ( fflush(d_file) ) {
+		d_stats.errors++;
+		result = JRN_WRITE_FAILED;
+	}
+	d_lock.leaveMutex();
+
+	return result;
+}
+
+bool CommandJournal::readString(std::string & str, unsigned int len) {
+	char l_buf[256];
+	unsigned int l_size;
+
+	str.clear();
+	while ( len ) {
+		l_size = (len < sizeof(l_buf)) ? len : sizeof(l_buf);
+		if ( fread(l_buf, l_size, 1, d_file) != 1 ) {
+			return false;
+		}
+		str.append(l_buf, l_size);
+		len -= l_size;
+	}
+
+	d_stats.bytes += str.size();
+	return true;
+}
+
+exitCode CommandJournal::readLable() {
+	unsigned short l_key;
+	unsigned short l_len;
+	std::string l_name;
+
+	if ( !get(d_file, l_key) || !get(d_file, l_len) ||
+			!readString(l_name, l_len) ) {
+		return JRN_BAD_FORMAT;
+	}
+	d_stats.bytes += sizeof(l_key) + sizeof(l_len);
+
+	if ( l_key >= d_lables.size() ) {
+		d_lables.resize(l_key+1, 0);
+	}
+	d_lables[l_key] = Command::lableId(l_name);
+	d_stats.lables++;
+
+	LOG4CPP_DEBUG(log, "Lable [%s] mapped [%hu => %hu]", l_name.c_str(), l_key, d_lables[l_key]);
+
+	return OK;
+}
+
+exitCode CommandJournal::readCommand(Command * & command, unsigned long long & stamp) {
+	unsigned int l_type;
+	unsigned int l_devType;
+	unsigned short l_prio;
+	unsigned short l_len;
+	unsigned short l_count;
+	unsigned short l_key;
+	unsigned char l_ptype;
+	unsigned int l_slen;
+	long long l_int;
+	double l_float;
+	std::string l_str;
+
+	if ( !get(d_file, stamp) || !get(d_file, l_type) ||
+			!get(d_file, l_devType) || !get(d_file, l_prio) ||
+			!get(d_file, l_len) || !readString(l_str, l_len) ||
+			!get(d_file, l_count) ) {
+		return JRN_BAD_FORMAT;
+	}
+	d_stats.bytes += sizeof(stamp) + sizeof(l_type) + sizeof(l_devType) +
+			sizeof(l_prio) + sizeof(l_len) + sizeof(l_count);
+
+	command = Command::getCommand(l_type, (Device::t_deviceType)l_devType, l_str, "Replay");
+	command->setPrio(l_prio);
+
+	while ( l_count-- ) {
+
+		if ( !get(d_file, l_key) || !get(d_file, l_ptype) ||
+				l_key >= d_lables.size() ) {
+			command->release();
+			return JRN_BAD_FORMAT;
+		}
+		d_stats.bytes += sizeof(l_key) + sizeof(l_ptype);
+
+		switch ( l_ptype ) {
+		case Command::PT_INT:
+			if ( !get(d_file, l_int) ) {
+				command->release();
+				return JRN_BAD_FORMAT;
+			}
+			d_stats.bytes += sizeof(l_int);
+			command->setParam(d_lables[l_key], (int)l_int, false);
+			break;
+		case Command::PT_FLOAT:
+			if ( !get(d_file, l_float) ) {
+				command->release();
+				return JRN_BAD_FORMAT;
+			}
+			d_stats.bytes += sizeof(l_float);
+			command->setParam(d_lables[l_key], l_float, false);
+			break;
+		case Command::PT_STRING:
+			if ( !get(d_file, l_slen) || !readString(l_str, l_slen) ) {
+				command->release();
+				return JRN_BAD_FORMAT;
+			}
+			d_stats.bytes += sizeof(l_slen);
+			command->setParam(d_lables[l_key], l_str, false);
+			break;
+		default:
+			command->release();
+			return JRN_BAD_FORMAT;
+		}
+
+	}
+
+	d_stats.commands++;
+	return OK;
+}
+
+exitCode CommandJournal::next(Command * & command, unsigned long long & stamp) {
+	unsigned char l_kind;
+	exitCode result;
+
+	if ( !d_file || d_mode != JOURNAL_READ ) {
+		return JRN_END_OF_JOURNAL;
+	}
+
+	for (;;) {
+
+		if ( !get(d_file, l_kind) ) {
+			return JRN_END_OF_JOURNAL;
+		}
+		d_stats.bytes += sizeof(l_kind);
+
+		switch ( l_kind ) {
+		case REC_LABLE:
+			result = readLable();
+			break;
+		case REC_COMMAND:
+			result = readCommand(command, stamp);
+			if ( result == OK ) {
+				return OK;
+			}
+			break;
+		default:
+			result = JRN_BAD_FORMAT;
+		}
+
+		if ( result != OK ) {
+			LOG4CPP_ERROR(log, "Corrupted journal [%s] at offset [%ld]",
+					d_path.c_str(), ftell(d_file));
+			d_stats.errors++;
+			return result;
+		}
+
+	}
+
+}
+
+exitCode CommandJournal::rewind() {
+
+	if ( !d_file || d_mode != JOURNAL_READ ) {
+		return JRN_END_OF_JOURNAL;
+	}
+
+	fseek(d_file, sizeof(COMMANDJOURNAL_MAGIC)-1, SEEK_SET);
+	memset(&d_stats, 0, sizeof(t_stats));
+	d_stats.bytes = sizeof(COMMANDJOURNAL_MAGIC)-1;
+
+	return OK;
+}
+
+void CommandJournal::getStats(t_stats & stats) {
+
+	d_lock.enterMutex();
+	stats = d_stats;
+	d_lock.leaveMutex();
+
+}
+
+
+} //namespace comsys
+} //namespace controlbox
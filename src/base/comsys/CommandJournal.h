@@ -0,0 +1,197 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _COMMANDJOURNAL_H
+#define _COMMANDJOURNAL_H
+
+#include <controlbox/base/Utility.h>
+#include <controlbox/base/Object.h>
+#include <controlbox/base/comsys/Command.h>
+#include <cc++/thread.h>
+#include <cstdio>
+#include <vector>
+
+/// The size of the stdio buffer used to write/read journals
+#define COMMANDJOURNAL_BUFFER_SIZE	65536
+
+namespace controlbox {
+namespace comsys {
+
+/// A binary journal of Commands.
+/// A CommandJournal records Commands into a compact binary file which could
+/// be later read back to rebuild the same Commands, e.g. to replay a field
+/// traffic on the bench.<br>
+/// The journal starts with a magic header and it is then a sequence of
+/// records: a command record holds the monotonic recording time, the
+/// command type, the device type and id, the priority and all the params.
+/// Param lables are written as their interned keys: a lable record,
+/// mapping a key into its name, is emitted the first time a key is used
+/// thus lables are spelled out only once per journal.
+/// @note numbers are written in host byte order: journals are meant to be
+///		replayed on the same architecture they have been recorded on.
+/// @see CommandDispatcher::setJournal
+/// @see CommandReplayer
+class CommandJournal : public Object {
+
+//-----[ Types ]----------------------------------------------------------------
+
+public:
+
+    /// The journal access mode
+    enum journalMode {
+        JOURNAL_WRITE = 0,	///< Record new Commands (truncate the file)
+        JOURNAL_READ		///< Read back recorded Commands
+    };
+    typedef enum journalMode t_journalMode;
+
+    /// Journal statistics
+    struct stats {
+        unsigned long commands;	///< Commands recorded (or read)
+        unsigned long lables;	///< Lable records written (or read)
+        unsigned long errors;	///< Write (or decode) errors
+        unsigned long long bytes;	///< Journal bytes written (or read)
+    };
+    typedef struct stats t_stats;
+
+protected:
+
+    /// Record kinds
+    enum recordKind {
+        REC_LABLE = 1,
+        REC_COMMAND
+    };
+
+
+//-----[ Members ]--------------------------------------------------------------
+
+protected:
+
+    /// The journal file path
+    std::string d_path;
+
+    /// The journal access mode
+    t_journalMode d_mode;
+
+    /// The journal file
+    FILE * d_file;
+
+    /// The stdio buffer of the journal file
+    char * d_buffer;
+
+    /// Reading: journal lable keys mapped into local interned keys
+    std::vector<Command::t_lable> d_lables;
+
+    /// Writing: true for lable keys already written into the journal
+    std::vector<bool> d_known;
+
+    /// Journal statistics
+    t_stats d_stats;
+
+    /// Serialize concurrent recorders
+    ost::Mutex d_lock;
+
+
+//-----[ Methods ]--------------------------------------------------------------
+
+public:
+
+    /// Open a journal.
+    /// @param path the journal file path
+    /// @param mode the access mode, a journal opened for writing is truncated
+    /// @param logName the log category, this name is prepended by the
+    ///		class namespace "controlbox.comlibs."
+    CommandJournal(std::string const & path, t_journalMode mode = JOURNAL_WRITE,
+                   std::string const & logName = "journal");
+
+    /// Flush and close the journal.
+    ~CommandJournal();
+
+    /// Return true if the journal has been successfully opened.
+    inline bool isOpen() const {
+        return (d_file != 0);
+    };
+
+    /// Record a Command.
+    /// This method could be called concurrently by many threads: the
+    /// Command is encoded without locks and then appended to the journal.
+    /// @param command the Command to record
+    /// @param stamp the recording time [us], by default the current
+    ///		monotonic time
+    /// @return OK on success, JRN_WRITE_FAILED otherwise
+    exitCode record(Command * command, unsigned long long stamp = 0);
+
+    /// Record a batch of Commands with a single journal lock.
+    exitCode recordBatch(Command * const * commands, unsigned int count);
+
+    /// Flush the recorded Commands to the journal file.
+    exitCode flush();
+
+    /// Read back the next recorded Command.
+    /// The returned Command is a new one, got from the CommandPool, which
+    /// must be released by the caller.
+    /// @param command the rebuilt Command
+    /// @param stamp the Command recording time [us]
+    /// @return OK on success, JRN_END_OF_JOURNAL once all the Commands
+    ///		have been read, JRN_BAD_FORMAT on corrupted journals
+    exitCode next(Command * & command, unsigned long long & stamp);
+
+    /// Restart reading from the first recorded Command.
+    exitCode rewind();
+
+    /// Collect the journal statistics.
+    void getStats(t_stats & stats);
+
+protected:
+
+    /// Encode a Command record into the specified buffer
+    void encode(Command * command, unsigned long long stamp, std::string & buf);
+
+    /// Encode lable records for the Command lables not yet written
+    /// @note must be called with the journal lock held
+    void encodeLables(Command * command, std::string & buf);
+
+    /// Append an encoded record to the journal
+    /// @note must be called with the journal lock held
+    exitCode write(std::string const & buf);
+
+    /// Read a lable record
+    exitCode readLable();
+
+    /// Read a Command record
+    exitCode readCommand(Command * & command, unsigned long long & stamp);
+
+    /// Read a string value
+    bool readString(std::string & str, unsigned int len);
+
+};
+
+} //namespace comsys
+} //namespace controlbox
+#endif
@@ -0,0 +1,138 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#include "CommandPool.ih"
+
+namespace controlbox {
+namespace comsys {
+
+CommandPool * CommandPool::d_instance = 0;
+
+
+CommandPool::CommandPool(unsigned int size, std::string const & logName) :
+	d_size(size),
+	d_lock("cpPoolMtx"),
+	log(log4cpp::Category::getInstance("controlbox.comlibs."+logName)) {
+
+	LOG4CPP_DEBUG(log, "CommandPool::CommandPool(size=%u)", size);
+
+	memset(&d_stats, 0, sizeof(t_stats));
+	d_stats.size = d_size;
+
+	d_free.reserve(d_size);
+
+}
+
+CommandPool * CommandPool::getInstance(unsigned int size) {
+
+	if ( !d_instance ) {
+		d_instance = new CommandPool(size);
+	}
+
+	return d_instance;
+}
+
+CommandPool::~CommandPool() {
+	t_freeList::iterator it;
+
+	LOG4CPP_INFO(log, "Pool stats: hits=%lu, misses=%lu, recycled=%lu, discarded=%lu, highWater=%u",
+			d_stats.hits, d_stats.misses, d_stats.recycled,
+			d_stats.discarded, d_stats.highWater);
+
+	d_lock.enterMutex();
+	for ( it = d_free.begin(); it != d_free.end(); it++ ) {
+		delete (*it);
+	}
+	d_free.clear();
+	d_lock.leaveMutex();
+
+}
+
+Command * CommandPool::get(Command::t_cmdType const & cmdType, Device::t_deviceType devType,
+                           Device::t_deviceId devId, std::string const & logName) {
+	Command * l_command = 0;
+
+	d_lock.enterMutex();
+	if ( !d_free.empty() ) {
+		l_command = d_free.back();
+		d_free.pop_back();
+		d_stats.hits++;
+	} else {
+		d_stats.misses++;
+	}
+	d_stats.inUse++;
+	if ( d_stats.inUse > d_stats.highWater ) {
+		d_stats.highWater = d_stats.inUse;
+	}
+	d_lock.leaveMutex();
+
+	// NOTE Commands are (re)initialized outside the critical section
+	if ( !l_command ) {
+		return new Command(cmdType, devType, devId, logName);
+	}
+
+	l_command->reset(cmdType, devType, devId, logName);
+	return l_command;
+
+}
+
+void CommandPool::put(Command * command) {
+
+	d_lock.enterMutex();
+	if ( d_stats.inUse ) {
+		d_stats.inUse--;
+	}
+	if ( d_free.size() < d_size ) {
+		d_free.push_back(command);
+		d_stats.recycled++;
+		command = 0;
+	} else {
+		d_stats.discarded++;
+	}
+	d_lock.leaveMutex();
+
+	if ( command ) {
+		delete command;
+	}
+
+}
+
+void CommandPool::getStats(t_stats & stats) {
+
+	d_lock.enterMutex();
+	stats = d_stats;
+	stats.cached = d_free.size();
+	d_lock.leaveMutex();
+
+}
+
+
+} //namespace comsys
+} //namespace controlbox
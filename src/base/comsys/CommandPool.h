@@ -0,0 +1,139 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _COMMANDPOOL_H
+#define _COMMANDPOOL_H
+
+#include <controlbox/base/Utility.h>
+#include <controlbox/base/comsys/Command.h>
+#include <cc++/thread.h>
+#include <vector>
+
+/// The default number of released Commands kept for recycling
+#define COMMANDPOOL_DEFAULT_SIZE	128
+
+namespace controlbox {
+namespace comsys {
+
+/// A recycling pool of Commands.
+/// Each happening usually produce a new Command which is released soon after
+/// it has been notified to the Handler. To avoid the malloc churn of bursty
+/// Generators, released Commands are not deleted but kept by this pool, with
+/// their params storage, and recycled by the next Command::getCommand().<br>
+/// The pool keeps at most a (configurable) number of released Commands: once
+/// full, further released Commands are deleted.
+/// @see Command::getCommand
+/// @see Command::release
+class CommandPool {
+
+//-----[ Types ]----------------------------------------------------------------
+
+public:
+
+    /// Pool usage statistics
+    struct stats {
+        unsigned long hits;		///< Commands served by recycling a released one
+        unsigned long misses;		///< Commands that has been allocated
+        unsigned long recycled;		///< Released Commands kept by the pool
+        unsigned long discarded;	///< Released Commands deleted because of a full pool
+        unsigned int inUse;		///< Commands currently in use
+        unsigned int highWater;		///< Maximum number of Commands in use
+        unsigned int cached;		///< Released Commands currently kept by the pool
+        unsigned int size;		///< Maximum number of released Commands kept
+    };
+    typedef struct stats t_stats;
+
+protected:
+
+    typedef std::vector<Command *> t_freeList;
+
+
+//-----[ Members ]--------------------------------------------------------------
+
+protected:
+
+    /// The singleton instance
+    static CommandPool * d_instance;
+
+    /// The released Commands available for recycling
+    t_freeList d_free;
+
+    /// The maximum number of released Commands to keep
+    unsigned int d_size;
+
+    /// Mutex access to the free list and counters
+    ost::Mutex d_lock;
+
+    /// Pool usage counters
+    t_stats d_stats;
+
+    /// Logger
+    log4cpp::Category & log;
+
+
+//-----[ Methods ]--------------------------------------------------------------
+
+public:
+
+    /// Get an instance of CommandPool
+    /// CommandPool is a singleton class, this method provide
+    /// a pointer to the (eventually just created) only one instance.
+    /// @param size the maximum number of released Commands to keep;
+    ///		considered only by the call building the instance
+    static CommandPool * getInstance(unsigned int size = COMMANDPOOL_DEFAULT_SIZE);
+
+    /// Delete all the released Commands kept by the pool.
+    ~CommandPool();
+
+    /// Get a Command.
+    /// A previously released Command is recycled, if available,
+    /// otherwise a new one is allocated.
+    /// @see Command::getCommand
+    Command * get(Command::t_cmdType const & cmdType, Device::t_deviceType devType,
+                  Device::t_deviceId devId, std::string const & logName);
+
+    /// Give back a Command.
+    /// The Command is kept for recycling or, if the pool is full, deleted.
+    /// @note the Command must not have references left.
+    void put(Command * command);
+
+    /// Collect pool usage statistics.
+    void getStats(t_stats & stats);
+
+protected:
+
+    /// Build a new CommandPool
+    CommandPool(unsigned int size, std::string const & logName = "CommandPool");
+
+};
+
+} //namespace comsys
+} //namespace controlbox
+#endif
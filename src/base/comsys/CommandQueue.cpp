@@ -0,0 +1,167 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#include "CommandQueue.ih"
+
+namespace controlbox {
+namespace comsys {
+
+
+CommandQueue::CommandQueue(unsigned int size) :
+	d_slots(0),
+	d_mask(0),
+	d_enqPos(0),
+	d_deqPos(0),
+	d_pushed(0),
+	d_popped(0),
+	d_overflows(0),
+	d_highWater(0) {
+	unsigned int l_size = 2;
+	unsigned int i;
+
+	// Rounding up to the next power of two
+	while ( l_size < size ) {
+		l_size <<= 1;
+	}
+	d_mask = l_size-1;
+
+	d_slots = new t_slot[l_size];
+	for (i=0; i<l_size; i++) {
+		d_slots[i].seq = i;
+		d_slots[i].command = 0;
+		d_slots[i].clean = false;
+		d_slots[i].stamp = 0;
+	}
+
+}
+
+CommandQueue::~CommandQueue() {
+	Command * l_command;
+	bool l_clean;
+	unsigned long long l_stamp;
+
+	// Releasing any still queued Command
+	while ( pop(l_command, l_clean, l_stamp) ) {
+		if ( l_clean ) {
+			l_command->release();
+		}
+	}
+
+	delete [] d_slots;
+
+}
+
+bool CommandQueue::push(Command * command, bool clean, unsigned long long stamp) {
+	t_slot * l_slot;
+	unsigned int l_pos;
+	int l_diff;
+
+	l_pos = d_enqPos;
+	for (;;) {
+		l_slot = &d_slots[l_pos & d_mask];
+		l_diff = (int)atomicRead(&(l_slot->seq)) - (int)l_pos;
+
+		if ( l_diff == 0 ) {
+			// The slot is free: trying to reserve it
+			if ( atomicCAS(&d_enqPos, l_pos, l_pos+1) ) {
+				break;
+			}
+		} else if ( l_diff < 0 ) {
+			// The slot is still used by the consumer: queue full
+			atomicInc(&d_overflows);
+			return false;
+		}
+
+		// Another producer has been faster: retrying
+		l_pos = d_enqPos;
+	}
+
+	l_slot->command = command;
+	l_slot->clean = clean;
+	l_slot->stamp = stamp;
+
+	// Publishing the slot to the consumer
+	atomicSet(&(l_slot->seq), l_pos+1);
+
+	atomicInc(&d_pushed);
+	atomicMax(&d_highWater, (l_pos+1) - atomicRead(&d_deqPos));
+
+	return true;
+
+}
+
+bool CommandQueue::pop(Command * & command, bool & clean, unsigned long long & stamp) {
+	t_slot * l_slot;
+	unsigned int l_pos;
+
+	l_pos = d_deqPos;
+	l_slot = &d_slots[l_pos & d_mask];
+
+	if ( (int)atomicRead(&(l_slot->seq)) - (int)(l_pos+1) < 0 ) {
+		// Nothing published on this slot yet
+		return false;
+	}
+
+	command = l_slot->command;
+	clean = l_slot->clean;
+	stamp = l_slot->stamp;
+
+	// Releasing the slot for the next ring round
+	atomicSet(&(l_slot->seq), l_pos+d_mask+1);
+	atomicSet(&d_deqPos, l_pos+1);
+
+	atomicInc(&d_popped);
+
+	return true;
+
+}
+
+unsigned int CommandQueue::size() const {
+	unsigned int l_enq = d_enqPos;
+	unsigned int l_deq = d_deqPos;
+
+	return (l_enq - l_deq);
+
+}
+
+void CommandQueue::getStats(t_stats & stats) const {
+
+	stats.pushed = d_pushed;
+	stats.popped = d_popped;
+	stats.overflows = d_overflows;
+	stats.highWater = d_highWater;
+	stats.size = size();
+	stats.capacity = capacity();
+
+}
+
+
+} //namespace comsys
+} //namespace controlbox
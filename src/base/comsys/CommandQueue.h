@@ -0,0 +1,150 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _COMMANDQUEUE_H
+#define _COMMANDQUEUE_H
+
+#include <controlbox/base/Utility.h>
+#include <controlbox/base/comsys/Command.h>
+
+/// The default number of slots of a CommandQueue
+#define COMMANDQUEUE_DEFAULT_SIZE	64
+
+namespace controlbox {
+namespace comsys {
+
+/// A bounded lock-free multi-producer single-consumer queue of Commands.
+/// A CommandQueue is a fixed size ring of Command pointers that could be
+/// safely filled by many concurrent Generator threads while being drained by
+/// a single consumer thread. Producers never block: once the ring is full
+/// new Commands are rejected and accounted for as overflows, the caller is
+/// in charge to decide what to do with the rejected Command.<br>
+/// Each slot carries a sequence number which is used to synchronize producers
+/// with the consumer, thus neither locks nor system calls are required on
+/// both the push and the pop paths.
+/// @note the queue size is always rounded up to the next power of two.
+class CommandQueue {
+
+//-----[ Types ]----------------------------------------------------------------
+
+public:
+
+    /// Queue usage statistics
+    struct stats {
+        unsigned long pushed;		///< Commands successfully queued
+        unsigned long popped;		///< Commands extracted from the queue
+        unsigned long overflows;	///< Commands rejected because of a full queue
+        unsigned int highWater;		///< Maximum number of queued Commands
+        unsigned int size;		///< Current number of queued Commands
+        unsigned int capacity;		///< The queue size
+    };
+    typedef struct stats t_stats;
+
+protected:
+
+    struct slot {
+        volatile unsigned int seq;	///< Slot sequence number
+        Command * command;		///< The queued Command
+        bool clean;			///< Whatever the Command should be released once handled
+        unsigned long long stamp;	///< The Command queuing time [us]
+    };
+    typedef struct slot t_slot;
+
+
+//-----[ Members ]--------------------------------------------------------------
+
+protected:
+
+    /// The ring of slots
+    t_slot * d_slots;
+
+    /// The number of slots minus one
+    unsigned int d_mask;
+
+    /// The next position to fill (shared among producers)
+    volatile unsigned int d_enqPos;
+
+    /// The next position to drain (owned by the consumer)
+    volatile unsigned int d_deqPos;
+
+    /// Queue usage counters
+    volatile unsigned long d_pushed;
+    volatile unsigned long d_popped;
+    volatile unsigned long d_overflows;
+    volatile unsigned int d_highWater;
+
+
+//-----[ Methods ]--------------------------------------------------------------
+
+public:
+
+    /// Build a new CommandQueue.
+    /// @param size the number of slots, rounded up to the next power of two
+    CommandQueue(unsigned int size = COMMANDQUEUE_DEFAULT_SIZE);
+
+    ~CommandQueue();
+
+    /// Queue a Command.
+    /// This method could be called concurrently by any number of threads.
+    /// @param command the Command to queue
+    /// @param clean the release policy to associate to the Command
+    /// @param stamp the Command queuing time [us]
+    /// @return true on success, false if the queue is full
+    bool push(Command * command, bool clean = true, unsigned long long stamp = 0);
+
+    /// Extract the oldest Command.
+    /// This method must be called only by the (single) consumer thread.
+    /// @param command the extracted Command
+    /// @param clean the release policy associated to the extracted Command
+    /// @param stamp the queuing time of the extracted Command [us]
+    /// @return true on success, false if the queue is empty
+    bool pop(Command * & command, bool & clean, unsigned long long & stamp);
+
+    /// Return the current number of queued Commands.
+    unsigned int size() const;
+
+    /// Return the number of slots.
+    inline unsigned int capacity() const {
+        return d_mask+1;
+    };
+
+    /// Return true if there are not queued Commands.
+    inline bool empty() const {
+        return (size() == 0);
+    };
+
+    /// Collect queue usage statistics.
+    void getStats(t_stats & stats) const;
+
+};
+
+} //namespace comsys
+} //namespace controlbox
+#endif
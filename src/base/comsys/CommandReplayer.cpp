@@ -0,0 +1,260 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+
+#include "CommandReplayer.ih"
+
+/// Sleeps shorter than this are skipped, replaying late rather than
+/// paying a system call for each Command [us]
+#define COMMANDREPLAYER_MIN_SLEEP_US	500
+
+namespace controlbox {
+namespace comsys {
+
+
+CommandReplayer::CommandReplayer(Handler * target, unsigned int queueSize,
+				std::string const & logName) :
+	CommandHandler(logName),
+	d_target(target),
+	d_dispatcher(0),
+	d_async(0),
+	d_dispatched(0),
+	d_dropped(0),
+	d_handled(0),
+	d_elapsed(0) {
+
+	LOG4CPP_DEBUG(log, "CommandReplayer::CommandReplayer(queueSize=%u)", queueSize);
+
+	if ( queueSize ) {
+		d_async = new AsyncCommandDispatcher(this, false, queueSize, "replayer");
+		d_dispatcher = d_async;
+		LOG4CPP_INFO(log, "Replaying by an asynchronous dispatcher, queue size [%u]", queueSize);
+	} else {
+		d_dispatcher = new CommandDispatcher(this, false, "replayer");
+		LOG4CPP_INFO(log, "Replaying by a synchronous dispatcher");
+	}
+
+}
+
+CommandReplayer::~CommandReplayer() {
+
+	LOG4CPP_DEBUG(log, "~CommandReplayer()");
+
+	delete d_dispatcher;
+
+}
+
+inline
+void CommandReplayer::account(Command * command, unsigned long latency) {
+	t_typeStats & l_stats = d_typesStats[command->type()];
+
+	l_stats.count++;
+	l_stats.latency += latency;
+	if ( latency > l_stats.maxLatency ) {
+		l_stats.maxLatency = latency;
+	}
+
+}
+
+inline
+void CommandReplayer::handled(unsigned int count) {
+	// NOTE the atomic update publishes the accounted stats to replay()
+	atomicAdd(&d_handled, (unsigned long)count);
+}
+
+exitCode CommandReplayer::notify() {
+	return d_target->notify();
+}
+
+exitCode CommandReplayer::notify(Command * command)
+throw (exceptions::IllegalCommandException) {
+	unsigned long long l_start;
+	exitCode result;
+
+	l_start = Utils::monotonicUsec();
+	try {
+		result = d_target->notify(command);
+	} catch (exceptions::IllegalCommandException & e) {
+		handled(1);
+		throw;
+	}
+	account(command, (unsigned long)(Utils::monotonicUsec() - l_start));
+	handled(1);
+
+	return result;
+}
+
+exitCode CommandReplayer::notifyBatch(Command * const * commands, unsigned int count)
+throw (exceptions::IllegalCommandException) {
+	unsigned long long l_start;
+	unsigned long l_latency;
+	exitCode result;
+	unsigned int i;
+
+	l_start = Utils::monotonicUsec();
+	try {
+		result = d_target->notifyBatch(commands, count);
+	} catch (exceptions::IllegalCommandException & e) {
+		handled(count);
+		throw;
+	}
+	l_latency = (unsigned long)(Utils::monotonicUsec() - l_start) / count;
+
+	for (i=0; i<count; i++) {
+		account(commands[i], l_latency);
+	}
+	handled(count);
+
+	return result;
+}
+
+void CommandReplayer::takeSample(unsigned long long start) {
+	CommandQueue::t_stats l_stats;
+	t_sample l_sample;
+
+	l_sample.elapsed = (unsigned long)((Utils::monotonicUsec() - start) / 1000);
+	l_sample.dispatched = d_dispatched;
+	l_sample.dropped = d_dropped;
+	l_sample.depth = 0;
+	if ( d_async ) {
+		d_async->getStats(l_stats);
+		l_sample.depth = l_stats.size;
+	}
+
+	d_samples.push_back(l_sample);
+
+}
+
+exitCode CommandReplayer::replay(CommandJournal & journal, double speed,
+				unsigned int sampleMs) {
+	Command * l_command;
+	unsigned long long l_stamp;
+	unsigned long long l_first = 0;
+	unsigned long long l_start;
+	unsigned long long l_now;
+	unsigned long long l_due;
+	unsigned long long l_nextSample;
+	exitCode result;
+
+	LOG4CPP_DEBUG(log, "CommandReplayer::replay(speed=%.2f, sampleMs=%u)", speed, sampleMs);
+
+	d_typesStats.clear();
+	d_samples.clear();
+	d_dispatched = 0;
+	d_dropped = 0;
+	atomicSet(&d_handled, 0UL);
+
+	l_start = Utils::monotonicUsec();
+	l_nextSample = l_start + sampleMs*1000ULL;
+	takeSample(l_start);
+
+	while ( (result = journal.next(l_command, l_stamp)) == OK ) {
+
+		if ( !d_dispatched ) {
+			l_first = l_stamp;
+		}
+
+		// Honoring the recorded inter-arrival time
+		if ( speed > 0 && l_stamp > l_first ) {
+			l_due = l_start + (unsigned long long)((l_stamp - l_first) / speed);
+			l_now = Utils::monotonicUsec();
+			if ( l_due > l_now + COMMANDREPLAYER_MIN_SLEEP_US ) {
+				usleep(l_due - l_now);
+			}
+		}
+
+		if ( d_dispatcher->dispatch(l_command, true) == DIS_QUEUE_FULL ) {
+			d_dropped++;
+		}
+		d_dispatched++;
+
+		if ( Utils::monotonicUsec() >= l_nextSample ) {
+			takeSample(l_start);
+			l_nextSample += sampleMs*1000ULL;
+		}
+
+	}
+
+	// Waiting for the target to handle all queued Commands: popped ones
+	// could still be in its hands, and not yet accounted
+	if ( d_async ) {
+		while ( atomicRead(&d_handled) < d_dispatched - d_dropped ) {
+			usleep(1000);
+			if ( Utils::monotonicUsec() >= l_nextSample ) {
+				takeSample(l_start);
+				l_nextSample += sampleMs*1000ULL;
+			}
+		}
+	}
+
+	d_elapsed = Utils::monotonicUsec() - l_start;
+	takeSample(l_start);
+
+	LOG4CPP_INFO(log, "Replayed [%lu] commands in [%llu]ms, [%lu] dropped",
+			d_dispatched, d_elapsed/1000, d_dropped);
+
+	return (result == JRN_END_OF_JOURNAL) ? OK : result;
+}
+
+void CommandReplayer::report(std::ostream & out) const {
+	t_typesStats::const_iterator it;
+	t_samples::const_iterator s;
+	double l_secs = d_elapsed / 1000000.0;
+
+	out << "Replayed commands: " << d_dispatched << endl;
+	out << "Dropped commands: " << d_dropped << endl;
+	out << "Elapsed time [ms]: " << d_elapsed/1000 << endl;
+	out << "Throughput [cmd/s]: " << std::fixed << std::setprecision(1)
+		<< (l_secs > 0 ? (d_dispatched - d_dropped) / l_secs : 0.0) << endl;
+
+	out << endl << "Handling latency by command type:" << endl;
+	out << std::setw(10) << "type" << std::setw(10) << "count"
+		<< std::setw(12) << "avg [us]" << std::setw(12) << "max [us]" << endl;
+	for ( it = d_typesStats.begin(); it != d_typesStats.end(); it++ ) {
+		out << std::setw(10) << std::hex << std::showbase << it->first
+			<< std::dec << std::noshowbase
+			<< std::setw(10) << it->second.count
+			<< std::setw(12) << (double)it->second.latency / it->second.count
+			<< std::setw(12) << it->second.maxLatency << endl;
+	}
+
+	out << endl << "Queue depth over time:" << endl;
+	out << std::setw(10) << "time [ms]" << std::setw(12) << "dispatched"
+		<< std::setw(10) << "dropped" << std::setw(10) << "depth" << endl;
+	for ( s = d_samples.begin(); s != d_samples.end(); s++ ) {
+		out << std::setw(10) << s->elapsed << std::setw(12) << s->dispatched
+			<< std::setw(10) << s->dropped << std::setw(10) << s->depth << endl;
+	}
+
+}
+
+
+} //namespace comsys
+} //namespace controlbox
@@ -0,0 +1,189 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _COMMANDREPLAYER_H
+#define _COMMANDREPLAYER_H
+
+#include <controlbox/base/Utility.h>
+#include <controlbox/base/comsys/CommandHandler.h>
+#include <controlbox/base/comsys/CommandDispatcher.h>
+#include <controlbox/base/comsys/AsyncCommandDispatcher.h>
+#include <controlbox/base/comsys/CommandJournal.h>
+#include <ostream>
+#include <vector>
+#include <map>
+
+/// The default interval between queue depth samples [ms]
+#define COMMANDREPLAYER_SAMPLE_MS	1000
+
+namespace controlbox {
+namespace comsys {
+
+/// Replay a CommandJournal into an Handler.
+/// A CommandReplayer read back the Commands recorded by a CommandJournal and
+/// dispatch them to a target Handler (e.g. the WSProxyCommandHandler),
+/// either honoring the recorded inter-arrival times, scaled by a speedup
+/// factor, or as fast as possible.<br>
+/// The replayer sits between the dispatcher and the target Handler, thus it
+/// measures the time spent by the target handling each Command type. The
+/// same dispatching used by the system could be reproduced: a synchronous
+/// CommandDispatcher or an AsyncCommandDispatcher, whose queue depth is then
+/// sampled along the replay.
+class CommandReplayer : public CommandHandler {
+
+//-----[ Types ]----------------------------------------------------------------
+
+public:
+
+    /// Handling statistics of a Command type
+    struct typeStats {
+        unsigned long count;		///< Commands handled
+        unsigned long long latency;	///< Overall handling time [us]
+        unsigned long maxLatency;	///< Maximum handling time [us]
+    };
+    typedef struct typeStats t_typeStats;
+
+    typedef std::map<Command::t_cmdType, t_typeStats> t_typesStats;
+
+    /// A queue depth sample
+    struct sample {
+        unsigned long elapsed;		///< Time since the replay start [ms]
+        unsigned long dispatched;	///< Commands dispatched so far
+        unsigned long dropped;		///< Commands dropped so far
+        unsigned int depth;		///< Commands queued by the dispatcher
+    };
+    typedef struct sample t_sample;
+
+    typedef std::vector<t_sample> t_samples;
+
+
+//-----[ Members ]--------------------------------------------------------------
+
+protected:
+
+    /// The Handler receiving replayed Commands
+    Handler * d_target;
+
+    /// The dispatcher feeding the target
+    CommandDispatcher * d_dispatcher;
+
+    /// The asynchronous dispatcher feeding the target, if any
+    AsyncCommandDispatcher * d_async;
+
+    /// The handling statistics of each Command type
+    t_typesStats d_typesStats;
+
+    /// The queue depth samples
+    t_samples d_samples;
+
+    /// The number of Commands dispatched
+    unsigned long d_dispatched;
+
+    /// The number of Commands dropped by the dispatcher (full queue)
+    unsigned long d_dropped;
+
+    /// The number of Commands handled by the target, updated once their
+    /// handling has been accounted
+    volatile unsigned long d_handled;
+
+    /// The replay duration [us]
+    unsigned long long d_elapsed;
+
+
+//-----[ Methods ]--------------------------------------------------------------
+
+public:
+
+    /// Build a new CommandReplayer.
+    /// @param target the Handler to which replay Commands
+    /// @param queueSize if not null, Commands are dispatched by an
+    ///		AsyncCommandDispatcher with the specified queue size,
+    ///		otherwise by a synchronous CommandDispatcher
+    /// @param logName the log category, this name is prepended by the
+    ///		class namespace "controlbox.comlibs."
+    CommandReplayer(Handler * target, unsigned int queueSize = 0,
+                    std::string const & logName = "replayer");
+
+    ~CommandReplayer();
+
+    /// Replay a journal.
+    /// Returns once all the Commands have been handled by the target.
+    /// @param journal the journal to replay, opened for reading
+    /// @param speed the speedup factor to apply to recorded inter-arrival
+    ///		times (1.0 replay in real time), 0 to replay at maximum speed
+    /// @param sampleMs the interval between queue depth samples [ms]
+    /// @return OK on success, JRN_BAD_FORMAT if the replay has been
+    ///		interrupted by a corrupted journal
+    exitCode replay(CommandJournal & journal, double speed = 1.0,
+                    unsigned int sampleMs = COMMANDREPLAYER_SAMPLE_MS);
+
+    /// Print a report of the last replay: throughput, handling latencies
+    /// of each Command type and the queue depth over time.
+    void report(std::ostream & out) const;
+
+    /// Return the handling statistics of each Command type.
+    inline t_typesStats const & typesStats() const {
+        return d_typesStats;
+    };
+
+    /// Return the queue depth samples.
+    inline t_samples const & samples() const {
+        return d_samples;
+    };
+
+    /// Forward the notification to the target.
+    exitCode notify();
+
+    /// Forward a Command to the target accounting its handling time.
+    exitCode notify(Command * command)
+    throw (exceptions::IllegalCommandException);
+
+    /// Forward a batch of Commands to the target.
+    /// The batch is notified with a single call, its handling time is
+    /// evenly accounted to each Command of the batch.
+    exitCode notifyBatch(Command * const * commands, unsigned int count)
+    throw (exceptions::IllegalCommandException);
+
+protected:
+
+    /// Account the handling time of a Command.
+    inline void account(Command * command, unsigned long latency);
+
+    /// Count Commands handled, even if the target failed on them.
+    inline void handled(unsigned int count);
+
+    /// Collect a queue depth sample.
+    void takeSample(unsigned long long start);
+
+};
+
+} //namespace comsys
+} //namespace controlbox
+#endif
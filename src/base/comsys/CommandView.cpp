@@ -0,0 +1,391 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#include "CommandView.ih"
+
+namespace controlbox {
+namespace comsys {
+
+/// A bounded frame writer.
+/// Once the buffer is full nothing more is written, but the frame length
+/// is still accounted, thus the caller could know the required size.
+struct frameWriter {
+	char * buf;
+	unsigned int size;
+	unsigned int len;
+
+	frameWriter(char * b, unsigned int s) :
+		buf(b),
+		size(s),
+		len(0) {
+	};
+
+	inline void putNum(unsigned long long value, unsigned short bytes) {
+		unsigned short i;
+		if ( len+bytes <= size ) {
+			for (i=0; i<bytes; i++) {
+				buf[len+i] = (char)((value >> (8*i)) & 0xFF);
+			}
+		}
+		len += bytes;
+	};
+
+	inline void putData(char const * data, unsigned int bytes) {
+		if ( len+bytes <= size ) {
+			memcpy(buf+len, data, bytes);
+		}
+		len += bytes;
+	};
+};
+
+/// Read a little endian number from a (validated) frame
+static inline unsigned long long get(char const * buf, unsigned short bytes) {
+	unsigned long long l_value = 0;
+	unsigned short i;
+
+	for (i=0; i<bytes; i++) {
+		l_value |= ((unsigned long long)(unsigned char)buf[i]) << (8*i);
+	}
+
+	return l_value;
+}
+
+static inline double getDouble(char const * buf) {
+	unsigned long long l_bits = get(buf, 8);
+	double l_value;
+
+	memcpy(&l_value, &l_bits, sizeof(double));
+	return l_value;
+}
+
+
+CommandView::CommandView() :
+	d_buf(0),
+	d_len(0),
+	d_cmdType(0),
+	d_devType(Device::UNDEF),
+	d_prio(0),
+	d_devId(0),
+	d_devIdLen(0),
+	d_paramCount(0),
+	d_params(0) {
+
+}
+
+CommandView::CommandView(char const * buf, unsigned int size) :
+	d_buf(0),
+	d_len(0),
+	d_cmdType(0),
+	d_devType(Device::UNDEF),
+	d_prio(0),
+	d_devId(0),
+	d_devIdLen(0),
+	d_paramCount(0),
+	d_params(0) {
+
+	parse(buf, size);
+
+}
+
+exitCode CommandView::encode(Command const & command, char * buf,
+				unsigned int size, unsigned int & len) {
+	Command::t_params::const_iterator it;
+	frameWriter l_frame(buf, size);
+	unsigned long long l_bits;
+	std::string l_lable;
+	std::string const * l_str;
+
+	// Typed payloads are encoded by their params
+	command.exportPayload();
+
+	if ( command.d_devId.size() > 0xFFFF ||
+			command.d_params.size() > 0xFFFF ) {
+		len = 0;
+		return CMD_BAD_ENCODING;
+	}
+
+	// Header, the length is set once known
+	l_frame.putNum('C', 1);
+	l_frame.putNum('B', 1);
+	l_frame.putNum(COMMAND_ENCODING_VERSION, 1);
+	l_frame.putNum(0, 1);
+	l_frame.putNum(0, 4);
+
+	l_frame.putNum(command.d_cmdType, 4);
+	l_frame.putNum((unsigned int)command.d_devType, 4);
+	l_frame.putNum(command.d_prio, 2);
+	l_frame.putNum(command.d_devId.size(), 2);
+	l_frame.putData(command.d_devId.data(), command.d_devId.size());
+
+	l_frame.putNum(command.d_params.size(), 2);
+	for ( it = command.d_params.begin(); it != command.d_params.end(); it++ ) {
+		l_lable = Command::lableName(it->lable);
+		l_frame.putNum(l_lable.size(), 2);
+		l_frame.putData(l_lable.data(), l_lable.size());
+		switch ( (it->param).type ) {
+		case Command::PT_INT:
+			l_frame.putNum(VT_INT, 1);
+			l_frame.putNum((unsigned long long)(long long)(it->param).value.i, 8);
+			break;
+		case Command::PT_FLOAT:
+			l_frame.putNum(VT_FLOAT, 1);
+			memcpy(&l_bits, &(it->param).value.d, sizeof(double));
+			l_frame.putNum(l_bits, 8);
+			break;
+		case Command::PT_STRING:
+			l_str = (it->param).value.s;
+			l_frame.putNum(VT_STRING, 1);
+			l_frame.putNum(l_str->size(), 4);
+			l_frame.putData(l_str->data(), l_str->size());
+			break;
+		}
+	}
+
+	len = l_frame.len;
+	if ( len > size ) {
+		return CMD_BUFFER_TOO_SMALL;
+	}
+
+	// Patching the frame length
+	l_frame.len = 4;
+	l_frame.putNum(len, 4);
+
+	return OK;
+
+}
+
+exitCode CommandView::frameLength(char const * buf, unsigned int size,
+					unsigned int & len) {
+
+	len = 0;
+
+	if ( size < COMMAND_ENCODING_HEADER ) {
+		return CMD_BUFFER_TOO_SMALL;
+	}
+
+	if ( buf[0] != 'C' || buf[1] != 'B' ||
+			(unsigned char)buf[2] > COMMAND_ENCODING_VERSION ) {
+		return CMD_BAD_ENCODING;
+	}
+
+	len = get(buf+4, 4);
+	if ( len < COMMAND_ENCODING_HEADER ) {
+		return CMD_BAD_ENCODING;
+	}
+
+	if ( len > size ) {
+		return CMD_BUFFER_TOO_SMALL;
+	}
+
+	return OK;
+
+}
+
+exitCode CommandView::parse(char const * buf, unsigned int size) {
+	unsigned int l_len;
+	unsigned int l_pos;
+	unsigned int l_strLen;
+	unsigned short l_count;
+	unsigned short i;
+	exitCode result;
+
+	d_buf = 0;
+
+	result = frameLength(buf, size, l_len);
+	if ( result != OK ) {
+		return result;
+	}
+
+	// Fixed size command fields
+	l_pos = COMMAND_ENCODING_HEADER;
+	if ( l_pos+12 > l_len ) {
+		return CMD_BAD_ENCODING;
+	}
+	d_cmdType = get(buf+l_pos, 4);
+	d_devType = (Device::t_deviceType)get(buf+l_pos+4, 4);
+	d_prio = get(buf+l_pos+8, 2);
+	d_devIdLen = get(buf+l_pos+10, 2);
+	l_pos += 12;
+
+	if ( l_pos+d_devIdLen+2 > l_len ) {
+		return CMD_BAD_ENCODING;
+	}
+	d_devId = buf+l_pos;
+	l_pos += d_devIdLen;
+
+	d_paramCount = get(buf+l_pos, 2);
+	l_pos += 2;
+	d_params = l_pos;
+
+	// Validating all the params, thus accessors don't need any check
+	for (i=0, l_count=d_paramCount; i<l_count; i++) {
+		if ( l_pos+2 > l_len ) {
+			return CMD_BAD_ENCODING;
+		}
+		l_pos += 2 + get(buf+l_pos, 2);
+		if ( l_pos+1 > l_len ) {
+			return CMD_BAD_ENCODING;
+		}
+		switch ( buf[l_pos] ) {
+		case VT_INT:
+		case VT_FLOAT:
+			l_pos += 1+8;
+			break;
+		case VT_STRING:
+			if ( l_pos+1+4 > l_len ) {
+				return CMD_BAD_ENCODING;
+			}
+			l_strLen = get(buf+l_pos+1, 4);
+			if ( l_strLen > l_len ) {
+				return CMD_BAD_ENCODING;
+			}
+			l_pos += 1+4+l_strLen;
+			break;
+		default:
+			return CMD_BAD_ENCODING;
+		}
+		if ( l_pos > l_len ) {
+			return CMD_BAD_ENCODING;
+		}
+	}
+
+	// Params must end the frame: nextParam walks up to the frame end
+	if ( l_pos != l_len ) {
+		return CMD_BAD_ENCODING;
+	}
+
+	d_buf = buf;
+	d_len = l_len;
+
+	return OK;
+
+}
+
+Device::t_deviceId CommandView::deviceId() const {
+
+	if ( !d_buf ) {
+		return Device::t_deviceId();
+	}
+
+	return Device::t_deviceId(d_devId, d_devIdLen);
+
+}
+
+bool CommandView::nextParam(unsigned int & cursor, t_paramView & param) const {
+
+	if ( !d_buf || cursor < d_params || cursor >= d_len ) {
+		return false;
+	}
+
+	param.lableLen = get(d_buf+cursor, 2);
+	param.lable = d_buf+cursor+2;
+	cursor += 2+param.lableLen;
+
+	param.type = (t_valueType)d_buf[cursor];
+	cursor++;
+
+	switch ( param.type ) {
+	case VT_INT:
+		param.i = (long long)get(d_buf+cursor, 8);
+		cursor += 8;
+		break;
+	case VT_FLOAT:
+		param.d = getDouble(d_buf+cursor);
+		cursor += 8;
+		break;
+	case VT_STRING:
+		param.strLen = get(d_buf+cursor, 4);
+		param.str = d_buf+cursor+4;
+		cursor += 4+param.strLen;
+		break;
+	}
+
+	return true;
+
+}
+
+bool CommandView::findParam(std::string const & lable, t_paramView & param,
+				unsigned int pos) const {
+	unsigned int l_cursor = firstParam();
+	unsigned int l_found = 0;
+
+	if ( !pos ) {
+		pos = 1;
+	}
+
+	while ( nextParam(l_cursor, param) ) {
+		if ( param.lableLen == lable.size() &&
+				!memcmp(param.lable, lable.data(), param.lableLen) &&
+				++l_found == pos ) {
+			return true;
+		}
+	}
+
+	return false;
+
+}
+
+Command * CommandView::toCommand(std::string const & logName) const {
+	unsigned int l_cursor = firstParam();
+	t_paramView l_param;
+	Command * l_cmd;
+	Command::t_lable l_lable;
+
+	if ( !d_buf ) {
+		return 0;
+	}
+
+	l_cmd = Command::getCommand(d_cmdType, d_devType, deviceId(), logName);
+	l_cmd->setPrio(d_prio);
+
+	// Params are appended in the encoded order, thus multi-value
+	// params are rebuilt as they were
+	while ( nextParam(l_cursor, l_param) ) {
+		l_lable = Command::lableId(std::string(l_param.lable, l_param.lableLen));
+		switch ( l_param.type ) {
+		case VT_INT:
+			l_cmd->setParam(l_lable, (int)l_param.i, false);
+			break;
+		case VT_FLOAT:
+			l_cmd->setParam(l_lable, l_param.d, false);
+			break;
+		case VT_STRING:
+			l_cmd->setParam(l_lable, std::string(l_param.str, l_param.strLen), false);
+			break;
+		}
+	}
+
+	return l_cmd;
+
+}
+
+
+} //namespace comsys
+} //namespace controlbox
@@ -0,0 +1,224 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _COMMANDVIEW_H
+#define _COMMANDVIEW_H
+
+#include <controlbox/base/Utility.h>
+#include <controlbox/base/comsys/Command.h>
+
+/// The binary encoding format version
+#define COMMAND_ENCODING_VERSION	1
+
+/// The size of the binary encoding header
+#define COMMAND_ENCODING_HEADER		8
+
+namespace controlbox {
+namespace comsys {
+
+/// A zero-copy view on a binary encoded Command.
+/// Commands could be encoded, by Command::encode(), into a compact binary
+/// frame suitable to be shipped among processes or stored on disk. Each
+/// frame is versioned and length prefixed, thus a stream of frames could be
+/// split without any knowledge of the Command content:
+/// <pre>
+///   header:  'C' 'B' version(1) flags(1) length(4)
+///   command: cmdType(4) devType(4) prio(2) devIdLen(2) devId
+///   params:  count(2) { lableLen(2) lable type(1) value }
+///   value:   int(8) | float(8) | strLen(4) str
+/// </pre>
+/// All numbers are little endian, the length accounts for the whole frame,
+/// header included. Param lables are encoded by name since interned lables
+/// are meaningful only within a process.<br>
+/// A CommandView parses a frame in place: the frame is validated once, then
+/// all accessors read from the caller buffer without any copy or allocation,
+/// the buffer must outlive the view. A Command could be rebuilt from the
+/// view, by toCommand(), only when really needed.
+class CommandView {
+
+//-----[ Types ]----------------------------------------------------------------
+
+public:
+
+    /// The type of an encoded param value
+    enum valueType {
+        VT_INT = 0,
+        VT_FLOAT,
+        VT_STRING
+    };
+    typedef enum valueType t_valueType;
+
+    /// An encoded param.
+    /// Lable and string values point into the encoded frame and they are
+    /// NOT null terminated.
+    struct paramView {
+        char const * lable;	///< The param lable
+        unsigned short lableLen;	///< The param lable length
+        t_valueType type;	///< The param value type
+        long long i;		///< The value of a VT_INT param
+        double d;		///< The value of a VT_FLOAT param
+        char const * str;	///< The value of a VT_STRING param
+        unsigned int strLen;	///< The length of a VT_STRING param
+    };
+    typedef struct paramView t_paramView;
+
+
+//-----[ Members ]--------------------------------------------------------------
+
+protected:
+
+    /// The encoded frame
+    char const * d_buf;
+
+    /// The encoded frame length
+    unsigned int d_len;
+
+    Command::t_cmdType d_cmdType;
+
+    Device::t_deviceType d_devType;
+
+    unsigned short d_prio;
+
+    /// The device identifier, within the frame
+    char const * d_devId;
+
+    unsigned short d_devIdLen;
+
+    unsigned short d_paramCount;
+
+    /// The offset of the first param within the frame
+    unsigned int d_params;
+
+
+//-----[ Methods ]--------------------------------------------------------------
+
+public:
+
+    /// Build an empty view.
+    CommandView();
+
+    /// Build a view on an encoded frame.
+    /// @see parse()
+    CommandView(char const * buf, unsigned int size);
+
+    /// Encode a Command into a caller provided buffer.
+    /// @param command the Command to encode
+    /// @param buf the buffer where the frame is written
+    /// @param size the buffer size
+    /// @param len the frame length, set also when the buffer is too small
+    /// @return OK on success, CMD_BUFFER_TOO_SMALL if the frame doesn't fit
+    ///		into the buffer, CMD_BAD_ENCODING if the Command could not
+    ///		be encoded
+    static exitCode encode(Command const & command, char * buf,
+                           unsigned int size, unsigned int & len);
+
+    /// Return the length of the frame at the beginning of a buffer.
+    /// Use this to split a stream of frames.
+    /// @param buf the buffer
+    /// @param size the number of bytes available into the buffer
+    /// @param len the frame length
+    /// @return OK if the whole frame is available, CMD_BUFFER_TOO_SMALL if
+    ///		more bytes are required, CMD_BAD_ENCODING if the buffer
+    ///		doesn't start with a valid frame header
+    static exitCode frameLength(char const * buf, unsigned int size,
+                                unsigned int & len);
+
+    /// Parse and validate an encoded frame.
+    /// @param buf the encoded frame, which must outlive the view
+    /// @param size the number of bytes available into the buffer
+    /// @return OK on success, CMD_BUFFER_TOO_SMALL if the frame is
+    ///		truncated, CMD_BAD_ENCODING on corrupted frames
+    exitCode parse(char const * buf, unsigned int size);
+
+    /// Return true if the view is on a valid frame.
+    inline bool valid() const {
+        return (d_buf != 0);
+    };
+
+    /// Return the length of the viewed frame.
+    inline unsigned int length() const {
+        return d_len;
+    };
+
+    inline Command::t_cmdType type() const {
+        return d_cmdType;
+    };
+
+    inline Device::t_deviceType device() const {
+        return d_devType;
+    };
+
+    inline unsigned short getPrio() const {
+        return d_prio;
+    };
+
+    /// Return the device identifier, not null terminated.
+    inline char const * deviceId(unsigned short & len) const {
+        len = d_devIdLen;
+        return d_devId;
+    };
+
+    /// Return a copy of the device identifier.
+    Device::t_deviceId deviceId() const;
+
+    inline unsigned short paramCount() const {
+        return d_paramCount;
+    };
+
+    /// Return the cursor to the first param.
+    inline unsigned int firstParam() const {
+        return d_params;
+    };
+
+    /// Read a param and move the cursor to the next one.
+    /// Params are returned in the Command insertion order.
+    /// @param cursor the param cursor, initialized by firstParam()
+    /// @param param the read param
+    /// @return false if there are not more params
+    bool nextParam(unsigned int & cursor, t_paramView & param) const;
+
+    /// Look for a param.
+    /// @param lable the param lable
+    /// @param param the found param
+    /// @param pos starting from 1, the lable occurrence to return
+    /// @return true if the param has been found
+    bool findParam(std::string const & lable, t_paramView & param,
+                   unsigned int pos = 1) const;
+
+    /// Build a new Command from the viewed frame.
+    /// @param logName the log category of the new Command
+    /// @return the new Command, 0 if the view is not valid
+    Command * toCommand(std::string const & logName = "Generic") const;
+
+};
+
+} //namespace comsys
+} //namespace controlbox
+#endif
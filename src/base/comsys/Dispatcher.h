@@ -81,6 +81,27 @@ public:
     /// @return Core:OK on success, Core::DIS_SUSPENDED if the Command has been queued.
     virtual exitCode dispatch(Command * command, bool clean = true) = 0;
 
+    /// Dispatch a batch of commands to Handler.
+    /// This default implementation simply dispatch each Command by itself.
+    /// @param commands the Commands to dispatch
+    /// @param count the number of Commands
+    /// @param clean set to true to release the commands once notified
+    /// @return OK on success, otherwise the first error returned.
+    virtual exitCode dispatchBatch(Command * const * commands, unsigned int count, bool clean = true) {
+        exitCode result = OK;
+        exitCode l_result;
+        unsigned int i;
+
+        for (i=0; i<count; i++) {
+            l_result = dispatch(commands[i], clean);
+            if ( result == OK ) {
+                result = l_result;
+            }
+        }
+
+        return result;
+    };
+
 };
 
 } //namespace comsys
@@ -41,7 +41,15 @@ EventDispatcher::EventDispatcher(Handler * handler, bool suspended, std::string
         Dispatcher(),
         d_suspended(suspended),
         d_waiting(0),
-        d_handler(handler) {
+        d_handler(handler),
+        d_coalesce(COALESCE_NONE),
+        d_coalesceParam(0),
+        d_coalesceLock("edCoalesceMtx"),
+        d_lastNotify(0),
+        d_trailing(false),
+        d_coalesceTimer(0),
+        d_coalesceDeadline(0),
+        d_merged(0) {
 
     LOG4CPP_DEBUG(log, "EventDispatcher::EventDispatcher(Handler * handler, bool suspended, std::string const & logName)");
 
@@ -51,6 +59,8 @@ EventDispatcher::~EventDispatcher() {
 
     LOG4CPP_DEBUG(log, "~EventDispatcher()");
 
+    stopCoalescing();
+
 }
 
 
@@ -66,7 +76,76 @@ exitCode EventDispatcher::setHandler(Handler * handler, bool suspended) {
 }
 
 
+exitCode EventDispatcher::setCoalescing(t_coalescePolicy policy, unsigned int param) {
+
+    LOG4CPP_DEBUG(log, "EventDispatcher::setCoalescing(policy=%d, param=%u)", policy, param);
+
+    if ( (policy == COALESCE_KEEP_LAST || policy == COALESCE_DEBOUNCE) && !param ) {
+        LOG4CPP_ERROR(log, "Coalescing policy [%d] requires a non null param", policy);
+        return DIS_COALESCE_PARAM_INVALID;
+    }
+
+    d_coalesceLock.enterMutex();
+    d_coalesce = policy;
+    d_coalesceParam = param;
+    d_lastNotify = 0;
+    d_coalesceLock.leaveMutex();
+
+    LOG4CPP_INFO(log, "Coalescing policy [%d] (param: %u)", policy, param);
+
+    return OK;
+
+}
+
+exitCode EventDispatcher::parseCoalescing(std::string const & name, t_coalescePolicy & policy) {
+
+    if ( name == "none" ) {
+        policy = COALESCE_NONE;
+    } else if ( name == "merge" ) {
+        policy = COALESCE_MERGE;
+    } else if ( name == "keeplast" ) {
+        policy = COALESCE_KEEP_LAST;
+    } else if ( name == "debounce" ) {
+        policy = COALESCE_DEBOUNCE;
+    } else {
+        return DIS_COALESCE_PARAM_INVALID;
+    }
+
+    return OK;
+
+}
+
+unsigned long EventDispatcher::merged() const {
+    return d_merged;
+}
+
+unsigned int EventDispatcher::coalesce(unsigned int events) {
+    unsigned int l_notify = events;
+
+    switch ( d_coalesce ) {
+    case COALESCE_MERGE:
+    case COALESCE_DEBOUNCE:
+        l_notify = events ? 1 : 0;
+        break;
+    case COALESCE_KEEP_LAST:
+        if ( events > d_coalesceParam ) {
+            l_notify = d_coalesceParam;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if ( events > l_notify ) {
+        atomicAdd(&d_merged, (unsigned long)(events-l_notify));
+    }
+
+    return l_notify;
+
+}
+
 exitCode EventDispatcher::resume(bool discard) {
+    unsigned int l_notify;
 
     LOG4CPP_DEBUG(log, "EventDispatcher::resume(bool discard)");
 
@@ -74,8 +153,15 @@ exitCode EventDispatcher::resume(bool discard) {
 
     if ( !discard ) {
 
-        LOG4CPP_INFO(log, "Disaptching [%d] queued events", d_waiting);
-        while ( d_waiting-- && !d_suspended ) {
+        l_notify = coalesce(d_waiting);
+        LOG4CPP_INFO(log, "Disaptching [%d] queued events (%u merged)",
+                        l_notify, d_waiting-l_notify);
+        if ( l_notify && d_coalesce == COALESCE_DEBOUNCE ) {
+            d_coalesceLock.enterMutex();
+            d_lastNotify = Utils::monotonicUsec();
+            d_coalesceLock.leaveMutex();
+        }
+        while ( l_notify-- && !d_suspended ) {
             d_handler->notify();
         }
 
@@ -115,6 +201,33 @@ exitCode EventDispatcher::dispatch(bool clean) {
     LOG4CPP_DEBUG(log, "EventDispatcher::dispatch()");
 
     if ( !d_suspended ) {
+
+        if ( d_coalesce == COALESCE_DEBOUNCE ) {
+            unsigned long long l_now = Utils::monotonicUsec();
+            unsigned long long l_window = (unsigned long long)d_coalesceParam*1000;
+
+            d_coalesceLock.enterMutex();
+            if ( d_lastNotify && (l_now - d_lastNotify) < l_window ) {
+                // Holding back the event up to the window expiration,
+                // merging it with a previously held one
+                if ( d_trailing ) {
+                    atomicInc(&d_merged);
+                }
+                d_trailing = true;
+                armCoalescing(d_lastNotify + l_window);
+                d_coalesceLock.leaveMutex();
+                LOG4CPP_DEBUG(log, "Event held back within the debounce window");
+                return OK;
+            }
+            // A held back event is superseded by this one
+            if ( d_trailing ) {
+                atomicInc(&d_merged);
+                d_trailing = false;
+            }
+            d_lastNotify = l_now;
+            d_coalesceLock.leaveMutex();
+        }
+
         LOG4CPP_INFO(log, "Disaptching new event");
         d_handler->notify();
         return OK;
@@ -127,5 +240,70 @@ exitCode EventDispatcher::dispatch(bool clean) {
 }
 
 
+void EventDispatcher::armCoalescing(unsigned long long deadline) {
+    unsigned long long l_now = Utils::monotonicUsec();
+    timeout_t l_delay;
+
+    if ( d_coalesceDeadline && d_coalesceDeadline <= deadline ) {
+        return;
+    }
+
+    l_delay = (deadline > l_now) ? (timeout_t)((deadline - l_now + 999)/1000) : 0;
+    if ( d_coalesceTimer ) {
+        TimerWheel::getInstance()->reschedule(d_coalesceTimer, l_delay);
+    } else {
+        d_coalesceTimer = TimerWheel::getInstance()->schedule(this, l_delay);
+    }
+    d_coalesceDeadline = deadline;
+
+}
+
+void EventDispatcher::stopCoalescing() {
+    TimerWheel::t_timerId l_timer;
+
+    d_coalesceLock.enterMutex();
+    l_timer = d_coalesceTimer;
+    d_coalesceTimer = 0;
+    d_coalesceDeadline = 0;
+    d_coalesceLock.leaveMutex();
+
+    // NOTE the lock is not held while cancelling, since a running
+    // timerExpired() could be waiting for it
+    if ( l_timer ) {
+        TimerWheel::getInstance()->cancel(l_timer);
+    }
+
+}
+
+void EventDispatcher::timerExpired(unsigned int timer) {
+    bool l_notify;
+
+    LOG4CPP_DEBUG(log, "EventDispatcher::timerExpired(timer=%u)", timer);
+
+    d_coalesceLock.enterMutex();
+    d_coalesceDeadline = 0;
+    l_notify = d_trailing;
+    d_trailing = false;
+    if ( l_notify && !d_suspended ) {
+        d_lastNotify = Utils::monotonicUsec();
+    }
+    d_coalesceLock.leaveMutex();
+
+    if ( !l_notify ) {
+        return;
+    }
+
+    if ( d_suspended ) {
+        d_waiting++;
+        LOG4CPP_INFO(log, "Disaptcher suspended; trailing event queued for delayed dispatching");
+        return;
+    }
+
+    LOG4CPP_INFO(log, "Disaptching trailing event");
+    d_handler->notify();
+
+}
+
+
 } //namespace comsys
 } //namespace controlbox
@@ -33,6 +33,7 @@
 #include <controlbox/base/Object.h>
 #include <controlbox/base/comsys/Dispatcher.h>
 #include <controlbox/base/Utility.h>
+#include <controlbox/base/TimerWheel.h>
 
 namespace controlbox {
 namespace comsys {
@@ -40,9 +41,22 @@ namespace comsys {
 
 /// A simple Dispatcher.
 /// An EventDispatcher is a simple Dispatcher that bind a Generator to an Handler
-/// in order to notify the last one about events generated by the first.
+/// in order to notify the last one about events generated by the first.<br>
+/// Bursts of events could be coalesced, to reduce the Handler wakeups, by
+/// defining a coalescing policy with setCoalescing().
 ///
-class EventDispatcher : public Object, public Dispatcher {
+class EventDispatcher : public Object, public Dispatcher, public TimerHandler {
+
+public:
+
+    /// Events coalescing policies
+    enum coalescePolicy {
+        COALESCE_NONE = 0,	///< Each event is notified (default)
+        COALESCE_MERGE,		///< Events queued while suspended are merged into one
+        COALESCE_KEEP_LAST,	///< Only the last N events queued while suspended are notified
+        COALESCE_DEBOUNCE	///< Events within a time window since the last notified one are merged into a trailing one
+    };
+    typedef enum coalescePolicy t_coalescePolicy;
 
 protected:
 
@@ -55,6 +69,34 @@ protected:
     /// The linked handler
     Handler * d_handler;
 
+    /// The events coalescing policy
+    t_coalescePolicy d_coalesce;
+
+    /// The coalescing policy parameter.
+    /// The number of events to keep for COALESCE_KEEP_LAST, the
+    /// window length [ms] for COALESCE_DEBOUNCE.
+    unsigned int d_coalesceParam;
+
+    /// Mutex access to the coalescing state
+    ost::Mutex d_coalesceLock;
+
+    /// The monotonic time [us] of the last notified event
+    unsigned long long d_lastNotify;
+
+    /// Set true when an event has been held back by COALESCE_DEBOUNCE,
+    /// to be notified once the window expires
+    bool d_trailing;
+
+    /// The timer notifying the held back events, 0 if not yet defined
+    TimerWheel::t_timerId d_coalesceTimer;
+
+    /// The monotonic time [us] the coalescing timer has been armed to,
+    /// 0 if it is not armed
+    unsigned long long d_coalesceDeadline;
+
+    /// The number of events merged by the coalescing policy
+    volatile unsigned long d_merged;
+
 
 public:
 
@@ -86,8 +128,46 @@ public:
     /// Otherwise the event is counted for future dispatching.
     exitCode dispatch(bool clean = true);
 
+    /// Define the events coalescing policy.
+    /// @param policy the coalescing policy
+    /// @param param the number of events to keep, for COALESCE_KEEP_LAST,
+    ///		or the window length [ms], for COALESCE_DEBOUNCE
+    /// @return OK on success, DIS_COALESCE_PARAM_INVALID if the policy
+    ///		requires a non null param
+    /// @note with COALESCE_DEBOUNCE the first event is notified immediately,
+    ///		while the last one of a burst is held back and notified once
+    ///		the window expires: the final state is never lost.
+    /// @see CommandDispatcher for Commands coalescing
+    exitCode setCoalescing(t_coalescePolicy policy, unsigned int param = 0);
+
+    /// Parse a coalescing policy name.
+    /// Recognized names are "none", "merge", "keeplast" and "debounce".
+    /// @return OK on success, DIS_COALESCE_PARAM_INVALID on unknown names
+    static exitCode parseCoalescing(std::string const & name, t_coalescePolicy & policy);
+
+    /// Return the number of events merged by the coalescing policy.
+    unsigned long merged() const;
+
 protected:
 
+    /// Return how many of the specified queued events should be notified,
+    /// accounting the other ones as merged.
+    unsigned int coalesce(unsigned int events);
+
+    /// Arm the coalescing timer to expire at the specified deadline,
+    /// unless it is already armed to expire before.
+    /// The coalescing lock must be held.
+    /// @param deadline the monotonic time [us] of the expiration
+    void armCoalescing(unsigned long long deadline);
+
+    /// Cancel the coalescing timer.
+    /// Once returned no held back events will be notified anymore:
+    /// subclasses should call this before tearing down their state.
+    void stopCoalescing();
+
+    /// Notify the events held back by COALESCE_DEBOUNCE.
+    void timerExpired(unsigned int timer);
+
     /// In this implementation of Dispatcher this method is simply
     /// an empty one doing noting
     inline exitCode dispatch(Command * command, bool clean = true) {
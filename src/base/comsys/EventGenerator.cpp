@@ -40,7 +40,8 @@ EventGenerator::EventGenerator(std::string const & logName, int pri) :
         d_enabled(false),
         d_running(false),
         d_doExit(false),
-        d_tid(0) {
+        d_tid(0),
+        d_limiter(0) {
 
 	LOG4CPP_DEBUG(log, "EventGenerator::EventGenerator(std::string const & logName)");
 
@@ -54,7 +55,8 @@ EventGenerator::EventGenerator(Dispatcher * dispatcher, bool enabled,  std::stri
         Generator(pri),
         d_dispatcher(dispatcher),
         d_enabled(false),
-        d_running(false) {
+        d_running(false),
+        d_limiter(0) {
 
 	LOG4CPP_DEBUG(log, "EventGenerator::EventGenerator(Dispatcher * dispatcher, bool enabled,  std::string const & logName)");
 
@@ -66,6 +68,14 @@ EventGenerator::EventGenerator(Dispatcher * dispatcher, bool enabled,  std::stri
 }
 
 
+EventGenerator::~EventGenerator() {
+
+	if ( d_limiter ) {
+		delete d_limiter;
+	}
+
+}
+
 exitCode EventGenerator::setDispatcher(Dispatcher * dispatcher, bool enabled) {
 
 	LOG4CPP_DEBUG(log, "EventGenerator::setDispatcher(Dispatcher * dispatcher, bool enabled)");
@@ -115,11 +125,28 @@ exitCode EventGenerator::disable() {
 }
 
 
+exitCode EventGenerator::setRateLimit(std::string const & prefix) {
+	RateLimiter * l_limiter;
+
+	LOG4CPP_DEBUG(log, "EventGenerator::setRateLimit(prefix=%s)", prefix.c_str());
+
+	l_limiter = d_limiter;
+	d_limiter = RateLimiter::getRateLimiter(prefix);
+	if ( l_limiter ) {
+		delete l_limiter;
+	}
+
+	return OK;
+}
+
 exitCode EventGenerator::notify(bool clean) {
 
 	LOG4CPP_DEBUG(log, "EventGenerator::notify()");
 
 	if (d_enabled) {
+		if ( d_limiter && !d_limiter->admit() ) {
+			return GEN_RATE_LIMITED;
+		}
 		LOG4CPP_INFO(log, "Event dispatching");
 		d_dispatcher->dispatch(clean);
 		return OK;
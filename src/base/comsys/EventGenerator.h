@@ -34,6 +34,7 @@
 #include <controlbox/base/Utility.h>
 #include <controlbox/base/comsys/Generator.h>
 #include <controlbox/base/comsys/Dispatcher.h>
+#include <controlbox/base/comsys/RateLimiter.h>
 #include <string>
 
 
@@ -61,6 +62,9 @@ protected:
     /// The Thread ID
     int d_tid;
 
+    /// The rate limiter of notified events, if any
+    RateLimiter * d_limiter;
+
 
 public:
 
@@ -83,7 +87,7 @@ public:
 
     /// Class destructor.
     /// @note this destructor ensume the associated thread will be terminated
-    ~EventGenerator() {};
+    ~EventGenerator();
 
     /// Define the dispatcher to witch notify new events.
     /// By default, if not otherwise specified, the EventGenerator
@@ -104,12 +108,25 @@ public:
     /// Events generated while disabled are definitively lost
     exitCode disable();
 
+    /// Rate limit the notification of generated events.
+    /// Limits are read from the configuration params starting with the
+    /// specified prefix, usually the one used by the device for its
+    /// other configuration params.
+    /// Rate limiting is disabled if not configured for that prefix.
+    /// @param prefix the configuration params prefix
+    /// @return OK
+    /// @note this should be called before enabling the Generator
+    /// @see RateLimiter
+    exitCode setRateLimit(std::string const & prefix);
+
 
 protected:
 
     /// Notify the associated event dispatcher about a new event
     /// This is usually done with a call to
     /// Dispatcher::dispatch() or Dispatcher::dispatch(Command)
+    /// @return OK on success, GEN_RATE_LIMITED if the event has been
+    ///		rejected by the rate limiter
     exitCode notify(bool clean = true);
 
     /// Processing start notifier
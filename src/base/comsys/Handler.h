@@ -65,6 +65,33 @@ public:
     virtual exitCode notify(Command * command)
     throw(exceptions::IllegalCommandException) = 0;
 
+    /// Batch Command notify routine
+    /// Process a batch of Commands, e.g. the backlog drained by a
+    /// Dispatcher, within a single call. This default implementation
+    /// simply notify each Command by itself: Handlers could override it
+    /// to amortize per-command costs (e.g. locking) over the whole batch.
+    /// @param commands the Commands to process
+    /// @param count the number of Commands
+    /// @return OK if all the Commands have been processed successfully,
+    ///		the first error returned otherwise
+    /// @throw exceptions::IllegalCommandException if the concrete class
+    ///		is not eligible for handling one of the Commands
+    virtual exitCode notifyBatch(Command * const * commands, unsigned int count)
+    throw(exceptions::IllegalCommandException) {
+        exitCode result = OK;
+        exitCode l_result;
+        unsigned int i;
+
+        for (i=0; i<count; i++) {
+            l_result = notify(commands[i]);
+            if ( result == OK ) {
+                result = l_result;
+            }
+        }
+
+        return result;
+    };
+
 };
 
 } //namespace comsys
@@ -32,32 +32,381 @@
 namespace controlbox {
 namespace comsys {
 
-MultipleDispatcher::MultipleDispatcher(std::string const & logName) {}
+MultipleDispatcher::MultipleDispatcher(std::string const & logName) :
+        Object("comlibs."+logName),
+        d_lanesLock("mdLanesMtx"),
+        d_view(new t_laneView),
+        d_journal(0),
+        d_bus(0),
+        d_coalesce(EventDispatcher::COALESCE_NONE),
+        d_coalesceParam(0) {
+
+    LOG4CPP_DEBUG(log, "MultipleDispatcher::MultipleDispatcher(std::string const & logName)");
+
+    d_view->commandLanes = 0;
+
+}
 
 MultipleDispatcher::~MultipleDispatcher() {
+    t_lanes::iterator it;
+
+    LOG4CPP_DEBUG(log, "~MultipleDispatcher()");
+
     // Remove all handlers
+    d_lanesLock.enterMutex();
+    for ( it = d_lanes.begin(); it != d_lanes.end(); it++ ) {
+        if ( it->owned ) {
+            delete it->dispatcher;
+        }
+    }
+    d_lanes.clear();
+    delete d_view;
+    d_view = 0;
+    d_lanesLock.leaveMutex();
+
+}
+
+void MultipleDispatcher::publishLanes(Dispatcher * release) {
+    t_laneView * l_old = d_view;
+    t_laneView * l_view;
+    t_lanes::iterator it;
+
+    l_view = new t_laneView;
+    l_view->lanes.assign(d_lanes.begin(), d_lanes.end());
+    l_view->commandLanes = 0;
+    for ( it = d_lanes.begin(); it != d_lanes.end(); it++ ) {
+        if ( it->commands ) {
+            l_view->commandLanes++;
+        }
+    }
+
+    atomicSet(&d_view, l_view);
+
+    // Waiting for the dispatchings still using the previous snapshot
+    d_rcu.synchronize();
+    delete l_old;
+    if ( release ) {
+        delete release;
+    }
+
 }
 
-exitCode MultipleDispatcher::addDispatcher(Dispatcher const & dispatcher) {
-	return OK;
+exitCode MultipleDispatcher::addDispatcher(Dispatcher * dispatcher) {
+    t_lanes::iterator it;
+    t_lane l_lane;
+
+    LOG4CPP_DEBUG(log, "MultipleDispatcher::addDispatcher(Dispatcher * dispatcher)");
+
+    d_lanesLock.enterMutex();
+    for ( it = d_lanes.begin(); it != d_lanes.end(); it++ ) {
+        if ( it->dispatcher == dispatcher ) {
+            d_lanesLock.leaveMutex();
+            LOG4CPP_WARN(log, "Dispatcher already attached");
+            return DIS_DISPATCHER_ALREADY_DEFINED;
+        }
+    }
+
+    l_lane.dispatcher = dispatcher;
+    l_lane.handler = 0;
+    l_lane.owned = false;
+    // Plain EventDispatchers just notify events, ignoring Commands
+    l_lane.commands = ( !dynamic_cast<EventDispatcher *>(dispatcher) ||
+                        dynamic_cast<CommandDispatcher *>(dispatcher) );
+    d_lanes.push_back(l_lane);
+    publishLanes();
+    d_lanesLock.leaveMutex();
+
+    return OK;
 }
 
-exitCode MultipleDispatcher::removeDispatcher(Dispatcher const & dispatcher) {
-	return OK;
+exitCode MultipleDispatcher::removeDispatcher(Dispatcher * dispatcher) {
+    t_lanes::iterator it;
+
+    LOG4CPP_DEBUG(log, "MultipleDispatcher::removeDispatcher(Dispatcher * dispatcher)");
+
+    d_lanesLock.enterMutex();
+    for ( it = d_lanes.begin(); it != d_lanes.end(); it++ ) {
+        if ( it->dispatcher == dispatcher ) {
+            bool l_owned = it->owned;
+            d_lanes.erase(it);
+            publishLanes(l_owned ? dispatcher : 0);
+            d_lanesLock.leaveMutex();
+            return OK;
+        }
+    }
+    d_lanesLock.leaveMutex();
+
+    LOG4CPP_WARN(log, "Dispatcher not attached");
+    return DIS_DISPATCHER_NOT_FOUND;
+}
+
+exitCode MultipleDispatcher::addHandler(Handler * handler, unsigned int queueSize) {
+    t_lanes::iterator it;
+    t_lane l_lane;
+
+    LOG4CPP_DEBUG(log, "MultipleDispatcher::addHandler(Handler * handler, unsigned int queueSize=%u)", queueSize);
+
+    d_lanesLock.enterMutex();
+    for ( it = d_lanes.begin(); it != d_lanes.end(); it++ ) {
+        if ( it->handler == handler ) {
+            d_lanesLock.leaveMutex();
+            LOG4CPP_WARN(log, "Handler already attached");
+            return DIS_DISPATCHER_ALREADY_DEFINED;
+        }
+    }
+
+    AsyncCommandDispatcher * l_acd = new AsyncCommandDispatcher(handler, false, queueSize, "mdLane");
+    l_acd->setCoalescing(d_coalesce, d_coalesceParam);
+    l_lane.dispatcher = l_acd;
+    l_lane.handler = handler;
+    l_lane.owned = true;
+    l_lane.commands = true;
+    d_lanes.push_back(l_lane);
+    publishLanes();
+    d_lanesLock.leaveMutex();
+
+    LOG4CPP_INFO(log, "New worker lane attached (%d lanes)", d_lanes.size());
+
+    return OK;
+}
+
+exitCode MultipleDispatcher::removeHandler(Handler * handler) {
+    t_lanes::iterator it;
+
+    LOG4CPP_DEBUG(log, "MultipleDispatcher::removeHandler(Handler * handler)");
+
+    d_lanesLock.enterMutex();
+    for ( it = d_lanes.begin(); it != d_lanes.end(); it++ ) {
+        if ( it->owned && it->handler == handler ) {
+            Dispatcher * l_dispatcher = it->dispatcher;
+            d_lanes.erase(it);
+            publishLanes(l_dispatcher);
+            d_lanesLock.leaveMutex();
+            return OK;
+        }
+    }
+    d_lanesLock.leaveMutex();
+
+    LOG4CPP_WARN(log, "Handler not attached");
+    return DIS_DISPATCHER_NOT_FOUND;
 }
 
 int MultipleDispatcher::handlersCount() {
-	return 0;
+    int l_count;
+
+    d_lanesLock.enterMutex();
+    l_count = d_lanes.size();
+    d_lanesLock.leaveMutex();
+
+    return l_count;
+}
+
+exitCode MultipleDispatcher::setHandler(Handler * handler, bool suspended) {
+    exitCode result;
+
+    LOG4CPP_DEBUG(log, "MultipleDispatcher::setHandler(Handler * handler, bool suspended=%d)", suspended);
+
+    result = addHandler(handler);
+    if ( result != OK || !suspended ) {
+        return result;
+    }
+
+    d_lanesLock.enterMutex();
+    d_lanes.back().dispatcher->suspend();
+    d_lanesLock.leaveMutex();
+
+    return OK;
+}
+
+exitCode MultipleDispatcher::suspend() {
+    t_lanes::iterator it;
+
+    LOG4CPP_DEBUG(log, "MultipleDispatcher::suspend()");
+
+    d_lanesLock.enterMutex();
+    for ( it = d_lanes.begin(); it != d_lanes.end(); it++ ) {
+        it->dispatcher->suspend();
+    }
+    d_lanesLock.leaveMutex();
+
+    return OK;
 }
 
-exitCode dispatch() {
-	return OK;
+exitCode MultipleDispatcher::resume(bool discard) {
+    t_lanes::iterator it;
+
+    LOG4CPP_DEBUG(log, "MultipleDispatcher::resume(bool discard=%d)", discard);
+
+    d_lanesLock.enterMutex();
+    for ( it = d_lanes.begin(); it != d_lanes.end(); it++ ) {
+        it->dispatcher->resume(discard);
+    }
+    d_lanesLock.leaveMutex();
+
+    return OK;
 }
 
-exitCode dispatch(Command * command) {
-	return OK;
+exitCode MultipleDispatcher::dispatch(bool clean) {
+    t_laneView const * l_view;
+    unsigned int l_epoch;
+    exitCode result = OK;
+    exitCode l_result;
+    unsigned int i;
+
+    LOG4CPP_DEBUG(log, "MultipleDispatcher::dispatch(bool clean=%d)", clean);
+
+    l_epoch = d_rcu.readLock();
+    l_view = atomicRead(&d_view);
+    for ( i = 0; i < l_view->lanes.size(); i++ ) {
+        l_result = l_view->lanes[i].dispatcher->dispatch(clean);
+        if ( result == OK ) {
+            result = l_result;
+        }
+    }
+    d_rcu.readUnlock(l_epoch);
+
+    return result;
+}
+
+exitCode MultipleDispatcher::dispatch(Command * command, bool clean) {
+    t_laneView const * l_view;
+    unsigned int l_epoch;
+    exitCode result = OK;
+    exitCode l_result;
+    unsigned int i;
+
+    LOG4CPP_DEBUG(log, "MultipleDispatcher::dispatch(Command * command, bool clean=%d)", clean);
+
+    if ( d_journal ) {
+        d_journal->record(command);
+    }
+
+    if ( d_bus ) {
+        d_bus->publish(command);
+    }
+
+    l_epoch = d_rcu.readLock();
+    l_view = atomicRead(&d_view);
+
+    if ( !l_view->commandLanes ) {
+        d_rcu.readUnlock(l_epoch);
+        LOG4CPP_WARN(log, "Unable to dispatch: no lanes defined");
+        if ( clean ) {
+            command->release();
+        }
+        return CS_DISPATCH_FAILURE;
+    }
+
+    // One reference for each lane taking over Commands: the Command is
+    // released by the lane that notify it last. We already own the
+    // first reference.
+    if ( clean && l_view->commandLanes > 1 ) {
+        command->ref(l_view->commandLanes-1);
+    }
+
+    for ( i = 0; i < l_view->lanes.size(); i++ ) {
+        if ( !l_view->lanes[i].commands ) {
+            continue;
+        }
+        l_result = l_view->lanes[i].dispatcher->dispatch(command, clean);
+        if ( result == OK ) {
+            result = l_result;
+        }
+    }
+
+    d_rcu.readUnlock(l_epoch);
+
+    return result;
 }
 
+exitCode MultipleDispatcher::dispatchBatch(Command * const * commands, unsigned int count, bool clean) {
+    t_laneView const * l_view;
+    unsigned int l_epoch;
+    exitCode result = OK;
+    exitCode l_result;
+    unsigned int i;
+
+    LOG4CPP_DEBUG(log, "MultipleDispatcher::dispatchBatch(count=%u, clean=%d)", count, clean);
+
+    if ( d_journal ) {
+        d_journal->recordBatch(commands, count);
+    }
+
+    if ( d_bus ) {
+        d_bus->publishBatch(commands, count);
+    }
+
+    l_epoch = d_rcu.readLock();
+    l_view = atomicRead(&d_view);
+
+    if ( !l_view->commandLanes ) {
+        d_rcu.readUnlock(l_epoch);
+        LOG4CPP_WARN(log, "Unable to dispatch: no lanes defined");
+        for (i=0; clean && i<count; i++) {
+            commands[i]->release();
+        }
+        return CS_DISPATCH_FAILURE;
+    }
+
+    // One reference for each lane taking over Commands
+    for (i=0; clean && l_view->commandLanes > 1 && i<count; i++) {
+        commands[i]->ref(l_view->commandLanes-1);
+    }
+
+    for ( i = 0; i < l_view->lanes.size(); i++ ) {
+        if ( !l_view->lanes[i].commands ) {
+            continue;
+        }
+        l_result = l_view->lanes[i].dispatcher->dispatchBatch(commands, count, clean);
+        if ( result == OK ) {
+            result = l_result;
+        }
+    }
+
+    d_rcu.readUnlock(l_epoch);
+
+    return result;
+}
+
+void MultipleDispatcher::setJournal(CommandJournal * journal) {
+
+    LOG4CPP_INFO(log, "Commands journaling %s", journal ? "enabled" : "disabled");
+    d_journal = journal;
+
+}
+
+void MultipleDispatcher::setBus(ShmBus * bus) {
+
+    LOG4CPP_INFO(log, "Commands bus publishing %s", bus ? "enabled" : "disabled");
+    d_bus = bus;
+
+}
+
+exitCode MultipleDispatcher::setCoalescing(EventDispatcher::t_coalescePolicy policy, unsigned int param) {
+    t_lanes::iterator it;
+    exitCode result = OK;
+
+    LOG4CPP_DEBUG(log, "MultipleDispatcher::setCoalescing(policy=%d, param=%u)", policy, param);
+
+    d_lanesLock.enterMutex();
+    for ( it = d_lanes.begin(); it != d_lanes.end(); it++ ) {
+        if ( !it->owned ) {
+            continue;
+        }
+        result = static_cast<AsyncCommandDispatcher *>(it->dispatcher)->setCoalescing(policy, param);
+        if ( result != OK ) {
+            break;
+        }
+    }
+    if ( result == OK ) {
+        d_coalesce = policy;
+        d_coalesceParam = param;
+    }
+    d_lanesLock.leaveMutex();
+
+    return result;
+
+}
 
 } //namespace comsys
 } //namespace controlbox
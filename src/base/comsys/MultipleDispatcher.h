@@ -31,10 +31,18 @@
 #define _MULTIPLEDISPATCHER_H
 
 
+#include <controlbox/base/Object.h>
 #include <controlbox/base/comsys/Dispatcher.h>
+#include <controlbox/base/comsys/EventDispatcher.h>
+#include <controlbox/base/comsys/CommandQueue.h>
+#include <controlbox/base/comsys/CommandJournal.h>
+#include <controlbox/base/comsys/ShmBus.h>
 #include <controlbox/base/Utility.h>
+#include <controlbox/base/Rcu.h>
+#include <cc++/thread.h>
 
 #include <list>
+#include <vector>
 
 
 namespace controlbox {
@@ -42,42 +50,160 @@ namespace comsys {
 
 /// Dispatch to multiple Handlers
 /// This class allow to dispatch the same event/command to
-/// multiple handlers by defining a list of dispatchers.
-/// Each dispatcher must be correctly initialized and linked
-/// to an handler of interest.
-class MultipleDispatcher : public Dispatcher {
+/// multiple handlers by defining a list of dispatchers (lanes).
+/// Each lane could be either a user provided Dispatcher, that must be correctly
+/// initialized and linked to an handler of interest, or a worker lane built
+/// by addHandler(): an AsyncCommandDispatcher with its own bounded queue and
+/// dispatch thread, so that a slow Handler never delays the other ones.<br>
+/// A dispatched Command is never copied: the same instance is shared among
+/// all lanes by taking a reference for each of them (see Command::ref()).
+/// Lanes attached by a plain EventDispatcher just notify events: Commands
+/// are not dispatched to them.<br>
+/// Dispatching never takes the lanes lock: it uses an immutable snapshot
+/// of the lanes, published by RCU each time they change. A removed lane is
+/// released once no dispatching could be using it anymore, thus Handlers
+/// must not change the lanes while notified by this dispatcher.
+/// @note since a fanned-out Command is shared among concurrent Handlers,
+///		Handlers must treat it as read-only.
+class MultipleDispatcher : public Object, public Dispatcher {
 
 protected:
-    std::list<Dispatcher *> dispatchers;
+
+    /// A dispatching lane
+    struct lane {
+        Dispatcher * dispatcher;	///< The lane dispatcher
+        Handler * handler;		///< The handler of an owned lane, 0 otherwise
+        bool owned;			///< True if the dispatcher has been built by us
+        bool commands;			///< True if the dispatcher takes over Commands
+    };
+    typedef struct lane t_lane;
+
+    typedef std::list<t_lane> t_lanes;
+
+    /// A snapshot of the lanes, used by dispatching
+    struct laneView {
+        std::vector<t_lane> lanes;	///< The lanes
+        unsigned int commandLanes;	///< The number of lanes taking over Commands
+    };
+    typedef struct laneView t_laneView;
+
+    /// The dispatching lanes
+    t_lanes d_lanes;
+
+    /// Mutex access to the lanes list
+    ost::Mutex d_lanesLock;
+
+    /// The current lanes snapshot
+    t_laneView * volatile d_view;
+
+    /// The RCU domain of the lanes snapshots
+    RcuDomain d_rcu;
+
+    /// The journal recording dispatched Commands, if any
+    CommandJournal * d_journal;
+
+    /// The shared memory bus exporting dispatched Commands, if any
+    ShmBus * d_bus;
+
+    /// The coalescing policy of the worker lanes
+    EventDispatcher::t_coalescePolicy d_coalesce;
+
+    /// The coalescing policy parameter of the worker lanes
+    unsigned int d_coalesceParam;
 
 public:
 
     /// Build a new MultipleDispatcher
     MultipleDispatcher(std::string const & logName = "MultipleDispatcher");
 
+    /// Release all owned lanes.
+    /// Commands still queued on worker lanes are notified before returning.
     ~MultipleDispatcher();
 
     /// Attach a new Dispatcher
-    exitCode addDispatcher(Dispatcher const & dispatcher);
+    /// The dispatcher is not owned and must be released by the caller
+    /// once removed or once this MultipleDispatcher has been destroyed.
+    /// @return OK on success, DIS_DISPATCHER_ALREADY_DEFINED if the
+    ///		dispatcher is already attached
+    exitCode addDispatcher(Dispatcher * dispatcher);
 
     /// Remove a Dispatcher
-    exitCode removeDispatcher(Dispatcher const & dispatcher);
+    /// @return OK on success, DIS_DISPATCHER_NOT_FOUND if the dispatcher
+    ///		is not attached
+    exitCode removeDispatcher(Dispatcher * dispatcher);
+
+    /// Attach a new Handler on its own worker lane
+    /// @param handler the handler to notify
+    /// @param queueSize the number of Commands that could be queued on
+    ///		this lane waiting for the Handler notification
+    /// @return OK on success, DIS_DISPATCHER_ALREADY_DEFINED if the
+    ///		handler is already attached
+    exitCode addHandler(Handler * handler, unsigned int queueSize = COMMANDQUEUE_DEFAULT_SIZE);
+
+    /// Remove an Handler and release its worker lane
+    /// Commands still queued on the lane are notified before returning.
+    /// @return OK on success, DIS_DISPATCHER_NOT_FOUND if the handler
+    ///		is not attached
+    exitCode removeHandler(Handler * handler);
 
     /// Get the number of dispatcher currently linked
     int handlersCount();
 
+    /// Attach a new Handler on its own worker lane.
+    /// @see addHandler
+    exitCode setHandler(Handler * handler, bool suspended = false);
+
+    /// Suspend notifications on each lane
+    exitCode suspend();
+
+    /// Resume notifications on each lane
+    exitCode resume(bool discard = false);
+
     /// Notify each associated handler about a new happening
     /// This is usually done with a call to
     /// Handler::notify() on each associated hendler
-    exitCode dispatch();
+    exitCode dispatch(bool clean = true);
 
     /// Dispatch a command to each associated handler.
-    /// If not suspended, dispatch the default command (or the specified one) to the associated Handler.
-    /// Otherwise the command is queued for future dispatching.
-    /// The default command, if needed, must be built by the subclasses's constructors.
-    /// @param the Command to dispatch, if NULL the default command will be dispatched (default NULL)
-    /// @return Core:OK on success, Core::DIS_SUSPENDED if the Command has been queued.
-    exitCode dispatch(Command * command);
+    /// The same Command is dispatched to each lane, that is in charge of
+    /// notifying (or queuing) it independently from the other lanes.
+    /// If clean is true a reference is taken for each lane so that the
+    /// Command is released once notified to all the Handlers.
+    /// @param command the Command to dispatch
+    /// @param clean set to true to release the command once notified
+    /// @return OK on success, CS_DISPATCH_FAILURE if there aren't lanes defined,
+    ///		otherwise the first error returned by a lane.
+    exitCode dispatch(Command * command, bool clean = true);
+
+    /// Dispatch a batch of commands to each associated handler.
+    /// Each lane receive the whole batch, sharing the same Commands.
+    /// @see dispatch(Command *, bool)
+    exitCode dispatchBatch(Command * const * commands, unsigned int count, bool clean = true);
+
+    /// Record dispatched Commands into a journal.
+    /// Commands are recorded once, before being fanned out to the lanes.
+    /// @see CommandDispatcher::setJournal
+    void setJournal(CommandJournal * journal);
+
+    /// Export dispatched Commands on a shared memory bus.
+    /// Commands are published once, before being fanned out to the lanes.
+    /// @see CommandDispatcher::setBus
+    void setBus(ShmBus * bus);
+
+    /// Define the coalescing policy of the worker lanes.
+    /// The policy applies to each worker lane, those attached later
+    /// included; attached Dispatchers are not affected.
+    /// @see EventDispatcher::setCoalescing
+    exitCode setCoalescing(EventDispatcher::t_coalescePolicy policy, unsigned int param = 0);
+
+protected:
+
+    /// Publish a new lanes snapshot.
+    /// The previous snapshot is released once no dispatching could be
+    /// using it anymore, and so is the specified dispatcher.
+    /// @param release an owned dispatcher just removed, if any
+    /// @note must be called with the lanes lock held
+    void publishLanes(Dispatcher * release = 0);
 
 };
 
@@ -0,0 +1,379 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+
+#include "RateLimiter.ih"
+
+/// Tokens are accounted in millionths to refill the bucket at any rate
+#define RATELIMITER_TOKEN	1000000ULL
+
+namespace controlbox {
+namespace comsys {
+
+
+RateLimiter * RateLimiter::getRateLimiter(std::string const & prefix) {
+	Configurator & l_config = Configurator::getInstance();
+	std::string l_policy;
+	t_ratePolicy l_ratePolicy = RL_DROP;
+	unsigned int l_rate;
+	unsigned int l_burst;
+
+	l_rate = l_config.paramInt(prefix+"_rateLimit", "0");
+	if ( !l_rate ) {
+		return 0;
+	}
+
+	l_burst = l_config.paramInt(prefix+"_rateBurst", "0");
+	if ( !l_burst ) {
+		l_burst = l_rate;
+	}
+
+	l_policy = l_config.param(prefix+"_ratePolicy", RATELIMITER_DEFAULT_POLICY);
+	if ( l_policy == "sample" ) {
+		l_ratePolicy = RL_SAMPLE;
+	} else if ( l_policy == "aggregate" ) {
+		l_ratePolicy = RL_AGGREGATE;
+	}
+
+	return new RateLimiter(prefix, l_rate, l_burst, l_ratePolicy,
+			l_config.paramInt(prefix+"_rateSample", RATELIMITER_DEFAULT_SAMPLE),
+			l_config.paramInt(prefix+"_rateExempt", RATELIMITER_DEFAULT_EXEMPT));
+
+}
+
+RateLimiter::RateLimiter(std::string const & prefix, unsigned int rate,
+			unsigned int burst, t_ratePolicy policy,
+			unsigned int sample, int exempt) :
+	Object("comlibs.rl."+prefix),
+	d_prefix(prefix),
+	d_policy(policy),
+	d_rate(rate),
+	d_burst(burst*RATELIMITER_TOKEN),
+	d_sample(sample ? sample : 1),
+	d_exempt(exempt),
+	d_pending(0),
+	d_dispatcher(0),
+	d_flushTimer(0),
+	d_flushDeadline(0),
+	d_lock("rlLock") {
+	static const char * l_policies[] = { "drop", "sample", "aggregate" };
+
+	LOG4CPP_DEBUG(log, "RateLimiter::RateLimiter(prefix=%s, rate=%u, burst=%u, policy=%d, sample=%u, exempt=%d)",
+			prefix.c_str(), rate, burst, policy, sample, exempt);
+
+	memset(&d_stats, 0, sizeof(t_stats));
+
+	LOG4CPP_INFO(log, "Rate limiting [%s] to [%u] events/s (burst %u), %s over-limit events",
+			prefix.c_str(), rate, burst, l_policies[d_policy]);
+	if ( d_exempt >= 0 ) {
+		LOG4CPP_INFO(log, "Commands with priority up to [%d] are not limited",
+				d_exempt);
+	}
+
+	exportQuery();
+
+}
+
+RateLimiter::~RateLimiter() {
+
+	LOG4CPP_DEBUG(log, "~RateLimiter()");
+
+	// Once canceled the timer handler is granted to be not running
+	if ( d_flushTimer ) {
+		TimerWheel::getInstance()->cancel(d_flushTimer);
+	}
+
+	QueryRegistry::getInstance()->unregisterQuery(name());
+
+	LOG4CPP_INFO(log, "Rate limiting [%s]: passed [%lu], rejected [%lu], sampled [%lu], summaries [%lu], exempted [%lu]",
+			d_prefix.c_str(), d_stats.passed, d_stats.rejected,
+			d_stats.sampled, d_stats.summaries, d_stats.exempted);
+
+}
+
+RateLimiter::t_bucket & RateLimiter::getBucket(unsigned int key, unsigned long long now) {
+	t_buckets::iterator it;
+
+	it = d_buckets.find(key);
+	if ( it != d_buckets.end() ) {
+		return it->second;
+	}
+
+	t_bucket & l_bucket = d_buckets[key];
+	l_bucket.tokens = d_burst;
+	l_bucket.lastRefill = now;
+	l_bucket.pending = 0;
+	l_bucket.pendingType = 0;
+	l_bucket.devType = Device::UNDEF;
+
+	return l_bucket;
+
+}
+
+inline
+void RateLimiter::refill(t_bucket & bucket, unsigned long long now) {
+
+	// NOTE each elapsed microsecond is worth d_rate micro-tokens
+	bucket.tokens += (now - bucket.lastRefill) * d_rate;
+	if ( bucket.tokens > d_burst ) {
+		bucket.tokens = d_burst;
+	}
+	bucket.lastRefill = now;
+
+}
+
+bool RateLimiter::admit(Command * command, Dispatcher * dispatcher) {
+	unsigned long long l_now = Utils::monotonicUsec();
+	bool l_admit = true;
+
+	d_lock.enterMutex();
+
+	// Urgent Commands neither consume tokens nor are rejected
+	if ( command && (int)command->getPrio() <= d_exempt ) {
+		d_stats.exempted++;
+		d_lock.leaveMutex();
+		return true;
+	}
+
+	t_bucket & l_bucket = getBucket(command ? command->getCoalesceKey() : 0, l_now);
+	refill(l_bucket, l_now);
+
+	if ( l_bucket.tokens >= RATELIMITER_TOKEN ) {
+		l_bucket.tokens -= RATELIMITER_TOKEN;
+		d_stats.passed++;
+		d_lock.leaveMutex();
+		return true;
+	}
+
+	switch ( d_policy ) {
+	case RL_SAMPLE:
+		if ( (d_stats.rejected + d_stats.sampled) % d_sample == 0 ) {
+			d_stats.sampled++;
+			break;
+		}
+		d_stats.rejected++;
+		l_admit = false;
+		break;
+	case RL_AGGREGATE:
+		// Only Commands could be summarized
+		if ( command ) {
+			if ( !l_bucket.pending++ ) {
+				d_pending++;
+			}
+			l_bucket.pendingType = command->type();
+			l_bucket.devType = command->device();
+			l_bucket.devId = command->deviceId();
+			l_bucket.timestamp = command->hasParam(Command::LBL_TIMESTAMP) ?
+				command->param(Command::LBL_TIMESTAMP) : "";
+			l_bucket.evtType = command->hasParam(Command::LBL_DIST_EVTTYPE) ?
+				command->param(Command::LBL_DIST_EVTTYPE) : "";
+			l_bucket.evtData = command->hasParam(Command::LBL_DIST_EVTDATA) ?
+				command->param(Command::LBL_DIST_EVTDATA) : "";
+			if ( dispatcher ) {
+				d_dispatcher = dispatcher;
+				armFlush(l_bucket, l_now);
+			}
+		}
+		// no break
+	case RL_DROP:
+		d_stats.rejected++;
+		l_admit = false;
+		break;
+	}
+
+	d_lock.leaveMutex();
+
+	if ( !l_admit ) {
+		LOG4CPP_DEBUG(log, "Over-limit event [%u] rejected",
+				command ? command->type() : 0);
+	}
+
+	return l_admit;
+
+}
+
+Command * RateLimiter::buildSummary(t_bucket & bucket) {
+	Command * l_summary;
+
+	LOG4CPP_INFO(log, "Summarizing [%lu] over-limit events", bucket.pending);
+
+	l_summary = Command::getCommand(RATE_LIMIT_SUMMARY, bucket.devType, bucket.devId, "RateLimiter");
+	if ( l_summary ) {
+		l_summary->setParam(Command::LBL_VALUE, (int)bucket.pending);
+		l_summary->setParam(Command::LBL_TYPE, (int)bucket.pendingType);
+		// The summary is timestamped when built if the suppressed
+		// Command was not
+		l_summary->setParam(Command::LBL_TIMESTAMP, bucket.timestamp.size() ?
+				bucket.timestamp : Utils::isoTime());
+		if ( bucket.evtType.size() ) {
+			l_summary->setParam(Command::LBL_DIST_EVTTYPE, bucket.evtType);
+			l_summary->setParam(Command::LBL_DIST_EVTDATA, bucket.evtData);
+		}
+		d_stats.summaries++;
+	}
+
+	bucket.pending = 0;
+	d_pending--;
+
+	return l_summary;
+
+}
+
+Command * RateLimiter::summary(Command * command) {
+	t_buckets::iterator it;
+	Command * l_summary = 0;
+
+	if ( !d_pending ) {
+		return 0;
+	}
+
+	d_lock.enterMutex();
+	it = d_buckets.find(command->getCoalesceKey());
+	if ( it != d_buckets.end() && it->second.pending ) {
+		l_summary = buildSummary(it->second);
+	}
+	d_lock.leaveMutex();
+
+	return l_summary;
+
+}
+
+void RateLimiter::armFlush(t_bucket const & bucket, unsigned long long now) {
+	unsigned long long l_deadline;
+	timeout_t l_delay;
+
+	// The time the bucket will hold a token again
+	l_deadline = now + (RATELIMITER_TOKEN - bucket.tokens + d_rate - 1) / d_rate;
+	if ( d_flushDeadline && d_flushDeadline <= l_deadline ) {
+		return;
+	}
+
+	l_delay = (timeout_t)((l_deadline - now + 999) / 1000);
+	if ( d_flushTimer ) {
+		TimerWheel::getInstance()->reschedule(d_flushTimer, l_delay);
+	} else {
+		d_flushTimer = TimerWheel::getInstance()->schedule(this, l_delay);
+	}
+	d_flushDeadline = l_deadline;
+
+}
+
+void RateLimiter::timerExpired(unsigned int timer) {
+	std::vector<Command *> l_summaries;
+	std::vector<Command *>::iterator summary;
+	unsigned long long l_now;
+	t_buckets::iterator it;
+	Dispatcher * l_dispatcher;
+
+	LOG4CPP_DEBUG(log, "RateLimiter::timerExpired(timer=%u)", timer);
+
+	d_lock.enterMutex();
+	d_flushDeadline = 0;
+	l_now = Utils::monotonicUsec();
+	for ( it = d_buckets.begin(); d_pending && it != d_buckets.end(); it++ ) {
+		t_bucket & l_bucket = it->second;
+		if ( !l_bucket.pending ) {
+			continue;
+		}
+		// The burst is over once the bucket holds a token, which is
+		// consumed by the summary
+		refill(l_bucket, l_now);
+		if ( l_bucket.tokens < RATELIMITER_TOKEN ) {
+			armFlush(l_bucket, l_now);
+			continue;
+		}
+		l_bucket.tokens -= RATELIMITER_TOKEN;
+		l_summaries.push_back(buildSummary(l_bucket));
+	}
+	l_dispatcher = d_dispatcher;
+	d_lock.leaveMutex();
+
+	for ( summary = l_summaries.begin(); summary != l_summaries.end(); summary++ ) {
+		if ( *summary ) {
+			l_dispatcher->dispatch(*summary, true);
+		}
+	}
+
+}
+
+void RateLimiter::getStats(t_stats & stats) {
+
+	d_lock.enterMutex();
+	stats = d_stats;
+	d_lock.leaveMutex();
+
+}
+
+std::string RateLimiter::name() const {
+	return "RL_" + d_prefix;
+}
+
+exitCode RateLimiter::exportQuery() {
+
+	return registerQuery(QUERY_STATS, name(),
+			"Rate limiting counters: passed, rejected, sampled, summaries, exempted",
+			"Set 0 to reset the counters", QST_RW);
+
+}
+
+exitCode RateLimiter::query(Querible::t_query & p_query) {
+	t_stats l_stats;
+
+	LOG4CPP_DEBUG(log, "RateLimiter::query(type=%d)", p_query.type);
+
+	switch ( p_query.type ) {
+
+	case QM_QUERY:
+		getStats(l_stats);
+		RETURN_VALUE(p_query, "%lu,%lu,%lu,%lu,%lu",
+				l_stats.passed, l_stats.rejected,
+				l_stats.sampled, l_stats.summaries,
+				l_stats.exempted);
+		break;
+	case QM_VALUES:
+		RETURN_VALUE(p_query, "Rate limiting counters of [%s]\r\nFormat: AT+%s=0 to reset\n\r",
+				d_prefix.c_str(), p_query.descr->name.c_str());
+		break;
+	case QM_SET:
+		d_lock.enterMutex();
+		memset(&d_stats, 0, sizeof(t_stats));
+		d_lock.leaveMutex();
+		RETURN_VALUE(p_query, "OK");
+		break;
+
+	}
+
+	return OK;
+
+}
+
+
+} //namespace comsys
+} //namespace controlbox
@@ -0,0 +1,289 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _RATELIMITER_H
+#define _RATELIMITER_H
+
+#include <controlbox/base/Utility.h>
+#include <controlbox/base/Object.h>
+#include <controlbox/base/Querible.h>
+#include <controlbox/base/TimerWheel.h>
+#include <controlbox/base/comsys/Command.h>
+#include <cc++/thread.h>
+#include <map>
+
+/// The default rate limiting policy
+#define RATELIMITER_DEFAULT_POLICY	"drop"
+
+/// The default sampling ratio of the "sample" policy: one over-limit
+/// event every RATELIMITER_DEFAULT_SAMPLE is notified anyway
+#define RATELIMITER_DEFAULT_SAMPLE	"10"
+
+/// The default priority of the Commands exempted from rate limiting:
+/// alarms (e.g. emergency breaks) are notified with priority 1
+#define RATELIMITER_DEFAULT_EXEMPT	"1"
+
+namespace controlbox {
+namespace comsys {
+
+class Dispatcher;
+
+/// A token bucket rate limiter for Generators.
+/// A RateLimiter bounds the rate at which a Generator could notify events:
+/// a bucket of at most <i>burst</i> tokens is refilled at <i>rate</i>
+/// tokens per second and each notified event consumes a token. Events
+/// generated while the bucket is empty are over-limit: depending on the
+/// configured policy they are dropped, sampled (one every N is notified
+/// anyway) or aggregated into a single summary Command notified, in place
+/// of all of them, before the next event within the limit or, once the
+/// burst is over, as soon as the bucket is refilled.<br>
+/// Commands defining a coalescing key (see Command::setCoalesceKey()), e.g.
+/// the ones of each sensor line, are accounted on a bucket of their own:
+/// a storm on a line does not starve the other ones.<br>
+/// Commands with an urgent priority (see Command::setPrio()), i.e. a
+/// priority value not greater than the exemption threshold, are never
+/// limited nor accounted: a storm never hides an alarm.<br>
+/// Limits are read from the configuration, keyed by the Generator
+/// configuration prefix, and rejection counters are exported by an
+/// "RL_<prefix>" query.
+/// <br>
+/// <h5>Configuration params used by this class:</h5>
+/// <ul>
+///	<li>
+///		<b>&lt;prefix&gt;_rateLimit</b> - <i>Default: 0</i><br>
+///		The maximum number of events notified per second, 0 to
+///		disable rate limiting<br>
+///	</li>
+///	<li>
+///		<b>&lt;prefix&gt;_rateBurst</b> - <i>Default: rateLimit</i><br>
+///		The maximum number of events notified back-to-back<br>
+///	</li>
+///	<li>
+///		<b>&lt;prefix&gt;_ratePolicy</b> - <i>Default: RATELIMITER_DEFAULT_POLICY</i><br>
+///		How over-limit events are handled: drop, sample or aggregate<br>
+///	</li>
+///	<li>
+///		<b>&lt;prefix&gt;_rateSample</b> - <i>Default: RATELIMITER_DEFAULT_SAMPLE</i><br>
+///		The sampling ratio of the "sample" policy<br>
+///	</li>
+///	<li>
+///		<b>&lt;prefix&gt;_rateExempt</b> - <i>Default: RATELIMITER_DEFAULT_EXEMPT</i><br>
+///		Commands with a priority value up to this one are exempted from
+///		rate limiting, -1 to limit all of them<br>
+///	</li>
+/// </ul>
+/// @see EventGenerator::setRateLimit
+class RateLimiter : public Object, public Querible, public TimerHandler {
+
+//-----[ Types ]----------------------------------------------------------------
+
+public:
+
+    /// How over-limit events are handled
+    enum ratePolicy {
+        RL_DROP = 0,	///< Over-limit events are dropped
+        RL_SAMPLE,	///< One over-limit event every N is notified anyway
+        RL_AGGREGATE	///< Over-limit events are summarized by a single Command
+    };
+    typedef enum ratePolicy t_ratePolicy;
+
+    /// Rate limiting counters
+    struct stats {
+        unsigned long passed;		///< Events within the limit
+        unsigned long rejected;		///< Over-limit events not notified
+        unsigned long sampled;		///< Over-limit events notified by sampling
+        unsigned long summaries;	///< Summary Commands notified
+        unsigned long exempted;		///< Urgent Commands not limited
+    };
+    typedef struct stats t_stats;
+
+protected:
+
+    /// The exported queries
+    enum queries {
+        QUERY_STATS = 0
+    };
+
+
+//-----[ Members ]--------------------------------------------------------------
+
+protected:
+
+    /// The configuration prefix
+    std::string d_prefix;
+
+    /// The policy for over-limit events
+    t_ratePolicy d_policy;
+
+    /// The refill rate [tokens/s]
+    unsigned int d_rate;
+
+    /// The bucket size [micro-tokens]
+    unsigned long long d_burst;
+
+    /// A token bucket
+    struct bucket {
+        unsigned long long tokens;	///< The tokens available [micro-tokens]
+        unsigned long long lastRefill;	///< The last refill time [us]
+        unsigned long pending;		///< Over-limit events not yet summarized
+        Command::t_cmdType pendingType;	///< The type of the last of them
+        Device::t_deviceType devType;	///< Its device type
+        Device::t_deviceId devId;	///< Its device identifier
+        std::string timestamp;		///< Its timestamp, if any
+        std::string evtType;		///< Its DIST event type, if any
+        std::string evtData;		///< Its DIST event data, if any
+    };
+    typedef struct bucket t_bucket;
+
+    /// The buckets, indexed by the Commands coalescing key
+    typedef std::map<unsigned int, t_bucket> t_buckets;
+
+    /// The buckets, the one of plain events and unkeyed Commands being
+    /// indexed by 0
+    t_buckets d_buckets;
+
+    /// The sampling ratio
+    unsigned int d_sample;
+
+    /// The priority of the Commands exempted from rate limiting,
+    /// -1 if none is exempted
+    int d_exempt;
+
+    /// The number of buckets with over-limit events not yet summarized
+    unsigned int d_pending;
+
+    /// The Dispatcher notifying the summaries flushed by the timer
+    Dispatcher * d_dispatcher;
+
+    /// The timer flushing the summaries, 0 if not yet defined
+    TimerWheel::t_timerId d_flushTimer;
+
+    /// The monotonic time [us] the flush timer has been armed to,
+    /// 0 if it is not armed
+    unsigned long long d_flushDeadline;
+
+    /// The counters
+    t_stats d_stats;
+
+    /// Mutex access to the bucket
+    ost::Mutex d_lock;
+
+
+//-----[ Methods ]--------------------------------------------------------------
+
+public:
+
+    /// Build a RateLimiter by configuration.
+    /// @param prefix the configuration prefix of the limited Generator
+    /// @return a new RateLimiter, 0 if rate limiting is not configured
+    static RateLimiter * getRateLimiter(std::string const & prefix);
+
+    /// Build a new RateLimiter.
+    /// @param prefix the configuration prefix of the limited Generator
+    /// @param rate the refill rate [events/s]
+    /// @param burst the bucket size [events]
+    /// @param policy the policy for over-limit events
+    /// @param sample the sampling ratio of the RL_SAMPLE policy
+    /// @param exempt the priority of the Commands exempted from rate
+    ///		limiting, i.e. Commands with a priority value up to this
+    ///		one, -1 (the default) to limit all of them
+    RateLimiter(std::string const & prefix, unsigned int rate,
+                unsigned int burst, t_ratePolicy policy = RL_DROP,
+                unsigned int sample = 10, int exempt = -1);
+
+    ~RateLimiter();
+
+    /// Account a new event.
+    /// @param command the Command to notify, 0 for plain events
+    /// @param dispatcher the Dispatcher of the Generator, used to notify
+    ///		the summaries flushed once the burst is over
+    /// @return true if the event should be notified, false if it
+    ///		should be dropped; exempted Commands are always notified
+    bool admit(Command * command = 0, Dispatcher * dispatcher = 0);
+
+    /// Build the summary of the aggregated events, if any.
+    /// With the RL_AGGREGATE policy, once a Command has been admitted this
+    /// method returns the Command summarizing the ones rejected before it
+    /// on the same bucket. The summary is a common service
+    /// RATE_LIMIT_SUMMARY Command, for the device of the last rejected
+    /// Command, with the number of rejected Commands as "value" and the
+    /// type of the last of them as "type". The timestamp and DIST event
+    /// params of the last rejected Command, if any, are copied too: the
+    /// summary carries the last suppressed state. Summaries of Commands
+    /// without a timestamp are timestamped with the system time.
+    /// @param command the admitted Command
+    /// @return the summary Command, to be released by the caller, or 0
+    Command * summary(Command * command);
+
+    /// Flush the summaries of the buckets refilled since the burst.
+    void timerExpired(unsigned int timer);
+
+    /// Return the policy for over-limit events.
+    inline t_ratePolicy policy() const {
+        return d_policy;
+    };
+
+    /// Collect the rate limiting counters.
+    void getStats(t_stats & stats);
+
+    /// Return the counters.
+    exitCode query(Querible::t_query & query);
+
+    /// Return the Querible name.
+    std::string name() const;
+
+protected:
+
+    /// Export the counters query.
+    exitCode exportQuery();
+
+    /// Return the bucket of a Command, building it if required.
+    /// @param key the Command coalescing key
+    /// @param now the current monotonic time [us]
+    /// @note must be called with the bucket lock held
+    t_bucket & getBucket(unsigned int key, unsigned long long now);
+
+    /// Refill a bucket.
+    /// @note must be called with the bucket lock held
+    inline void refill(t_bucket & bucket, unsigned long long now);
+
+    /// Build the summary of a bucket and reset its pending events.
+    /// @note must be called with the bucket lock held
+    Command * buildSummary(t_bucket & bucket);
+
+    /// Arm the flush timer to expire once a bucket holds a token.
+    /// @note must be called with the bucket lock held
+    void armFlush(t_bucket const & bucket, unsigned long long now);
+
+};
+
+} //namespace comsys
+} //namespace controlbox
+#endif
@@ -0,0 +1,332 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#include "ShmBus.ih"
+
+namespace controlbox {
+namespace comsys {
+
+
+ShmBus::ShmBus(std::string const & name, unsigned int size,
+		std::string const & logName) :
+	Object("comlibs."+logName),
+	d_name(name),
+	d_mapSize(0),
+	d_hdr(0),
+	d_ring(0),
+	d_wait(0),
+	d_size(4*SHMBUS_MAX_FRAME),
+	d_head(0),
+	d_tail(0),
+	d_published(0),
+	d_dropped(0),
+	d_wakeups(0),
+	d_staleWaiters(0),
+	d_lock("sbLock") {
+	std::string l_waitName(name + SHMBUS_WAIT_SUFFIX);
+	void * l_map;
+	int l_fd;
+
+	LOG4CPP_DEBUG(log, "ShmBus::ShmBus(name=%s, size=%u)", name.c_str(), size);
+
+	// Rounding up to the next power of two, at least few frames
+	while ( d_size < size ) {
+		d_size <<= 1;
+	}
+	d_mapSize = sizeof(t_shmBusHeader) + d_size;
+
+	// The wait page: the only memory readers could write
+	shm_unlink(l_waitName.c_str());
+	l_fd = shm_open(l_waitName.c_str(), O_CREAT|O_EXCL|O_RDWR, 0660);
+	if ( l_fd < 0 ) {
+		LOG4CPP_ERROR(log, "Unable to create bus [%s]: %s", l_waitName.c_str(), strerror(errno));
+		return;
+	}
+	if ( ftruncate(l_fd, getpagesize()) ) {
+		LOG4CPP_ERROR(log, "Unable to size bus [%s]: %s", l_waitName.c_str(), strerror(errno));
+		close(l_fd);
+		shm_unlink(l_waitName.c_str());
+		return;
+	}
+	l_map = mmap(0, getpagesize(), PROT_READ|PROT_WRITE, MAP_SHARED, l_fd, 0);
+	close(l_fd);
+	if ( l_map == MAP_FAILED ) {
+		LOG4CPP_ERROR(log, "Unable to map bus [%s]: %s", l_waitName.c_str(), strerror(errno));
+		shm_unlink(l_waitName.c_str());
+		return;
+	}
+	d_wait = (t_shmBusWait *)l_map;
+
+	shm_unlink(d_name.c_str());
+	l_fd = shm_open(d_name.c_str(), O_CREAT|O_EXCL|O_RDWR, 0640);
+	if ( l_fd < 0 ) {
+		LOG4CPP_ERROR(log, "Unable to create bus [%s]: %s", d_name.c_str(), strerror(errno));
+		munmap(d_wait, getpagesize());
+		shm_unlink(l_waitName.c_str());
+		d_wait = 0;
+		return;
+	}
+
+	if ( ftruncate(l_fd, d_mapSize) ) {
+		LOG4CPP_ERROR(log, "Unable to size bus [%s]: %s", d_name.c_str(), strerror(errno));
+		close(l_fd);
+		shm_unlink(d_name.c_str());
+		munmap(d_wait, getpagesize());
+		shm_unlink(l_waitName.c_str());
+		d_wait = 0;
+		return;
+	}
+
+	l_map = mmap(0, d_mapSize, PROT_READ|PROT_WRITE, MAP_SHARED, l_fd, 0);
+	close(l_fd);
+	if ( l_map == MAP_FAILED ) {
+		LOG4CPP_ERROR(log, "Unable to map bus [%s]: %s", d_name.c_str(), strerror(errno));
+		shm_unlink(d_name.c_str());
+		munmap(d_wait, getpagesize());
+		shm_unlink(l_waitName.c_str());
+		d_wait = 0;
+		return;
+	}
+
+	d_hdr = (t_shmBusHeader *)l_map;
+	d_ring = (char *)l_map + sizeof(t_shmBusHeader);
+
+	memset(d_hdr, 0, sizeof(t_shmBusHeader));
+	d_hdr->version = SHMBUS_VERSION;
+	d_hdr->size = d_size;
+	d_hdr->writerPid = getpid();
+
+	// Readers attach only once the header is ready
+	atomicBarrier();
+	d_hdr->magic = SHMBUS_MAGIC;
+
+	LOG4CPP_INFO(log, "Publishing commands on bus [%s] (%u bytes)", d_name.c_str(), d_size);
+
+}
+
+ShmBus::~ShmBus() {
+
+	LOG4CPP_DEBUG(log, "~ShmBus()");
+
+	if ( !d_hdr ) {
+		return;
+	}
+
+	LOG4CPP_INFO(log, "Bus [%s] closed: %u commands published, %u dropped, %lu wakeups",
+			d_name.c_str(), d_published, atomicRead(&d_dropped), d_wakeups);
+
+	munmap(d_hdr, d_mapSize);
+	shm_unlink(d_name.c_str());
+
+	munmap(d_wait, getpagesize());
+	shm_unlink((d_name + SHMBUS_WAIT_SUFFIX).c_str());
+
+}
+
+unsigned int ShmBus::encode(Command * command, char * frame) {
+	unsigned int l_len;
+
+	if ( command->encode(frame, SHMBUS_MAX_FRAME, l_len) != OK ) {
+		LOG4CPP_WARN(log, "Command [%u] too big (%u bytes), not published",
+				command->type(), l_len);
+		atomicSet(&d_hdr->dropped, atomicInc(&d_dropped));
+		return 0;
+	}
+
+	return l_len;
+
+}
+
+void ShmBus::reclaim(unsigned int head, unsigned int end) {
+	unsigned int l_tail = d_tail;
+	t_shmBusRecord * l_rec;
+	unsigned int l_off;
+
+	if ( end - l_tail <= d_size ) {
+		return;
+	}
+
+	// Dropping the oldest records
+	while ( end - l_tail > d_size ) {
+		l_off = l_tail & (d_size-1);
+		l_rec = (t_shmBusRecord *)(d_ring+l_off);
+		if ( l_rec->len == SHMBUS_WRAP ) {
+			l_tail += d_size - l_off;
+			continue;
+		}
+		if ( l_rec->len > SHMBUS_MAX_FRAME ||
+				l_off+sizeof(t_shmBusRecord)+l_rec->len > d_size ) {
+			// Should never happen: the ring is written by us only
+			LOG4CPP_ERROR(log, "Bus [%s] corrupted at [%u], dropping all records",
+					d_name.c_str(), l_tail);
+			l_tail = head;
+			break;
+		}
+		l_tail += SHMBUS_ALIGN(sizeof(t_shmBusRecord)+l_rec->len);
+	}
+	d_tail = l_tail;
+
+	// Readers must know about overwritten records before we touch them
+	atomicSet(&d_hdr->tail, l_tail);
+	atomicBarrier();
+
+}
+
+unsigned int ShmBus::write(unsigned int head, char const * frame, unsigned int len) {
+	unsigned int l_head = head;
+	unsigned int l_off = l_head & (d_size-1);
+	unsigned int l_size = SHMBUS_ALIGN(sizeof(t_shmBusRecord)+len);
+	unsigned int l_pad = 0;
+	t_shmBusRecord * l_rec;
+
+	// Records are never split across the end of the ring
+	if ( l_off + l_size > d_size ) {
+		l_pad = d_size - l_off;
+	}
+
+	reclaim(l_head, l_head + l_pad + l_size);
+
+	if ( l_pad ) {
+		((t_shmBusRecord *)(d_ring+l_off))->len = SHMBUS_WRAP;
+		l_head += l_pad;
+		l_off = 0;
+	}
+
+	l_rec = (t_shmBusRecord *)(d_ring+l_off);
+	l_rec->len = len;
+	l_rec->seq = d_published++;
+	memcpy(d_ring+l_off+sizeof(t_shmBusRecord), frame, len);
+
+	// NOTE the new head is published by commit()
+	return l_head + l_size;
+
+}
+
+void ShmBus::commit(unsigned int head) {
+	int l_waiters;
+
+	d_head = head;
+
+	// Records must be visible before readers could notice the new head
+	atomicBarrier();
+	atomicSet(&d_hdr->head, head);
+	atomicSet(&d_hdr->published, d_published);
+	atomicInc(&d_wait->seq);
+
+	l_waiters = atomicRead(&d_wait->waiters);
+	if ( l_waiters <= 0 ) {
+		return;
+	}
+
+	d_wakeups++;
+	if ( syscall(SYS_futex, &d_wait->seq, FUTEX_WAKE, INT_MAX, 0, 0, 0) > 0 ) {
+		return;
+	}
+
+	// Nobody was sleeping: either the count has been left behind by a
+	// dead reader, or the readers are still going to sleep, which will
+	// not happen since the sequence has already been bumped. In both
+	// cases the count could be dropped, unless new readers showed up.
+	if ( atomicCAS(&d_wait->waiters, l_waiters, 0) ) {
+		d_staleWaiters++;
+	}
+
+}
+
+exitCode ShmBus::publish(Command * command) {
+	char l_frame[SHMBUS_MAX_FRAME];
+	unsigned int l_len;
+
+	if ( !d_hdr ) {
+		return SHM_OPEN_FAILED;
+	}
+
+	l_len = encode(command, l_frame);
+	if ( !l_len ) {
+		return SHM_FRAME_TOO_BIG;
+	}
+
+	d_lock.enterMutex();
+	commit(write(d_head, l_frame, l_len));
+	d_lock.leaveMutex();
+
+	return OK;
+
+}
+
+exitCode ShmBus::publishBatch(Command * const * commands, unsigned int count) {
+	char l_frame[SHMBUS_MAX_FRAME];
+	unsigned int l_len;
+	unsigned int l_head;
+	exitCode result = OK;
+	unsigned int i;
+
+	if ( !d_hdr ) {
+		return SHM_OPEN_FAILED;
+	}
+
+	d_lock.enterMutex();
+	l_head = d_head;
+	for (i=0; i<count; i++) {
+		l_len = encode(commands[i], l_frame);
+		if ( !l_len ) {
+			result = SHM_FRAME_TOO_BIG;
+			continue;
+		}
+		l_head = write(l_head, l_frame, l_len);
+	}
+	commit(l_head);
+	d_lock.leaveMutex();
+
+	return result;
+
+}
+
+void ShmBus::getStats(t_stats & stats) {
+
+	memset(&stats, 0, sizeof(t_stats));
+
+	if ( !d_hdr ) {
+		return;
+	}
+
+	d_lock.enterMutex();
+	stats.published = d_published;
+	stats.wakeups = d_wakeups;
+	stats.staleWaiters = d_staleWaiters;
+	d_lock.leaveMutex();
+	stats.dropped = atomicRead(&d_dropped);
+	stats.size = d_size;
+
+}
+
+
+} //namespace comsys
+} //namespace controlbox
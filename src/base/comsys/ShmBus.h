@@ -0,0 +1,251 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _SHMBUS_H
+#define _SHMBUS_H
+
+#include <controlbox/base/Utility.h>
+#include <controlbox/base/Object.h>
+#include <controlbox/base/comsys/Command.h>
+#include <cc++/thread.h>
+
+/// The default name of the shared memory bus
+#define SHMBUS_DEFAULT_NAME	"/cbox"
+
+/// The default size of the shared memory ring [bytes]
+#define SHMBUS_DEFAULT_SIZE	65536
+
+/// The maximum size of an encoded Command published on the bus
+#define SHMBUS_MAX_FRAME	1024
+
+/// The shared memory bus magic number ("CBBS")
+#define SHMBUS_MAGIC		0x43424253
+
+/// The shared memory bus layout version
+#define SHMBUS_VERSION		2
+
+/// The suffix of the shared memory object readers use to wait
+#define SHMBUS_WAIT_SUFFIX	".wait"
+
+/// The maximum time a reader sleeps before checking again the ring [ms]
+#define SHMBUS_WAIT_RECHECK	1000
+
+/// The record length marking the unused end of the ring
+#define SHMBUS_WRAP		0xFFFFFFFF
+
+/// Round up a record length to keep records 8 bytes aligned
+#define SHMBUS_ALIGN(len)	(((len)+7) & ~7)
+
+namespace controlbox {
+namespace comsys {
+
+/// The shared memory bus header.
+/// The header is followed by the ring of records, each one made by a
+/// record header and by the encoded Command frame.
+/// Positions are free running byte counters: the ring offset is obtained
+/// by masking them with (size-1).<br>
+/// The header and the ring are written only by the publisher, which keeps
+/// its own copy of the ring state and just mirrors it here for readers.
+struct shmBusHeader {
+    unsigned int magic;		///< SHMBUS_MAGIC once the bus is ready
+    unsigned int version;	///< SHMBUS_VERSION
+    unsigned int size;		///< The ring size [bytes], a power of two
+    int writerPid;		///< The publisher PID
+    volatile unsigned int head;	///< The next write position
+    volatile unsigned int tail;	///< The oldest valid record position
+    volatile unsigned int published;	///< Commands published
+    volatile unsigned int dropped;	///< Commands too big to be published
+    unsigned int reserved[8];
+};
+typedef struct shmBusHeader t_shmBusHeader;
+
+/// The shared memory bus wait page.
+/// This is the only memory readers could write, it is a distinct shared
+/// memory object (named by SHMBUS_WAIT_SUFFIX) thus the ring could be
+/// exported read-only.
+struct shmBusWait {
+    volatile int seq;		///< Bumped at each publish, the readers futex
+    volatile int waiters;	///< Readers going to sleep on the futex
+};
+typedef struct shmBusWait t_shmBusWait;
+
+/// A ring record header, followed by the encoded Command.
+struct shmBusRecord {
+    unsigned int len;		///< The frame length, SHMBUS_WRAP at the ring end
+    unsigned int seq;		///< The record sequence number
+};
+typedef struct shmBusRecord t_shmBusRecord;
+
+/// A shared memory bus publishing Commands to external processes.
+/// A ShmBus exports dispatched Commands on a POSIX shared memory ring, thus
+/// any number of external processes could follow the live events using a
+/// ShmBusReader. Each Command is published as a CommandView frame.<br>
+/// The ring is written by the publisher only: readers track their own
+/// position and they never slow down the publisher. Once the ring is full
+/// the oldest records are overwritten, readers lagging behind detect it
+/// and skip to the oldest still valid record.<br>
+/// Publishing does not require any system call: the ring is updated with
+/// plain memory accesses and readers are woken up, by a futex, only if
+/// some of them is actually sleeping waiting for new Commands. A waiters
+/// count left behind by a dead reader is dropped by the first wakeup which
+/// finds nobody sleeping.<br>
+/// The ring is exported to the owner group only (mode 0640), readers
+/// write just the separate wait page (mode 0660).
+/// @note a new bus is created at each startup: readers should attach again
+///		if the publisher is restarted.
+/// @see CommandDispatcher::setBus
+/// @see ShmBusReader
+class ShmBus : public Object {
+
+//-----[ Types ]----------------------------------------------------------------
+
+public:
+
+    /// Bus statistics
+    struct stats {
+        unsigned long published;	///< Commands published
+        unsigned long dropped;		///< Commands too big to be published
+        unsigned long wakeups;		///< Futex wakeups issued
+        unsigned long staleWaiters;	///< Stale waiters counts dropped
+        unsigned int size;		///< The ring size [bytes]
+    };
+    typedef struct stats t_stats;
+
+
+//-----[ Members ]--------------------------------------------------------------
+
+protected:
+
+    /// The shared memory object name
+    std::string d_name;
+
+    /// The shared memory mapping size
+    unsigned int d_mapSize;
+
+    /// The mapped bus header
+    t_shmBusHeader * d_hdr;
+
+    /// The mapped ring
+    char * d_ring;
+
+    /// The mapped wait page
+    t_shmBusWait * d_wait;
+
+    /// The ring size [bytes]
+    unsigned int d_size;
+
+    /// The next write position
+    unsigned int d_head;
+
+    /// The oldest valid record position
+    unsigned int d_tail;
+
+    /// Commands published
+    unsigned int d_published;
+
+    /// Commands too big to be published
+    unsigned int d_dropped;
+
+    /// Futex wakeups issued
+    unsigned long d_wakeups;
+
+    /// Stale waiters counts dropped
+    unsigned long d_staleWaiters;
+
+    /// Serialize concurrent publishers
+    ost::Mutex d_lock;
+
+
+//-----[ Methods ]--------------------------------------------------------------
+
+public:
+
+    /// Create a new shared memory bus.
+    /// A previous bus with the same name is removed.
+    /// @param name the shared memory object name
+    /// @param size the ring size [bytes], rounded up to the next power of two
+    /// @param logName the log category, this name is prepended by the
+    ///		class namespace "controlbox.comlibs."
+    ShmBus(std::string const & name = SHMBUS_DEFAULT_NAME,
+           unsigned int size = SHMBUS_DEFAULT_SIZE,
+           std::string const & logName = "shmbus");
+
+    /// Remove the shared memory bus.
+    ~ShmBus();
+
+    /// Return true if the bus has been successfully created.
+    inline bool isOpen() const {
+        return (d_hdr != 0);
+    };
+
+    /// Publish a Command.
+    /// This method could be called concurrently by many threads: the
+    /// Command is encoded without locks and then copied into the ring.
+    /// @param command the Command to publish
+    /// @return OK on success, SHM_FRAME_TOO_BIG if the encoded Command
+    ///		is bigger than SHMBUS_MAX_FRAME
+    exitCode publish(Command * command);
+
+    /// Publish a batch of Commands.
+    /// Readers are woken up once for the whole batch.
+    exitCode publishBatch(Command * const * commands, unsigned int count);
+
+    /// Collect the bus statistics.
+    void getStats(t_stats & stats);
+
+protected:
+
+    /// Encode a Command into the specified buffer.
+    /// @return the frame length, 0 if the frame is too big
+    unsigned int encode(Command * command, char * frame);
+
+    /// Copy a frame into the ring.
+    /// @param head the position where the frame should be written
+    /// @return the position following the written record
+    /// @note must be called with the publishers lock held
+    unsigned int write(unsigned int head, char const * frame, unsigned int len);
+
+    /// Advance the ring tail to make room up to the specified position.
+    /// @param head the position where the next record is going to be
+    ///		written, which is the new tail if the ring is corrupted
+    /// @param end the position following the next record
+    /// @note must be called with the publishers lock held
+    void reclaim(unsigned int head, unsigned int end);
+
+    /// Make the written records visible and wakeup sleeping readers.
+    /// @param head the new ring head
+    /// @note must be called with the publishers lock held
+    void commit(unsigned int head);
+
+};
+
+} //namespace comsys
+} //namespace controlbox
+#endif
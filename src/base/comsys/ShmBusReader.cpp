@@ -0,0 +1,261 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#include "ShmBusReader.ih"
+
+namespace controlbox {
+namespace comsys {
+
+
+ShmBusReader::ShmBusReader(std::string const & name, bool fromOldest) :
+	d_name(name),
+	d_mapSize(0),
+	d_hdr(0),
+	d_ring(0),
+	d_wait(0),
+	d_cursor(0),
+	d_lost(0),
+	d_seq(0),
+	d_synced(false) {
+	t_shmBusHeader l_hdr;
+	t_shmBusWait * l_wait;
+	struct stat l_stat;
+	void * l_map;
+	int l_fd;
+
+	// NOTE readers write just the wait page
+	l_fd = shm_open((d_name + SHMBUS_WAIT_SUFFIX).c_str(), O_RDWR, 0);
+	if ( l_fd < 0 ) {
+		return;
+	}
+	l_map = mmap(0, getpagesize(), PROT_READ|PROT_WRITE, MAP_SHARED, l_fd, 0);
+	close(l_fd);
+	if ( l_map == MAP_FAILED ) {
+		return;
+	}
+	l_wait = (t_shmBusWait *)l_map;
+
+	l_fd = shm_open(d_name.c_str(), O_RDONLY, 0);
+	if ( l_fd < 0 ) {
+		munmap(l_wait, getpagesize());
+		return;
+	}
+
+	if ( fstat(l_fd, &l_stat) ||
+			(unsigned int)l_stat.st_size < sizeof(t_shmBusHeader) ) {
+		close(l_fd);
+		munmap(l_wait, getpagesize());
+		return;
+	}
+
+	l_map = mmap(0, l_stat.st_size, PROT_READ, MAP_SHARED, l_fd, 0);
+	close(l_fd);
+	if ( l_map == MAP_FAILED ) {
+		munmap(l_wait, getpagesize());
+		return;
+	}
+
+	memcpy(&l_hdr, l_map, sizeof(t_shmBusHeader));
+	if ( l_hdr.magic != SHMBUS_MAGIC || l_hdr.version != SHMBUS_VERSION ||
+			sizeof(t_shmBusHeader) + l_hdr.size > (unsigned int)l_stat.st_size ) {
+		munmap(l_map, l_stat.st_size);
+		munmap(l_wait, getpagesize());
+		return;
+	}
+
+	d_mapSize = l_stat.st_size;
+	d_hdr = (t_shmBusHeader *)l_map;
+	d_ring = (char const *)l_map + sizeof(t_shmBusHeader);
+	d_wait = l_wait;
+
+	d_cursor = fromOldest ? atomicRead(&d_hdr->tail) : atomicRead(&d_hdr->head);
+
+}
+
+ShmBusReader::~ShmBusReader() {
+
+	if ( d_hdr ) {
+		munmap(d_hdr, d_mapSize);
+		munmap(d_wait, getpagesize());
+	}
+
+}
+
+exitCode ShmBusReader::next(char * buf, unsigned int size, unsigned int & len) {
+	t_shmBusRecord l_rec;
+	unsigned int l_mask;
+	unsigned int l_tail;
+	unsigned int l_off;
+
+	if ( !d_hdr ) {
+		return SHM_OPEN_FAILED;
+	}
+
+	l_mask = d_hdr->size-1;
+
+	for (;;) {
+
+		// Skipping records overwritten by the publisher
+		l_tail = atomicRead(&d_hdr->tail);
+		if ( (int)(d_cursor - l_tail) < 0 ) {
+			d_cursor = l_tail;
+		}
+
+		if ( d_cursor == atomicRead(&d_hdr->head) ) {
+			return SHM_NO_DATA;
+		}
+		atomicBarrier();
+
+		l_off = d_cursor & l_mask;
+		l_rec = *(t_shmBusRecord const *)(d_ring+l_off);
+
+		// A bogus length means the record is being overwritten
+		if ( l_rec.len <= size && l_rec.len <= SHMBUS_MAX_FRAME &&
+				l_off+sizeof(t_shmBusRecord)+l_rec.len <= d_hdr->size ) {
+			memcpy(buf, d_ring+l_off+sizeof(t_shmBusRecord), l_rec.len);
+		}
+
+		// Verifying the record has not been overwritten while copying
+		atomicBarrier();
+		if ( (int)(d_cursor - atomicRead(&d_hdr->tail)) < 0 ) {
+			continue;
+		}
+
+		if ( l_rec.len == SHMBUS_WRAP ) {
+			d_cursor += d_hdr->size - l_off;
+			continue;
+		}
+		d_cursor += SHMBUS_ALIGN(sizeof(t_shmBusRecord)+l_rec.len);
+
+		// Accounting records overwritten before we could read them
+		if ( d_synced ) {
+			d_lost += l_rec.seq - d_seq;
+		}
+		d_seq = l_rec.seq+1;
+		d_synced = true;
+
+		len = l_rec.len;
+		if ( len > size ) {
+			return CMD_BUFFER_TOO_SMALL;
+		}
+
+		return OK;
+	}
+
+}
+
+exitCode ShmBusReader::next(CommandView & view) {
+	unsigned int l_len;
+	exitCode result;
+
+	do {
+		result = next(d_frame, SHMBUS_MAX_FRAME, l_len);
+		if ( result == OK ) {
+			result = view.parse(d_frame, l_len);
+		}
+	} while ( result != OK && result != SHM_NO_DATA && result != SHM_OPEN_FAILED );
+
+	return result;
+
+}
+
+exitCode ShmBusReader::wait(unsigned int timeout) {
+	unsigned long long l_deadline;
+	unsigned long long l_now;
+	unsigned long long l_sleep;
+	struct timespec l_timeout;
+	int l_seq;
+
+	if ( !d_hdr ) {
+		return SHM_OPEN_FAILED;
+	}
+
+	l_deadline = Utils::monotonicUsec() + (unsigned long long)timeout*1000;
+
+	while ( d_cursor == atomicRead(&d_hdr->head) ) {
+
+		// Announcing a sleeping reader, then double checking for new
+		// records published before the publisher could notice us.
+		// NOTE wakeups could be spurious: the sequence is bumped after
+		// the head, thus we could be woken up for records already read
+		atomicInc(&d_wait->waiters);
+		l_seq = atomicRead(&d_wait->seq);
+		if ( d_cursor != atomicRead(&d_hdr->head) ) {
+			leave();
+			break;
+		}
+
+		// NOTE a concurrent stale count drop could hide us from the
+		// publisher, thus we never sleep longer than a recheck period
+		l_now = Utils::monotonicUsec();
+		if ( timeout && l_now >= l_deadline ) {
+			leave();
+			break;
+		}
+		l_sleep = SHMBUS_WAIT_RECHECK*1000ULL;
+		if ( timeout && l_deadline-l_now < l_sleep ) {
+			l_sleep = l_deadline-l_now;
+		}
+		l_timeout.tv_sec = l_sleep/1000000;
+		l_timeout.tv_nsec = (l_sleep%1000000)*1000;
+		syscall(SYS_futex, &d_wait->seq, FUTEX_WAIT, l_seq, &l_timeout, 0, 0);
+		leave();
+
+	}
+
+	return (d_cursor != atomicRead(&d_hdr->head)) ? OK : SHM_NO_DATA;
+
+}
+
+void ShmBusReader::leave() {
+	int l_waiters;
+
+	// The publisher drops the count when it finds nobody sleeping,
+	// thus it should never go below zero
+	do {
+		l_waiters = atomicRead(&d_wait->waiters);
+		if ( l_waiters <= 0 ) {
+			return;
+		}
+	} while ( !atomicCAS(&d_wait->waiters, l_waiters, l_waiters-1) );
+
+}
+
+unsigned long ShmBusReader::published() const {
+	return d_hdr ? d_hdr->published : 0;
+}
+
+int ShmBusReader::writerPid() const {
+	return d_hdr ? d_hdr->writerPid : 0;
+}
+
+
+} //namespace comsys
+} //namespace controlbox
@@ -0,0 +1,149 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _SHMBUSREADER_H
+#define _SHMBUSREADER_H
+
+#include <controlbox/base/Utility.h>
+#include <controlbox/base/comsys/ShmBus.h>
+#include <controlbox/base/comsys/CommandView.h>
+
+namespace controlbox {
+namespace comsys {
+
+/// A reader of the shared memory bus.
+/// A ShmBusReader attaches to the bus exported by a ShmBus publisher, from
+/// within any other process, to follow the published Commands. Each reader
+/// tracks its own position into the ring, thus any number of readers could
+/// attach to the same bus without affecting each other.<br>
+/// Reading never requires system calls; a reader waiting for new Commands
+/// sleeps on a futex and it is woken up by the publisher.<br>
+/// Readers lagging behind the publisher by more than the ring size lose
+/// the overwritten Commands: that is accounted but it is not an error,
+/// the reader simply skip to the oldest still available Command.
+/// @see ShmBus
+class ShmBusReader {
+
+//-----[ Members ]--------------------------------------------------------------
+
+protected:
+
+    /// The shared memory object name
+    std::string d_name;
+
+    /// The shared memory mapping size
+    unsigned int d_mapSize;
+
+    /// The mapped bus header
+    t_shmBusHeader * d_hdr;
+
+    /// The mapped ring
+    char const * d_ring;
+
+    /// The mapped wait page
+    t_shmBusWait * d_wait;
+
+    /// The next position to read
+    unsigned int d_cursor;
+
+    /// The number of Commands lost because overwritten
+    unsigned long d_lost;
+
+    /// The sequence number of the next expected record
+    unsigned int d_seq;
+
+    /// Set true once the first record has been read
+    bool d_synced;
+
+    /// The last read frame
+    char d_frame[SHMBUS_MAX_FRAME];
+
+
+//-----[ Methods ]--------------------------------------------------------------
+
+public:
+
+    /// Attach to a shared memory bus.
+    /// @param name the shared memory object name
+    /// @param fromOldest set true to start reading from the oldest Command
+    ///		still available, by default only Commands published after
+    ///		the attach are read
+    ShmBusReader(std::string const & name = SHMBUS_DEFAULT_NAME,
+                 bool fromOldest = false);
+
+    /// Detach from the shared memory bus.
+    ~ShmBusReader();
+
+    /// Return true if the reader has been successfully attached.
+    inline bool isOpen() const {
+        return (d_hdr != 0);
+    };
+
+    /// Read the next Command frame.
+    /// @param buf the buffer where the frame is copied, which should be at
+    ///		least SHMBUS_MAX_FRAME bytes long
+    /// @param size the buffer size
+    /// @param len the frame length
+    /// @return OK on success, SHM_NO_DATA if there are not new Commands,
+    ///		CMD_BUFFER_TOO_SMALL if the frame doesn't fit the buffer
+    ///		(the frame is skipped)
+    exitCode next(char * buf, unsigned int size, unsigned int & len);
+
+    /// Read the next Command.
+    /// The view is valid till the following call.
+    /// @return OK on success, SHM_NO_DATA if there are not new Commands
+    exitCode next(CommandView & view);
+
+    /// Wait for new Commands.
+    /// @param timeout the maximum waiting time [ms], 0 to wait forever
+    /// @return OK if new Commands are available, SHM_NO_DATA on timeout
+    exitCode wait(unsigned int timeout = 0);
+
+    /// Return the number of Commands lost because overwritten.
+    inline unsigned long lost() const {
+        return d_lost;
+    };
+
+    /// Return the number of Commands published so far.
+    unsigned long published() const;
+
+    /// Return the publisher PID.
+    int writerPid() const;
+
+protected:
+
+    /// Withdraw the announce of a sleeping reader.
+    void leave();
+
+};
+
+} //namespace comsys
+} //namespace controlbox
+#endif
@@ -0,0 +1,243 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#include "TaskGenerator.ih"
+
+
+namespace controlbox {
+namespace comsys {
+
+
+TaskGenerator::TaskGenerator(std::string const & logName, int pri) :
+        CommandGenerator(logName, pri),
+        d_stepTimer(0),
+        d_stepping(0),
+        d_dedicated(false) {
+
+	LOG4CPP_DEBUG(log, "TaskGenerator::TaskGenerator(std::string const & logName)");
+
+	d_doExit = false;
+
+}
+
+
+TaskGenerator::TaskGenerator(Dispatcher * dispatcher, bool enabled, std::string const & logName, int pri) :
+        // NOTE the base class must not be enabled: it would start a thread
+        CommandGenerator(dispatcher, false, logName, pri),
+        d_stepTimer(0),
+        d_stepping(0),
+        d_dedicated(false) {
+
+	LOG4CPP_DEBUG(log, "TaskGenerator::TaskGenerator(Dispatcher * dispatcher, bool enabled, std::string const & logName)");
+
+	d_doExit = false;
+
+	if ( enabled ) {
+		enable();
+	}
+
+}
+
+TaskGenerator::~TaskGenerator() {
+
+	stopSteps();
+
+}
+
+exitCode TaskGenerator::enable() {
+
+	LOG4CPP_DEBUG(log, "TaskGenerator::enable()");
+
+	if ( !d_dispatcher ) {
+		LOG4CPP_ERROR(log, "Trying to enable a generator without a linked Dispatcher");
+		return CS_DISPATCH_FAILURE;
+	}
+
+	if ( !d_enabled ) {
+		d_enabled = true;
+		if ( atomicCAS(&d_stepping, 0U, 1U) ) {
+			d_running = true;
+			if ( d_dedicated ) {
+				LOG4CPP_INFO(log, "Starting the Generator steps thread");
+				start();
+			} else {
+				LOG4CPP_INFO(log, "Submitting the Generator steps");
+				Executor::getInstance()->submit(this);
+			}
+		}
+	}
+
+	return OK;
+}
+
+void TaskGenerator::wakeup() {
+	TimerWheel::t_timerId l_timer;
+
+	if ( d_doExit || !d_enabled ) {
+		return;
+	}
+
+	if ( d_dedicated ) {
+		d_stepWakeup.signal();
+		return;
+	}
+
+	if ( atomicCAS(&d_stepping, 0U, 1U) ) {
+		LOG4CPP_DEBUG(log, "Submitting again the Generator steps");
+		d_running = true;
+		Executor::getInstance()->submit(this);
+		return;
+	}
+
+	// NOTE an expiring timer has already submitted the next step: the
+	// timer is anticipated only if still armed
+	l_timer = atomicRead(&d_stepTimer);
+	if ( l_timer ) {
+		TimerWheel::getInstance()->rescheduleIfPending(l_timer, 0);
+	}
+
+}
+
+void TaskGenerator::setDedicated(void) {
+
+	d_dedicated = true;
+
+}
+
+void TaskGenerator::stopSteps() {
+
+	if ( d_doExit ) {
+		return;
+	}
+
+	LOG4CPP_DEBUG(log, "Stopping Generator steps");
+
+	d_doExit = true;
+	atomicBarrier();
+
+	if ( d_dedicated ) {
+		if ( atomicRead(&d_stepping) ) {
+			d_stepWakeup.signal();
+			join();
+		}
+		atomicSet(&d_stepping, 0U);
+		d_running = false;
+		return;
+	}
+
+	// A running step could schedule its next one, while an expiring
+	// timer could submit it again: they will both see d_doExit
+	if ( atomicRead(&d_stepping) ) {
+		Executor::getInstance()->cancel(this);
+	}
+	if ( d_stepTimer ) {
+		TimerWheel::getInstance()->cancel(d_stepTimer);
+		atomicSet(&d_stepTimer, (TimerWheel::t_timerId)0);
+	}
+	if ( atomicRead(&d_stepping) ) {
+		Executor::getInstance()->cancel(this);
+	}
+
+	atomicSet(&d_stepping, 0U);
+	d_running = false;
+
+}
+
+void TaskGenerator::execute() {
+	timeout_t l_delay;
+
+	if ( d_doExit ) {
+		return;
+	}
+
+	l_delay = step();
+
+	if ( l_delay == TASKGENERATOR_STOP ) {
+		LOG4CPP_INFO(log, "Generator steps completed");
+		d_running = false;
+		atomicSet(&d_stepping, 0U);
+		return;
+	}
+
+	if ( d_doExit ) {
+		return;
+	}
+
+	if ( !l_delay ) {
+		Executor::getInstance()->submit(this);
+		return;
+	}
+
+	if ( d_stepTimer ) {
+		TimerWheel::getInstance()->reschedule(d_stepTimer, l_delay);
+	} else {
+		atomicSet(&d_stepTimer, TimerWheel::getInstance()->schedule(this, l_delay));
+	}
+
+}
+
+void TaskGenerator::timerExpired(unsigned int timer) {
+
+	if ( !d_doExit ) {
+		Executor::getInstance()->submit(this);
+	}
+
+}
+
+void TaskGenerator::run(void) {
+	timeout_t l_delay;
+
+	threadStartNotify("TASK");
+
+	while ( !d_doExit ) {
+
+		l_delay = step();
+		if ( d_doExit ) {
+			break;
+		}
+
+		// Wakeups received while the step was running are not lost
+		if ( l_delay == TASKGENERATOR_STOP ) {
+			LOG4CPP_INFO(log, "Generator steps completed");
+			d_stepWakeup.wait();
+		} else if ( l_delay ) {
+			d_stepWakeup.wait(l_delay);
+		}
+		d_stepWakeup.reset();
+
+	}
+
+	threadStopNotify();
+
+}
+
+
+} //namespace comsys
+} //namespace controlbox
@@ -0,0 +1,137 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _TASKGENERATOR_H
+#define _TASKGENERATOR_H
+
+
+#include <controlbox/base/Utility.h>
+#include <controlbox/base/Executor.h>
+#include <controlbox/base/TimerWheel.h>
+#include <controlbox/base/comsys/CommandGenerator.h>
+#include <string>
+
+/// The step() return value to stop a TaskGenerator
+#define TASKGENERATOR_STOP	((timeout_t)~0)
+
+
+namespace controlbox {
+namespace comsys {
+
+/// A CommandGenerator running as a task of the shared Executor.
+/// This is the migration adapter for Generators whose logic is an endless
+/// run() loop: the body of the loop is moved into step(), which returns
+/// the milliseconds to wait before the next step. Once enabled, steps are
+/// run by the Executor workers and delayed using the TimerWheel: no
+/// dedicated thread is required.<br>
+/// Steps which could block for long (e.g. serial transfers) would hold an
+/// Executor worker meanwhile: such Generators should call setDedicated()
+/// to run their steps on a dedicated thread instead.
+/// @note subclasses must call stopSteps() at the beginning of their
+///	destructor, before any member used by step() is released.
+class TaskGenerator : public CommandGenerator, public Task, public TimerHandler {
+
+protected:
+
+    /// The timer delaying the next step, 0 if not yet scheduled
+    volatile TimerWheel::t_timerId d_stepTimer;
+
+    /// 1 while steps are submitted, or scheduled, 0 once they terminate.
+    /// Switched only by CAS: steps are never submitted twice.
+    volatile unsigned int d_stepping;
+
+    /// Set true to run the steps on a dedicated thread
+    bool d_dedicated;
+
+    /// Wakeup the dedicated thread waiting for its next step
+    ost::Event d_stepWakeup;
+
+public:
+
+    /// Create a new TaskGenerator initially disabled.
+    /// @param logName the log category, this name is prepended by the
+    ///		class namespace "controlbox.comlibs."
+    TaskGenerator(std::string const & logName = "TaskGenerator", int pri = 0);
+
+    /// Create a new TaskGenerator associated to the specified Dispatcher
+    /// @param dispatcher the dispatcher to with send events notifications
+    /// @param enabled set false if the generator has to be initially disabled (default true)
+    /// @param logName the log category, this name is prepended by the
+    ///		class namespace "controlbox.comlibs."
+    TaskGenerator(Dispatcher * dispatcher, bool enabled = true, std::string const & logName = "TaskGenerator", int pri = 0);
+
+    /// Class destructor
+    ~TaskGenerator();
+
+    /// Enable the notification of generated events.
+    /// The first call to this method submit the first step to the Executor,
+    /// or starts the dedicated thread.
+    /// @return OK on success, CS_DISPATCH_FAILURE if a Dispatcher is not defined
+    exitCode enable();
+
+protected:
+
+    /// Run a step of the Generator logic.
+    /// @return the milliseconds to wait before the next step,
+    ///		TASKGENERATOR_STOP to terminate
+    virtual timeout_t step() = 0;
+
+    /// Anticipate the next step.
+    /// If the Generator is waiting for its next step, that step is run as
+    /// soon as possible; if steps have been terminated by a
+    /// TASKGENERATOR_STOP they are submitted again.
+    /// A step already running is not affected, but on a dedicated thread
+    /// the step following it is run immediately.
+    void wakeup();
+
+    /// Run the steps on a dedicated thread instead of the Executor.
+    /// This must be called before enable().
+    void setDedicated(void);
+
+    /// Stop running steps.
+    /// Once returned step() is not running and it will not be called anymore.
+    void stopSteps();
+
+    /// Run a step and schedule the next one
+    void execute();
+
+    /// Submit the next step once its delay expire
+    void timerExpired(unsigned int timer);
+
+    /// Run the steps on the dedicated thread.
+    /// Terminated steps wait for a wakeup() to start again.
+    void run(void);
+
+};
+
+
+} //namespace comsys
+} //namespace controlbox
+#endif
@@ -0,0 +1,107 @@
+//***************************************************************************************
+//*************  Copyright (C) 2006 - Patrick Bellasi ***********************************
+//***************************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//***************************************************************************************
+//******************** Module information ***********************************************
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   ModuleDescription
+//**
+//** Filename:      Filename
+//** Owner:         Patrick Bellasi
+//** Creation date:  21/06/2006
+//**
+//***************************************************************************************
+//******************** Revision history *************************************************
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------------------------- -----------------------------
+//**
+//**
+//***************************************************************************************
+
+
+
+#ifndef _TYPEDCOMMAND_H
+#define _TYPEDCOMMAND_H
+
+#include <controlbox/base/comsys/Command.h>
+
+namespace controlbox {
+namespace comsys {
+
+/// Type checked access to Commands carrying a typed payload.
+/// A typed payload is a plain struct carried by a Command in place of (or
+/// along with) its params: Generators fill the struct fields and Handlers
+/// read them back directly, without params lookups, string conversions or
+/// UnknowedParamException handling on the hot path.<br>
+/// The payload type T must be a POD struct which defines:
+/// <ul>
+///	<li><i>PAYLOAD_TYPE</i>: an enum value identifying the payload,
+///		unique among all payloads and not null</li>
+///	<li><i>static void exportParams(T const & payload, Command & command)</i>:
+///		set the params equivalent to the payload, used to serve
+///		legacy Handlers using the params API and xmlDump()</li>
+/// </ul>
+/// Payloads bigger than COMMAND_PAYLOAD_SIZE are rejected at compile time.
+/// @see Command::setPayload
+template <typename T>
+class TypedCommand {
+
+public:
+
+    /// Build a new Command carrying the specified payload.
+    /// @param cmdType the command type
+    /// @param devType the device class to witch the Command is adressed
+    /// @param devId the device identifier within the device class
+    /// @param payload the payload to copy into the Command
+    /// @param logName the log category of the Command
+    /// @see Command::getCommand
+    static Command * getCommand(Command::t_cmdType const & cmdType,
+                                Device::t_deviceType devType,
+                                Device::t_deviceId devId,
+                                T const & payload,
+                                std::string const & logName = "Generic") {
+        Command * l_command;
+
+        l_command = Command::getCommand(cmdType, devType, devId, logName);
+        setPayload(l_command, payload);
+
+        return l_command;
+    };
+
+    /// Set the payload of a Command.
+    static void setPayload(Command * command, T const & payload) {
+        // Payloads must fit into the Command storage
+        (void)sizeof(StaticAssert<(sizeof(T) <= COMMAND_PAYLOAD_SIZE)>);
+
+        command->setPayload(T::PAYLOAD_TYPE, &payload, sizeof(T), &exporter);
+    };
+
+    /// Return the payload carried by a Command.
+    /// @return the payload, or 0 if the Command doesn't carry a T payload
+    static inline T * payload(Command * command) {
+        if ( command->payloadType() != T::PAYLOAD_TYPE ) {
+            return 0;
+        }
+        return static_cast<T *>(command->payload());
+    };
+
+protected:
+
+    /// Export a T payload into params.
+    static void exporter(void const * payload, Command & command) {
+        T::exportParams(*static_cast<T const *>(payload), command);
+    };
+
+};
+
+} //namespace comsys
+} //namespace controlbox
+#endif
@@ -51,6 +51,8 @@
 #include "controlbox/base/Utility.h"
 #include "controlbox/base/QueryRegistry.h"
 #include "controlbox/base/ThreadDB.h"
+#include "controlbox/base/Executor.h"
+#include "controlbox/base/AsyncAppender.h"
 #include "controlbox/devices/DeviceFactory.h"
 
 #include "controlbox/devices/DeviceTime.h"
@@ -64,15 +66,47 @@
 #include "controlbox/devices/wsproxy/WSProxyCommandHandler.h"
 
 #include "controlbox/base/comsys/CommandDispatcher.h"
+#include "controlbox/base/comsys/AsyncCommandDispatcher.h"
+#include "controlbox/base/comsys/MultipleDispatcher.h"
+#include "controlbox/base/comsys/CommandPool.h"
+#include "controlbox/base/comsys/CommandJournal.h"
+#include "controlbox/base/comsys/ShmBus.h"
+#include "controlbox/devices/FileWriterCommandHandler.h"
 // #include "controlbox/devices/ATcontrol.h"
 
 
 
 #define GCC_SPLIT_BLOCK __asm__ ("");
 
+/// The number of commands that could be queued by the asynchronous dispatcher
+#define CBOX_DEFAULT_DISPATCHER_QUEUESIZE	"64"
+
+/// The policy coalescing bursts of sensors commands
+#define CBOX_DEFAULT_DISPATCHER_COALESCE	"none"
+
+/// The coalescing policy parameter: the debounce window [ms] or the
+/// number of commands to keep for each sensor line
+#define CBOX_DEFAULT_DISPATCHER_COALESCEPARAM	"500"
+
+/// The size of the shared memory ring exporting dispatched commands [bytes]
+#define CBOX_DEFAULT_BUS_SIZE			"65536"
+
+/// The number of released commands kept for recycling
+#define CBOX_DEFAULT_COMMANDPOOL_SIZE	"128"
+
+/// The number of worker threads running device tasks
+#define CBOX_DEFAULT_EXECUTOR_WORKERS	"2"
+
+/// The time a thread could be busy before being reported as stalled [ms]
+#define CBOX_DEFAULT_STALL_BUDGET	"10000"
+
+/// The number of log records buffered by each thread, 0 to log synchronously
+#define CBOX_DEFAULT_LOGGER_RINGSIZE	"128"
+
 log4cpp::Category & logger = log4cpp::Category::getInstance("controlbox");
 
 controlbox::ThreadDB * dbThread = 0;
+controlbox::AsyncLogger * asyncLogger = 0;
 controlbox::QueryRegistry * qr = 0;
 
 controlbox::device::DeviceFactory * df = 0;
@@ -88,7 +122,13 @@ controlbox::device::DeviceTE * devTE = 0;
 
 controlbox::device::WSProxyCommandHandler * uploader = 0;
 
-controlbox::comsys::CommandDispatcher * cd;
+controlbox::device::FileWriterCommandHandler * cmdWriter = 0;
+
+controlbox::comsys::Dispatcher * cd;
+
+controlbox::comsys::CommandJournal * journal = 0;
+
+controlbox::comsys::ShmBus * bus = 0;
 
 bool useColors = true;
 
@@ -105,12 +145,71 @@ int setupQueues(void) {
 	return 0;
 }
 
-int setupDevices(void) {
+int setupDevices(std::string const & cmdlog) {
+	controlbox::Configurator & config = controlbox::Configurator::getInstance();
+	controlbox::comsys::MultipleDispatcher * md;
+	controlbox::comsys::CommandDispatcher * scd;
+	controlbox::comsys::EventDispatcher::t_coalescePolicy coalesce;
+	unsigned int coalesceParam;
+	std::string journalPath;
+	std::string busName;
+	unsigned int queueSize;
 
 	logger.info("Setting up devices");
 
 	df = controlbox::device::DeviceFactory::getInstance();
-	cd = new controlbox::comsys::CommandDispatcher(uploader, false);
+
+	queueSize = config.paramInt("CommandDispatcher_queueSize",
+				CBOX_DEFAULT_DISPATCHER_QUEUESIZE);
+
+	// Recording dispatched commands for bench replay
+	journalPath = config.param("CommandDispatcher_journal", "");
+	if ( journalPath.size() ) {
+		logger.info("Recording commands journal [%s]", journalPath.c_str());
+		journal = new controlbox::comsys::CommandJournal(journalPath);
+	}
+
+	// Exporting dispatched commands to external processes
+	busName = config.param("CommandDispatcher_bus", "");
+	if ( busName.size() ) {
+		logger.info("Publishing commands on bus [%s]", busName.c_str());
+		bus = new controlbox::comsys::ShmBus(busName,
+				config.paramInt("CommandDispatcher_busSize",
+					CBOX_DEFAULT_BUS_SIZE));
+	}
+
+	// Coalescing bursts of sensors commands (e.g. flapping digital inputs)
+	if ( controlbox::comsys::EventDispatcher::parseCoalescing(
+			config.param("CommandDispatcher_coalesce",
+				CBOX_DEFAULT_DISPATCHER_COALESCE), coalesce) != controlbox::OK ) {
+		logger.warn("Unknown commands coalescing policy, coalescing disabled");
+		coalesce = controlbox::comsys::EventDispatcher::COALESCE_NONE;
+	}
+	coalesceParam = config.paramInt("CommandDispatcher_coalesceParam",
+				CBOX_DEFAULT_DISPATCHER_COALESCEPARAM);
+
+	if ( config.paramBool("CommandDispatcher_cmdlog", "no") ) {
+		logger.info("Dumping commands to [%s]", cmdlog.c_str());
+		cmdWriter = new controlbox::device::FileWriterCommandHandler(cmdlog);
+		md = new controlbox::comsys::MultipleDispatcher();
+		md->addHandler(uploader, queueSize);
+		md->addHandler(cmdWriter, queueSize);
+		md->setJournal(journal);
+		md->setBus(bus);
+		md->setCoalescing(coalesce, coalesceParam);
+		cd = md;
+	} else {
+		if ( config.paramBool("CommandDispatcher_async", "no") ) {
+			logger.info("Using asynchronous command dispatching");
+			scd = new controlbox::comsys::AsyncCommandDispatcher(uploader, false, queueSize);
+		} else {
+			scd = new controlbox::comsys::CommandDispatcher(uploader, false);
+		}
+		scd->setJournal(journal);
+		scd->setBus(bus);
+		scd->setCoalescing(coalesce, coalesceParam);
+		cd = scd;
+	}
 
 	devTime = df->getDeviceTime("DeviceTime");
 	devTime->setDispatcher(cd, true);
@@ -154,16 +253,73 @@ void shandler(int sig) {
 
 }
 
+int cBoxCompile(std::string const & conf) {
+	controlbox::Configurator & config(controlbox::Configurator::getInstance(conf));
+	bool valid = true;
+
+	logger.info("Compiling configuration [%s]", conf.c_str());
+
+	// The per-device sections are checked just like the devices would
+	// load them, without accessing any hardware
+	if ( controlbox::device::DeviceAnalogSensors::checkConfiguration(config, logger) != controlbox::OK ) {
+		logger.error("Invalid Analog Sensors configuration");
+		valid = false;
+	}
+	if ( controlbox::device::DeviceGPRS::checkConfiguration(config, logger) != controlbox::OK ) {
+		logger.error("Invalid GPRS netlinks configuration");
+		valid = false;
+	}
+	if ( controlbox::device::WSProxyCommandHandler::checkConfiguration(config, logger) != controlbox::OK ) {
+		logger.error("Invalid EndPoints configuration");
+		valid = false;
+	}
+	if ( !valid ) {
+		logger.error("Configuration compilation FAILED");
+		return EXIT_FAILURE;
+	}
+
+	if ( config.compile() != controlbox::OK ) {
+		logger.error("Configuration compilation FAILED");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+
+}
+
 int cBoxMain(std::string const & conf,
 		std::string const & cmdlog) {
 	sigset_t mask;
 	struct sigaction act;
+	long l_ringSize;
+	long l_workers;
 
 	// Ensuring there are not running PPPD deamons that lock modems TTY's ports
 	system("killall pppd");
 
 	// Preloading the configuration options
-	controlbox::Configurator::getInstance(conf);
+	controlbox::Configurator & config = controlbox::Configurator::getInstance(conf);
+
+	// Moving the logging I/O out of the devices threads
+	l_ringSize = config.paramInt("AsyncLogger_ringSize",
+				CBOX_DEFAULT_LOGGER_RINGSIZE);
+	if ( l_ringSize > 0 ) {
+		asyncLogger = controlbox::AsyncLogger::getInstance(l_ringSize);
+	}
+
+	// Building the Commands pool before any Generator could be started
+	controlbox::comsys::CommandPool::getInstance(config.paramInt("CommandPool_size",
+				CBOX_DEFAULT_COMMANDPOOL_SIZE));
+
+	// Building the tasks Executor before any device could submit a task
+	l_workers = config.paramInt("Executor_workers",
+				CBOX_DEFAULT_EXECUTOR_WORKERS);
+	if ( l_workers < 1 || l_workers > EXECUTOR_MAX_WORKERS ) {
+		logger.warn("Invalid Executor_workers [%ld], using [%d]",
+				l_workers, EXECUTOR_DEFAULT_WORKERS);
+		l_workers = EXECUTOR_DEFAULT_WORKERS;
+	}
+	controlbox::Executor::getInstance(l_workers);
 
 	qr = controlbox::QueryRegistry::getInstance();
 	df = controlbox::device::DeviceFactory::getInstance();
@@ -171,7 +327,7 @@ int cBoxMain(std::string const & conf,
 
 	setupQueues();
 
-	setupDevices();
+	setupDevices(cmdlog);
 
 	startUpload();
 
@@ -195,7 +351,12 @@ int cBoxMain(std::string const & conf,
 	}
 
 	// Starting thread monitor
-	dbThread->start();
+	dbThread->startMonitor(THREADDB_MONITOR_PERIOD,
+			config.paramInt("ThreadDB_stallBudget",
+				CBOX_DEFAULT_STALL_BUDGET));
+
+	// Reloading the configuration on changes
+	config.watch();
 
 	// Suspending and waiting for system suthdown...
 	sigsuspend(&mask);
@@ -216,14 +377,26 @@ int cBoxMain(std::string const & conf,
 	// FIXME this should be a blocking call?!?
 	uploader->onShutdown();
 
+	// Persisting params updated at run-time
+	config.syncToFile();
+
 	delete devGPRS;
 
+	if ( journal ) {
+		journal->flush();
+	}
+
 // FIXME the following devices have some problems on deleting them
 // 	delete devAS;
 // 	delete devATGPS;
 // 	delete devSig;
 // 	delete uploader;
 
+	// Writing buffered log records before log4cpp shutdown
+	if ( asyncLogger ) {
+		asyncLogger->shutdown();
+	}
+
 	return EXIT_SUCCESS;
 
 }
@@ -241,6 +414,7 @@ void print_usage(char * progname) {
 	cout << "\t -l, --loggeer              Logger configuration filepath" << endl;
 	cout << "\t -v, --verbose              Enable verbose output" << endl;
 	cout << "\t -y, --nocolors             Disable colors on output" << endl;
+	cout << "\t -C, --compile-config       Compile the configuration file and exit" << endl;
 	cout << "\t -h, --help                 Print this help" << endl;
 
 	cout << "\nby Patrick Bellasi - derkling@gmail.com\n" << endl;
@@ -255,15 +429,17 @@ int main (int argc, char *argv[]) {
 	static struct option long_options[] = {
 			{"configuration", required_argument, 0, 'c'},
 			{"cmdlog", required_argument, 0, 'd'},
+			{"compile-config", no_argument, 0, 'C'},
 			{"help", no_argument, 0, 'h'},
 			{"logconf", required_argument, 0, 'l'},
 			{"verbose", no_argument, 0, 'v'},
 			{"nocolors", no_argument, 0, 'y'},
 			{0, 0, 0, 0}
 		};
-	static const char * optstring = "c:d:hl:vy";
+	static const char * optstring = "c:Cd:hl:vy";
 	int c;
 	bool silent = true;
+	bool compileConfig = false;
 
 	// cBox configuration
 	std::string cboxConfiguration = "/etc/cbox/cbox.conf";
@@ -317,6 +493,9 @@ int main (int argc, char *argv[]) {
 					return EXIT_FAILURE;
 				}
 				break;
+			case 'C':
+				compileConfig = true;
+				break;
 			case 'h':
 				print_usage(argv[0]);
 				return EXIT_SUCCESS;
@@ -351,6 +530,13 @@ int main (int argc, char *argv[]) {
 	}
 
 	std::cout << "Using system configuration: " << cboxConfiguration << endl;
+
+	if ( compileConfig ) {
+		c = cBoxCompile(cboxConfiguration);
+		log4cpp::Category::shutdown();
+		return c;
+	}
+
 	std::cout << "Command dump: " << cmdLogfile << endl << endl;
 	cBoxMain(cboxConfiguration, cmdLogfile);
 
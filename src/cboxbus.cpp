@@ -0,0 +1,186 @@
+//******************************************************************************
+//**             Copyright (C) 2006 by Patrick Bellasi                        **
+//******************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//******************************************************************************
+//**                   Module information                                     **
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   Main program
+//**
+//** Filename:      cBox
+//** Owner:         Patrick Bellasi
+//** Creation date:  01/08/2007
+//**
+//**
+//******************************************************************************
+//**                   Revision history                                       **
+//**
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------- --------------------
+//**
+//**
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include <iostream>
+
+#include "controlbox/base/Utility.h"
+#include "controlbox/base/comsys/CommandView.h"
+#include "controlbox/base/comsys/ShmBusReader.h"
+
+using namespace std;
+
+
+/// Print the Help menu
+void print_usage(char * progname) {
+
+	cout << "cBox bus reader ver. " << PACKAGE_VERSION << " (";
+	cout << "Build: " << __DATE__ << " " << __TIME__ << ")" << endl;
+	cout << "\tUsage: " << progname << " [options]" << endl;
+	cout << "\tOptions:" << endl;
+	cout << "\t -n, --name                 Bus name (default " << SHMBUS_DEFAULT_NAME << ")" << endl;
+	cout << "\t -o, --oldest               Start from the oldest available Command" << endl;
+	cout << "\t -c, --count                Exit after the specified number of Commands" << endl;
+	cout << "\t -s, --stats                Print only throughput statistics, every second" << endl;
+	cout << "\t -h, --help                 Print this help" << endl;
+
+	cout << "\nby Patrick Bellasi - derkling@gmail.com\n" << endl;
+
+}
+
+/// Print a one line summary of a Command
+void print_command(controlbox::comsys::CommandView const & view) {
+	controlbox::comsys::CommandView::t_paramView l_param;
+	unsigned int l_cursor = view.firstParam();
+
+	cout << "[" << view.device() << ":" << view.deviceId() << "] type=0x"
+		<< hex << view.type() << dec << " prio=" << view.getPrio();
+
+	while ( view.nextParam(l_cursor, l_param) ) {
+		cout << " " << string(l_param.lable, l_param.lableLen) << "=";
+		switch ( l_param.type ) {
+		case controlbox::comsys::CommandView::VT_INT:
+			cout << l_param.i;
+			break;
+		case controlbox::comsys::CommandView::VT_FLOAT:
+			cout << l_param.d;
+			break;
+		case controlbox::comsys::CommandView::VT_STRING:
+			cout << "'" << string(l_param.str, l_param.strLen) << "'";
+			break;
+		}
+	}
+
+	cout << endl;
+
+}
+
+int main (int argc, char *argv[]) {
+	static struct option long_options[] = {
+			{"name", required_argument, 0, 'n'},
+			{"oldest", no_argument, 0, 'o'},
+			{"count", required_argument, 0, 'c'},
+			{"stats", no_argument, 0, 's'},
+			{"help", no_argument, 0, 'h'},
+			{0, 0, 0, 0}
+		};
+	static const char * optstring = "n:oc:sh";
+	int option_index;
+	int c;
+
+	std::string name = SHMBUS_DEFAULT_NAME;
+	bool fromOldest = false;
+	unsigned long count = 0;
+	bool statsOnly = false;
+
+	controlbox::comsys::ShmBusReader * reader;
+	controlbox::comsys::CommandView view;
+	unsigned long long lastReport;
+	unsigned long long now;
+	unsigned long received = 0;
+	unsigned long lastReceived = 0;
+
+	while (1) {
+		option_index = 0;
+
+		c = getopt_long (argc, argv, optstring, long_options, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+			case 'n':
+				name = optarg;
+				break;
+			case 'o':
+				fromOldest = true;
+				break;
+			case 'c':
+				count = atol(optarg);
+				break;
+			case 's':
+				statsOnly = true;
+				break;
+			case 'h':
+				print_usage(argv[0]);
+				return EXIT_SUCCESS;
+			default:
+				print_usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	reader = new controlbox::comsys::ShmBusReader(name, fromOldest);
+	if ( !reader->isOpen() ) {
+		cout << "Unable to attach bus [" << name << "]" << endl;
+		delete reader;
+		return EXIT_FAILURE;
+	}
+
+	cerr << "Attached bus [" << name << "] published by PID "
+		<< reader->writerPid() << endl;
+
+	lastReport = controlbox::Utils::monotonicUsec();
+	while ( !count || received < count ) {
+
+		if ( reader->next(view) == controlbox::OK ) {
+			received++;
+			if ( !statsOnly ) {
+				print_command(view);
+			}
+		} else {
+			// Waking up at least once a second to report statistics
+			reader->wait(1000);
+		}
+
+		if ( !statsOnly ) {
+			continue;
+		}
+
+		now = controlbox::Utils::monotonicUsec();
+		if ( now - lastReport >= 1000000 ) {
+			cout << "received " << received << " (+"
+				<< (received-lastReceived)*1000000/(now-lastReport)
+				<< "/s), lost " << reader->lost() << endl;
+			lastReport = now;
+			lastReceived = received;
+		}
+	}
+
+	cerr << "Received " << received << " Commands, lost " << reader->lost() << endl;
+
+	delete reader;
+
+	return EXIT_SUCCESS;
+
+}
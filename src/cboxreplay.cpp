@@ -0,0 +1,222 @@
+//******************************************************************************
+//**             Copyright (C) 2006 by Patrick Bellasi                        **
+//******************************************************************************
+//**
+//** The copyright to the computer programs here in is the property of
+//** Patrick Bellasi. The programs may be used and/or copied only with the
+//** written permission from the author or in accordance with the terms and
+//** conditions stipulated in the agreement/contract under which the
+//** programs have been supplied.
+//**
+//******************************************************************************
+//**                   Module information                                     **
+//**
+//** Project:       ControlBox (0.1)
+//** Description:   Main program
+//**
+//** Filename:      cBox
+//** Owner:         Patrick Bellasi
+//** Creation date:  01/08/2007
+//**
+//**
+//******************************************************************************
+//**                   Revision history                                       **
+//**
+//** Revision Date       Comments                           Responsible
+//** -------- ---------- ---------------------------------- --------------------
+//**
+//**
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include <iostream>
+
+#include <log4cpp/PropertyConfigurator.hh>
+#include <log4cpp/Category.hh>
+#include <log4cpp/Priority.hh>
+
+#include "controlbox/base/Utility.h"
+#include "controlbox/base/Configurator.h"
+#include "controlbox/base/comsys/CommandPool.h"
+#include "controlbox/base/comsys/CommandJournal.h"
+#include "controlbox/base/comsys/CommandReplayer.h"
+#include "controlbox/devices/DeviceFactory.h"
+#include "controlbox/devices/wsproxy/WSProxyCommandHandler.h"
+#include "controlbox/devices/FileWriterCommandHandler.h"
+
+
+log4cpp::Category & logger = log4cpp::Category::getInstance("controlbox");
+
+/// A target that simply drops replayed Commands.
+/// Used to measure the replay (and dispatching) overhead alone.
+class NullCommandHandler : public controlbox::comsys::CommandHandler {
+public:
+	NullCommandHandler() :
+		controlbox::comsys::CommandHandler("NullHandler") {};
+	controlbox::exitCode notify() {
+		return controlbox::OK;
+	};
+	controlbox::exitCode notify(controlbox::comsys::Command * command)
+	throw (controlbox::exceptions::IllegalCommandException) {
+		return controlbox::OK;
+	};
+};
+
+
+/// Print the Help menu
+void print_usage(char * progname) {
+
+	cout << "cBox journal replay ver. " << PACKAGE_VERSION << " (";
+	cout << "Build: " << __DATE__ << " " << __TIME__ << ")" << endl;
+	cout << "\tUsage: " << progname << " [options] <journal>" << endl;
+	cout << "\tOptions:" << endl;
+	cout << "\t -c, --configuration        Configuration file" << endl;
+	cout << "\t -l, --logconf              Logger configuration filepath" << endl;
+	cout << "\t -t, --target               Replay target: wsproxy (default), null, or a file path" << endl;
+	cout << "\t -s, --speed                Speedup factor, 0 for maximum speed (default 1)" << endl;
+	cout << "\t -q, --queue                Asynchronous dispatching queue size (default synchronous)" << endl;
+	cout << "\t -i, --interval             Queue depth sampling interval [ms] (default 1000)" << endl;
+	cout << "\t -u, --upload               Start the WSProxy upload thread" << endl;
+	cout << "\t -h, --help                 Print this help" << endl;
+
+	cout << "\nby Patrick Bellasi - derkling@gmail.com\n" << endl;
+
+}
+
+int main (int argc, char *argv[]) {
+	static struct option long_options[] = {
+			{"configuration", required_argument, 0, 'c'},
+			{"logconf", required_argument, 0, 'l'},
+			{"target", required_argument, 0, 't'},
+			{"speed", required_argument, 0, 's'},
+			{"queue", required_argument, 0, 'q'},
+			{"interval", required_argument, 0, 'i'},
+			{"upload", no_argument, 0, 'u'},
+			{"help", no_argument, 0, 'h'},
+			{0, 0, 0, 0}
+		};
+	static const char * optstring = "c:l:t:s:q:i:uh";
+	int option_index;
+	int c;
+
+	std::string cboxConfiguration = "/etc/cbox/cbox.conf";
+	std::string loggerConfiguration = "/etc/cbox/cbox.conf";
+	std::string target = "wsproxy";
+	double speed = 1.0;
+	unsigned int queueSize = 0;
+	unsigned int interval = COMMANDREPLAYER_SAMPLE_MS;
+	bool upload = false;
+
+	controlbox::comsys::Handler * handler = 0;
+	controlbox::device::WSProxyCommandHandler * uploader = 0;
+	controlbox::comsys::CommandJournal * journal;
+	controlbox::comsys::CommandReplayer * replayer;
+	controlbox::exitCode result;
+
+	while (1) {
+		option_index = 0;
+
+		c = getopt_long (argc, argv, optstring, long_options, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+			case 'c':
+				cboxConfiguration = optarg;
+				break;
+			case 'l':
+				loggerConfiguration = optarg;
+				break;
+			case 't':
+				target = optarg;
+				break;
+			case 's':
+				speed = atof(optarg);
+				break;
+			case 'q':
+				queueSize = atoi(optarg);
+				break;
+			case 'i':
+				interval = atoi(optarg);
+				break;
+			case 'u':
+				upload = true;
+				break;
+			case 'h':
+				print_usage(argv[0]);
+				return EXIT_SUCCESS;
+			default:
+				print_usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if ( optind >= argc ) {
+		cout << "Missing journal to replay!" << endl;
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	try {
+		log4cpp::PropertyConfigurator::configure(loggerConfiguration);
+	} catch(log4cpp::ConfigureFailure& f) {
+		std::cout << "Configuration problem " << f.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	controlbox::Configurator::getInstance(cboxConfiguration);
+	controlbox::comsys::CommandPool::getInstance();
+
+	journal = new controlbox::comsys::CommandJournal(argv[optind],
+			controlbox::comsys::CommandJournal::JOURNAL_READ);
+	if ( !journal->isOpen() ) {
+		cout << "Unable to open journal [" << argv[optind] << "]" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if ( target == "wsproxy" ) {
+		uploader = controlbox::device::DeviceFactory::getInstance()->getWSProxy();
+		if ( !uploader ) {
+			cout << "Proxy initialization FAILED" << endl;
+			return EXIT_FAILURE;
+		}
+		if ( upload ) {
+			uploader->startUpload();
+		}
+		handler = uploader;
+	} else if ( target == "null" ) {
+		handler = new NullCommandHandler();
+	} else {
+		handler = new controlbox::device::FileWriterCommandHandler(target, "ReplayWriter", false);
+	}
+
+	cout << "Replaying [" << argv[optind] << "] into [" << target << "] at ";
+	if ( speed > 0 ) {
+		cout << speed << "x";
+	} else {
+		cout << "maximum speed";
+	}
+	cout << endl << endl;
+
+	replayer = new controlbox::comsys::CommandReplayer(handler, queueSize);
+	result = replayer->replay(*journal, speed, interval);
+	replayer->report(cout);
+
+	delete replayer;
+	delete journal;
+	if ( !uploader ) {
+		delete handler;
+	} else {
+		uploader->onShutdown();
+	}
+
+	log4cpp::Category::shutdown();
+
+	return (result == controlbox::OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
+
@@ -48,6 +48,8 @@
 #include "controlbox/devices/PollEventGenerator.h"
 #include "controlbox/devices/FileWriterCommandHandler.h"
 #include "controlbox/base/comsys/Command.h"
+#include "controlbox/base/comsys/CommandView.h"
+#include "controlbox/base/comsys/RateLimiter.h"
 #include "controlbox/base/DeviceDB.h"
 #include "controlbox/devices/DeviceFactory.h"
 
@@ -63,6 +65,7 @@
 #include "controlbox/devices/wsproxy/WSProxyCommandHandler.h"
 
 #include "controlbox/base/QueryRegistry.h"
+#include "controlbox/base/AsyncAppender.h"
 #include "controlbox/devices/ATcontrol.h"
 
 #include <stdio.h>
@@ -71,6 +74,7 @@
 #include <fstream>
 #include <getopt.h>
 #include <iomanip>
+#include <cstring>
 
 #define GCC_SPLIT_BLOCK __asm__ ("");
 
@@ -80,9 +84,13 @@ void print_usage(char * progname);
 int test_loglibs(log4cpp::Category & logger);
 int test_comlibs(log4cpp::Category & logger);
 int test_utils(log4cpp::Category & logger);
+int test_config(log4cpp::Category & logger);
+int test_asynclog(log4cpp::Category & logger);
+int test_ratelimit(log4cpp::Category & logger);
 int test_threads(log4cpp::Category & logger);
 int test_devicedb(log4cpp::Category & logger);
 int test_command(log4cpp::Category & logger);
+int test_codec(log4cpp::Category & logger);
 int test_wsproxy(log4cpp::Category & logger);
 // int test_nmeaparser(log4cpp::Category & logger);
 int test_devicegprs(log4cpp::Category & logger);
@@ -115,6 +123,7 @@ int main (int argc, char *argv[]) {
 			{"comlibstest", no_argument, 0, 'l'},
 			{"devdbtest", no_argument, 0, 'e'},
 			{"commandtest", no_argument, 0, 'd'},
+			{"codectest", no_argument, 0, 'k'},
 			{"wsproxytest", no_argument, 0, 'w'},
 			{"threads", no_argument, 0, 'm'},
 			{"gprstest", no_argument, 0, 'n'},
@@ -125,10 +134,13 @@ int main (int argc, char *argv[]) {
 			{"tetest", no_argument, 0, 'i'},
 			{"attest", no_argument, 0, 't'},
 			{"utilstest", no_argument, 0, 'u'},
+			{"configtest", no_argument, 0, 'f'},
+			{"asynclogtest", no_argument, 0, 'A'},
+			{"ratelimittest", no_argument, 0, 'R'},
 			{"nocolors", no_argument, 0, 'y'},
 			{0, 0, 0, 0}
 		};
-	static const char * optstring = "abC:c:dehgilLmnors:tuwy";
+	static const char * optstring = "AabC:c:defhgiklLmnoRrs:tuwy";
 	int c;
 	bool silent = false;
 
@@ -137,9 +149,13 @@ int main (int argc, char *argv[]) {
 	bool testLoglibs = false;
 	bool testComlibs = false;
 	bool testUtils = false;
+	bool testConfig = false;
+	bool testAsyncLog = false;
+	bool testRateLimit = false;
 	bool testThreads = false;
 	bool testDeviceDB = false;
 	bool testDaricomCommand = false;
+	bool testCommandCodec = false;
 	bool testWSProxyCommandHandler = false;
 // 	bool testDeviceGPS = false;
 	bool testDeviceGPRS = false;
@@ -222,6 +238,10 @@ int main (int argc, char *argv[]) {
 				testDaricomCommand = true;
 				printHelp = false;
 				break;
+			case 'k':
+				testCommandCodec = true;
+				printHelp = false;
+				break;
 			case 'w':
 				testWSProxyCommandHandler = true;
 				printHelp = false;
@@ -265,6 +285,18 @@ int main (int argc, char *argv[]) {
 				testUtils = true;
 				printHelp = false;
 				break;
+			case 'f':
+				testConfig = true;
+				printHelp = false;
+				break;
+			case 'A':
+				testAsyncLog = true;
+				printHelp = false;
+				break;
+			case 'R':
+				testRateLimit = true;
+				printHelp = false;
+				break;
 			case 'h':
 				print_usage(argv[0]);
 				return EXIT_SUCCESS;
@@ -343,6 +375,18 @@ int main (int argc, char *argv[]) {
 		logger.debug("----------- Testing Utilities ---");
 		test_utils(logger);
 	}
+	if (testConfig) {
+		logger.debug("----------- Testing Configurator ---");
+		test_config(logger);
+	}
+	if (testAsyncLog) {
+		logger.debug("----------- Testing AsyncLogger ---");
+		test_asynclog(logger);
+	}
+	if (testRateLimit) {
+		logger.debug("----------- Testing RateLimiter ---");
+		test_ratelimit(logger);
+	}
 	if (testThreads) {
 		logger.debug("----------- Testing Threads ---");
 		test_threads(logger);
@@ -355,6 +399,10 @@ int main (int argc, char *argv[]) {
 		logger.debug("----------- Testing DaricomCommand ---");
 		test_command(logger);
 	}
+	if (testCommandCodec) {
+		logger.debug("----------- Testing Command encoding ---");
+		test_codec(logger);
+	}
 	if (testWSProxyCommandHandler) {
 		logger.debug("----------- Testing WSProxyCommandHandler ---");
 		test_wsproxy(logger);
@@ -415,9 +463,13 @@ void print_usage(char * progname) {
 	cout << "\t-l, --comlibstest          Do a Test on comlibs" << endl;
 	cout << "\t-L, --loglibstest          Do a Test on logging libraries" << endl;
 	cout << "\t-u, --utilstest            Do a Test on Utilities" << endl;
+	cout << "\t-f, --configtest           Do a Test on Configurator typed params" << endl;
+	cout << "\t-A, --asynclogtest         Do a Test on AsyncLogger drops and flush" << endl;
+	cout << "\t-R, --ratelimittest        Do a Test on RateLimiter priority exemption" << endl;
 	cout << "\t-m, --threadstest          Do a Test on Threads" << endl;
 	cout << "\t-e, --devdbtest            Do a Test on DeviceDB" << endl;
 	cout << "\t-d, --commandtest          Do a Test on DaricomCommand" << endl;
+	cout << "\t-k, --codectest            Do a Test on Command binary encoding" << endl;
 	cout << "\t-w, --wsproxytest          Do a Test on WSProxyCommandHandler" << endl;
 	cout << "\t-g, --atgpstest            Do a Test on DeviceATGPS" << endl;
 	cout << "\t-o, --gpiotest             Do a Test on DeviceGPIO" << endl;
@@ -795,6 +847,279 @@ int test_utils(log4cpp::Category & logger) {
 	return 0;
 }
 
+/// Configurator TEST case
+int test_config(log4cpp::Category & logger) {
+	controlbox::Configurator & conf(controlbox::Configurator::getInstance());
+	typedef struct {
+		const char * value;
+		const char * defaultValue;
+		long expected;
+	} intCase_t;
+	intCase_t intCases[] = {
+		{ "10",		"5",	10 },
+		{ "010",	"5",	10 },	// Leading zeros are not octal
+		{ "-010",	"5",	-10 },
+		{ " 42 ",	"5",	42 },
+		{ "0x10",	"5",	16 },
+		{ "-0x10",	"5",	-16 },
+		{ "0X1f",	"5",	31 },
+		{ "08",		"5",	8 },
+		{ "0x",		"5",	5 },	// Invalid values fall back to the default
+		{ "12abc",	"5",	5 },
+		{ "abc",	"7",	7 },
+		{ "",		"0x0A",	10 },
+		{ 0, 0, 0 }
+	};
+	unsigned int failed = 0;
+	unsigned int i;
+	long value;
+
+	logger.info("01 - Testing integer params parsing...");
+	for (i=0; intCases[i].value; i++) {
+		conf.setParam("cboxtest_int", intCases[i].value, false);
+		value = conf.paramInt("cboxtest_int", intCases[i].defaultValue);
+		if ( value != intCases[i].expected ) {
+			logger.error("FAILED: [%s] (default [%s]) => %ld, expected %ld",
+				intCases[i].value, intCases[i].defaultValue,
+				value, intCases[i].expected);
+			failed++;
+		}
+	}
+	logger.info("");
+
+	logger.info("02 - Testing the same param with different defaults...");
+	conf.setParam("cboxtest_int", "010", false);
+	if ( conf.paramInt("cboxtest_int", "1") != 10 ||
+			conf.paramInt("cboxtest_int", "2") != 10 ||
+			conf.paramInt("cboxtest_int", "1") != 10 ) {
+		logger.error("FAILED: a valid value depends on the default");
+		failed++;
+	}
+	// Reported just once, whatever the defaults used
+	conf.setParam("cboxtest_int", "invalid", false);
+	if ( conf.paramInt("cboxtest_int", "1") != 1 ||
+			conf.paramInt("cboxtest_int", "2") != 2 ||
+			conf.paramInt("cboxtest_int", "1") != 1 ) {
+		logger.error("FAILED: an invalid value does not fall back to the default");
+		failed++;
+	}
+	if ( conf.paramInt("cboxtest_undefined", "3") != 3 ||
+			conf.paramInt("cboxtest_undefined", "0x04") != 4 ) {
+		logger.error("FAILED: an undefined param does not use the default");
+		failed++;
+	}
+	logger.info("");
+
+	logger.info("03 - Testing other typed params...");
+	conf.setParam("cboxtest_bool", "On", false);
+	conf.setParam("cboxtest_double", "010.5", false);
+	if ( !conf.paramBool("cboxtest_bool") ||
+			conf.paramDouble("cboxtest_double") != 10.5 ||
+			conf.paramList("cboxtest_double").size() != 1 ) {
+		logger.error("FAILED: typed params of different types");
+		failed++;
+	}
+	logger.info("");
+
+	if ( failed ) {
+		logger.error("FAILED: [%u] checks", failed);
+		return -1;
+	}
+
+	logger.info("DONE!");
+
+	return 0;
+}
+
+/// An appender counting the events it gets, blocking on the first one
+class BlockingAppender : public log4cpp::AppenderSkeleton {
+public:
+	ost::Semaphore entered;
+	ost::Semaphore release;
+	unsigned int count;
+	std::string first;
+
+	BlockingAppender() :
+		log4cpp::AppenderSkeleton("BlockingAppender"),
+		entered(0), release(0), count(0) {
+	}
+	bool reopen() { return true; }
+	void close() {}
+	bool requiresLayout() const { return false; }
+	void setLayout(log4cpp::Layout * layout) {}
+protected:
+	void _append(log4cpp::LoggingEvent const & event) {
+		if ( !count++ ) {
+			first = event.message;
+			entered.post();
+			release.wait();
+		}
+	}
+};
+
+/// The AsyncLogger test producer, logging on its own ring
+struct asyncProducer {
+	log4cpp::Category * log;
+	BlockingAppender * appender;
+	std::string message;
+	unsigned int count;
+};
+
+void * asyncProduce(void * arg) {
+	asyncProducer * p = (asyncProducer *)arg;
+	unsigned int i;
+
+	p->log->info(p->message);
+	// The AsyncLogger thread is now blocked writing the first record,
+	// which is kept into the ring up to the end of the write
+	p->appender->entered.wait();
+	for (i=0; i<p->count; i++) {
+		p->log->info("Record %u", i);
+	}
+
+	return 0;
+}
+
+/// AsyncLogger TEST case
+int test_asynclog(log4cpp::Category & logger) {
+	log4cpp::Category & log(log4cpp::Category::getInstance(std::string("controlbox.cboxtest.asynclog")));
+	BlockingAppender * appender = new BlockingAppender();
+	controlbox::AsyncLogger * asyncLogger;
+	controlbox::AsyncLogger::t_stats stats;
+	asyncProducer producer;
+	pthread_t thread;
+	unsigned int failed = 0;
+
+	// The appender is owned by the category
+	log.setAdditivity(false);
+	log.setPriority(log4cpp::Priority::INFO);
+	log.addAppender(appender);
+
+	asyncLogger = controlbox::AsyncLogger::getInstance(8);
+	asyncLogger->getStats(stats);
+
+	logger.info("01 - Logging a long message and filling a ring...");
+	producer.log = &log;
+	producer.appender = appender;
+	producer.message.assign(4*ASYNCLOGGER_MESSAGE_SIZE, 'x');
+	producer.count = 4*stats.ringSize;
+	pthread_create(&thread, 0, asyncProduce, &producer);
+	pthread_join(thread, 0);
+	appender->release.post();
+	logger.info("");
+
+	logger.info("02 - Testing shutdown flush...");
+	asyncLogger->shutdown();
+	asyncLogger->getStats(stats);
+	if ( appender->first != producer.message ) {
+		logger.error("FAILED: long message of [%u] chars written as [%u] chars",
+				producer.message.size(), appender->first.size());
+		failed++;
+	}
+	if ( appender->count != stats.ringSize ) {
+		logger.error("FAILED: [%u] records written, expected [%u]",
+				appender->count, stats.ringSize);
+		failed++;
+	}
+	if ( stats.spilled != 1 || stats.truncated ) {
+		logger.error("FAILED: [%lu] records spilled, [%lu] truncated",
+				stats.spilled, stats.truncated);
+		failed++;
+	}
+	logger.info("");
+
+	logger.info("03 - Testing drops counting...");
+	if ( stats.dropped != producer.count-(stats.ringSize-1) ) {
+		logger.error("FAILED: [%lu] records dropped, expected [%u]",
+				stats.dropped, producer.count-(stats.ringSize-1));
+		failed++;
+	}
+	// Appenders are called synchronously once shut down
+	log.info("Synchronous record");
+	if ( appender->count != stats.ringSize+1 ) {
+		logger.error("FAILED: record not written after shutdown");
+		failed++;
+	}
+	logger.info("");
+
+	if ( failed ) {
+		logger.error("FAILED: [%u] checks", failed);
+		return -1;
+	}
+
+	logger.info("DONE!");
+
+	return 0;
+}
+
+/// Account a Command of the specified priority on a RateLimiter
+bool rateAdmit(controlbox::comsys::RateLimiter & limiter, unsigned short prio) {
+	controlbox::comsys::Command * command;
+	bool admitted;
+
+	command = controlbox::comsys::Command::getCommand(1, Device::DEVICE_ODO, "ODO", "RateLimiter");
+	command->setPrio(prio);
+	admitted = limiter.admit(command);
+	command->release();
+
+	return admitted;
+}
+
+int test_ratelimit(log4cpp::Category & logger) {
+	// One event per second, bursts of two, urgent up to priority 1
+	controlbox::comsys::RateLimiter limiter("cboxtest", 1, 2,
+			controlbox::comsys::RateLimiter::RL_DROP, 10, 1);
+	controlbox::comsys::RateLimiter strict("cboxtest_strict", 1, 2);
+	controlbox::comsys::RateLimiter::t_stats stats;
+	unsigned int failed = 0;
+	unsigned int i;
+
+	logger.info("01 - Testing the burst of normal Commands...");
+	if ( !rateAdmit(limiter, 10) || !rateAdmit(limiter, 2) ||
+			rateAdmit(limiter, 10) ) {
+		logger.error("FAILED: the burst is not limited");
+		failed++;
+	}
+	logger.info("");
+
+	logger.info("02 - Testing urgent Commands on an empty bucket...");
+	for (i=0; i<5; i++) {
+		if ( !rateAdmit(limiter, i%2) ) {
+			logger.error("FAILED: urgent Command [%u] rejected", i);
+			failed++;
+		}
+	}
+	// Urgent Commands don't consume tokens
+	if ( rateAdmit(limiter, 10) ) {
+		logger.error("FAILED: the bucket has been refilled");
+		failed++;
+	}
+	limiter.getStats(stats);
+	if ( stats.passed != 2 || stats.rejected != 2 || stats.exempted != 5 ) {
+		logger.error("FAILED: passed [%lu], rejected [%lu], exempted [%lu]",
+			stats.passed, stats.rejected, stats.exempted);
+		failed++;
+	}
+	logger.info("");
+
+	logger.info("03 - Testing the exemption is disabled by default...");
+	if ( !rateAdmit(strict, 1) || !rateAdmit(strict, 1) ||
+			rateAdmit(strict, 0) ) {
+		logger.error("FAILED: urgent Command not limited");
+		failed++;
+	}
+	logger.info("");
+
+	if ( failed ) {
+		logger.error("FAILED: [%u] checks", failed);
+		return -1;
+	}
+
+	logger.info("DONE!");
+
+	return 0;
+}
+
 /// Threads TEST case
 int test_threads(log4cpp::Category & logger) {
 
@@ -904,6 +1229,11 @@ int test_devicedb(log4cpp::Category & logger) {
 	controlbox::device::PollEventGenerator * peg1 = 0;
 	controlbox::device::PollEventGenerator * peg2 = 0;
 	controlbox::device::PollEventGenerator * peg3 = 0;
+	std::string fwId("./filewriter2.log");
+	unsigned long long start, numTime, strTime, typeTime;
+	unsigned int loops = 1000000;
+	unsigned int i;
+	int failures = 0;
 
 	logger.info("Getting a reference to the DeviceFactory... ");
 	df = controlbox::device::DeviceFactory::getInstance();
@@ -923,6 +1253,33 @@ int test_devicedb(log4cpp::Category & logger) {
 
 	logger.info("%s", db->printDB().c_str());
 
+	logger.info("Benchmarking DeviceDB lookups (%u loops)... ", loops);
+	start = Utils::monotonicUsec();
+	for (i=0; i<loops; i++) {
+		if ( db->getDevice(Device::EG_POLLER, (short)2000) != peg2 ) {
+			failures++;
+		}
+	}
+	numTime = Utils::monotonicUsec() - start;
+	start = Utils::monotonicUsec();
+	for (i=0; i<loops; i++) {
+		if ( db->getDevice(Device::CH_FILEWRITER, fwId) != fw2 ) {
+			failures++;
+		}
+	}
+	strTime = Utils::monotonicUsec() - start;
+	start = Utils::monotonicUsec();
+	for (i=0; i<loops; i++) {
+		if ( db->getDevice(Device::EG_POLLER) != peg1 ) {
+			failures++;
+		}
+	}
+	typeTime = Utils::monotonicUsec() - start;
+	logger.info("by numeric id: %llu ns/lookup", (numTime*1000)/loops);
+	logger.info("by string id:  %llu ns/lookup", (strTime*1000)/loops);
+	logger.info("by type:       %llu ns/lookup", (typeTime*1000)/loops);
+	logger.info("DONE! (%d failures)", failures);
+
 
 	command = controlbox::comsys::Command::getCommand(controlbox::device::PollEventGenerator::SEND_POLL_DATA, Device::EG_POLLER, "Poller", "PollData");
 	cd = new controlbox::comsys::CommandDispatcher(fw1, false);
@@ -952,7 +1309,7 @@ int test_devicedb(log4cpp::Category & logger) {
 
 	logger.info("%s", db->printDB().c_str());
 
-	return 0;
+	return failures;
 
 }
 
@@ -1005,6 +1362,158 @@ int test_command(log4cpp::Category & logger) {
 
 }
 
+/// Command binary encoding TEST case
+int test_codec(log4cpp::Category & logger) {
+
+	controlbox::comsys::Command * command = 0;
+	controlbox::comsys::Command * decoded = 0;
+	controlbox::comsys::CommandView view;
+	controlbox::comsys::CommandView::t_paramView param;
+	char buf[512];
+	unsigned int len;
+	unsigned int i;
+	unsigned int lable;
+	unsigned int value;
+	unsigned int size;
+	unsigned int loops = 100000;
+	unsigned long long start;
+	unsigned long long binTime;
+	unsigned long long xmlTime;
+	std::string xmlOrig;
+	std::string xmlDecoded;
+	int failures = 0;
+
+	logger.info("Initializing a Command... ");
+	command = controlbox::comsys::Command::getCommand(1, Device::DEVICE_TE, "Sampi500", "Sampi500");
+	command->setPrio(3);
+	command->setParam( "StringParam", "ParamValue" );
+	command->setParam( "IntParam", -2 );
+	command->setParam( "FloatParam",  1.23 );
+	command->setParam( "MultiParam1", 1, false);
+	command->setParam( "MultiParam1", "due", false);
+	command->setParam( "MultiParam1", 3, false);
+	logger.info("DONE!");
+
+	logger.info("Testing encoding into a too small buffer... ");
+	if ( command->encode(buf, 8, len) != CMD_BUFFER_TOO_SMALL ||
+			len != command->encodedSize() ) {
+		logger.error("Too small buffer NOT detected");
+		failures++;
+	}
+
+	logger.info("Testing round-trip... ");
+	command->encode(buf, sizeof(buf), len);
+	logger.info("Encoded [%u] bytes", len);
+	if ( view.parse(buf, len) != OK ) {
+		logger.error("Encoded frame NOT parsed");
+		failures++;
+	}
+	if ( view.type() != 1 || view.device() != Device::DEVICE_TE ||
+			view.deviceId() != "Sampi500" || view.getPrio() != 3 ||
+			view.paramCount() != 6 ) {
+		logger.error("Command header NOT preserved");
+		failures++;
+	}
+	if ( !view.findParam("MultiParam1", param, 2) ||
+			param.type != controlbox::comsys::CommandView::VT_STRING ||
+			std::string(param.str, param.strLen) != "due" ) {
+		logger.error("MultiParam1[2] NOT preserved");
+		failures++;
+	}
+	if ( !view.findParam("IntParam", param) || param.i != -2 ) {
+		logger.error("IntParam NOT preserved");
+		failures++;
+	}
+	decoded = view.toCommand("Sampi500");
+	command->xmlDump(xmlOrig);
+	decoded->xmlDump(xmlDecoded);
+	if ( xmlOrig != xmlDecoded ) {
+		logger.error("Decoded Command differs:%s", xmlDecoded.c_str());
+		failures++;
+	}
+	decoded->release();
+
+	logger.info("Testing truncated and corrupted frames... ");
+	for (i=0; i<len; i++) {
+		if ( view.parse(buf, i) == OK ) {
+			logger.error("Frame truncated at [%u] bytes NOT detected", i);
+			failures++;
+		}
+	}
+	buf[0] = 'X';
+	if ( view.parse(buf, len) != CMD_BAD_ENCODING ) {
+		logger.error("Corrupted frame NOT detected");
+		failures++;
+	}
+
+	logger.info("Testing corrupted params within an intact frame... ");
+	command->encode(buf, sizeof(buf), len);
+	view.parse(buf, len);
+	view.findParam("StringParam", param);
+	lable = param.lable - buf;
+	value = lable + param.lableLen;
+	for (i=0; i<8; i++) {
+		command->encode(buf, sizeof(buf), len);
+		size = len;
+		switch ( i ) {
+		case 0: // devId longer than the frame
+			buf[COMMAND_ENCODING_HEADER+10] = (char)0xFF;
+			buf[COMMAND_ENCODING_HEADER+11] = (char)0xFF;
+			break;
+		case 1: // more params than encoded
+			buf[COMMAND_ENCODING_HEADER+12+8]++;
+			break;
+		case 2: // lable longer than the frame
+			buf[lable-2] = (char)0xFF;
+			buf[lable-1] = (char)0xFF;
+			break;
+		case 3: // unknown value type
+			buf[value] = 9;
+			break;
+		case 4: // string longer than the frame
+			buf[value+2] = (char)0x01;
+			break;
+		case 5: // string length wrapping around the frame position
+			memset(buf+value+1, 0xFF, 4);
+			break;
+		case 6: // less params than encoded
+			buf[COMMAND_ENCODING_HEADER+12+8]--;
+			break;
+		case 7: // trailing bytes after the last param
+			size = len+4;
+			memset(buf+len, 0, 4);
+			buf[4] = size & 0xFF;
+			buf[5] = (size >> 8) & 0xFF;
+			break;
+		}
+		if ( view.parse(buf, size) != CMD_BAD_ENCODING ) {
+			logger.error("Corrupted param [case %u] NOT detected", i);
+			failures++;
+		}
+	}
+	logger.info("DONE! (%d failures)", failures);
+
+	logger.info("Benchmarking encoding against xmlDump (%u loops)... ", loops);
+	start = Utils::monotonicUsec();
+	for (i=0; i<loops; i++) {
+		command->encode(buf, sizeof(buf), len);
+		view.parse(buf, len);
+	}
+	binTime = Utils::monotonicUsec() - start;
+	start = Utils::monotonicUsec();
+	for (i=0; i<loops; i++) {
+		command->xmlDump(xmlOrig);
+	}
+	xmlTime = Utils::monotonicUsec() - start;
+	logger.info("binary encode+parse: %llu ns/cmd, %u bytes", (binTime*1000)/loops, len);
+	logger.info("xmlDump:             %llu ns/cmd, %u bytes", (xmlTime*1000)/loops, xmlOrig.size());
+
+	command->release();
+
+	return failures;
+
+}
+
 /// WSProxyCommandHandler TEST case
 int test_wsproxy(log4cpp::Category & logger) {
 
@@ -1050,7 +1559,7 @@ int test_wsproxy(log4cpp::Category & logger) {
 	// finisce using it we get a SEGFAULT!!!
 	logger.debug("waiting 30s before continuing...");
 	::sleep(5);
-	delete command;
+	command->release();
 */
 
 	logger.debug("05 - Preparing a poll generator for sending periodic data... ");
@@ -167,14 +167,17 @@ void ATcontrol::doParse (void) {
 
         LOG4CPP_DEBUG(log, "Received new AT Command [%s]", sentence.c_str());
 
-        // Parsing command
-        querible = parseQuery(sentence, theQuery);
-        if ( !querible ) {
-            LOG4CPP_DEBUG(log, "Invalid AT command received");
-            d_tty << "Not supported AT Command" << d_delimiter << flush;
-            queryResult = GENERIC_ERROR;
-        } else {
-            queryResult = querible->query(theQuery);
+        // Parsing command, the query is kept registered till served
+        {
+            QueryRegistry::Guard l_guard;
+            querible = parseQuery(sentence, theQuery, l_guard);
+            if ( !querible ) {
+                LOG4CPP_DEBUG(log, "Invalid AT command received");
+                d_tty << "Not supported AT Command" << d_delimiter << flush;
+                queryResult = GENERIC_ERROR;
+            } else {
+                queryResult = querible->query(theQuery);
+            }
         }
 
         if ( d_sendExitCode ) {
@@ -192,7 +195,8 @@ void ATcontrol::doParse (void) {
 
 }
 
-Querible * ATcontrol::parseQuery (std::string const & atCommand, Querible::t_query & theQuery) {
+Querible * ATcontrol::parseQuery (std::string const & atCommand, Querible::t_query & theQuery,
+                                  QueryRegistry::Guard const & guard) {
     unsigned short commandEndIndex;
     const char * atStr = atCommand.c_str();
     char queryName[ATCONTROL_COMMAND_MAXLENGTH];
@@ -239,14 +243,13 @@ Querible * ATcontrol::parseQuery (std::string const & atCommand, Querible::t_que
     queryName[commandEndIndex] = 0;
     LOG4CPP_DEBUG(log, "Command name: [%s]", queryName);
 
-    querible = qR->getQuerible(queryName);
+    querible = qR->lookup(queryName, theQuery.descr, guard);
 
     if ( !querible ) {
         LOG4CPP_WARN(log, "AT command [%s] not supported", queryName);
         return 0;
     }
 
-    theQuery.descr = qR->getQueryDescriptor(queryName, querible);
     theQuery.responce = false;
 
     return querible;
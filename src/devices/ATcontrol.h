@@ -33,6 +33,7 @@
 #include <controlbox/base/Utility.h>
 #include <controlbox/devices/DeviceInCabin.h>
 #include <controlbox/base/Configurator.h>
+#include <controlbox/base/QueryRegistry.h>
 #include<cc++/serial.h>
 
 #define ATCONTROL_DEFAULT_DEVICE 	"/dev/ttyUSB0:9600:8:n:1"
@@ -164,7 +165,11 @@ protected:
 
     void doParse (void);
 
-    Querible * parseQuery (std::string const & atCommand, Querible::t_query & theQuery);
+    /// Parse an AT command and look for the Querible exporting it.
+    /// @param guard the registry read-side section the returned
+    ///		Querible, and the query descriptor, are valid within
+    Querible * parseQuery (std::string const & atCommand, Querible::t_query & theQuery,
+                           QueryRegistry::Guard const & guard);
 
     void run(void);
 
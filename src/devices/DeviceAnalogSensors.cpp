@@ -46,7 +46,7 @@ DeviceAnalogSensors * DeviceAnalogSensors::getInstance(std::string const & logNa
 }
 
 DeviceAnalogSensors::DeviceAnalogSensors(std::string const & logName) :
-	CommandGenerator(logName),
+	TaskGenerator(logName),
 	Device(Device::DEVICE_AS, 0, logName),
 	d_config(Configurator::getInstance()),
 	loadI2C(false),
@@ -86,6 +86,10 @@ DeviceAnalogSensors::~DeviceAnalogSensors() {
 
 	LOG4CPP_INFO(log, "Stopping DeviceAnalogSensors");
 
+	d_config.unsubscribe(this);
+
+	stopSteps();
+
 	// Destroing analog sensors map
 	aSensor = analogSensors.begin();
 	while ( aSensor != analogSensors.end()) {
@@ -137,6 +141,8 @@ DeviceAnalogSensors::loadSensorConfiguration(void) {
 		if ( curSensor ) {
 			analogSensors[string(curSensor->id)] = curSensor;
 			logSensorParams(curSensor);
+			// Alarm limits could be tuned at run-time
+			d_config.subscribe(dsCfgLable.str(), this);
 		} else {
 			LOG4CPP_WARN(log, "Error on loading an Analog Sensor configuration");
 		}
@@ -152,8 +158,30 @@ DeviceAnalogSensors::loadSensorConfiguration(void) {
 }
 
 inline
-DeviceAnalogSensors::t_analogSensor * DeviceAnalogSensors::parseCfgString(std::string const & asCfg) {
+DeviceAnalogSensors::t_analogSensor * DeviceAnalogSensors::parseCfgString(std::string const & asCfg, bool validate) {
 	t_analogSensor * pAs = 0;
+
+	LOG4CPP_DEBUG(log, "parseCfgString(asCfg=%s)", asCfg.c_str());
+
+	pAs = new t_analogSensor();
+
+	if ( parseSensor(asCfg, pAs, log) != OK ) {
+		LOG4CPP_ERROR(log, "Invalid Analog Sensor configuration [%s]", asCfg.c_str());
+		delete pAs;
+		return 0;
+	}
+
+	if ( !validate || validateParams(pAs) ) {
+		return pAs;
+	} else {
+		delete pAs;
+		return 0;
+	}
+
+}
+
+exitCode
+DeviceAnalogSensors::parseSensor(std::string const & asCfg, t_analogSensor * pAs, log4cpp::Category & log) {
 	std::ostringstream cfgTemplate("");
 	int enabled;
 // 	int alarmEnabled;
@@ -162,18 +190,15 @@ DeviceAnalogSensors::t_analogSensor * DeviceAnalogSensors::parseCfgString(std::s
 	char description[AS_DESC_START+1];
 	char * descStart;
 
-	LOG4CPP_DEBUG(log, "parseCfgString(asCfg=%s)", asCfg.c_str());
-
-	pAs = new t_analogSensor();
-
-	// TODO: Error handling on pattern matching...
-
 	// Input configuration string template:
 	// - for i2c protocol:
 	// id proto address reg minSample maxSample minValue maxValue unit enabled downLimit upperLimit alarmEnabled description
 	cfgTemplate << "%" << AS_MAX_ID_LENGTH << "s %u";
 	DLOG4CPP_DEBUG(log, "Format string: [%s]", cfgTemplate.str().c_str());
-	sscanf(asCfg.c_str(), cfgTemplate.str().c_str(), pAs->id, &pAs->proto);
+	if ( sscanf(asCfg.c_str(), cfgTemplate.str().c_str(), pAs->id, &pAs->proto) != 2 ) {
+		LOG4CPP_ERROR(log, "Missing Analog Sensor id or protocol");
+		return AS_CFG_PARSE_ERROR;
+	}
 
 	DLOG4CPP_DEBUG(log, "Id: [%s] Proto: [%d]", pAs->id, pAs->proto);
 
@@ -186,9 +211,12 @@ DeviceAnalogSensors::t_analogSensor * DeviceAnalogSensors::parseCfgString(std::s
 			// - select Protocol-Specifics substrings...
 			cfgTemplate << " %i %i";
 			//LOG4CPP_DEBUG(log, "Format string: [%s]", cfgTemplate.str().c_str());
-			sscanf(asCfg.c_str(), cfgTemplate.str().c_str(),
+			if ( sscanf(asCfg.c_str(), cfgTemplate.str().c_str(),
 				&pAs->address.i2cAddress.chipAddress,
-				&pAs->address.i2cAddress.reg);
+				&pAs->address.i2cAddress.reg) != 2 ) {
+				LOG4CPP_ERROR(log, "Missing I2C address for Analog Sensor [%s]", pAs->id);
+				return AS_CFG_PARSE_ERROR;
+			}
 
 			//LOG4CPP_DEBUG(log, "Chip: [%d] Reg: [%d]", pAs->address.i2cAddress.chipAddress, pAs->address.i2cAddress.reg);
 
@@ -205,10 +233,13 @@ DeviceAnalogSensors::t_analogSensor * DeviceAnalogSensors::parseCfgString(std::s
 			// - select Protocol-Specifics substrings...
 			cfgTemplate << " %i %i %d";
 			DLOG4CPP_DEBUG(log, "Format string: [%s]", cfgTemplate.str().c_str());
-			sscanf(asCfg.c_str(), cfgTemplate.str().c_str(),
+			if ( sscanf(asCfg.c_str(), cfgTemplate.str().c_str(),
 				&pAs->address.sysfsAddress.bus,
 				&pAs->address.sysfsAddress.address,
-				&pAs->address.sysfsAddress.channel);
+				&pAs->address.sysfsAddress.channel) != 3 ) {
+				LOG4CPP_ERROR(log, "Missing sysfs address for Analog Sensor [%s]", pAs->id);
+				return AS_CFG_PARSE_ERROR;
+			}
 
 			DLOG4CPP_DEBUG(log, "Bus: [0x%X] Address: [0x%X]"
 				" Port: [%d] Bit: [%d]",
@@ -228,22 +259,32 @@ DeviceAnalogSensors::t_analogSensor * DeviceAnalogSensors::parseCfgString(std::s
 		break;
 
 		default:
-			LOG4CPP_WARN(log, "Unsupported Protocol Type for Analog Sensor [%s]", pAs->id);
-			return 0;
+			LOG4CPP_ERROR(log, "Unsupported Protocol Type for Analog Sensor [%s]", pAs->id);
+			return AS_CFG_PARSE_ERROR;
 
 	}
 
 	// Parsing the remaining Protocol-Independant" params...
 	cfgTemplate << " %d %d %f %f %" << AS_MAX_UNIT_LENGTH << "s %d %f %f %" << AS_MAX_VALUE_LENGTH << "s %" << AS_MAX_VALUE_LENGTH << "s %i %c %u %" << AS_DESC_START << "s";
 	DLOG4CPP_DEBUG(log, "Format string: [%s]", cfgTemplate.str().c_str());
-	sscanf(asCfg.c_str(), cfgTemplate.str().c_str(),
+	// The description is optional
+	if ( sscanf(asCfg.c_str(), cfgTemplate.str().c_str(),
 			&pAs->minSample, &pAs->maxSample,
 			&pAs->minValue, &pAs->maxValue,
 			pAs->unit, &enabled,
 			&downLimit, &upperLimit,
 			pAs->lvalue, pAs->hvalue,
 			&pAs->event, &param,
-			&pAs->alarmPollTime, description);
+			&pAs->alarmPollTime, description) < 13 ) {
+		LOG4CPP_ERROR(log, "Missing params for Analog Sensor [%s]", pAs->id);
+		return AS_CFG_PARSE_ERROR;
+	}
+
+	// Samples are converted to values, and limits to samples, by ranges
+	if ( pAs->minSample == pAs->maxSample || pAs->minValue == pAs->maxValue ) {
+		LOG4CPP_ERROR(log, "Empty samples or values range for Analog Sensor [%s]", pAs->id);
+		return AS_CFG_PARSE_ERROR;
+	}
 
 	pAs->enabled = enabled ? true : false;
 
@@ -272,12 +313,86 @@ DeviceAnalogSensors::t_analogSensor * DeviceAnalogSensors::parseCfgString(std::s
 		strncpy(pAs->description, descStart, AS_MAX_DESC_LENGTH);
 	}
 
-	if ( validateParams(pAs) ) {
-		return pAs;
-	} else {
-		return 0;
+	return OK;
+
+}
+
+exitCode
+DeviceAnalogSensors::checkConfiguration(Configurator & config, log4cpp::Category & log) {
+	std::ostringstream asCfgLable("");
+	std::string asCfg;
+	std::set<std::string> ids;
+	t_analogSensor aSensor;
+	exitCode result = OK;
+	short sensor;
+
+	// Sensors are parsed just like at load time, without accessing them
+	sensor = AS_FIRST_ID;
+	asCfgLable << AS_CONF_BASE << sensor;
+	asCfg = config.param(asCfgLable.str(), "");
+
+	while ( asCfg.size() ) {
+
+		memset(&aSensor, 0, sizeof(t_analogSensor));
+		if ( parseSensor(asCfg, &aSensor, log) != OK ) {
+			LOG4CPP_ERROR(log, "Invalid Analog Sensor configuration [%s]",
+					asCfgLable.str().c_str());
+			result = AS_CFG_PARSE_ERROR;
+		} else if ( !ids.insert(aSensor.id).second ) {
+			LOG4CPP_ERROR(log, "Duplicated analog sensor id [%s] on [%s]",
+					aSensor.id, asCfgLable.str().c_str());
+			result = AS_CFG_PARSE_ERROR;
+		}
+
+		// Looking for next sensor definition
+		sensor++; asCfgLable.str("");
+		asCfgLable << AS_CONF_BASE << sensor;
+		asCfg = config.param(asCfgLable.str(), "");
+	};
+
+	return result;
+
+}
+
+void
+DeviceAnalogSensors::paramChanged(std::string const & param) {
+	std::string asCfg;
+	t_analogSensor * pNew;
+	t_analogSensor * pAs;
+
+	LOG4CPP_DEBUG(log, "DeviceAnalogSensors::paramChanged(param=%s)", param.c_str());
+
+	asCfg = d_config.param(param, "");
+	if ( !asCfg.size() ) {
+		LOG4CPP_WARN(log, "Analog sensor [%s] removed, restart required to unload it", param.c_str());
+		return;
+	}
+
+	pNew = parseCfgString(asCfg, false);
+	if ( !pNew ) {
+		LOG4CPP_WARN(log, "Error on reloading an Analog Sensor configuration");
+		return;
 	}
 
+	pAs = findById(pNew->id);
+	if ( !pAs ) {
+		LOG4CPP_WARN(log, "Analog sensor [%s] not loaded, restart required to load it", pNew->id);
+		delete pNew;
+		return;
+	}
+
+	d_limitsLock.enterMutex();
+	pAs->downLimit = pNew->downLimit;
+	pAs->upperLimit = pNew->upperLimit;
+	memcpy(pAs->lvalue, pNew->lvalue, sizeof(t_asValue));
+	memcpy(pAs->hvalue, pNew->hvalue, sizeof(t_asValue));
+	d_limitsLock.leaveMutex();
+
+	LOG4CPP_INFO(log, "Updated alarm limits of analog sensor [%s]", pAs->id);
+	logSensorParams(pAs);
+
+	delete pNew;
+
 }
 
 inline bool
@@ -313,6 +428,9 @@ DeviceAnalogSensors::logSensorParams(DeviceAnalogSensors::t_analogSensor * pAs)
 
 #ifdef CONTROLBOX_DEBUG
 	std::ostringstream params("");
+	t_asLimits l_limits;
+
+	getLimits(pAs, l_limits);
 
 	LOG4CPP_DEBUG(log, "ID: %-*s - %s", AS_MAX_ID_LENGTH, pAs->id, pAs->description);
 	LOG4CPP_DEBUG(log, "\tMin Sample:   %5d\t\tMax Sample:   %5d", pAs->minSample, pAs->maxSample);
@@ -336,9 +454,9 @@ DeviceAnalogSensors::logSensorParams(DeviceAnalogSensors::t_analogSensor * pAs)
 	LOG4CPP_DEBUG(log, "\t%s", params.str().c_str());
 
 	params.str("");
-	params << "Low Alarm:  " << setw(7) << std::setprecision(3) << sampleToValue(pAs, pAs->downLimit);
+	params << "Low Alarm:  " << setw(7) << std::setprecision(3) << sampleToValue(pAs, l_limits.downLimit);
 	params << " " << left << setw(AS_MAX_UNIT_LENGTH) << pAs->unit << right;
-	params << "\tHigh Alarm:  " << setw(7) << std::setprecision(3) << sampleToValue(pAs, pAs->upperLimit);
+	params << "\tHigh Alarm:  " << setw(7) << std::setprecision(3) << sampleToValue(pAs, l_limits.upperLimit);
 	params << " " << left << setw(AS_MAX_UNIT_LENGTH) << pAs->unit;
 	LOG4CPP_DEBUG(log, "\t%s", params.str().c_str());
 
@@ -516,7 +634,7 @@ DeviceAnalogSensors::sampleToValue(DeviceAnalogSensors::t_analogSensor * pAs, in
 	return ((valueRange*curSampleRange)/sampleRange)+pAs->minValue;
 }
 
-inline unsigned
+unsigned
 DeviceAnalogSensors::valueToSample(DeviceAnalogSensors::t_analogSensor * pAs, float value) {
 
 	float valueRange;
@@ -536,7 +654,7 @@ DeviceAnalogSensors::startMonitors() {
 	t_asMap::iterator aSensor;
 	DeviceAnalogSensors::t_analogSensor * pAs;
 
-	LOG4CPP_DEBUG(log, "Starting monitors threads...");
+	LOG4CPP_DEBUG(log, "Starting monitors...");
 
 	aSensor = analogSensors.begin();
 	while ( aSensor != analogSensors.end()) {
@@ -545,7 +663,6 @@ DeviceAnalogSensors::startMonitors() {
 				pAs->id, pAs->event, pAs->alarmPollTime);
 		if ( pAs->event && pAs->alarmPollTime ) {
 			pAs->monitor = new DeviceAnalogSensors::Monitor(this, pAs, pAs->alarmPollTime);
-			(pAs->monitor)->start();
 			LOG4CPP_INFO(log, "Monitoring sensor [%s] with poll time [%d]",
 						pAs->id, pAs->alarmPollTime);
 		}
@@ -559,29 +676,25 @@ DeviceAnalogSensors::Monitor::Monitor(DeviceAnalogSensors * device, DeviceAnalog
 	d_pollTime(pollTime),
 	d_pAs(pAs) {
 
-}
+	d_timer = TimerWheel::getInstance()->schedule(this, d_pollTime, d_pollTime);
+	if ( !d_timer ) {
+		LOG4CPP_ERROR(d_device->log, "Failed scheduling the monitor of sensor [%s]", d_pAs->id);
+	}
 
-void
-DeviceAnalogSensors::Monitor::run (void) {
-	controlbox::ThreadDB *l_tdb = ThreadDB::getInstance();
-	int l_tid;
-	char name[16];
+}
 
-	snprintf(name, 16, "AS-%s", d_pAs->id);
+DeviceAnalogSensors::Monitor::~Monitor() {
 
-	l_tid = syscall(SYS_gettid);
-	LOG4CPP_INFO(d_device->log, "Thread [%s (%d)] started", name, l_tid);
+	if ( d_timer ) {
+		TimerWheel::getInstance()->cancel(d_timer);
+	}
 
-	this->setName(name);
-	l_tdb->registerThread(this, l_tid);
+}
 
-	while (true) {
-		sleep(d_pollTime);
-		d_device->checkSafety(d_pAs, true);
-	}
+void
+DeviceAnalogSensors::Monitor::timerExpired(unsigned int timer) {
 
-	LOG4CPP_WARN(d_device->log, "Thread [%s (%d)] terminated", this->getName(), l_tid);
-	l_tdb->unregisterThread(this);
+	d_device->checkSafety(d_pAs, true);
 
 }
 
@@ -601,14 +714,27 @@ DeviceAnalogSensors::checkSafety(std::string asId) {
 
 }
 
+inline void
+DeviceAnalogSensors::getLimits(DeviceAnalogSensors::t_analogSensor * pAs, t_asLimits & limits) {
+	ost::MutexLock l_lock(d_limitsLock);
+
+	limits.downLimit = pAs->downLimit;
+	limits.upperLimit = pAs->upperLimit;
+	memcpy(limits.lvalue, pAs->lvalue, sizeof(t_asValue));
+	memcpy(limits.hvalue, pAs->hvalue, sizeof(t_asValue));
+
+}
+
 bool
 DeviceAnalogSensors::checkSafety(DeviceAnalogSensors::t_analogSensor * pAs, bool p_notify) {
+	t_asLimits l_limits;
 	unsigned lastSample;
 	bool alarm = false;
 	bool sendNotify = false;
 
 	LOG4CPP_DEBUG(log, "DeviceAnalogSensors::checkSafety(pAs=%p, notify=%s)", pAs, p_notify ? "YES" : "NO");
 
+	// NOTE the sensor I/O is done without holding the limits lock
 	lastSample = updateSensor(pAs);
 
 	// Fix the reading for sensors that are not attached:
@@ -617,13 +743,22 @@ DeviceAnalogSensors::checkSafety(DeviceAnalogSensors::t_analogSensor * pAs, bool
 	if (lastSample<pAs->minSample)
 		lastSample=pAs->minSample;
 
-	alarm = (lastSample < pAs->downLimit) || (lastSample > pAs->upperLimit);
+	// Checking the sample and updating the alarm state against a
+	// consistent copy of the limits
+	d_limitsLock.enterMutex();
+
+	l_limits.downLimit = pAs->downLimit;
+	l_limits.upperLimit = pAs->upperLimit;
+	memcpy(l_limits.lvalue, pAs->lvalue, sizeof(t_asValue));
+	memcpy(l_limits.hvalue, pAs->hvalue, sizeof(t_asValue));
+
+	alarm = (lastSample < l_limits.downLimit) || (lastSample > l_limits.upperLimit);
 
 	if ( alarm ) {
-		if ( (lastSample < pAs->downLimit) && (pAs->alarmState != LOW_ALARM) ) {
+		if ( (lastSample < l_limits.downLimit) && (pAs->alarmState != LOW_ALARM) ) {
 			pAs->alarmState = LOW_ALARM;
 			sendNotify = true;
-		} else if ( (lastSample > pAs->upperLimit) && (pAs->alarmState != HIGH_ALARM) ) {
+		} else if ( (lastSample > l_limits.upperLimit) && (pAs->alarmState != HIGH_ALARM) ) {
 			pAs->alarmState = HIGH_ALARM;
 			sendNotify = true;
 		}
@@ -634,8 +769,10 @@ DeviceAnalogSensors::checkSafety(DeviceAnalogSensors::t_analogSensor * pAs, bool
 		}
 	}
 
+	d_limitsLock.leaveMutex();
+
 	if ( p_notify && sendNotify ) {
-		notifyAlarm(pAs);
+		notifyAlarm(pAs, lastSample, l_limits);
 		return alarm;
 	}
 
@@ -644,27 +781,29 @@ DeviceAnalogSensors::checkSafety(DeviceAnalogSensors::t_analogSensor * pAs, bool
 }
 
 void
-DeviceAnalogSensors::notifyAlarm(DeviceAnalogSensors::t_analogSensor * pAs) {
+DeviceAnalogSensors::notifyAlarm(DeviceAnalogSensors::t_analogSensor * pAs,
+				t_channelValue sample, t_asLimits const & limits) {
 	std::ostringstream alarmStr("");
 
-	alarmStr << "Sensor [" << pAs->id << " = " << sampleToValue(pAs) << "] ";
-	alarmStr << "out of safety range [" << setw(7) << setprecision(3) << sampleToValue(pAs, pAs->downLimit);
-	alarmStr << " - " << sampleToValue(pAs, pAs->upperLimit) << "]";
+	alarmStr << "Sensor [" << pAs->id << " = " << sampleToValue(pAs, sample) << "] ";
+	alarmStr << "out of safety range [" << setw(7) << setprecision(3) << sampleToValue(pAs, limits.downLimit);
+	alarmStr << " - " << sampleToValue(pAs, limits.upperLimit) << "]";
 
 	LOG4CPP_WARN(log, "%s", alarmStr.str().c_str());
 
 	DLOG4CPP_WARN(log, "Sensor [%s = %f] out of safety range [%f - %f]",
-				pAs->id, sampleToValue(pAs),
-				sampleToValue(pAs, pAs->downLimit),
-				sampleToValue(pAs, pAs->upperLimit)
+				pAs->id, sampleToValue(pAs, sample),
+				sampleToValue(pAs, limits.downLimit),
+				sampleToValue(pAs, limits.upperLimit)
 			);
 
-	notifySensorEvent(*pAs);
+	notifySensorEvent(*pAs, sample, limits);
 
 }
 
 inline exitCode
-DeviceAnalogSensors::notifySensorEvent(t_analogSensor & aSensor) {
+DeviceAnalogSensors::notifySensorEvent(t_analogSensor & aSensor, t_channelValue sample,
+					t_asLimits const & limits) {
 	comsys::Command * cSgd;
 
 	cSgd = comsys::Command::getCommand(ANALOG_SENSORS_EVENT,
@@ -674,13 +813,16 @@ DeviceAnalogSensors::notifySensorEvent(t_analogSensor & aSensor) {
 		LOG4CPP_FATAL(log, "Unable to build a new Command");
 		return OUT_OF_MEMORY;
 	}
-	cSgd->setParam( "timestamp", d_time->time() );
-	cSgd->setParam( "event",   aSensor.event);
+	// Successive alarms of the same sensor could be coalesced by the dispatcher
+	cSgd->setCoalesceKey(0x10000 | ((unsigned)aSensor.event << 8) |
+			(aSensor.hasParam ? (unsigned)aSensor.param : 0));
+	cSgd->setParam( comsys::Command::LBL_TIMESTAMP, d_time->time() );
+	cSgd->setParam( comsys::Command::LBL_EVENT,   aSensor.event);
 	if (aSensor.hasParam) {
-		cSgd->setParam( "param",  aSensor.param);
+		cSgd->setParam( comsys::Command::LBL_PARAM,  aSensor.param);
 	}
-	cSgd->setParam( "value",  sampleToValue(&aSensor, aSensor.lastSample));
-	cSgd->setParam( "sevent", getAlarmStrEvent(aSensor));
+	cSgd->setParam( comsys::Command::LBL_VALUE,  sampleToValue(&aSensor, sample));
+	cSgd->setParam( "sevent", getAlarmStrEvent(sample, limits));
 
 	// Notifying command
 	notify(cSgd);
@@ -689,13 +831,13 @@ DeviceAnalogSensors::notifySensorEvent(t_analogSensor & aSensor) {
 }
 
 inline std::string
-DeviceAnalogSensors::getAlarmStrEvent(t_analogSensor & aSensor) {
+DeviceAnalogSensors::getAlarmStrEvent(t_channelValue sample, t_asLimits const & limits) {
 
-	if (aSensor.lastSample <= aSensor.downLimit)
-		return aSensor.lvalue;
+	if (sample <= limits.downLimit)
+		return limits.lvalue;
 
-	if (aSensor.lastSample >= aSensor.upperLimit)
-		return aSensor.hvalue;
+	if (sample >= limits.upperLimit)
+		return limits.hvalue;
 
 	return "RangeOk";
 
@@ -808,14 +950,12 @@ float DeviceAnalogSensors::value(std::string asId, bool update) {
 #endif
 
 
-void DeviceAnalogSensors::run(void) {
-
-	threadStartNotify("AS-L");
+timeout_t DeviceAnalogSensors::step(void) {
 
-	// Eventually start the monitor threads (that could generat events)
+	// Eventually start the monitors (that could generat events)
 	startMonitors();
 
-	threadStopNotify();
+	return TASKGENERATOR_STOP;
 }
 
 
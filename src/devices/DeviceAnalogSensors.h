@@ -33,9 +33,10 @@
 #include <cc++/thread.h>
 #include <controlbox/base/Utility.h>
 #include <controlbox/base/Configurator.h>
+#include <controlbox/base/TimerWheel.h>
 #include <controlbox/devices/DeviceTime.h>
 #include <controlbox/devices/DeviceI2CBus.h>
-#include <controlbox/base/comsys/CommandGenerator.h>
+#include <controlbox/base/comsys/TaskGenerator.h>
 
 #define AS_DEFAULT_DEVICE	"/dev/i2c"
 #define AS_DEFAULT_SYSFSBASE	"/sys/bus/i2c/devices"
@@ -87,7 +88,7 @@ namespace device {
 ///	</li>
 /// </ul>
 /// @see CommandHandler
-class DeviceAnalogSensors : public comsys::CommandGenerator, public Device {
+class DeviceAnalogSensors : public comsys::TaskGenerator, public Device, public ConfigurationHandler {
 
 //------------------------------------------------------------------------------
 //				Class Members
@@ -182,6 +183,15 @@ public:
     };
     typedef struct analogSensor t_analogSensor;
 
+    /// The alarm limits of a sensor, a copy taken under the limits lock
+    struct asLimits {
+        unsigned downLimit;			///> the lower limit that trigger an alarm
+        unsigned upperLimit;			///> the upper limit that trigger an alarm
+        t_asValue lvalue;			///> the value associated to a lower limit violation
+        t_asValue hvalue;			///> the value associated to an upper limit violation
+    };
+    typedef struct asLimits t_asLimits;
+
     /// A map of analog sensors.
     typedef map<std::string, t_analogSensor*> t_asMap;
 
@@ -191,15 +201,17 @@ public:
 
 protected:
 
-    class Monitor : public ost::PosixThread {
+    /// A periodic safety check of an analog sensor, run by the TimerWheel
+    class Monitor : public TimerHandler {
     public:
         Monitor(DeviceAnalogSensors * device, t_analogSensor * pAs, timeout_t d_pollTime);
-        ~Monitor() {};
-        void run (void);
+        ~Monitor();
+        void timerExpired(unsigned int timer);
     protected:
         DeviceAnalogSensors * d_device;
         timeout_t d_pollTime;
         t_analogSensor * d_pAs;
+        TimerWheel::t_timerId d_timer;
     };
     // Allowing inner class to access DeviceAnalogSensors members
     friend class Monitor;
@@ -221,6 +233,11 @@ protected:
     /// The map of availables analog sensors
     t_asMap analogSensors;
 
+    /// Protect the sensors alarm limits and alarm states, the limits
+    /// could be updated at run-time by configuration changes.
+    /// @note never held while reading sensors or notifying alarms
+    ost::Mutex d_limitsLock;
+
     /// Whatever some sensors use the i2c device
     bool loadI2C;
 
@@ -245,6 +262,11 @@ public:
     /// Return an instance of an Analo Sensor Device
     static DeviceAnalogSensors * getInstance(std::string const & logName = "DeviceAS");
 
+    /// Check the sensors configuration, without loading the device.
+    /// @return OK if all the defined sensors are valid,
+    ///		AS_CFG_PARSE_ERROR otherwise
+    static exitCode checkConfiguration(Configurator & config, log4cpp::Category & log);
+
     /// Class destructor.
     ~DeviceAnalogSensors();
 
@@ -264,6 +286,10 @@ public:
     ///		or the required device is not alarm monitored.
     inline bool checkSafety(std::string asId);
 
+    /// Update the alarm limits of a sensor on configuration changes.
+    /// Only limits and their associated values are updated, new
+    /// sensors definitions require a restart.
+    void paramChanged(std::string const & param);
 
 
 protected:
@@ -271,7 +297,15 @@ protected:
     /// Create a new DeviceAnalogSensors.
     DeviceAnalogSensors(std::string const & logName);
 
-    inline t_analogSensor * parseCfgString(std::string const & asCfg);
+    /// @param validate set false to parse a configuration string of an
+    ///		already loaded sensor
+    inline t_analogSensor * parseCfgString(std::string const & asCfg, bool validate = true);
+
+    /// Parse a sensor configuration string.
+    /// @return OK on success, AS_CFG_PARSE_ERROR if the configuration
+    ///		string is malformed
+    static exitCode parseSensor(std::string const & asCfg, t_analogSensor * pAs,
+    				log4cpp::Category & log);
 
     inline exitCode loadSensorConfiguration(void);
 
@@ -293,11 +327,15 @@ protected:
     ///		readed for this sensor
     inline float sampleToValue(t_analogSensor * pAs, int theSample = -1);
 
-    inline unsigned valueToSample(t_analogSensor * pAs, float value);
+    static unsigned valueToSample(t_analogSensor * pAs, float value);
+
+    /// Copy the alarm limits of a sensor, under the limits lock
+    inline void getLimits(t_analogSensor * pAs, t_asLimits & limits);
 
-    inline exitCode notifySensorEvent(t_analogSensor & aSensor);
+    inline exitCode notifySensorEvent(t_analogSensor & aSensor, t_channelValue sample,
+                                        t_asLimits const & limits);
 
-    inline std::string getAlarmStrEvent(t_analogSensor & aSensor);
+    inline std::string getAlarmStrEvent(t_channelValue sample, t_asLimits const & limits);
 
     inline t_analogSensor * findById (std::string asId);
 
@@ -312,10 +350,15 @@ protected:
     ///		or the required device is not alarm monitored.
     bool checkSafety(t_analogSensor * pAs, bool notify = false);
 
-    void notifyAlarm(t_analogSensor * pAs);
+    /// Notify an alarm state change.
+    /// @param sample the sample which triggered the change
+    /// @param limits the limits the sample has been checked against
+    void notifyAlarm(t_analogSensor * pAs, t_channelValue sample,
+                        t_asLimits const & limits);
 
-    /// Upload SOAP message's Thread body.
-    void run(void);
+    /// Start the sensors monitors.
+    /// This is run once, by the Executor, when the device is enabled.
+    timeout_t step(void);
 
 };
 
@@ -77,6 +77,9 @@ DeviceDigitalSensors::DeviceDigitalSensors(std::string const & logName) :
 	initSensors();
 	updateSensors();
 
+	// Protecting upload queues from faulty lines flooding events
+	setRateLimit("DigitalSensor");
+
 // 	d_intrLine = atoi(d_config.param("DigitalSensor_PA_intrline", DS_DEFAULT_PA_INTRLINE).c_str());
 // 	LOG4CPP_DEBUG(log, "Using PA interrupt line [%d]", d_intrLine);
 
@@ -516,11 +519,14 @@ DeviceDigitalSensors::notifySensorEvent(t_digitalSensor & aSensor) {
 	}
 
 	cSgd->setPrio(aSensor.prio);
-	cSgd->setParam( "event", aSensor.event);
-	cSgd->setParam( "value", aSensor.lastState);
+	// Successive states of the same line could be coalesced by the dispatcher
+	cSgd->setCoalesceKey(0x10000 | ((unsigned)aSensor.event << 8) |
+			(aSensor.hasParam ? (unsigned)aSensor.param : 0));
+	cSgd->setParam( comsys::Command::LBL_EVENT, aSensor.event);
+	cSgd->setParam( comsys::Command::LBL_VALUE, aSensor.lastState);
 	cSgd->setParam( "status", (aSensor.lastState) ? aSensor.hvalue : aSensor.lvalue);
 	if (aSensor.hasParam) {
-		cSgd->setParam( "param", aSensor.param);
+		cSgd->setParam( comsys::Command::LBL_PARAM, aSensor.param);
 	}
 
 	// TODO right here we could implement a "tasklet" for simila events grouping.
@@ -532,7 +538,7 @@ DeviceDigitalSensors::notifySensorEvent(t_digitalSensor & aSensor) {
 	// Formatting value for DIST protocol
 	buf.str("");
 	buf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)aSensor.event;
-	cSgd->setParam( "dist_evtType", buf.str());
+	cSgd->setParam( comsys::Command::LBL_DIST_EVTTYPE, buf.str());
 
 	buf.str("");
 	switch ( (unsigned)aSensor.event ) {
@@ -544,10 +550,10 @@ DeviceDigitalSensors::notifySensorEvent(t_digitalSensor & aSensor) {
 		buf << (unsigned)aSensor.lastState;
 		break;
 	}
-	cSgd->setParam( "dist_evtData", buf.str() );
+	cSgd->setParam( comsys::Command::LBL_DIST_EVTDATA, buf.str() );
 
 	// FIXME we should use the sensor timestamp for the notification
-	cSgd->setParam( "timestamp", d_time->time() );
+	cSgd->setParam( comsys::Command::LBL_TIMESTAMP, d_time->time() );
 
 	// Notifying command
 	notify(cSgd);
@@ -147,10 +147,10 @@ exitCode DeviceInCabin::qh_SendGenericData (t_query & p_query) {
 
         buf.str("");
         buf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x09;
-        cSgd->setParam( "dist_evtType", buf.str());
+        cSgd->setParam( comsys::Command::LBL_DIST_EVTTYPE, buf.str());
 //         cSgd->setParam( "dist_evtType", 0x09 );
-        cSgd->setParam( "dist_evtData", p_query.value );
-        cSgd->setParam( "timestamp", d_time->time() );
+        cSgd->setParam( comsys::Command::LBL_DIST_EVTDATA, p_query.value );
+        cSgd->setParam( comsys::Command::LBL_TIMESTAMP, d_time->time() );
 
         // Notifying command
         notify(cSgd);
@@ -208,12 +208,12 @@ exitCode DeviceInCabin::qh_SendCodedEvent (t_query & p_query) {
 
         buf.str("");
         buf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x0A;
-        cSgd->setParam( "dist_evtType", buf.str());
+        cSgd->setParam( comsys::Command::LBL_DIST_EVTTYPE, buf.str());
 // 	cSgd->setParam( "dist_evtType", 0x0A );
         buf.str("");
         buf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << p_query.value;
-        cSgd->setParam( "dist_evtData", buf.str() );
-        cSgd->setParam( "timestamp", d_time->time() );
+        cSgd->setParam( comsys::Command::LBL_DIST_EVTDATA, buf.str() );
+        cSgd->setParam( comsys::Command::LBL_TIMESTAMP, d_time->time() );
 
         // Notifying command
         notify(cSgd);
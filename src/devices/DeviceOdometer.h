@@ -32,6 +32,12 @@
 
 #include <controlbox/base/Utility.h>
 #include <controlbox/base/Device.h>
+#include <controlbox/base/comsys/Command.h>
+#include <cstring>
+#include <cstdio>
+
+/// The size of an odometer event timestamp
+#define ODOEVENT_TIMESTAMP_SIZE	25
 
 namespace controlbox {
 namespace device {
@@ -70,6 +76,32 @@ public:
     };
     typedef enum distUnits t_distUnits;
 
+    /// The typed payload of odometer events.
+    /// Events within the DIST range (distType not null) are uploaded,
+    /// the other ones are locally handled.
+    /// @see comsys::TypedCommand
+    struct odoEvent {
+        enum { PAYLOAD_TYPE = controlbox::Device::DEVICE_ODO };
+
+        char timestamp[ODOEVENT_TIMESTAMP_SIZE+1];	///< The event time
+        unsigned char distType;		///< The DIST event code, 0 if none
+        char distData[4];		///< The DIST event data
+
+        /// Export an event as plain params for legacy Handlers
+        static void exportParams(odoEvent const & evt, comsys::Command & command) {
+            char l_type[3];
+
+            command.setParam(comsys::Command::LBL_TIMESTAMP, std::string(evt.timestamp));
+            if ( !evt.distType ) {
+                return;
+            }
+            snprintf(l_type, sizeof(l_type), "%02X", evt.distType);
+            command.setParam(comsys::Command::LBL_DIST_EVTDATA, std::string(evt.distData));
+            command.setParam(comsys::Command::LBL_DIST_EVTTYPE, std::string(l_type));
+        };
+    };
+    typedef struct odoEvent t_odoEvent;
+
 //------------------------------------------------------------------------------
 //				Class Methods
 //------------------------------------------------------------------------------
@@ -45,7 +45,6 @@ DeviceSerial::DeviceSerial(std::string const & base, std::string const & logName
 	char * muxStart = 0;
 	char * confStart = 0;
 	char newTTYConf[128];
-	std::string l_param;
 
 	LOG4CPP_DEBUG(log, "Loading serial device configuration");
 
@@ -85,14 +84,11 @@ DeviceSerial::DeviceSerial(std::string const & base, std::string const & logName
 	d_initString = d_config.param(paramName("tty_initString"),
 					DEVICESERIAL_DEFAULT_INIT_STRING);
 
-	l_param = d_config.param(paramName("tty_flowCtrl"), DEVICESERIAL_DEFAULT_FLOW_CTRL);
-	sscanf(l_param.c_str(), "%u", &d_flowCtrl);
+	d_flowCtrl = d_config.paramInt(paramName("tty_flowCtrl"), DEVICESERIAL_DEFAULT_FLOW_CTRL);
 
-	l_param = d_config.param(paramName("tty_respDelay"), DEVICESERIAL_DEFAULT_RESPONCE_DELAY);
-	sscanf(l_param.c_str(), "%u", &d_respDelay);
+	d_respDelay = d_config.paramInt(paramName("tty_respDelay"), DEVICESERIAL_DEFAULT_RESPONCE_DELAY);
 
-	l_param = d_config.param(paramName("tty_respTimeout"), DEVICESERIAL_DEFAULT_RESPONCE_TIMEOUT);
-	sscanf(l_param.c_str(), "%u", &d_respTimeout);
+	d_respTimeout = d_config.paramInt(paramName("tty_respTimeout"), DEVICESERIAL_DEFAULT_RESPONCE_TIMEOUT);
 
 }
 
@@ -46,10 +46,11 @@ const char *DeviceSignals::signalTriggerName[] = {
 	"BOTH",
 };
 
-DeviceSignals::DeviceSignals(std::string const & logName) :
+DeviceSignals::DeviceSignals(std::string const & logName, bool threaded) :
 	CommandGenerator(logName),
 	Device(Device::DEVICE_SINGALS, logName, logName),
 	d_config(Configurator::getInstance()),
+	d_threaded(threaded),
 	log(Device::log) {
 	DeviceFactory * df = DeviceFactory::getInstance();
 
@@ -72,7 +73,9 @@ DeviceSignals::DeviceSignals(std::string const & logName) :
 	// In that case an abort will happens!!!
 
 	// Start the working thread
-	this->start();
+	if ( d_threaded ) {
+		this->start();
+	}
 
 }
 
@@ -82,7 +85,9 @@ DeviceSignals::~DeviceSignals() {
 	LOG4CPP_INFO(log, "Stopping DeviceSignals");
 
 	d_doExit = true;
-	this->ost::Thread::resume();
+	if ( d_threaded ) {
+		this->ost::Thread::resume();
+	}
 
 	// Cleaning up mappings
 	anH = handlers.begin();
@@ -130,7 +135,9 @@ exitCode DeviceSignals::registerHandler(unsigned short s, SignalHandler * sh, co
 			signalTypeName[s], p_name[0] ? p_name : "UNK", signalTriggerName[t]);
 
 	// Unlocking the Signal thread
-	this->signalThread(SIGCONT);
+	if ( d_threaded ) {
+		this->signalThread(SIGCONT);
+	}
 
 	return OK;
 }
@@ -179,9 +186,9 @@ exitCode DeviceSignals::notifyPower(bool on) {
 		LOG4CPP_FATAL(log, "Unable to build a new Command");
 		return OUT_OF_MEMORY;
 	}
-	cSgd->setParam( "dist_evtType", "0D");
-	cSgd->setParam( "dist_evtData", on ? "1" : "0" );
-	cSgd->setParam( "timestamp", d_time->time() );
+	cSgd->setParam( comsys::Command::LBL_DIST_EVTTYPE, "0D");
+	cSgd->setParam( comsys::Command::LBL_DIST_EVTDATA, on ? "1" : "0" );
+	cSgd->setParam( comsys::Command::LBL_TIMESTAMP, d_time->time() );
 	cSgd->setPrio(0);
 
 	// Notifying command
@@ -200,9 +207,9 @@ exitCode DeviceSignals::notifyDeviceOpen(bool open) {
 		LOG4CPP_FATAL(log, "Unable to build a new Command");
 		return OUT_OF_MEMORY;
 	}
-	cSgd->setParam( "dist_evtType", "22");
-	cSgd->setParam( "dist_evtData", open ? "1" : "0" );
-	cSgd->setParam( "timestamp", d_time->time() );
+	cSgd->setParam( comsys::Command::LBL_DIST_EVTTYPE, "22");
+	cSgd->setParam( comsys::Command::LBL_DIST_EVTDATA, open ? "1" : "0" );
+	cSgd->setParam( comsys::Command::LBL_TIMESTAMP, d_time->time() );
 	cSgd->setPrio(0);
 
 	// Notifying command
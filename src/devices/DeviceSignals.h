@@ -130,6 +130,10 @@ protected:
     /// Number of interrupt handlers registered for each interrupt line
     unsigned short handlersCount[SIGNAL_COUNT];
 
+    /// Set true when signals are waited by the working thread, false for
+    /// event driven implementations (which don't start the thread)
+    bool d_threaded;
+
     /// The logger to use locally.
     log4cpp::Category & log;
 
@@ -168,8 +172,10 @@ protected:
     /// In order to get a valid instance of that class
     /// the builder method shuld be used.
     /// @param logName the log category.
+    /// @param threaded set false if the subclass is event driven, thus
+    ///		the working thread, waiting for interrupts, is not required
     /// @see getInstance
-    DeviceSignals(std::string const & logName);
+    DeviceSignals(std::string const & logName, bool threaded = true);
    
     /// Notify Power State
     exitCode notifyPower(bool on);
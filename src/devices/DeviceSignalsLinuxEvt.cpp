@@ -34,7 +34,7 @@ namespace device {
 DeviceSignalsLinuxEvt * DeviceSignalsLinuxEvt::d_instance = 0;
 
 DeviceSignalsLinuxEvt::DeviceSignalsLinuxEvt(std::string const & logName) :
-	DeviceSignals(logName) {
+	DeviceSignals(logName, false) {
 
 
 	d_eventsPath = d_config.param("Signal_input_event", DEFAULT_SIGNAL_INPUT_EVENT);
@@ -43,15 +43,25 @@ DeviceSignalsLinuxEvt::DeviceSignalsLinuxEvt(std::string const & logName) :
 	if ((d_fdEvents = ::open(d_eventsPath.c_str(), O_RDONLY))<0) {
 		LOG4CPP_ERROR(log, "failed to open input event interface [%s], %s\n", d_eventsPath.c_str(), strerror(errno));
 		d_fdEvents = 0;
+		return;
 	}
+
+	// Input events are read by the Reactor thread
+	fcntl(d_fdEvents, F_SETFL, O_NONBLOCK);
+	if ( Reactor::getInstance()->watch(d_fdEvents, this) != OK ) {
+		LOG4CPP_ERROR(log, "failed watching input event interface [%s]", d_eventsPath.c_str());
+	}
+
 }
 
 
 
 DeviceSignalsLinuxEvt::~DeviceSignalsLinuxEvt() {
 
-	if (d_fdEvents)
+	if (d_fdEvents) {
+		Reactor::getInstance()->unwatch(d_fdEvents);
 		::close(d_fdEvents);
+	}
 
 }
 
@@ -112,6 +122,29 @@ exitCode DeviceSignalsLinuxEvt::waitInterrupt(t_signalMask & status) {
 	return OK;
 }
 
+void DeviceSignalsLinuxEvt::fdReady(int fd, unsigned int events) {
+	struct input_event event;
+	int result;
+
+	while ( (result = ::read(d_fdEvents, &event, sizeof(struct input_event))) > 0 ) {
+		LOG4CPP_DEBUG(log, "input event, time: %ld.%ld, type: 0x%X, code: 0x%X, value: %d",
+				event.time.tv_sec, event.time.tv_usec,
+				event.type, event.code, event.value);
+	}
+
+	if ( result < 0 && errno != EAGAIN ) {
+		LOG4CPP_ERROR(log, "failed reading input event, %s", strerror(errno));
+	}
+
+	// The Reactor drops the watch: no more events will be notified
+	if ( events & (Reactor::FD_ERROR|Reactor::FD_HANGUP) ) {
+		LOG4CPP_ERROR(log, "input event interface [%s] %s, events disabled",
+				d_eventsPath.c_str(),
+				(events & Reactor::FD_ERROR) ? "failed" : "hung up");
+	}
+
+}
+
 
 }// namespace device
 }// namespace controlbox
@@ -31,6 +31,7 @@
 
 #include <controlbox/base/Utility.h>
 #include <controlbox/base/Configurator.h>
+#include <controlbox/base/Reactor.h>
 #include <controlbox/devices/DeviceSignals.h>
 
 
@@ -40,8 +41,10 @@
 namespace controlbox {
 namespace device {
 
-/// A DeviceSignals for AXIS platform.
-class DeviceSignalsLinuxEvt : public DeviceSignals {
+/// A DeviceSignals based on the Linux input events interface.
+/// This implementation is event driven: the input events file is watched
+/// by the shared Reactor, thus no dedicated thread is required.
+class DeviceSignalsLinuxEvt : public DeviceSignals, public ReactorHandler {
 
 public:
 
@@ -76,6 +79,9 @@ protected:
     /// Wait for an interrupt to happens
     exitCode waitInterrupt(t_signalMask & status);
 
+    /// Read the input events available
+    void fdReady(int fd, unsigned int events);
+
 };
 
 } //namespace device
@@ -66,9 +66,6 @@ DeviceTime * DeviceTime::getInstance(std::string const & logName) {
 }
 
 string DeviceTime::time(bool utc) const {
-	char str[26];
-	time_t t;
-	struct tm *tmp;
 	std::string strTime;
 
 	LOG4CPP_DEBUG(log, "time(utc=%s)", utc ? "YES" : "NO" );
@@ -90,23 +87,13 @@ string DeviceTime::time(bool utc) const {
 	}
 
 	// Last chanche: use systime
-	t = std::time(0);
-	tmp = localtime(&t);
-	if (tmp == NULL) {
-		LOG4CPP_ERROR(log, "Unable to get locatime");
+	strTime = Utils::isoTime();
+	if ( !strTime.size() ) {
+		LOG4CPP_ERROR(log, "Failure on system time formatting");
 		return string("1970-01-01T00:00:00+00:00");
 	}
-	if (strftime(str, 25, "%FT%T%z", tmp) == 0) {
-		LOG4CPP_ERROR(log, "Failure on time formatting");
-		return string("1970-01-01T00:00:00+00:00");
-	}
-	// Adjusting TimeZone...
-	str[24] = str[23];
-	str[23] = str[22];
-	str[22] = ':';
-	str[25] = 0;
 
-	return string(str);
+	return strTime;
 
 }
 
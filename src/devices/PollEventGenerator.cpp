@@ -37,6 +37,7 @@ PollEventGenerator::PollEventGenerator(timeout_t p_pollTime, std::string const &
         Device(Device::EG_POLLER, p_pollTime, logName),
         comsys::EventGenerator(logName),
         d_pollTime(p_pollTime),
+        d_timer(0),
         log(Device::log) {
 
     LOG4CPP_DEBUG(log, "PollEventGenerator(unsigned int, std::string const &)");
@@ -56,6 +57,7 @@ PollEventGenerator::PollEventGenerator(timeout_t p_pollTime, comsys::Dispatcher
         // NOTE we must ensure the pollTime is set correctly before starting the thread (if enabled)
         comsys::EventGenerator(dispatcher, false, logName),
         d_pollTime(p_pollTime),
+        d_timer(0),
         log(Device::log) {
 
     LOG4CPP_DEBUG(log, "PollEventGenerator(unsigned int, Dispatcher *, bool, string const &)");
@@ -64,7 +66,7 @@ PollEventGenerator::PollEventGenerator(timeout_t p_pollTime, comsys::Dispatcher
     dbReg(true);
 
     if ( enabled ) {
-	this-enable();
+	enable();
     }
 
 }
@@ -72,13 +74,12 @@ PollEventGenerator::PollEventGenerator(timeout_t p_pollTime, comsys::Dispatcher
 
 PollEventGenerator::~PollEventGenerator() {
 
-    LOG4CPP_INFO(log, "Terminating the PollEventGenerator events generation thread... ");
+    LOG4CPP_INFO(log, "Terminating the PollEventGenerator events generation... ");
 
-    // Thread::terminate() should always be called at the start of any
-    // destructor of a class derived from Thread to assure the remaining
-    // part of the destructor is called without the thread still executing.
-    this->terminate();
-    threadStopNotify();
+    // Once canceled the timer handler is granted to be not running
+    if ( d_timer ) {
+        TimerWheel::getInstance()->cancel(d_timer);
+    }
 
 }
 
@@ -89,7 +90,16 @@ exitCode PollEventGenerator::setPollTime(timeout_t p_pollTime, bool reset) {
 
     d_pollTime = p_pollTime;
 
-    return OK;
+    if ( !d_enabled || !d_timer ) {
+        return OK;
+    }
+
+    if ( reset ) {
+        LOG4CPP_DEBUG(log, "Restarting polling with a [%lu]ms interval", d_pollTime);
+        return TimerWheel::getInstance()->reschedule(d_timer, d_pollTime, d_pollTime);
+    }
+
+    return TimerWheel::getInstance()->setPeriod(d_timer, d_pollTime);
 
 }
 
@@ -102,6 +112,51 @@ timeout_t PollEventGenerator::pollTime() const {
 
 }
 
+exitCode PollEventGenerator::enable() {
+
+    LOG4CPP_DEBUG(log, "PollEventGenerator::enable()");
+
+    if ( !d_dispatcher ) {
+        LOG4CPP_ERROR(log, "Trying to enable a generator without a linked Dispatcher");
+        return CS_DISPATCH_FAILURE;
+    }
+
+    if ( d_enabled ) {
+        return OK;
+    }
+
+    LOG4CPP_INFO(log, "Starting polling every [%lu]ms", d_pollTime);
+    d_timer = TimerWheel::getInstance()->schedule(this, d_pollTime, d_pollTime);
+    if ( !d_timer ) {
+        LOG4CPP_ERROR(log, "Failed scheduling the polling timer");
+        return GENERIC_ERROR;
+    }
+
+    d_enabled = true;
+    return OK;
+
+}
+
+exitCode PollEventGenerator::disable() {
+    TimerWheel::t_timerId l_timer = d_timer;
+
+    LOG4CPP_DEBUG(log, "PollEventGenerator::disable()");
+
+    d_enabled = false;
+    d_timer = 0;
+    if ( l_timer ) {
+        TimerWheel::getInstance()->cancel(l_timer);
+    }
+
+    return OK;
+
+}
+
+void PollEventGenerator::timerExpired(unsigned int timer) {
+    LOG4CPP_DEBUG(log, "Polling");
+    notify(false);
+}
+
 void PollEventGenerator::trigger() {
 	LOG4CPP_DEBUG(log, "Async Polling");
 	notify(false);
@@ -109,16 +164,7 @@ void PollEventGenerator::trigger() {
 
 void   PollEventGenerator::run (void) {
 
-    threadStartNotify("POLL");
-
-    while (true) {
-        LOG4CPP_DEBUG(log, "Next poll within %d ms", d_pollTime);
-        sleep(d_pollTime);
-        LOG4CPP_DEBUG(log, "Polling");
-        notify(false);
-    }
-
-    threadStopNotify();
+    LOG4CPP_WARN(log, "Polling events are generated by the TimerWheel");
 
 }
 
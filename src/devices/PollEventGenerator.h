@@ -34,6 +34,7 @@
 #include <controlbox/base/Utility.h>
 #include <controlbox/base/comsys/EventGenerator.h>
 #include <controlbox/base/Device.h>
+#include <controlbox/base/TimerWheel.h>
 #include <string>
 
 
@@ -46,9 +47,11 @@ namespace device {
 /// ciclically generate a new event every pollTime milliseconds.
 /// This events are disapatched to the associated Disaptcher when the
 /// class is in the enabled state: otherwise poll events are definitively
-/// lost.
+/// lost.<br>
+/// Polling events are generated by a periodic timer of the shared
+/// TimerWheel: no dedicated thread is used.
 /// @see EventGenerator
-class PollEventGenerator : public Device, public comsys::EventGenerator {
+class PollEventGenerator : public Device, public comsys::EventGenerator, public TimerHandler {
 
 public:
     /// Generated Messages
@@ -61,6 +64,9 @@ protected:
 
     timeout_t d_pollTime;
 
+    /// The polling timer, 0 if not scheduled
+    TimerWheel::t_timerId d_timer;
+
     /// The logger to use locally.
     log4cpp::Category & log;
 
@@ -111,6 +117,14 @@ public:
     /// @return OK on success
     exitCode setPollTime(timeout_t pollTime, bool reset = false);
 
+    /// Enable the generation of polling events.
+    /// The first event is generated pollTime milliseconds later.
+    /// @return OK on success, CS_DISPATCH_FAILURE if a Dispatcher is not defined
+    exitCode enable();
+
+    /// Disable the generation of polling events.
+    exitCode disable();
+
     /// Return the current pollTime
     /// @return the current pollTime in milliseconds
     timeout_t pollTime() const;
@@ -121,10 +135,11 @@ public:
 
 protected:
 
-    /// The thread cycle
-    /// This method, hinerited from Thread class, it's a simple
-    /// thread body that: sleep for pollTime milliseconds, awke sending
-    /// a pollEvent (if enabled), and so on in an endless loop.
+    /// Send a pollEvent on polling timer expiration
+    void timerExpired(unsigned int timer);
+
+    /// The thread cycle.
+    /// Not used: polling events are generated by the TimerWheel.
     void   run (void);
 
 };
@@ -94,10 +94,10 @@ DeviceArdu::DeviceArdu(std::string const & logName) :
 	d_sysfspath += "/" + d_config.param("Odometer_i2cAddress", ARDU_DEFAULT_I2CADDR);
 	LOG4CPP_INFO(log, "Sysfspath [%s]", d_sysfspath.c_str());
 
-	d_intrLine = atoi(d_config.param("Odometer_PA_intrline", ARDU_DEFAULT_PA_INTRLINE).c_str());
+	d_intrLine = d_config.paramInt("Odometer_PA_intrline", ARDU_DEFAULT_PA_INTRLINE);
 	LOG4CPP_INFO(log, "Using PA interrupt line [%d]", d_intrLine);
 
-	d_ppm = atoi(d_config.param("Odometer_ppm", ARDU_DEFAULT_PPM).c_str());
+	d_ppm = d_config.paramInt("Odometer_ppm", ARDU_DEFAULT_PPM);
 	LOG4CPP_INFO(log, "PPM [%d]", d_ppm);
 
 	d_highSpeedAlarm = (unsigned)strtoul(
@@ -311,9 +311,12 @@ DeviceArdu::time(bool utc) {
 
 exitCode
 DeviceArdu::notifyOdoEvent(unsigned short event) {
-	comsys::Command * cOdoEvent;
+	comsys::Command * cOdoEvent = 0;
 	int eventCode;
+	unsigned short prio = 2;
 	DeviceOdometer::t_cmdType cmdType;
+	bool hasValue = false;
+	double value = 0;
 
 	switch (event) {
 	case MOVE:
@@ -329,12 +332,16 @@ DeviceArdu::notifyOdoEvent(unsigned short event) {
 	case OVER_SPEED:
 		cmdType = DeviceOdometer::ODOMETER_EVENT_OVER_SPEED;
 		eventCode = 0x17;
-		cOdoEvent->setParam( "value", odoSpeed() );
+		prio = 1;
+		hasValue = true;
+		value = odoSpeed();
 		break;
 	case EMERGENCY_BREAK:
 		cmdType = DeviceOdometer::ODOMETER_EVENT_EMERGENCY_BREAK;
 		eventCode = 0x23;
-		cOdoEvent->setParam( "value", 0 );
+		prio = 1;
+		hasValue = true;
+		value = 0;
 		break;
 	default:
 		LOG4CPP_DEBUG(log, "Not an ODO event");
@@ -353,8 +360,12 @@ DeviceArdu::notifyOdoEvent(unsigned short event) {
 		LOG4CPP_FATAL(log, "Unable to build a new Command");
 		return OUT_OF_MEMORY;
 	}
-	cOdoEvent->setParam( "timestamp", d_time->time() );
-	cOdoEvent->setParam( "event",   eventCode);
+	cOdoEvent->setParam( comsys::Command::LBL_TIMESTAMP, d_time->time() );
+	cOdoEvent->setParam( comsys::Command::LBL_EVENT,   eventCode);
+	if ( hasValue ) {
+		cOdoEvent->setParam( comsys::Command::LBL_VALUE, value );
+	}
+	cOdoEvent->setPrio(prio);
 
 	// Notifying command
 	notify(cOdoEvent);
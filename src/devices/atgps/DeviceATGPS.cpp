@@ -107,34 +107,32 @@ DeviceATGPS::DeviceATGPS(std::string const & logName) :
 // 	d_intrLine = atoi(d_config.param("device_atgps_intr_PA_pin", ATGPS_DEFAULT_PA_INTRLINE).c_str());
 // 	LOG4CPP_DEBUG(log, "Using PA interrupt line [%d]", d_intrLine);
 
-	d_ppm = atoi(d_config.param("device_atgps_ppm", ATGPS_DEFAULT_PPM).c_str());
+	d_ppm = d_config.paramInt("device_atgps_ppm", ATGPS_DEFAULT_PPM);
 	LOG4CPP_INFO(log, "PPM [%d]", d_ppm);
 
-	d_highSpeedAlarm = (unsigned)strtoul(
-		d_config.param("device_atgps_hiSpeedAlarm", ATGPS_DEFAULT_HIGHSPEED_ALARM).c_str(),
-		(char **)NULL, 10);
+	d_highSpeedAlarm = (unsigned)d_config.paramInt("device_atgps_hiSpeedAlarm",
+		ATGPS_DEFAULT_HIGHSPEED_ALARM);
 	LOG4CPP_INFO(log, "HighSpeedAlarm [%d m/s]", d_highSpeedAlarm);
 
-	d_maxSpeed = (unsigned)strtoul(
-		d_config.param("device_atgps_maxSpeed", ATGPS_DEFAULT_MAXSPEED).c_str(),
-		(char **)NULL, 10);
+	d_maxSpeed = (unsigned)d_config.paramInt("device_atgps_maxSpeed",
+		ATGPS_DEFAULT_MAXSPEED);
 	LOG4CPP_INFO(log, "MaxSpeed [%d m/s]", d_maxSpeed);
 
-	d_emergencyBreakAlarm = (unsigned)strtoul(
-		d_config.param("device_atgps_emergencyBreak", ATGPS_DEFAULT_EMERGENCY_BREAK).c_str(),
-		(char **)NULL, 10);
+	d_emergencyBreakAlarm = (unsigned)d_config.paramInt("device_atgps_emergencyBreak",
+		ATGPS_DEFAULT_EMERGENCY_BREAK);
 	LOG4CPP_INFO(log, "EmergencyBreakAlarm [%d m/s^2]", d_emergencyBreakAlarm);
 
-	d_distanceAlarm = strtoul(
-		d_config.param("device_atgps_distanceAlarm", ATGPS_DEFAULT_DISTANCE_ALARM).c_str(),
-		(char **)NULL, 10);
+	d_distanceAlarm = d_config.paramInt("device_atgps_distanceAlarm",
+		ATGPS_DEFAULT_DISTANCE_ALARM);
 	LOG4CPP_INFO(log, "DistanceAlarm [%d m]", d_distanceAlarm);
 
-	d_initDistance = strtoul(
-		d_config.param("device_atgps_initDistance", ATGPS_DEFAULT_INIT_DISTANCE).c_str(),
-		(char **)NULL, 10);
+	d_initDistance = d_config.paramInt("device_atgps_initDistance",
+		ATGPS_DEFAULT_INIT_DISTANCE);
 	LOG4CPP_INFO(log, "InitDistance [%d m]", d_initDistance);
 
+	// Protecting upload queues from alarms storms
+	setRateLimit("device_atgps");
+
 	initDevice();
 
 }
@@ -562,10 +560,11 @@ exitCode
 DeviceATGPS::notifyEvent(unsigned short event) {
 	comsys::Command::t_cmdType cmdt;
 	comsys::Command * cSgd = 0;
-	int eventCode = 0x00;
+	t_odoEvent evt;
 	unsigned short prio = 2;
 	unsigned int speed = 0;
-	std::ostringstream sbuf("");
+
+	memset(&evt, 0, sizeof(t_odoEvent));
 
 	switch (event) {
 	case MOVE:
@@ -578,20 +577,20 @@ DeviceATGPS::notifyEvent(unsigned short event) {
 		break;
 	case OVER_SPEED:
 		cmdt = ODOMETER_EVENT_OVER_SPEED;
-		eventCode = 0x17;
+		evt.distType = 0x17;
 		prio = 1;
 		speed = (unsigned int)odoSpeed(DeviceOdometer::KMH);
 		if ( speed > (d_maxSpeed*3.6) ) {
 			speed = (unsigned int)(d_maxSpeed*3.6);
 		}
-		sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << speed;
+		snprintf(evt.distData, sizeof(evt.distData), "%02X", speed);
 		LOG4CPP_INFO(log, "OVER_SPEED Event");
 		break;
 	case EMERGENCY_BREAK:
 		cmdt = ODOMETER_EVENT_EMERGENCY_BREAK;
-		eventCode = 0x23;
+		evt.distType = 0x23;
 		prio = 1;
-		sbuf << "0";
+		evt.distData[0] = '0';
 		LOG4CPP_INFO(log, "EMERGENCY_BREAK Event");
 		break;
 	case SAFE_SPEED:
@@ -615,14 +614,18 @@ DeviceATGPS::notifyEvent(unsigned short event) {
 		return ATGPS_EVENT_UNDEFINED;
 	}
 
+	strncpy(evt.timestamp, d_time->time().c_str(), ODOEVENT_TIMESTAMP_SIZE);
+
+	// NOTE events carry a typed payload: params are built only if
+	// some Handler asks for them
 	if ( event <= EMERGENCY_BREAK) {
-		cSgd = comsys::Command::getCommand(cmdt,
+		cSgd = comsys::TypedCommand<t_odoEvent>::getCommand(cmdt,
 				Device::DEVICE_ODO, "DEVICE_ODO",
-				log.getName());
+				evt, log.getName());
 	} else {
-		cSgd = comsys::Command::getCommand(cmdt,
+		cSgd = comsys::TypedCommand<t_odoEvent>::getCommand(cmdt,
 				Device::DEVICE_GPS, "DEVICE_GPS",
-				log.getName());
+				evt, log.getName());
 	}
 
 	if ( !cSgd ) {
@@ -630,17 +633,8 @@ DeviceATGPS::notifyEvent(unsigned short event) {
 		return OUT_OF_MEMORY;
 	}
 
-	cSgd->setParam("timestamp", d_time->time() );
 	cSgd->setPrio(prio);
 
-	if ( eventCode ) {
-		// This is a DIST event
-		cSgd->setParam("dist_evtData", sbuf.str() );
-		sbuf.str("");
-		sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)eventCode;
-		cSgd->setParam("dist_evtType", sbuf.str());
-	}
-
 	// Notifying command
 	notify(cSgd);
 
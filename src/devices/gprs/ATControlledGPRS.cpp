@@ -71,13 +71,11 @@ DeviceGPRS::DeviceGPRS(short module, t_gprs_models model, std::string const
 	// Loading the TTY port configuration string
 	d_ttyConfig = d_config.param(paramName("tty"), DEVICEGPRS_DEFAULT_GPRS_DEVICE);
 
-	sscanf(d_config.param(paramName("atDelay"),
-				DEVICEGPRS_DEFAULT_AT_RESPONCE_DELAY).c_str(),
-		"%i", &d_atResponceDelay);
+	d_atResponceDelay = d_config.paramInt(paramName("atDelay"),
+				DEVICEGPRS_DEFAULT_AT_RESPONCE_DELAY);
 
-	sscanf(d_config.param(paramName("cmdEscape"),
-				DEVICEGPRS_DEFAULT_AT_CMD_ESCAPE).c_str(),
-		"%i", &d_atCmdEscape);
+	d_atCmdEscape = d_config.paramInt(paramName("cmdEscape"),
+				DEVICEGPRS_DEFAULT_AT_CMD_ESCAPE);
 
 	d_atInitString = d_config.param(paramName("atInitString"),
 				DEVICEGPRS_DEFAULT_AT_INIT_STRING);
@@ -1389,7 +1387,7 @@ DeviceGPRS::updateState(t_netStatus state) {
 		LOG4CPP_FATAL(log, "Unable to build a new Command for GPRS state update");
 		return OUT_OF_MEMORY;
 	}
-	cGprsState->setParam( "state",  state);
+	cGprsState->setParam( comsys::Command::LBL_STATE,  state);
 	//cGprsState->setParam( "descr",  sstate[state]);
 
 	// Notifying command
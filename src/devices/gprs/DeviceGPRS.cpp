@@ -389,6 +389,58 @@ DeviceGPRS::loadAPNConf(unsigned int apnId, std::string & apnName, t_netlink & c
 }
 
 
+exitCode
+DeviceGPRS::checkConfiguration(Configurator & config, log4cpp::Category & log) {
+	std::ostringstream lable("");
+	std::string linkConf;
+	exitCode result = OK;
+	unsigned short module;
+	unsigned short i;
+	char simId, apnId;
+
+	for (module=0; module<10; module++) {
+
+		lable.str("");
+		lable << "gprs_modem_" << module << "_links";
+		linkConf = config.param(lable.str(), "");
+		if ( !linkConf.size() ) {
+			continue;
+		}
+
+		// Same sintax used by loadNetLinks:
+		// 	sim,linkid[:sim,linkid[...]]
+		for (i=0; i<linkConf.size(); i+=4) {
+			if ( i+3 > linkConf.size() || linkConf[i+1] != ',' ||
+				(i+3 < linkConf.size() && linkConf[i+3] != ':') ||
+				i+4 == linkConf.size() ||
+				!isdigit(linkConf[i]) || !isdigit(linkConf[i+2]) ) {
+				LOG4CPP_ERROR(log, "Malformed netlinks [%s] on [%s]",
+						linkConf.c_str(), lable.str().c_str());
+				result = GPRS_NETLINK_PARSE_ERROR;
+				break;
+			}
+			simId = linkConf[i];
+			apnId = linkConf[i+2];
+
+			if ( simId != '1' && simId != '2' ) {
+				LOG4CPP_ERROR(log, "Unsupported SIM number [%c] on [%s]",
+						simId, lable.str().c_str());
+				result = GPRS_NETLINK_PARSE_ERROR;
+			}
+
+			if ( !config.param(std::string("gprs_apn_") + apnId + "_name", "").size() ) {
+				LOG4CPP_ERROR(log, "Undefined APN [%c] on [%s]",
+						apnId, lable.str().c_str());
+				result = GPRS_NETLINK_NOT_SUPPORTED;
+			}
+		}
+
+	}
+
+	return result;
+
+}
+
 #if 0
 // This code has been replaced by the usage of DeviceSerial
 exitCode
@@ -719,7 +771,7 @@ DeviceGPRS::updateState(t_netStatus state) {
 		LOG4CPP_FATAL(log, "Unable to build a new Command for GPRS state update");
 		return OUT_OF_MEMORY;
 	}
-	cGprsState->setParam( "state",  state);
+	cGprsState->setParam( comsys::Command::LBL_STATE,  state);
 	cGprsState->setParam( "descr",  d_netStatusStr[state]);
 
 	// Notifying command
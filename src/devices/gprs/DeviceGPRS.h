@@ -331,6 +331,14 @@ class DeviceGPRS:public comsys::CommandGenerator, public Device {
 					std::string const &logName =
 				       "DeviceGPRS");
 
+	/// Check the netlinks configuration of all the modules, without
+	/// loading any device.
+	/// @return OK if all the defined netlinks are valid,
+	///		GPRS_NETLINK_PARSE_ERROR on malformed links definitions,
+	///		GPRS_NETLINK_NOT_SUPPORTED on links to undefined APNs
+	static exitCode checkConfiguration(Configurator & config,
+					log4cpp::Category & log);
+
 	/// Class destructor.
 	virtual ~DeviceGPRS();
 
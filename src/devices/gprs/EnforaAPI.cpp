@@ -60,7 +60,8 @@ EnforaAPI::EnforaAPI(short module, std::string const & logName)
 	throw (exceptions::SerialConfigurationException*) :
         DeviceGPRS(module, DeviceGPRS::DEVICEGPRS_MODEL_ENFORA, logName),
 	d_gpio(0),
-        d_apiEnabled(false) {
+        d_apiEnabled(false),
+	d_tdb(ThreadDB::getInstance()) {
 	DeviceFactory * df = DeviceFactory::getInstance();
 	exitCode result;
 
@@ -597,6 +598,8 @@ EnforaAPI::addHeader(t_apiCommand & msg, t_apiType t, bool toString) {
 
 exitCode
 EnforaAPI::sendAT(t_apiCommand & msg, t_apiResponce & resp, unsigned int timeout) {
+	// Marking the calling thread busy while waiting for the modem
+	HeartbeatScope l_busy(d_tdb->currentHeartbeat(), "sendAT");
 	int net_result = GPRS_RESET_REQUIRED;
 	exitCode result = OK;
 	unsigned short retry;
@@ -33,6 +33,7 @@
 #include <controlbox/devices/gprs/DeviceGPRS.h>
 #include <controlbox/devices/DeviceGPIO.h>
 #include <controlbox/base/Utility.h>
+#include <controlbox/base/ThreadDB.h>
 
 #define ENFORAAPI_API_HEADER_SIZE	4
 #define ENFORAAPI_API_HEADER_TYPE_POS	2
@@ -107,6 +108,9 @@ protected:
 	/// Set true when the API is enabled
 	bool d_apiEnabled;
 
+	/// The threads registry, used to mark AT commands round trips
+	ThreadDB * d_tdb;
+
 	std::string d_curLinkname;
 
 	/// The modem
@@ -44,9 +44,8 @@ char const * DeviceTE::eventDescr[] = {
 
 DeviceTE::DeviceTE(t_teModels model, std::string const & logName)
 	throw (exceptions::SerialDeviceException*) :
-	CommandGenerator(logName),
+	TaskGenerator(logName),
 	Device(Device::DEVICE_TE, model, logName),
-	d_doExit(false),
 	d_config(Configurator::getInstance()),
 	d_model(model),
 	d_tty(0),
@@ -55,7 +54,6 @@ DeviceTE::DeviceTE(t_teModels model, std::string const & logName)
 #endif
 	log(Device::log) {
 	DeviceFactory * df = DeviceFactory::getInstance();
-	std::string l_param;
 
 	LOG4CPP_DEBUG(log, "DeviceTE(std::string const &)");
 
@@ -65,25 +63,27 @@ DeviceTE::DeviceTE(t_teModels model, std::string const & logName)
 		throw new exceptions::SerialDeviceException("Unable to build a SerialDevice");
 	}
 
+	// The serial download must not hold an Executor worker
+	setDedicated();
+
 	// Loading configuration params
-	l_param = d_config.param("device_te_polling_delay", DEVICETE_DEFAULT_POLLING_DELAY, true);
-	sscanf(l_param.c_str(), "%i", &d_pollInterval);
+	d_pollInterval = d_config.paramInt("device_te_polling_delay", DEVICETE_DEFAULT_POLLING_DELAY);
+	d_config.subscribe("device_te_polling_delay", this);
 
-	l_param = d_config.param("device_te_retry", DEVICETE_DEFAULT_RETRY, true);
-	sscanf(l_param.c_str(), "%hu", &d_retry);
+	d_retry = d_config.paramInt("device_te_retry", DEVICETE_DEFAULT_RETRY);
 
-	d_forceRawUpload = d_config.testParam("device_te_forceRawUpload", DEVICETE_FORCERAW);
+	d_forceRawUpload = d_config.paramBool("device_te_forceRawUpload");
 	if ( d_forceRawUpload ) {
 		LOG4CPP_INFO(log, "Forcing RAW messages upload");
 	}
 
-	d_dupRawUpload = d_config.testParam("device_te_dupRawUpload", DEVICETE_DUPLICATE_RAW);
+	d_dupRawUpload = d_config.paramBool("device_te_dupRawUpload");
 	if ( d_forceRawUpload ) {
 		LOG4CPP_INFO(log, "Enabling duplicate upload for RAW messages");
 	}
 
 #ifdef DARICOMDEBUG
-	d_forceDownload = d_config.testParam("device_te_force", DEVICETE_FORCE);
+	d_forceDownload = d_config.paramBool("device_te_force");
 	if ( d_forceDownload ) {
 		LOG4CPP_WARN(log, "Checksum verification on TE record download is DISABLED");
 	}
@@ -112,7 +112,7 @@ DeviceTE * DeviceTE::getInstance() {
 		return d_instance;
 	}
 
-	model = (t_teModels) atoi (config.param("device_te_model", DEVICETE_DEFAULT_MODEL).c_str());
+	model = (t_teModels) config.paramInt("device_te_model", DEVICETE_DEFAULT_MODEL);
 
 	switch ( model ) {
 		case SAMPI500:
@@ -133,6 +133,8 @@ DeviceTE * DeviceTE::getInstance() {
 }
 
 DeviceTE::~DeviceTE() {
+	d_config.unsubscribe(this);
+	stopSteps();
 	d_tty->closeSerial();
 	delete(d_tty);
 }
@@ -159,6 +161,7 @@ inline
 exitCode DeviceTE::notifyEvents(void) {
 	t_event * l_event;
 	comsys::Command * cSgd;
+	std::vector<comsys::Command *> l_batch;
 	bool rawNotify = false;
 
 	while ( !d_eventsToNotify.empty() ) {
@@ -186,10 +189,13 @@ exitCode DeviceTE::notifyEvents(void) {
 			cSgd = comsys::Command::getCommand(DeviceTE::SEND_TE_EVENT, Device::DEVICE_TE, "DEVICE_TE", name());
 			if ( !cSgd ) {
 				LOG4CPP_FATAL(log, "Unable to build a new Command");
+				if ( l_batch.size() ) {
+					notifyBatch(&l_batch[0], l_batch.size());
+				}
 				return OUT_OF_MEMORY;
 			}
 			// Setting event param
-			cSgd->setParam( "type", eventDescr[l_event->type]);
+			cSgd->setParam( comsys::Command::LBL_TYPE, eventDescr[l_event->type]);
 
 			// Setting priority
 			cSgd->setPrio(3);
@@ -198,16 +204,16 @@ exitCode DeviceTE::notifyEvents(void) {
 			formatEvent(*l_event, *cSgd);
 
 			// Checking if a "timestamp" has been defined, otherwise we add a local timestamp
-			if ( !cSgd->hasParam("timestamp") ) {
+			if ( !cSgd->hasParam(comsys::Command::LBL_TIMESTAMP) ) {
 				LOG4CPP_DEBUG(log, "No timestamp parsed from TE event");
 				// TODO: Should we set also a timestamp?
-				cSgd->setParam( "timestamp", d_time->time() );
+				cSgd->setParam( comsys::Command::LBL_TIMESTAMP, d_time->time() );
 			}
 
 			//cSgd->setParam( "event",  formatEvent(*l_event));
 
-			// Notifying the command
-			notify(cSgd);
+			// Queuing the command for a batched notification
+			l_batch.push_back(cSgd);
 
 			if (l_event->type != UNDEF) {
 				rawNotify = true;
@@ -225,47 +231,64 @@ exitCode DeviceTE::notifyEvents(void) {
 		delete l_event;
 
 	}
+
+	// Notifying all the commands with a single dispatch
+	if ( l_batch.size() ) {
+		notifyBatch(&l_batch[0], l_batch.size());
+	}
+
 	return OK;
 }
 
-void DeviceTE::run (void) {
-	exitCode downloadExitCode;
+void DeviceTE::paramChanged(std::string const & param) {
+	unsigned int l_pollInterval;
 
-	threadStartNotify("TE");
-
-	d_doExit = false;
-	while ( !d_doExit ) {
-
-		// NOTE by setting d_pollInterval==0 we disable the TE polling query
-		if (d_pollInterval) {
-
-			downloadExitCode = downloadEvents(d_eventsToNotify);
-
-			switch ( downloadExitCode ) {
-				case OK:
-					notifyEvents();
-					break;
-				case TE_NO_NEW_EVENTS:
-					break;
-				case TE_NOT_RESPONDING:
-					LOG4CPP_DEBUG(log, "Device TE not responding");
-					break;
-				case TE_RESTART_DOWNLOAD:
-					LOG4CPP_DEBUG(log, "Retrying download");
-					continue;
-				default:
-					LOG4CPP_WARN(log, "Anomal result code");
-					break;
-			}
+	l_pollInterval = d_config.paramInt("device_te_polling_delay", DEVICETE_DEFAULT_POLLING_DELAY);
+	if ( l_pollInterval == d_pollInterval ) {
+		return;
+	}
+
+	LOG4CPP_INFO(log, "Polling interval updated [%ums => %ums]",
+			d_pollInterval, l_pollInterval);
+
+	d_pollInterval = l_pollInterval;
+
+	// Polling immediately with the new interval
+	wakeup();
+
+}
+
+
+timeout_t DeviceTE::step(void) {
+	exitCode downloadExitCode;
 
-		}
+	// NOTE by setting d_pollInterval==0 we disable the TE polling query
+	if ( !d_pollInterval ) {
+		LOG4CPP_INFO(log, "TE polling disabled");
+		return TASKGENERATOR_STOP;
+	}
 
-// TODO we should use a conditional var with timeout instead of this sleep
-		sleep(d_pollInterval);
+	downloadExitCode = downloadEvents(d_eventsToNotify);
 
+	switch ( downloadExitCode ) {
+		case OK:
+			notifyEvents();
+			break;
+		case TE_NO_NEW_EVENTS:
+			break;
+		case TE_NOT_RESPONDING:
+			LOG4CPP_DEBUG(log, "Device TE not responding");
+			break;
+		case TE_RESTART_DOWNLOAD:
+			LOG4CPP_DEBUG(log, "Retrying download");
+			return 0;
+		default:
+			LOG4CPP_WARN(log, "Anomal result code");
+			break;
 	}
 
-	threadStopNotify();
+	// Waiting for the next polling period
+	return d_pollInterval;
 
 }
 
@@ -34,7 +34,7 @@
 #include <cc++/serial.h>
 #include <controlbox/base/Utility.h>
 #include <controlbox/base/Configurator.h>
-#include <controlbox/base/comsys/CommandGenerator.h>
+#include <controlbox/base/comsys/TaskGenerator.h>
 #include <controlbox/devices/DeviceSerial.h>
 #include <controlbox/devices/DeviceTime.h>
 
@@ -100,8 +100,11 @@ namespace device {
 ///		debug mode</u>, otherwise it will be ignored.<br>
 ///	</li>
 /// </ul>
+/// The TE is polled by the steps of a TaskGenerator. The serial download
+/// could block for long, thus steps run on a dedicated thread instead of
+/// holding an Executor worker.
 /// @see CommandHandler
-class DeviceTE : public comsys::CommandGenerator, public Device  {
+class DeviceTE : public comsys::TaskGenerator, public Device, public ConfigurationHandler  {
 
   public:
 
@@ -170,10 +173,6 @@ class DeviceTE : public comsys::CommandGenerator, public Device  {
 	/// The instance
 	static DeviceTE * d_instance;
 
-	/// Set to true once we want to terminate the polling thread and
-	///	destroying the class
-	bool d_doExit;
-
 	/// The Configurator to use for getting configuration params
 	Configurator & d_config;
 
@@ -186,8 +185,9 @@ class DeviceTE : public comsys::CommandGenerator, public Device  {
 	/// The Time Device to use
 	DeviceTime * d_time;
 
-	/// The polling time [ms]
-	unsigned int d_pollInterval;
+	/// The polling time [ms], 0 to disable polling.
+	/// It could be updated at run-time by configuration changes.
+	volatile unsigned int d_pollInterval;
 
 	/// Number of times to retry read on "device not responding"
 	unsigned short d_retry;
@@ -221,6 +221,9 @@ class DeviceTE : public comsys::CommandGenerator, public Device  {
 	/// Class destructor.
 	~DeviceTE();
 
+	/// Update the polling interval on configuration changes
+	void paramChanged(std::string const & param);
+
   protected:
 
 	/// Create a new DeviceTE initially disabled.
@@ -266,11 +269,11 @@ class DeviceTE : public comsys::CommandGenerator, public Device  {
 
 	inline exitCode notifyEvents(void);
 
-	/// The TE data polling cycle.
-	/// This method it's a simple end-less cycle that:
-	/// sleep for a while and after wake-up querying
-	/// the TE for new data to be downloaded.
-	void   run (void);
+	/// A TE data polling step.
+	/// Query the TE for new data to be downloaded and notify them.
+	/// @return the polling interval, TASKGENERATOR_STOP if polling
+	///		is disabled
+	timeout_t step(void);
 
 };
 
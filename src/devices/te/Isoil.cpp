@@ -194,8 +194,8 @@ Isoil::formatEvent(t_event const & p_event, comsys::Command & cmd) {
 	evt = p_event.event.c_str();
 
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x14;
-	cmd.setParam( "dist_evtType", sbuf.str());
-	cmd.setParam("dist_evtData", evt+1);
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, evt+1);
 	LOG4CPP_DEBUG(log, "RAW SampiTE_550, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				evt+4);
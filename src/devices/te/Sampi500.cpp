@@ -444,9 +444,9 @@ Sampi500::formatEvent_Raw(const char * evt, comsys::Command & cmd) {
 
 	sbuf.str("");
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x29;
-	cmd.setParam( "dist_evtType", sbuf.str());
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
 // 	cmd.setParam("dist_evtType", 0x29);
-	cmd.setParam("dist_evtData", evt+1);
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, evt+1);
 	LOG4CPP_DEBUG(log, "RAW Sampi500_500, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				evt+4);
@@ -469,9 +469,9 @@ Sampi500::formatEvent_PowerUp(const char * evt, comsys::Command & cmd) {
 
 	sbuf.str("");
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x02;
-	cmd.setParam( "dist_evtType", sbuf.str());
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
 // 	cmd.setParam("dist_evtType", 0x02);
-	cmd.setParam("dist_evtData", buf);
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, buf);
 	LOG4CPP_DEBUG(log, "A   Sampi500_500, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				buf);
@@ -517,9 +517,9 @@ Sampi500::formatEvent_Shutdown(const char * evt, comsys::Command & cmd) {
 
 	sbuf.str("");
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x05;
-	cmd.setParam( "dist_evtType", sbuf.str());
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
 // 	cmd.setParam("dist_evtType", 0x05);
-	cmd.setParam("dist_evtData", buf);
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, buf);
 	LOG4CPP_DEBUG(log, "S   Sampi500_500, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				buf);
@@ -556,9 +556,9 @@ Sampi500::formatEvent_Load(const char * evt, comsys::Command & cmd) {
 
 	sbuf.str("");
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x03;
-	cmd.setParam( "dist_evtType", sbuf.str());
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
 // 	cmd.setParam("dist_evtType", 0x03);
-	cmd.setParam("dist_evtData", buf);
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, buf);
 	LOG4CPP_DEBUG(log, "C   Sampi500_500, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				buf);
@@ -637,9 +637,9 @@ Sampi500::formatEvent_Download(const char * evt, comsys::Command & cmd) {
 
 	sbuf.str("");
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x04;
-	cmd.setParam( "dist_evtType", sbuf.str());
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
 // 	cmd.setParam("dist_evtType", 0x04);
-	cmd.setParam("dist_evtData", cbuf);
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, cbuf);
 	LOG4CPP_DEBUG(log, "O   Sampi500_500, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				cbuf);
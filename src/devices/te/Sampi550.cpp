@@ -326,8 +326,8 @@ Sampi550::formatEvent(t_event const & p_event, comsys::Command & cmd) {
 
 // 	sbuf.str("");
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x2A;
-	cmd.setParam( "dist_evtType", sbuf.str());
-	cmd.setParam("dist_evtData", evt+1);
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, evt+1);
 	LOG4CPP_INFO(log, "RAW SampiTE_550, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				evt+4);
@@ -449,9 +449,9 @@ SampiTE::formatEvent_Raw(const char * evt, comsys::Command & cmd) {
 
 	sbuf.str("");
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x14;
-	cmd.setParam( "dist_evtType", sbuf.str());
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
 // 	cmd.setParam("dist_evtType", 0x29);
-	cmd.setParam("dist_evtData", evt+1);
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, evt+1);
 	LOG4CPP_DEBUG(log, "RAW SampiTE_500, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				evt+4);
@@ -474,9 +474,9 @@ SampiTE::formatEvent_PowerUp(const char * evt, comsys::Command & cmd) {
 
 	sbuf.str("");
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x02;
-	cmd.setParam( "dist_evtType", sbuf.str());
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
 // 	cmd.setParam("dist_evtType", 0x02);
-	cmd.setParam("dist_evtData", buf);
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, buf);
 	LOG4CPP_DEBUG(log, "A   SampiTE_500, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				buf);
@@ -522,9 +522,9 @@ SampiTE::formatEvent_Shutdown(const char * evt, comsys::Command & cmd) {
 
 	sbuf.str("");
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x05;
-	cmd.setParam( "dist_evtType", sbuf.str());
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
 // 	cmd.setParam("dist_evtType", 0x05);
-	cmd.setParam("dist_evtData", buf);
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, buf);
 	LOG4CPP_DEBUG(log, "S   SampiTE_500, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				buf);
@@ -561,9 +561,9 @@ SampiTE::formatEvent_Load(const char * evt, comsys::Command & cmd) {
 
 	sbuf.str("");
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x03;
-	cmd.setParam( "dist_evtType", sbuf.str());
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
 // 	cmd.setParam("dist_evtType", 0x03);
-	cmd.setParam("dist_evtData", buf);
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, buf);
 	LOG4CPP_DEBUG(log, "C   SampiTE_500, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				buf);
@@ -642,9 +642,9 @@ SampiTE::formatEvent_Download(const char * evt, comsys::Command & cmd) {
 
 	sbuf.str("");
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x04;
-	cmd.setParam( "dist_evtType", sbuf.str());
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
 // 	cmd.setParam("dist_evtType", 0x04);
-	cmd.setParam("dist_evtData", cbuf);
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, cbuf);
 	LOG4CPP_DEBUG(log, "O   SampiTE_500, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				cbuf);
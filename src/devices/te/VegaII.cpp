@@ -328,8 +328,8 @@ VegaII::formatEvent(t_event const & p_event, comsys::Command & cmd) {
 	evt = p_event.event.c_str();
 
 	sbuf << std::uppercase << std::setw(2) << std::setfill('0') << std::hex << (unsigned)0x2B;
-	cmd.setParam( "dist_evtType", sbuf.str());
-	cmd.setParam("dist_evtData", evt+1);
+	cmd.setParam( comsys::Command::LBL_DIST_EVTTYPE, sbuf.str());
+	cmd.setParam(comsys::Command::LBL_DIST_EVTDATA, evt+1);
 	LOG4CPP_DEBUG(log, "RAW VegaII, DIST-CODE [%s], DATA [%s]",
 				sbuf.str().c_str(),
 				evt+4);
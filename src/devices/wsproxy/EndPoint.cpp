@@ -105,6 +105,56 @@ EndPoint::getEndPoint(unsigned short const type,
 
 }
 
+exitCode
+EndPoint::checkConfiguration(std::string const & paramBase,
+			Configurator & config,
+			log4cpp::Category & log) {
+	std::string epCfg;
+	exitCode result = OK;
+	char * tail;
+	long value;
+
+	// The EndPoint type
+	epCfg = config.param(paramBase, "");
+	value = strtol(epCfg.c_str(), &tail, 0);
+	if ( tail == epCfg.c_str() || *tail ) {
+		LOG4CPP_ERROR(log, "Invalid EndPoint type [%s] on [%s]",
+				epCfg.c_str(), paramBase.c_str());
+		return WS_EP_CFG_ERROR;
+	}
+	if ( value != WS_EP_FILE && value != WS_EP_DIST ) {
+		LOG4CPP_ERROR(log, "Unsupported EndPoint type [%ld] on [%s]",
+				value, paramBase.c_str());
+		return WS_EP_NOT_SUPPORTED;
+	}
+
+	// The EndPoint QueueMask
+	epCfg = config.param(paramBase + "_qmask", "0x0");
+	strtol(epCfg.c_str(), &tail, 0);
+	if ( tail == epCfg.c_str() || *tail ) {
+		LOG4CPP_ERROR(log, "Invalid EndPoint queue mask [%s] on [%s]",
+				epCfg.c_str(), paramBase.c_str());
+		result = WS_EP_CFG_ERROR;
+	}
+
+	// A DIST EndPoint requires a link and a server
+	if ( value == WS_EP_DIST ) {
+		if ( !config.param(paramBase + "_apn", "").size() ) {
+			LOG4CPP_ERROR(log, "No APN defined for DIST Server EndPoint [%s]",
+					paramBase.c_str());
+			result = WS_EP_CFG_ERROR;
+		}
+		if ( !config.param(paramBase + "_srv", "").size() ) {
+			LOG4CPP_ERROR(log, "No server defined for DIST Server EndPoint [%s]",
+					paramBase.c_str());
+			result = WS_EP_CFG_ERROR;
+		}
+	}
+
+	return result;
+
+}
+
 char EndPoint::getQueueLable(unsigned int queue) {
 	unsigned int enabled;
 	unsigned short i;
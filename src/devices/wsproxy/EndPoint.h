@@ -179,6 +179,14 @@ public:
     				std::string const & paramBase,
     				std::string const & logName);
 
+    /// Check an EndPoint configuration, without building it.
+    /// @param paramBase the base of the EndPoint configuration params lables
+    /// @return OK if the EndPoint is valid, WS_EP_NOT_SUPPORTED on unknown
+    ///		types, WS_EP_CFG_ERROR on invalid or missing params
+    static exitCode checkConfiguration(std::string const & paramBase,
+    				Configurator & config,
+    				log4cpp::Category & log);
+
     static unsigned int getEndPointQueuesMask(void) {
 	return d_epEnabledQueueMask;
     }
@@ -146,6 +146,7 @@ exitCode WSProxyCommandHandler::setupCommandParser() {
 
     d_cmdParser[DeviceTE::SEND_TE_EVENT] = &WSProxyCommandHandler::cp_sendTEEvent;
     d_cmdParser[DeviceSignals::SYSTEM_EVENT] = &WSProxyCommandHandler::cp_sendSignalEvent;
+    d_cmdParser[RATE_LIMIT_SUMMARY] = &WSProxyCommandHandler::cp_rateLimitSummary;
 
     return OK;
 }
@@ -236,6 +237,30 @@ exitCode WSProxyCommandHandler::loadEndPoints() {
 	return OK;
 }
 
+exitCode WSProxyCommandHandler::checkConfiguration(Configurator & config, log4cpp::Category & log) {
+	std::ostringstream epCfgLable("");
+	exitCode result = OK;
+	exitCode epResult;
+	short epId;
+
+	// Same EndPoints looked up by loadEndPoints
+	for (epId = WSPROXY_EP_FIRST_ID; epId <= WSPROXY_EP_MAXNUM; epId++) {
+
+		epCfgLable.str("");
+		epCfgLable << "WSProxy_EndPoint_" << epId;
+		if ( !config.param(epCfgLable.str(), "").size() ) {
+			break;
+		}
+
+		epResult = EndPoint::checkConfiguration(epCfgLable.str(), config, log);
+		if ( epResult != OK ) {
+			result = epResult;
+		}
+	}
+
+	return result;
+}
+
 inline
 exitCode WSProxyCommandHandler::initPoller() {
 // 	DeviceFactory * d_devFactory = DeviceFactory::getInstance();
@@ -265,6 +290,11 @@ exitCode WSProxyCommandHandler::initPoller() {
 	d_lastStopTime = 0;
 	updatePoller(false, true);
 
+	// Poll times could be tuned at run-time
+	d_configurator.subscribe("WSProxy_polltime_stopped", this);
+	d_configurator.subscribe("WSProxy_polltime_moving", this);
+	d_configurator.subscribe("WSProxy_polltime_movingwgps", this);
+
 	return OK;
 }
 
@@ -310,6 +340,8 @@ WSProxyCommandHandler::~WSProxyCommandHandler() {
 
     LOG4CPP_INFO(log, "Stopping WSProxyCommandHandler, no more Commands will by uploaded");
 
+    d_configurator.unsubscribe(this);
+
     // Safely terminate the upload thread...
     d_doExit = true;
     if ( isRunning() ) {
@@ -339,13 +371,12 @@ exitCode WSProxyCommandHandler::notify() {
 }
 
 
-exitCode WSProxyCommandHandler::notify(comsys::Command * cmd)
-throw (exceptions::IllegalCommandException) {
+exitCode WSProxyCommandHandler::buildMsg(comsys::Command * cmd, t_wsData ** p_wsData) {
     t_cmdParser::iterator it;
     t_wsData * l_wsData = 0;
     exitCode result;
 
-    LOG4CPP_DEBUG(log, "%s:%d WSProxyCommandHandler::notify(Command * cmd)", __FILE__, __LINE__);
+    (*p_wsData) = 0;
 
     // Checking if the command is supported (aka. a Command Parser has
     // been defined for the current command)
@@ -381,6 +412,24 @@ throw (exceptions::IllegalCommandException) {
 	l_wsData->prio = cmd->getPrio();
 	LOG4CPP_DEBUG(log, "Message prio [%hu]", l_wsData->prio);
 
+	(*p_wsData) = l_wsData;
+
+	return OK;
+
+}
+
+exitCode WSProxyCommandHandler::notify(comsys::Command * cmd)
+throw (exceptions::IllegalCommandException) {
+    t_wsData * l_wsData = 0;
+    exitCode result;
+
+    LOG4CPP_DEBUG(log, "%s:%d WSProxyCommandHandler::notify(Command * cmd)", __FILE__, __LINE__);
+
+	result = buildMsg(cmd, &l_wsData);
+	if ( result != OK || l_wsData == 0 ) {
+		return result;
+	}
+
 	result = queueMsg(*l_wsData);
 	if (result!=OK) {
 		LOG4CPP_WARN(log, "Failed queuing message");
@@ -393,22 +442,57 @@ throw (exceptions::IllegalCommandException) {
 
 }
 
+exitCode WSProxyCommandHandler::notifyBatch(comsys::Command * const * commands, unsigned int count)
+throw (exceptions::IllegalCommandException) {
+    std::vector<t_wsData *> l_msgs;
+    t_wsData * l_wsData;
+    exitCode result = OK;
+    exitCode l_result;
+    unsigned int i;
+
+    LOG4CPP_DEBUG(log, "WSProxyCommandHandler::notifyBatch(count=%u)", count);
+
+	// Building messages out of the upload queues lock
+	l_msgs.reserve(count);
+	for (i=0; i<count; i++) {
+		l_result = buildMsg(commands[i], &l_wsData);
+		if ( l_result != OK && result == OK ) {
+			result = l_result;
+		}
+		if ( l_wsData ) {
+			l_msgs.push_back(l_wsData);
+		}
+	}
+
+	if ( l_msgs.empty() ) {
+		return result;
+	}
+
+	l_result = queueMsgs(&l_msgs[0], l_msgs.size());
+	if ( l_result != OK ) {
+		LOG4CPP_WARN(log, "Failed queuing messages");
+		return l_result;
+	}
+
+	LOG4CPP_DEBUG(log, "Notify of [%u] commands COMPLETED", count);
+
+	return result;
+
+}
+
 unsigned int WSProxyCommandHandler::updatePollTime(void) {
 
 	switch (d_pollState) {
 	case NOT_MOVING:
-		sscanf(d_configurator.param("WSProxy_polltime_stopped", WSPROXY_POLLTIME_NOT_MOVING).c_str(),
-			"%u", &d_pollTime);
+		d_pollTime = d_configurator.paramInt("WSProxy_polltime_stopped", WSPROXY_POLLTIME_NOT_MOVING);
 		LOG4CPP_DEBUG(log, "Configuring POLLTIME for NOT_MOVING");
 		break;
 	case MOVING_NO_GPS:
-		sscanf(d_configurator.param("WSProxy_polltime_moving", WSPROXY_POLLTIME_MOVE_NO_GPS).c_str(),
-			"%u", &d_pollTime);
+		d_pollTime = d_configurator.paramInt("WSProxy_polltime_moving", WSPROXY_POLLTIME_MOVE_NO_GPS);
 		LOG4CPP_DEBUG(log, "Configuring POLLTIME for MOVE_NO_GPS");
 		break;
 	case MOVING_WITH_GPS:
-		sscanf(d_configurator.param("WSProxy_polltime_movingwgps", WSPROXY_POLLTIME_MOVE).c_str(),
-			"%u", &d_pollTime);
+		d_pollTime = d_configurator.paramInt("WSProxy_polltime_movingwgps", WSPROXY_POLLTIME_MOVE);
 		LOG4CPP_DEBUG(log, "Configuring POLLTIME for MOVE");
 		break;
 	}
@@ -424,11 +508,11 @@ unsigned int WSProxyCommandHandler::updatePollTime(void) {
 }
 
 exitCode WSProxyCommandHandler::updatePoller(bool notifyChange, bool force) {
+	ost::MutexLock l_lock(d_pollerLock);
 	t_pollState state = MOVING_NO_GPS;
 	unsigned long stopTime;
 	unsigned minStopTime;
 	unsigned fix = 0;
-	DeviceFactory * d_devFactory;
 	double odoSpeed = 0.0, gpsSpeed = 0.0;
 
 	if (d_devGPS && d_devODO) {
@@ -453,8 +537,7 @@ exitCode WSProxyCommandHandler::updatePoller(bool notifyChange, bool force) {
 			state = NOT_MOVING;
 		} else {
 			stopTime = (std::time(0) - d_lastStopTime);
-			sscanf(d_configurator.param("WSProxy_polltime_minstoptime", WSPROXY_MIN_STOP_TIME).c_str(),
-				"%u", &minStopTime);
+			minStopTime = d_configurator.paramInt("WSProxy_polltime_minstoptime", WSPROXY_MIN_STOP_TIME);
 			if ( stopTime > minStopTime ) {
 				LOG4CPP_DEBUG(log, "More than [%d]s since last stop event", minStopTime);
 				state = NOT_MOVING;
@@ -482,6 +565,19 @@ exitCode WSProxyCommandHandler::updatePoller(bool notifyChange, bool force) {
 	LOG4CPP_DEBUG(log, "Poll state changed to %d", d_pollState);
 
 	updatePollTime();
+	buildPoller();
+
+	if ( notifyChange ) {
+		// Sending a new poll message to represent the state changed
+		notify(d_pollCmd);
+	}
+
+	return OK;
+
+}
+
+void WSProxyCommandHandler::buildPoller(void) {
+	DeviceFactory * d_devFactory;
 
 	// Delete any previous used poller
 	if (d_devPoll) {
@@ -494,14 +590,21 @@ exitCode WSProxyCommandHandler::updatePoller(bool notifyChange, bool force) {
 	d_devPoll->setDispatcher(d_pollCd);
 	d_devPoll->enable();
 
-	if ( notifyChange ) {
-		// Sending a new poll message to represent the state changed
-		notify(d_pollCmd);
-	}
-
 	LOG4CPP_DEBUG(log, "Built new DevicePoller(%d)", d_pollTime*1000);
 
-	return OK;
+}
+
+void WSProxyCommandHandler::paramChanged(std::string const & param) {
+	ost::MutexLock l_lock(d_pollerLock);
+	unsigned l_pollTime = d_pollTime;
+
+	LOG4CPP_INFO(log, "Configuration param [%s] changed", param.c_str());
+
+	// Rebuilding the poller only if the current state poll time changed
+	if ( updatePollTime() == l_pollTime ) {
+		return;
+	}
+	buildPoller();
 
 }
 
@@ -577,31 +680,43 @@ void WSProxyCommandHandler::printQueuesStatus(void) {
 }
 
 exitCode WSProxyCommandHandler::queueMsg(t_wsData & p_wsData) {
-	std::ostringstream queueStatus("");
-// 	unsigned short i;
+	t_wsData * l_msg = &p_wsData;
 
-	if ( p_wsData.prio >= WSPROXY_UPLOAD_QUEUES )
-		p_wsData.prio = (WSPROXY_UPLOAD_QUEUES-1);
+	return queueMsgs(&l_msg, 1);
 
-	LOG4CPP_DEBUG(log, "Queuing message with prio [%d]", p_wsData.prio);
+}
+
+exitCode WSProxyCommandHandler::queueMsgs(t_wsData * const * p_msgs, unsigned int p_count) {
+	bool l_poll = false;
+	unsigned int i;
+
+	for (i=0; i<p_count; i++) {
+		if ( p_msgs[i]->prio >= WSPROXY_UPLOAD_QUEUES )
+			p_msgs[i]->prio = (WSPROXY_UPLOAD_QUEUES-1);
+		// Trigger upload thread only if this is not a queuing-only message
+		if ( p_msgs[i]->prio < WSPROXY_QUEUING_ONLY_PRI )
+			l_poll = true;
+	}
+
+	LOG4CPP_DEBUG(log, "Queuing [%u] messages", p_count);
 
-LOG4CPP_WARN(log, "MUTEX, QN, W...");
 	d_uqMutex.enterMutex();
-LOG4CPP_WARN(log, "MUTEX, QN, A");
 
-	d_uploadQueues[p_wsData.prio].push_front(&p_wsData);
+	for (i=0; i<p_count; i++) {
+		d_uploadQueues[p_msgs[i]->prio].push_front(p_msgs[i]);
+		d_lastLoadedQueue = p_msgs[i]->prio;
+	}
 	d_queuesUpdated = true;
-	d_lastLoadedQueue = p_wsData.prio;
 
 	d_uqMutex.leaveMutex();
-LOG4CPP_WARN(log, "MUTEX, QN, R");
 
-	LOG4CPP_INFO(log, "==> Q%u [%05d:%s]", p_wsData.prio, p_wsData.msgCount, getQueueMask(p_wsData.endPoint).c_str());
+	for (i=0; i<p_count; i++) {
+		LOG4CPP_INFO(log, "==> Q%u [%05d:%s]", p_msgs[i]->prio, p_msgs[i]->msgCount, getQueueMask(p_msgs[i]->endPoint).c_str());
+	}
 
 	printQueuesStatus();
 
-	// Trigger upload thread only if this is not a queuing-only message
-	if ( p_wsData.prio < WSPROXY_QUEUING_ONLY_PRI ) {
+	if ( l_poll ) {
 		LOG4CPP_DEBUG(log, "Polling upload thread...");
 		onPolling();
 	}
@@ -626,11 +741,11 @@ exitCode WSProxyCommandHandler::checkEpCommands(EndPoint::t_epRespList &respList
 			switch (cmd->code) {
 			case EndPoint::EPCMD_CIM:
 				LOG4CPP_INFO(log, "Setting CIM [%s]", (cmd->value).c_str());
-				d_configurator.setParam("CIM", cmd->value);
+				d_configurator.setParam("CIM", cmd->value, true);
 				break;
 			case EndPoint::EPCMD_FRQ:
 				LOG4CPP_INFO(log, "Setting upload frequency [%d]", (cmd->value).c_str());
-				d_configurator.setParam("uploadFreq", cmd->value);
+				d_configurator.setParam("uploadFreq", cmd->value, true);
 				break;
 			default:
 				LOG4CPP_WARN(log, "EndPoint command [%d] with value [%s] not (yet) supported",
@@ -861,11 +976,22 @@ exitCode WSProxyCommandHandler::loadUploadQueueFromFile(std::string const & file
 */
 
 
+exitCode WSProxyCommandHandler::uploadMessage(Heartbeat * heartbeat,
+					t_wsData & msg, t_mgsType type) {
+	// Each upload is a busy section: the ThreadDB monitor reports it
+	// if it takes too long
+	HeartbeatScope l_busy(heartbeat, "upload");
+
+	return callEndPoints(msg, type);
+
+}
+
 void WSProxyCommandHandler::run(void) {
 	// A pointer to a gSOAP message to upload
 	t_uploadList::iterator it;
 	unsigned int qIndex;
 	controlbox::ThreadDB *l_tdb = ThreadDB::getInstance();
+	Heartbeat * l_hb;
 	int l_tid;
 	exitCode result;
 
@@ -874,6 +1000,7 @@ void WSProxyCommandHandler::run(void) {
 
 	this->setName("UQ");
 	result = l_tdb->registerThread(this, l_tid);
+	l_hb = l_tdb->getHeartbeat(l_tid);
 
 	do { // While system is running...
 
@@ -904,17 +1031,14 @@ void WSProxyCommandHandler::run(void) {
 			do {
 				it = d_uploadQueues[d_lastLoadedQueue].begin();
 				if ( it != d_uploadQueues[d_lastLoadedQueue].end() ) {
-					result = callEndPoints( *(*it), WS_MSG_NEW );
+					result = uploadMessage(l_hb, *(*it), WS_MSG_NEW);
 					if (result == OK) {
-LOG4CPP_WARN(log, "MUTEX, UN, W...");
 	d_uqMutex.enterMutex();
-LOG4CPP_WARN(log, "MUTEX, UN, A");
 						// Removing the SOAP message from the upload queue;
 						LOG4CPP_DEBUG(log, "UPLOAD THREAD: removing MOST RECENT message from queue");
 						delete (*it);
 						it = d_uploadQueues[qIndex].erase(it);
 	d_uqMutex.leaveMutex();
-LOG4CPP_WARN(log, "MUTEX, UN, R");
 					}
 					printQueuesStatus();
 				}
@@ -943,17 +1067,14 @@ LOG4CPP_WARN(log, "MUTEX, UN, R");
 				// has been queued, or the system is shutting down...
 				while ( it != d_uploadQueues[qIndex].end() &&
 					!d_queuesUpdated && !d_doExit ) {
-					result = callEndPoints( *(*it), WS_MSG_QUEUED );
+					result = uploadMessage(l_hb, *(*it), WS_MSG_QUEUED);
 					if (result == OK) {
-LOG4CPP_WARN(log, "MUTEX, UQ, W...");
 	d_uqMutex.enterMutex();
-LOG4CPP_WARN(log, "MUTEX, UQ, A");
 						// Removing the SOAP message from the upload queue;
 						LOG4CPP_DEBUG(log, "UPLOAD THREAD: removing message from queue");
 						delete (*it);
 						it = d_uploadQueues[qIndex].erase(it);
 	d_uqMutex.leaveMutex();
-LOG4CPP_WARN(log, "MUTEX, UQ, R");
 					} else {
 						// NOTE the erase already update the iterator to the
 						// next entry! ;-)
@@ -972,8 +1093,9 @@ LOG4CPP_WARN(log, "MUTEX, UQ, R");
 
 	// Terminating the Poll Event Generator
 	delete d_devPoll;
+	// the poll Command is released by its (default) CommandDispatcher
 	delete d_pollCd;
-	delete d_pollCmd;
+	d_pollCmd = 0;
 
 	// Uploading last-one HIGH-PRIORITY message
 	it = d_uploadQueues[0].begin();
@@ -1114,7 +1236,7 @@ exitCode WSProxyCommandHandler::cp_gprsStatusUpdate(t_wsData ** p_wsData, comsys
 
 /*
     try {
-        d_netStatus = (DeviceGPRS::t_netStatus)cmd.getIParam("state");
+        d_netStatus = (DeviceGPRS::t_netStatus)cmd.getIParam(comsys::Command::LBL_STATE);
     } catch (exceptions::UnknowedParamException upe) {
         LOG4CPP_ERROR(log, "Missing [state] param on GPRS_STATUS_UPDATE command processing");
         return WS_MISSING_COMMAND_PARAM;
@@ -1187,6 +1309,8 @@ exitCode  WSProxyCommandHandler::query(Querible::t_query & p_query) {
 
 
 exitCode WSProxyCommandHandler::formatDistEvent(t_wsData ** p_wsData, comsys::Command & cmd, t_idSource src) {
+    DeviceOdometer::t_odoEvent * l_evt;
+    char l_type[3];
 
 
    LOG4CPP_DEBUG(log, "Building new DIST event");
@@ -1194,12 +1318,22 @@ exitCode WSProxyCommandHandler::formatDistEvent(t_wsData ** p_wsData, comsys::Co
     // Building the new wsData element
     (*p_wsData) = newWsData(src);
 
-    strncpy((*p_wsData)->cx_date, cmd.param("timestamp").c_str(), WSPROXY_TIMESTAMP_SIZE);
+    // Typed odometer events are formatted without params lookups
+    l_evt = comsys::TypedCommand<DeviceOdometer::t_odoEvent>::payload(&cmd);
+    if ( l_evt ) {
+        strncpy((*p_wsData)->cx_date, l_evt->timestamp, WSPROXY_TIMESTAMP_SIZE);
+        ((*p_wsData)->cx_date)[WSPROXY_TIMESTAMP_SIZE] = 0;
+        snprintf(l_type, sizeof(l_type), "%02X", l_evt->distType);
+        (*p_wsData)->msg << l_type << ";" << l_evt->distData;
+        return OK;
+    }
+
+    strncpy((*p_wsData)->cx_date, cmd.param(comsys::Command::LBL_TIMESTAMP).c_str(), WSPROXY_TIMESTAMP_SIZE);
     ((*p_wsData)->cx_date)[WSPROXY_TIMESTAMP_SIZE] = 0;
 
     // Appending event data
-    (*p_wsData)->msg << setw(2) << setfill('0') << hex << cmd.param("dist_evtType");
-    (*p_wsData)->msg << ";" << cmd.param("dist_evtData");
+    (*p_wsData)->msg << setw(2) << setfill('0') << hex << cmd.param(comsys::Command::LBL_DIST_EVTTYPE);
+    (*p_wsData)->msg << ";" << cmd.param(comsys::Command::LBL_DIST_EVTDATA);
 
     return OK;
 }
@@ -1449,5 +1583,27 @@ exitCode WSProxyCommandHandler::cp_sendSignalEvent(t_wsData ** p_wsData, comsys:
 
 }
 
+/// Riepilogo degli eventi soppressi dal rate limiting.
+/// The summary carries the last suppressed DIST event, if any, which is
+/// uploaded in place of all the suppressed ones: the last state of the
+/// rate limited source reaches the server.
+exitCode WSProxyCommandHandler::cp_rateLimitSummary(t_wsData ** p_wsData, comsys::Command & cmd) {
+
+	LOG4CPP_DEBUG(log, "Parsing Rate Limit Summary");
+
+	LOG4CPP_WARN(log, "Suppressed [%s] over-limit events of type [%s] from device [%u]",
+			cmd.param(comsys::Command::LBL_VALUE).c_str(),
+			cmd.param(comsys::Command::LBL_TYPE).c_str(),
+			cmd.device());
+
+	if ( !cmd.hasParam(comsys::Command::LBL_DIST_EVTTYPE) ) {
+		*p_wsData = 0; // NO wsData: local command
+		return WS_LOCAL_COMMAND;
+	}
+
+	return formatDistEvent(p_wsData, cmd, WS_SRC_CONC);
+
+}
+
 }// namespace device
 }// namespace controlbox
@@ -38,6 +38,7 @@
 #include <controlbox/base/Querible.h>
 #include <cc++/thread.h>
 #include <controlbox/base/Configurator.h>
+#include <controlbox/base/ThreadDB.h>
 #include <queue>
 #include <controlbox/devices/DeviceTime.h>
 #include <controlbox/devices/DeviceGPS.h>
@@ -126,7 +127,7 @@ namespace device {
 ///	</li>
 /// </ul>
 /// @see CommandHandler
-class WSProxyCommandHandler : public comsys::CommandHandler, public Querible, public ost::PosixThread  {
+class WSProxyCommandHandler : public comsys::CommandHandler, public Querible, public ConfigurationHandler, public ost::PosixThread  {
 
 //------------------------------------------------------------------------------
 //				PUBLIC TYPES
@@ -280,6 +281,10 @@ protected:
 
     unsigned d_pollTime;
 
+    /// Serialize poller updates, which could be triggered by configuration
+    /// changes too
+    ost::Mutex d_pollerLock;
+
     /// Minimum time between successive poll messages
     unsigned d_minPollTime;
 
@@ -355,6 +360,12 @@ public:
 
     static WSProxyCommandHandler * getInstance(std::string const & logName = "WSProxy");
 
+    /// Check the EndPoints configuration, without loading them.
+    /// @return OK if all the defined EndPoints are valid, the error of
+    ///		the last invalid EndPoint otherwise
+    /// @see EndPoint::checkConfiguration
+    static exitCode checkConfiguration(Configurator & config, log4cpp::Category & log);
+
     /// Class destructor.
     ~WSProxyCommandHandler();
 
@@ -373,6 +384,18 @@ public:
     exitCode notify(comsys::Command * cmd)
     throw (exceptions::IllegalCommandException);
 
+    /// Batch command notify routine.
+    /// All the messages built from the specified commands are queued
+    /// with a single lock of the upload queues, and the upload thread
+    /// is polled at most once for the whole batch.
+    /// @param commands the Commands to process
+    /// @param count the number of Commands
+    /// @return OK on success, the first error returned otherwise
+    /// @throw exceptions::IllegalCommandException never throwed by this
+    ///			implementation.
+    exitCode notifyBatch(comsys::Command * const * commands, unsigned int count)
+    throw (exceptions::IllegalCommandException);
+
     /// Start the upload thread.
     /// This method must be called to start uploading messages
     exitCode startUpload();
@@ -384,6 +407,10 @@ public:
 //-----[ Query interface ]------------------------------------------------------
     exitCode query(Querible::t_query & query);
 
+//-----[ Configuration interface ]----------------------------------------------
+    /// Rebuild the poller on poll times changes
+    void paramChanged(std::string const & param);
+
     inline std::string name() const {
         return d_name;
     };
@@ -440,9 +467,12 @@ protected:
     /// Return the poll time for the current device poll state
     unsigned int updatePollTime(void);
 
-    /// Build a new poller
+    /// Update the poll state and, if changed, build a new poller
     exitCode updatePoller(bool notifyChange = true, bool force = false);
 
+    /// Build a new poller using the current poll time
+    void buildPoller(void);
+
     /// Return the actual CIM
     inline std::string getCIM(void);
 
@@ -500,6 +530,19 @@ protected:
     /// @param message the gSOAP message to upload
     exitCode queueMsg(t_wsData & wsData);
 
+    /// Queue a set of SOAP messages to be uploaded to the WebService.
+    /// All the messages are queued with a single lock of the upload
+    /// queues and the upload theread is notified at most once.
+    /// @param msgs the gSOAP messages to upload
+    /// @param count the number of messages
+    exitCode queueMsgs(t_wsData * const * msgs, unsigned int count);
+
+    /// Build the SOAP message for a command.
+    /// @param cmd the command to parse
+    /// @param wsData the built message, 0 for local commands
+    /// @return OK on success
+    exitCode buildMsg(comsys::Command * cmd, t_wsData ** wsData);
+
     /// Check EndPoint piggybacked commands and trigger suitable options.
     exitCode checkEpCommands(EndPoint::t_epRespList &respList);
 
@@ -519,6 +562,11 @@ protected:
     /// @note This class leave message untouched.
     exitCode callEndPoints(t_wsData & p_wsData, t_mgsType p_type = WS_MSG_QUEUED);
 
+    /// Upload a message marking the upload thread busy meanwhile.
+    /// @param heartbeat the upload thread heartbeat, nothing is marked if null
+    /// @see callEndPoints
+    exitCode uploadMessage(Heartbeat * heartbeat, t_wsData & msg, t_mgsType type);
+
     /// Notify EndPoint about upload thread resuming or suspending
     /// @param suspend set true to notify the EndPoint we are suspending
     ///		the upload thread
@@ -585,6 +633,8 @@ protected:
     exitCode cp_sendOdoEvent(t_wsData ** wsData, comsys::Command & cmd);
     /// SYSTEM_EVENT: Eventi generati dal sistema
     exitCode cp_sendSignalEvent(t_wsData ** wsData, comsys::Command & cmd);
+    /// RATE_LIMIT_SUMMARY: Eventi soppressi dal rate limiting
+    exitCode cp_rateLimitSummary(t_wsData ** wsData, comsys::Command & cmd);
 
 };
 